@@ -0,0 +1,667 @@
+/*
+ *   Copyright (c) 2023 Nicola Piccinelli
+ *   All rights reserved.
+ */
+#include <mpc/NLMPC.hpp>
+#include <mpc/Utils.hpp>
+
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Closed-loop performances of a problem solved with an NLopt algorithm
+ */
+struct Outcome
+{
+    double average_ms = 0;
+    double maximum_ms = 0;
+    double cost = 0;
+    int steps = 0;
+    int failures = 0;
+};
+
+/**
+ * @brief Collect the latency of the controller and the closed-loop cost
+ */
+template <typename TController>
+Outcome summarize(TController &controller, double cost, int failures)
+{
+    auto stats = controller.getExecutionStats();
+
+    Outcome out;
+    out.average_ms = stats.averageSolutionTime.count() * 1e3;
+    out.maximum_ms = stats.maxSolutionTime.count() * 1e3;
+    out.cost = cost;
+    out.steps = stats.numberOfSolutions;
+    out.failures = failures;
+    return out;
+}
+
+/**
+ * @brief Van der Pol oscillator of the test cases (test/NLMPC/test_vanderpol.cpp)
+ */
+Outcome vanderpolTest(mpc::NLParameters params)
+{
+    constexpr int num_states = 2;
+    constexpr int num_output = 2;
+    constexpr int num_inputs = 1;
+    constexpr int pred_hor = 10;
+    constexpr int ctrl_hor = 5;
+    constexpr int ineq_c = pred_hor + 1;
+    constexpr int eq_c = 0;
+
+    double ts = 0.1;
+
+    mpc::NLMPC<num_states, num_inputs, num_output, pred_hor, ctrl_hor, ineq_c, eq_c> controller;
+    controller.setLoggerLevel(mpc::Logger::log_level::NONE);
+    controller.setDiscretizationSamplingTime(ts);
+
+    auto stateEq = [](
+                       mpc::cvec<num_states> &dx,
+                       const mpc::cvec<num_states> &x,
+                       const mpc::cvec<num_inputs> &u)
+    {
+        dx(0) = ((1.0 - (x(1) * x(1))) * x(0)) - x(1) + u(0);
+        dx(1) = x(0);
+    };
+
+    controller.setStateSpaceFunction([&](
+                                         mpc::cvec<num_states> &dx,
+                                         const mpc::cvec<num_states> &x,
+                                         const mpc::cvec<num_inputs> &u,
+                                         const unsigned int &)
+                                     { stateEq(dx, x, u); });
+
+    controller.setObjectiveFunction([](
+                                        const mpc::mat<pred_hor + 1, num_states> &x,
+                                        const mpc::mat<pred_hor + 1, num_output> &,
+                                        const mpc::mat<pred_hor + 1, num_inputs> &u,
+                                        double)
+                                    { return x.array().square().sum() + u.array().square().sum(); });
+
+    controller.setIneqConFunction([](
+                                      mpc::cvec<ineq_c> &in_con,
+                                      const mpc::mat<pred_hor + 1, num_states> &,
+                                      const mpc::mat<pred_hor + 1, num_output> &,
+                                      const mpc::mat<pred_hor + 1, num_inputs> &u,
+                                      const double &)
+                                  {
+        for (int i = 0; i < ineq_c; i++) {
+            in_con(i) = u(i, 0) - 0.5;
+        } });
+
+    params.maximum_iteration = 100;
+    params.relative_ftol = 1e-3;
+    params.enable_warm_start = false;
+    controller.setOptimizerParameters(params);
+
+    mpc::cvec<num_states> x, dx;
+    x << 0, 1.0;
+
+    auto r = controller.getLastResult();
+    double cost = 0;
+    int failures = 0;
+    for (int steps = 0; steps < 200; steps++)
+    {
+        r = controller.optimize(x, r.cmd);
+        failures += r.status == mpc::ResultStatus::ERROR;
+        cost += x.squaredNorm() + r.cmd.squaredNorm();
+
+        stateEq(dx, x, r.cmd);
+        x += dx * ts;
+        if (std::fabs(x[0]) <= 1e-2 && std::fabs(x[1]) <= 1e-1)
+        {
+            break;
+        }
+    }
+
+    return summarize(controller, cost, failures);
+}
+
+/**
+ * @brief Discrete time LTI SISO system of the test cases (test/NLMPC/test_discrete_lti_siso.cpp)
+ */
+Outcome discreteLtiSiso(mpc::NLParameters params)
+{
+    constexpr int Tnx = 2;
+    constexpr int Tnu = 1;
+    constexpr int Tny = 1;
+    constexpr int Tph = 10;
+    constexpr int Tch = 5;
+    constexpr int Tineq = (Tph + 1) * 2;
+    constexpr int Teq = 0;
+
+    mpc::NLMPC<Tnx, Tnu, Tny, Tph, Tch, Tineq, Teq> controller;
+    controller.setLoggerLevel(mpc::Logger::log_level::NONE);
+
+    mpc::mat<Tnx, Tnx> A;
+    mpc::mat<Tnx, Tnu> B;
+    mpc::mat<Tny, Tnx> C;
+
+    A << 1, 0,
+        1, 1;
+    B << 1,
+        0;
+    C << 0, 1;
+
+    auto stateEq = [=](
+                       mpc::cvec<Tnx> &xn,
+                       const mpc::cvec<Tnx> &x,
+                       const mpc::cvec<Tnu> &u,
+                       const unsigned int &)
+    {
+        xn = A * x + B * u;
+    };
+    controller.setStateSpaceFunction(stateEq);
+
+    controller.setOutputFunction([=](
+                                     mpc::cvec<Tny> &y,
+                                     const mpc::cvec<Tnx> &x,
+                                     const mpc::cvec<Tnu> &,
+                                     const unsigned int &)
+                                 { y = C * x; });
+
+    controller.setObjectiveFunction([](
+                                        const mpc::mat<Tph + 1, Tnx> &x,
+                                        const mpc::mat<Tph + 1, Tny> &y,
+                                        const mpc::mat<Tph + 1, Tnu> &u,
+                                        const double &)
+                                    { return x.array().square().sum() + u.array().square().sum() + y.array().square().sum(); });
+
+    controller.setIneqConFunction([](
+                                      mpc::cvec<Tineq> &ineq,
+                                      const mpc::mat<Tph + 1, Tnx> &,
+                                      const mpc::mat<Tph + 1, Tny> &,
+                                      const mpc::mat<Tph + 1, Tnu> &u,
+                                      const double &)
+                                  {
+        for (int i = 0; i < Tph + 1; i++)
+        {
+            ineq(i) = u(i) - 0.5;
+            ineq(i + (Tph + 1)) = -u(i) - 7;
+        } });
+
+    params.maximum_iteration = 100;
+    params.relative_ftol = 1e-6;
+    params.enable_warm_start = true;
+    controller.setOptimizerParameters(params);
+
+    mpc::cvec<Tnx> x, xn;
+    x << 10, 0;
+
+    auto r = controller.getLastResult();
+    double cost = 0;
+    int failures = 0;
+    for (int steps = 0; steps < 30; steps++)
+    {
+        r = controller.optimize(x, r.cmd);
+        failures += r.status == mpc::ResultStatus::ERROR;
+        cost += x.squaredNorm() + r.cmd.squaredNorm() + (C * x).squaredNorm();
+
+        stateEq(xn, x, r.cmd, 0);
+        x = xn;
+    }
+
+    return summarize(controller, cost, failures);
+}
+
+/**
+ * @brief Van der Pol oscillator example (examples/vanderpol_ex.cpp)
+ */
+Outcome vanderpolExample(mpc::NLParameters params)
+{
+    constexpr int num_states = 2;
+    constexpr int num_output = 2;
+    constexpr int num_inputs = 1;
+    constexpr int pred_hor = 10;
+    constexpr int ctrl_hor = 5;
+    constexpr int ineq_c = pred_hor + 1;
+    constexpr int eq_c = 0;
+
+    double ts = 0.1;
+
+    mpc::NLMPC<num_states, num_inputs, num_output, pred_hor, ctrl_hor, ineq_c, eq_c> controller;
+    controller.setLoggerLevel(mpc::Logger::log_level::NONE);
+    controller.setDiscretizationSamplingTime(ts);
+
+    params.maximum_iteration = 1000;
+    controller.setOptimizerParameters(params);
+
+    auto stateEq = [](
+                       mpc::cvec<num_states> &dx,
+                       const mpc::cvec<num_states> &x,
+                       const mpc::cvec<num_inputs> &u)
+    {
+        dx(0) = ((1.0 - (x(1) * x(1))) * x(0)) - x(1) + u(0);
+        dx(1) = x(0);
+    };
+
+    controller.setStateSpaceFunction([&](
+                                         mpc::cvec<num_states> &dx,
+                                         const mpc::cvec<num_states> &x,
+                                         const mpc::cvec<num_inputs> &u,
+                                         const unsigned int &)
+                                     { stateEq(dx, x, u); });
+
+    controller.setObjectiveFunction([](
+                                        const mpc::mat<pred_hor + 1, num_states> &x,
+                                        const mpc::mat<pred_hor + 1, num_output> &,
+                                        const mpc::mat<pred_hor + 1, num_inputs> &u,
+                                        double)
+                                    { return x.array().square().sum() + u.array().square().sum(); });
+
+    controller.setIneqConFunction([](
+                                      mpc::cvec<ineq_c> &in_con,
+                                      const mpc::mat<pred_hor + 1, num_states> &,
+                                      const mpc::mat<pred_hor + 1, num_output> &,
+                                      const mpc::mat<pred_hor + 1, num_inputs> &u,
+                                      const double &)
+                                  {
+        for (int i = 0; i < ineq_c; i++) {
+            in_con(i) = u(i, 0) - 0.5;
+        } });
+
+    mpc::cvec<num_states> x, dx;
+    x << 0, 1.0;
+
+    auto r = controller.getLastResult();
+    double cost = 0;
+    int failures = 0;
+    for (int steps = 0; steps < 200; steps++)
+    {
+        r = controller.optimize(x, r.cmd);
+        failures += r.status == mpc::ResultStatus::ERROR;
+        cost += x.squaredNorm() + r.cmd.squaredNorm();
+
+        stateEq(dx, x, r.cmd);
+        x += dx * ts;
+        if (std::fabs(x[0]) <= 1e-2 && std::fabs(x[1]) <= 1e-1)
+        {
+            break;
+        }
+    }
+
+    return summarize(controller, cost, failures);
+}
+
+/**
+ * @brief Coupled Van der Pol oscillators example (examples/networked_oscillators_ex.cpp)
+ */
+Outcome networkedOscillators(mpc::NLParameters params)
+{
+    constexpr int N = 4;
+    constexpr int num_states = 2 * N;
+    constexpr int num_output = 2 * N;
+    constexpr int num_inputs = N;
+    constexpr int pred_hor = 20;
+    constexpr int ctrl_hor = 10;
+    constexpr int ineq_c = pred_hor + 1;
+    constexpr int eq_c = 0;
+
+    double ts = 0.1;
+    double mu = 1.0;
+    double k = 0.1;
+
+    auto dynamics = [=](mpc::cvec<num_states> &dx, const mpc::cvec<num_states> &x, const mpc::cvec<num_inputs> &u)
+    {
+        for (int i = 0; i < N; ++i)
+        {
+            dx(2 * i) = x(2 * i + 1);
+            dx(2 * i + 1) = mu * (1 - x(2 * i) * x(2 * i)) * x(2 * i + 1) - x(2 * i) + u(i);
+
+            for (int j = 0; j < N; ++j)
+            {
+                if (i != j)
+                {
+                    dx(2 * i + 1) += k * (x(2 * j) - x(2 * i));
+                }
+            }
+        }
+    };
+
+    mpc::NLMPC<num_states, num_inputs, num_output, pred_hor, ctrl_hor, ineq_c, eq_c> controller;
+    controller.setLoggerLevel(mpc::Logger::log_level::NONE);
+    controller.setDiscretizationSamplingTime(ts);
+
+    controller.setStateSpaceFunction([&](
+                                         mpc::cvec<num_states> &dx,
+                                         const mpc::cvec<num_states> &x,
+                                         const mpc::cvec<num_inputs> &u,
+                                         const unsigned int &)
+                                     { dynamics(dx, x, u); });
+
+    controller.setObjectiveFunction([](
+                                        const mpc::mat<pred_hor + 1, num_states> &x,
+                                        const mpc::mat<pred_hor + 1, num_output> &,
+                                        const mpc::mat<pred_hor + 1, num_inputs> &u,
+                                        double)
+                                    { return x.array().square().sum() + u.array().square().sum(); });
+
+    controller.setIneqConFunction([](
+                                      mpc::cvec<ineq_c> &in_con,
+                                      const mpc::mat<pred_hor + 1, num_states> &,
+                                      const mpc::mat<pred_hor + 1, num_output> &,
+                                      const mpc::mat<pred_hor + 1, num_inputs> &u,
+                                      const double &)
+                                  {
+        for (int i = 0; i < ineq_c; i++) {
+            in_con(i) = u(i, 0) - 0.5;
+        } });
+
+    controller.setOptimizerParameters(params);
+
+    mpc::cvec<num_states> x, dx;
+    x.setZero();
+    x(0) = 1.0;
+
+    auto r = controller.getLastResult();
+    double cost = 0;
+    int failures = 0;
+    for (int steps = 0; steps < 10; steps++)
+    {
+        r = controller.optimize(x, r.cmd);
+        failures += r.status == mpc::ResultStatus::ERROR;
+        cost += x.squaredNorm() + r.cmd.squaredNorm();
+
+        dynamics(dx, x, r.cmd);
+        x += dx * ts;
+        if (x.array().abs().maxCoeff() < 1e-2)
+        {
+            break;
+        }
+    }
+
+    return summarize(controller, cost, failures);
+}
+
+/**
+ * @brief UGV tracking with obstacles example (examples/ugv_ex.cpp)
+ */
+Outcome ugv(mpc::NLParameters params)
+{
+    constexpr int n_obs = 2;
+
+    constexpr int Tnx = 4;
+    constexpr int Tnu = 2;
+    constexpr int Tny = 4;
+    constexpr int Tph = 10;
+    constexpr int Tch = 10;
+    constexpr int Tineq = (Tph + 1) * n_obs;
+    constexpr int Teq = 0;
+
+    double Ts = 0.1;
+    double speed = 1.0;
+
+    mpc::cvec<2> obs_pos[n_obs];
+    double obs_radius[n_obs] = {0.3, 0.3};
+    obs_pos[0] << 2.0, 1.0;
+    obs_pos[1] << 1.0, 1.0;
+
+    mpc::cvec<2> yref, v_pref;
+    yref << 2.0, 2.0;
+    v_pref.setZero();
+
+    mpc::NLMPC<Tnx, Tnu, Tny, Tph, Tch, Tineq, Teq> controller;
+    controller.setLoggerLevel(mpc::Logger::log_level::NONE);
+
+    mpc::mat<Tnx, Tnx> A;
+    mpc::mat<Tnx, Tnu> B;
+    mpc::mat<Tny, Tnx> C;
+    mpc::mat<Tny, Tnu> D;
+
+    A.setZero();
+    A.block(0, 2, 2, 2).setIdentity();
+    B.setZero();
+    B.block(2, 0, 2, 2).setIdentity();
+    C.setIdentity();
+    D.setZero();
+
+    mpc::mat<Tnx, Tnx> Ad;
+    mpc::mat<Tnx, Tnu> Bd;
+    mpc::mat<Tny, Tnx> Cd;
+    mpc::mat<Tny, Tnu> Dd;
+    mpc::discretization<Tnx, Tnu, Tny>(A, B, C, D, Ts, Ad, Bd, Cd, Dd);
+
+    auto stateEq = [&](
+                       mpc::cvec<Tnx> &xn,
+                       const mpc::cvec<Tnx> &x,
+                       const mpc::cvec<Tnu> &u,
+                       const unsigned int &)
+    {
+        xn = Ad * x + Bd * u;
+    };
+    controller.setStateSpaceFunction(stateEq);
+
+    controller.setObjectiveFunction([&](
+                                        const mpc::mat<Tph + 1, Tnx> &x,
+                                        const mpc::mat<Tph + 1, Tny> &,
+                                        const mpc::mat<Tph + 1, Tnu> &u,
+                                        const double &e)
+                                    {
+        double cost = 0;
+        for (int i = 0; i < Tph + 1; i++)
+        {
+            cost += 1e3 * (x.row(i).segment(2, 2).transpose() - v_pref).squaredNorm();
+            cost += 1e-2 * u.row(i).squaredNorm();
+        }
+        return cost + 1e-5 * e * e; });
+
+    controller.setIneqConFunction([&](
+                                      mpc::cvec<Tineq> &ineq,
+                                      const mpc::mat<Tph + 1, Tnx> &x,
+                                      const mpc::mat<Tph + 1, Tny> &,
+                                      const mpc::mat<Tph + 1, Tnu> &,
+                                      const double &)
+                                  {
+        int index = 0;
+        for (int i = 0; i < Tph + 1; i++)
+        {
+            for (int j = 0; j < n_obs; j++)
+            {
+                mpc::cvec<2> r_pos = x.row(i).segment(0, 2).transpose() - obs_pos[j];
+                ineq(index++) = obs_radius[j] - r_pos.norm();
+            }
+        } });
+
+    params.maximum_iteration = 100;
+    params.hard_constraints = false;
+    params.enable_warm_start = true;
+    controller.setOptimizerParameters(params);
+
+    mpc::cvec<Tnx> x, xn;
+    x.setZero();
+
+    auto r = controller.getLastResult();
+    r.cmd.setZero();
+
+    double cost = 0;
+    int failures = 0;
+    for (int steps = 0; steps < 150; steps++)
+    {
+        r = controller.optimize(x, r.cmd);
+        failures += r.status == mpc::ResultStatus::ERROR;
+        cost += (x.segment(0, 2) - yref).squaredNorm() + 1e-2 * r.cmd.squaredNorm();
+
+        stateEq(xn, x, r.cmd, 0);
+        x = xn;
+
+        v_pref = (yref - x.segment(0, 2)).normalized() * speed;
+        if ((x.segment(0, 2) - yref).norm() < 0.05)
+        {
+            break;
+        }
+    }
+
+    return summarize(controller, cost, failures);
+}
+
+/**
+ * @brief Quadrotor regulation example (examples/quadrotor_ex.cpp) formulated as a
+ * non-linear problem with the same quadratic weights and bounds
+ */
+Outcome quadrotor(mpc::NLParameters params)
+{
+    constexpr int Tnx = 12;
+    constexpr int Tny = 12;
+    constexpr int Tnu = 4;
+    constexpr int Tph = 10;
+    constexpr int Tch = 10;
+    constexpr int Tineq = 0;
+    constexpr int Teq = 0;
+
+    mpc::mat<Tnx, Tnx> Ad;
+    Ad << 1, 0, 0, 0, 0, 0, 0.1, 0, 0, 0, 0, 0,
+        0, 1, 0, 0, 0, 0, 0, 0.1, 0, 0, 0, 0,
+        0, 0, 1, 0, 0, 0, 0, 0, 0.1, 0, 0, 0,
+        0.0488, 0, 0, 1, 0, 0, 0.0016, 0, 0, 0.0992, 0, 0,
+        0, -0.0488, 0, 0, 1, 0, 0, -0.0016, 0, 0, 0.0992, 0,
+        0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0.0992,
+        0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0,
+        0.9734, 0, 0, 0, 0, 0, 0.0488, 0, 0, 0.9846, 0, 0,
+        0, -0.9734, 0, 0, 0, 0, 0, -0.0488, 0, 0, 0.9846, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0.9846;
+
+    mpc::mat<Tnx, Tnu> Bd;
+    Bd << 0, -0.0726, 0, 0.0726,
+        -0.0726, 0, 0.0726, 0,
+        -0.0152, 0.0152, -0.0152, 0.0152,
+        0, -0.0006, -0.0000, 0.0006,
+        0.0006, 0, -0.0006, 0,
+        0.0106, 0.0106, 0.0106, 0.0106,
+        0, -1.4512, 0, 1.4512,
+        -1.4512, 0, 1.4512, 0,
+        -0.3049, 0.3049, -0.3049, 0.3049,
+        0, -0.0236, 0, 0.0236,
+        0.0236, 0, -0.0236, 0,
+        0.2107, 0.2107, 0.2107, 0.2107;
+
+    mpc::cvec<Tny> OutputW, yRef;
+    mpc::cvec<Tnu> InputW;
+    OutputW << 0, 0, 10, 10, 10, 10, 0, 0, 0, 5, 5, 5;
+    InputW << 0.1, 0.1, 0.1, 0.1;
+    yRef << 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0;
+
+    mpc::NLMPC<Tnx, Tnu, Tny, Tph, Tch, Tineq, Teq> controller;
+    controller.setLoggerLevel(mpc::Logger::log_level::NONE);
+
+    auto stateEq = [&](
+                       mpc::cvec<Tnx> &xn,
+                       const mpc::cvec<Tnx> &x,
+                       const mpc::cvec<Tnu> &u,
+                       const unsigned int &)
+    {
+        xn = Ad * x + Bd * u;
+    };
+    controller.setStateSpaceFunction(stateEq);
+
+    controller.setObjectiveFunction([&](
+                                        const mpc::mat<Tph + 1, Tnx> &x,
+                                        const mpc::mat<Tph + 1, Tny> &,
+                                        const mpc::mat<Tph + 1, Tnu> &u,
+                                        const double &)
+                                    {
+        double cost = 0;
+        for (int i = 1; i < Tph + 1; i++)
+        {
+            cost += (x.row(i).transpose() - yRef).cwiseAbs2().dot(OutputW);
+            cost += u.row(i - 1).transpose().cwiseAbs2().dot(InputW);
+        }
+        return cost; });
+
+    mpc::cvec<Tnx> xmin, xmax;
+    xmin << -M_PI / 6, -M_PI / 6, -mpc::inf, -mpc::inf, -mpc::inf, -1,
+        -mpc::inf, -mpc::inf, -mpc::inf, -mpc::inf, -mpc::inf, -mpc::inf;
+    xmax << M_PI / 6, M_PI / 6, mpc::inf, mpc::inf, mpc::inf, mpc::inf,
+        mpc::inf, mpc::inf, mpc::inf, mpc::inf, mpc::inf, mpc::inf;
+
+    mpc::cvec<Tnu> umin, umax;
+    double u0 = 10.5916;
+    umin << 9.6, 9.6, 9.6, 9.6;
+    umin.array() -= u0;
+    umax << 13, 13, 13, 13;
+    umax.array() -= u0;
+
+    controller.setStateBounds(xmin, xmax, mpc::HorizonSlice::all());
+    controller.setInputBounds(umin, umax, mpc::HorizonSlice::all());
+
+    params.maximum_iteration = 250;
+    params.relative_ftol = 1e-6;
+    params.enable_warm_start = true;
+    controller.setOptimizerParameters(params);
+
+    mpc::cvec<Tnx> x, xn;
+    x.setZero();
+
+    auto r = controller.getLastResult();
+    double cost = 0;
+    int failures = 0;
+    for (int steps = 0; steps < 20; steps++)
+    {
+        r = controller.optimize(x, r.cmd);
+        failures += r.status == mpc::ResultStatus::ERROR;
+        cost += (x - yRef).cwiseAbs2().dot(OutputW) + r.cmd.cwiseAbs2().dot(InputW);
+
+        stateEq(xn, x, r.cmd, 0);
+        x = xn;
+    }
+
+    return summarize(controller, cost, failures);
+}
+
+int main()
+{
+    std::vector<std::pair<std::string, std::function<Outcome(mpc::NLParameters)>>> problems = {
+        {"vanderpol (test)", vanderpolTest},
+        {"discrete lti siso (test)", discreteLtiSiso},
+        {"vanderpol", vanderpolExample},
+        {"networked oscillators", networkedOscillators},
+        {"ugv", ugv},
+        {"quadrotor", quadrotor}};
+
+    std::vector<std::pair<std::string, mpc::NLAlgorithm>> algorithms = {
+        {"SLSQP", mpc::NLAlgorithm::SLSQP},
+        {"MMA", mpc::NLAlgorithm::MMA},
+        {"CCSAQ", mpc::NLAlgorithm::CCSAQ},
+        {"AUGLAG/LBFGS", mpc::NLAlgorithm::AUGLAG}};
+
+    std::cout << std::left
+              << std::setw(28) << "problem"
+              << std::setw(16) << "algorithm"
+              << std::right
+              << std::setw(14) << "avg [ms]"
+              << std::setw(14) << "max [ms]"
+              << std::setw(16) << "cost"
+              << std::setw(8) << "steps"
+              << std::setw(10) << "failures"
+              << std::endl;
+
+    for (auto &problem : problems)
+    {
+        for (auto &algorithm : algorithms)
+        {
+            mpc::NLParameters params;
+            params.algorithm = algorithm.second;
+            params.auglag_local_algorithm = mpc::NLAlgorithm::LBFGS;
+
+            auto out = problem.second(params);
+
+            std::cout << std::left
+                      << std::setw(28) << problem.first
+                      << std::setw(16) << algorithm.first
+                      << std::right << std::fixed << std::setprecision(3)
+                      << std::setw(14) << out.average_ms
+                      << std::setw(14) << out.maximum_ms
+                      << std::setw(16) << out.cost
+                      << std::setw(8) << out.steps
+                      << std::setw(10) << out.failures
+                      << std::endl;
+        }
+    }
+
+    return 0;
+}
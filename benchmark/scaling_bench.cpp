@@ -0,0 +1,167 @@
+/*
+ *   Copyright (c) 2023 Nicola Piccinelli
+ *   All rights reserved.
+ */
+#include <mpc/NLMPC.hpp>
+
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+constexpr int num_states = 2;
+constexpr int num_output = 2;
+constexpr int num_inputs = 1;
+constexpr int pred_hor = 10;
+constexpr int ctrl_hor = 5;
+constexpr int ineq_c = 0;
+constexpr int eq_c = 0;
+
+constexpr double ts = 0.1;
+
+// units of the states and of the input, far from the unit magnitude
+constexpr double x0_unit = 100.0;
+constexpr double x1_unit = 0.01;
+constexpr double u_unit = 50.0;
+
+using Controller = mpc::NLMPC<num_states, num_inputs, num_output, pred_hor, ctrl_hor, ineq_c, eq_c>;
+
+/**
+ * @brief Van der Pol oscillator of the example (examples/vanderpol_ex.cpp) with the
+ * states and the input expressed in badly scaled units
+ */
+struct ScaledVanderPol
+{
+    void operator()(
+        mpc::cvec<num_states> &dx,
+        const mpc::cvec<num_states> &x,
+        const mpc::cvec<num_inputs> &u,
+        const unsigned int &) const
+    {
+        double p = x(0) / x0_unit;
+        double q = x(1) / x1_unit;
+        double v = u(0) / u_unit;
+
+        dx(0) = x0_unit * (((1.0 - (q * q)) * p) - q + v);
+        dx(1) = x1_unit * p;
+    }
+};
+
+/**
+ * @brief Closed-loop effort of the controller
+ */
+struct Outcome
+{
+    double average_iterations = 0;
+    double average_ms = 0;
+    double cost = 0;
+    int steps = 0;
+};
+
+/**
+ * @brief Run the closed loop of the scaled vanderpol oscillator with the desired
+ * backend and scaling of the optimization vector
+ */
+Outcome vanderpol(mpc::NLBackend backend, mpc::NLScaling scaling)
+{
+    Controller controller;
+    controller.setLoggerLevel(mpc::Logger::log_level::NONE);
+    controller.setDiscretizationSamplingTime(ts);
+
+    mpc::NLParameters params;
+    params.backend = backend;
+    params.scaling = scaling;
+    params.maximum_iteration = 1000;
+    params.sqp_iterations = 50;
+    params.sqp_step_tolerance = 1e-6;
+    params.enable_warm_start = true;
+    controller.setOptimizerParameters(params);
+
+    ScaledVanderPol stateEq;
+    controller.setStaticStateSpaceFunction(stateEq);
+
+    controller.setObjectiveFunction([](
+                                        const mpc::mat<pred_hor + 1, num_states> &x,
+                                        const mpc::mat<pred_hor + 1, num_output> &,
+                                        const mpc::mat<pred_hor + 1, num_inputs> &u,
+                                        double)
+                                    { return (x.col(0) / x0_unit).squaredNorm() +
+                                             (x.col(1) / x1_unit).squaredNorm() +
+                                             (u / u_unit).squaredNorm(); });
+
+    mpc::cvec<num_states> xmin, xmax;
+    xmin << -5.0 * x0_unit, -5.0 * x1_unit;
+    xmax << 5.0 * x0_unit, 5.0 * x1_unit;
+    controller.setStateBounds(xmin, xmax, mpc::HorizonSlice::all());
+
+    mpc::cvec<num_inputs> umin, umax;
+    umin << -0.5 * u_unit;
+    umax << 0.5 * u_unit;
+    controller.setInputBounds(umin, umax, mpc::HorizonSlice::all());
+
+    Outcome out;
+    mpc::cvec<num_states> x, dx;
+    x << 0, x1_unit;
+
+    auto r = controller.getLastResult();
+    r.cmd.setZero();
+
+    for (int steps = 0; steps < 200; steps++)
+    {
+        r = controller.optimize(x, r.cmd);
+        out.average_iterations += r.iterations;
+        out.cost += (x(0) / x0_unit) * (x(0) / x0_unit) + (x(1) / x1_unit) * (x(1) / x1_unit);
+
+        stateEq(dx, x, r.cmd, 0);
+        x += dx * ts;
+    }
+
+    auto stats = controller.getExecutionStats();
+    out.average_ms = stats.averageSolutionTime.count() * 1e3;
+    out.steps = stats.numberOfSolutions;
+    out.average_iterations /= out.steps;
+    return out;
+}
+
+int main()
+{
+    std::cout << std::left
+              << std::setw(10) << "backend"
+              << std::setw(14) << "scaling"
+              << std::right
+              << std::setw(12) << "iterations"
+              << std::setw(14) << "avg [ms]"
+              << std::setw(16) << "cost"
+              << std::setw(8) << "steps"
+              << std::endl;
+
+    std::vector<std::pair<std::string, mpc::NLBackend>> backends = {
+        {"SQP", mpc::NLBackend::SQP},
+        {"NLOPT", mpc::NLBackend::NLOPT}};
+
+    std::vector<std::pair<std::string, mpc::NLScaling>> scalings = {
+        {"manual", mpc::NLScaling::MANUAL},
+        {"bounds", mpc::NLScaling::BOUNDS},
+        {"trajectory", mpc::NLScaling::TRAJECTORY}};
+
+    for (auto &backend : backends)
+    {
+        for (auto &scaling : scalings)
+        {
+            auto out = vanderpol(backend.second, scaling.second);
+
+            // the NLopt backend reports the number of objective function evaluations
+            std::cout << std::left
+                      << std::setw(10) << backend.first
+                      << std::setw(14) << scaling.first
+                      << std::right << std::fixed << std::setprecision(3)
+                      << std::setw(12) << out.average_iterations
+                      << std::setw(14) << out.average_ms
+                      << std::setw(16) << out.cost
+                      << std::setw(8) << out.steps
+                      << std::endl;
+        }
+    }
+
+    return 0;
+}
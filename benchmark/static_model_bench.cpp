@@ -0,0 +1,193 @@
+/*
+ *   Copyright (c) 2023 Nicola Piccinelli
+ *   All rights reserved.
+ */
+#include <mpc/NLMPC.hpp>
+
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+constexpr int num_states = 2;
+constexpr int num_output = 2;
+constexpr int num_inputs = 1;
+constexpr int pred_hor = 10;
+constexpr int ctrl_hor = 5;
+constexpr int ineq_c = pred_hor + 1;
+constexpr int eq_c = 0;
+
+constexpr double ts = 0.1;
+constexpr int repetitions = 20;
+
+using Controller = mpc::NLMPC<num_states, num_inputs, num_output, pred_hor, ctrl_hor, ineq_c, eq_c>;
+
+/**
+ * @brief Van der Pol oscillator of the example (examples/vanderpol_ex.cpp)
+ */
+struct VanderPol
+{
+    void operator()(
+        mpc::cvec<num_states> &dx,
+        const mpc::cvec<num_states> &x,
+        const mpc::cvec<num_inputs> &u,
+        const unsigned int &) const
+    {
+        dx(0) = ((1.0 - (x(1) * x(1))) * x(0)) - x(1) + u(0);
+        dx(1) = x(0);
+    }
+};
+
+/**
+ * @brief Van der Pol oscillator evaluated on packets of points (one point for each column)
+ */
+struct VanderPolPacket
+{
+    template <typename TX, typename TU, typename TSteps>
+    void operator()(TX &dx, const TX &x, const TU &u, const TSteps &) const
+    {
+        dx.row(0) = ((1.0 - x.row(1).square()) * x.row(0)) - x.row(1) + u.row(0);
+        dx.row(1) = x.row(0);
+    }
+};
+
+/**
+ * @brief Registration of the state space function
+ */
+enum class Registration
+{
+    HANDLE,
+    STATIC,
+    PACKET
+};
+
+/**
+ * @brief Closed-loop latency of the controller
+ */
+struct Outcome
+{
+    double average_ms = 0;
+    double maximum_ms = 0;
+    double cost = 0;
+    int steps = 0;
+};
+
+/**
+ * @brief Run the closed loop of the vanderpol example, the state space function is
+ * registered as a std::function handle, as a statically dispatched callable or on packets
+ */
+Outcome vanderpol(Registration registration)
+{
+    Controller controller;
+    controller.setLoggerLevel(mpc::Logger::log_level::NONE);
+    controller.setDiscretizationSamplingTime(ts);
+
+    mpc::NLParameters params;
+    params.maximum_iteration = 1000;
+    controller.setOptimizerParameters(params);
+
+    VanderPol stateEq;
+    switch (registration)
+    {
+    case Registration::STATIC:
+        controller.setStaticStateSpaceFunction(stateEq);
+        break;
+    case Registration::PACKET:
+        controller.setPacketStateSpaceFunction(VanderPolPacket());
+        break;
+    default:
+        controller.setStateSpaceFunction(stateEq);
+        break;
+    }
+
+    controller.setObjectiveFunction([](
+                                        const mpc::mat<pred_hor + 1, num_states> &x,
+                                        const mpc::mat<pred_hor + 1, num_output> &,
+                                        const mpc::mat<pred_hor + 1, num_inputs> &u,
+                                        double)
+                                    { return x.array().square().sum() + u.array().square().sum(); });
+
+    controller.setIneqConFunction([](
+                                      mpc::cvec<ineq_c> &in_con,
+                                      const mpc::mat<pred_hor + 1, num_states> &,
+                                      const mpc::mat<pred_hor + 1, num_output> &,
+                                      const mpc::mat<pred_hor + 1, num_inputs> &u,
+                                      const double &)
+                                  {
+        for (int i = 0; i < ineq_c; i++) {
+            in_con(i) = u(i, 0) - 0.5;
+        } });
+
+    Outcome out;
+    for (int k = 0; k < repetitions; k++)
+    {
+        mpc::cvec<num_states> x, dx;
+        x << 0, 1.0;
+
+        auto r = controller.getLastResult();
+        r.cmd.setZero();
+
+        for (int steps = 0; steps < 500; steps++)
+        {
+            r = controller.optimize(x, r.cmd);
+            out.cost += x.squaredNorm() + r.cmd.squaredNorm();
+
+            stateEq(dx, x, r.cmd, 0);
+            x += dx * ts;
+            if (std::fabs(x[0]) <= 1e-2 && std::fabs(x[1]) <= 1e-1)
+            {
+                break;
+            }
+        }
+    }
+
+    auto stats = controller.getExecutionStats();
+    out.average_ms = stats.averageSolutionTime.count() * 1e3;
+    out.maximum_ms = stats.maxSolutionTime.count() * 1e3;
+    out.cost /= repetitions;
+    out.steps = stats.numberOfSolutions;
+    return out;
+}
+
+int main()
+{
+    std::cout << std::left
+              << std::setw(20) << "state space"
+              << std::right
+              << std::setw(14) << "avg [ms]"
+              << std::setw(14) << "max [ms]"
+              << std::setw(16) << "cost"
+              << std::setw(8) << "steps"
+              << std::endl;
+
+    std::vector<std::pair<std::string, Registration>> registrations = {
+        {"std::function", Registration::HANDLE},
+        {"static", Registration::STATIC},
+        {"packet", Registration::PACKET}};
+
+    double reference = 0;
+    for (auto &registration : registrations)
+    {
+        auto out = vanderpol(registration.second);
+
+        std::cout << std::left
+                  << std::setw(20) << registration.first
+                  << std::right << std::fixed << std::setprecision(3)
+                  << std::setw(14) << out.average_ms
+                  << std::setw(14) << out.maximum_ms
+                  << std::setw(16) << out.cost
+                  << std::setw(8) << out.steps
+                  << std::endl;
+
+        if (registration.second == Registration::HANDLE)
+        {
+            reference = out.average_ms;
+        }
+        else
+        {
+            std::cout << "speedup: " << reference / out.average_ms << std::endl;
+        }
+    }
+
+    return 0;
+}
@@ -97,6 +97,21 @@ namespace mpc
             const mat<sizer.ph + 1, sizer.nu> &,
             const double &)>;
 
+        /**
+         * @brief User-defined function handle for the non-linear MPC
+         * objective function in residual form. The arguments of the function
+         * are the residual vector (already sized with the number of residuals
+         * declared at registration), the state, output and input vectors
+         * along the horizon while the last term is the slack variable.
+         * The objective function is half the squared norm of the residuals
+         */
+        using ResFunHandle = std::function<void(
+            cvec<> &,
+            const mat<sizer.ph + 1, sizer.nx> &,
+            const mat<sizer.ph + 1, sizer.ny> &,
+            const mat<sizer.ph + 1, sizer.nu> &,
+            const double &)>;
+
         /**
          * @brief User-defined function handle for the non-linear MPC
          * inequality constraints function. The arguments of the function 
@@ -148,6 +163,89 @@ namespace mpc
             const cvec<sizer.nu> &,
             const unsigned int &)>;
 
+        /**
+         * @brief User-defined function handle for the non-linear MPC
+         * dynamical system model evaluated on a batch of points. The arguments
+         * of the function are the matrix of the vector fields (or next states),
+         * the matrices of the states and of the inputs and the steps of the
+         * horizon, one column (or element) for each point of the batch
+         */
+        using BatchStateFunHandle = std::function<void(
+            mat<sizer.nx, Eigen::Dynamic> &,
+            const mat<sizer.nx, Eigen::Dynamic> &,
+            const mat<sizer.nu, Eigen::Dynamic> &,
+            const std::vector<unsigned int> &)>;
+
+        /**
+         * @brief Parametric variant of the objective function handle. The last
+         * argument is the preview parameters table (one column for each step
+         * of the horizon) owned by the controller
+         */
+        using ParamObjFunHandle = std::function<double(
+            const mat<sizer.ph + 1, sizer.nx> &,
+            const mat<sizer.ph + 1, sizer.ny> &,
+            const mat<sizer.ph + 1, sizer.nu> &,
+            const double &,
+            const mat<> &)>;
+
+        /**
+         * @brief Parametric variant of the residual function handle. The last
+         * argument is the preview parameters table
+         */
+        using ParamResFunHandle = std::function<void(
+            cvec<> &,
+            const mat<sizer.ph + 1, sizer.nx> &,
+            const mat<sizer.ph + 1, sizer.ny> &,
+            const mat<sizer.ph + 1, sizer.nu> &,
+            const double &,
+            const mat<> &)>;
+
+        /**
+         * @brief Parametric variant of the inequality constraints function handle.
+         * The last argument is the preview parameters table
+         */
+        using ParamIConFunHandle = std::function<void(
+            cvec<sizer.ineq> &,
+            const mat<sizer.ph + 1, sizer.nx> &,
+            const mat<sizer.ph + 1, sizer.ny> &,
+            const mat<sizer.ph + 1, sizer.nu> &,
+            const double &,
+            const mat<> &)>;
+
+        /**
+         * @brief Parametric variant of the equality constraints function handle.
+         * The last argument is the preview parameters table
+         */
+        using ParamEConFunHandle = std::function<void(
+            cvec<sizer.eq> &,
+            const mat<sizer.ph + 1, sizer.nx> &,
+            const mat<sizer.ph + 1, sizer.nu> &,
+            const mat<> &)>;
+
+        /**
+         * @brief Parametric variant of the dynamical system model handle. The last
+         * argument is the preview parameters table, the column of the current
+         * step is selected with the step argument
+         */
+        using ParamStateFunHandle = std::function<void(
+            cvec<sizer.nx> &,
+            const cvec<sizer.nx> &,
+            const cvec<sizer.nu> &,
+            const unsigned int &,
+            const mat<> &)>;
+
+        /**
+         * @brief Parametric variant of the dynamical system output model handle.
+         * The last argument is the preview parameters table, the column of the
+         * current step is selected with the step argument
+         */
+        using ParamOutFunHandle = std::function<void(
+            cvec<sizer.ny> &,
+            const cvec<sizer.nx> &,
+            const cvec<sizer.nu> &,
+            const unsigned int &,
+            const mat<> &)>;
+
     private:
         size_t runtime_size_nx;
         size_t runtime_size_nu;
@@ -4,6 +4,7 @@
  */
 #pragma once
 
+#include <atomic>
 #include <iostream>
 #include <ostream>
 #include <string>
@@ -72,8 +73,8 @@ namespace mpc
          */
         Logger &log(log_type type)
         {
-            Logger::instance().currentType = type;
-            if ((int)Logger::instance().thresholdLevel <= (int)Logger::instance().currentType) {
+            currentType = type;
+            if (isEnabled()) {
                 *(Logger::instance().os) << "[MPC++";
                 if (!Logger::instance().prefix.empty())
                 {
@@ -127,7 +128,7 @@ namespace mpc
         template <typename T>
         Logger &operator<<(const T &x)
         {
-            if ((int)thresholdLevel <= (int)currentType) {
+            if (isEnabled()) {
                 *os << x;
             }
 
@@ -136,13 +137,38 @@ namespace mpc
 
         Logger &operator<<(std::ostream &(*f)(std::ostream &o))
         {
-            if ((int)thresholdLevel <= (int)currentType) {
+            if (isEnabled()) {
                 *os << f;
             }
 
             return *this;
         };
 
+        /**
+         * @brief Silence the messages of the current thread while in scope, the worker
+         * threads of the optimizer are muted so that their messages are not interleaved
+         * with the ones of the calling thread
+         */
+        class ThreadMute
+        {
+        public:
+            ThreadMute() : previous(muted)
+            {
+                muted = true;
+            }
+
+            ~ThreadMute()
+            {
+                muted = previous;
+            }
+
+            ThreadMute(const ThreadMute &) = delete;
+            ThreadMute &operator=(const ThreadMute &) = delete;
+
+        private:
+            bool previous;
+        };
+
     private:
         /**
          * @brief Construct a new Logger, currently the output stream is forced to be
@@ -163,13 +189,24 @@ namespace mpc
             thresholdLevel = log_level::NORMAL;
         }
 
+        /**
+         * @brief Return if the message being logged by the current thread is printed
+         */
+        bool isEnabled() const
+        {
+            return !muted && (int)thresholdLevel.load() <= (int)currentType;
+        }
+
         Logger(const Logger &) = delete;
         Logger &operator=(const Logger &) = delete;
 
         std::ostream *os;
         std::string prefix;
-        log_level thresholdLevel;
-        log_type currentType;
+        std::atomic<log_level> thresholdLevel;
+
+        // the type of the message being logged is tracked for each thread
+        inline static thread_local log_type currentType = log_type::DETAIL;
+        inline static thread_local bool muted = false;
     };
 
 } // namespace mpc
\ No newline at end of file
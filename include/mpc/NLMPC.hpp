@@ -152,6 +152,35 @@ namespace mpc
             return res;
         }
 
+        /**
+         * @brief Set the handler to the function defining the objective function in
+         * residual form (the objective function is half the squared norm of the residuals).
+         * The second order backends (SQP and IPM) use the Gauss-Newton approximation
+         * of the hessian built from the Jacobian of the residuals
+         *
+         * @param handle function handler
+         * @param nres number of residuals
+         * @return true
+         * @return false
+         */
+        bool setResidualFunction(
+            const typename IDimensionable<MPCSize(Tnx, Tnu, 0, Tny, Tph, Tch, Tineq, Teq)>::ResFunHandle handle,
+            const int nres)
+        {
+            Logger::instance().log(Logger::log_type::DETAIL)
+                << "Setting residual objective function handle"
+                << std::endl;
+
+            auto res = objF->setResidual(handle, nres);
+
+            Logger::instance().log(Logger::log_type::DETAIL)
+                << "Binding objective function handle"
+                << std::endl;
+
+            ((NLOptimizer<MPCSize(Tnx, Tnu, 0, Tny, Tph, Tch, Tineq, Teq)> *)optPtr)->bindObjective();
+            return res;
+        }
+
         /**
          * @brief Set the handler to the function defining the state space update function.
          * Based on the type of system (continuous or discrete) you should provide the appropriate
@@ -165,31 +194,102 @@ namespace mpc
         bool setStateSpaceFunction(const typename IDimensionable<MPCSize(Tnx, Tnu, 0, Tny, Tph, Tch, Tineq, Teq)>::StateFunHandle handle,
                                    const float eq_tol = 1e-10)
         {
-            cvec<2 * Size(Tph) * Size(Tny)> ineq_tol_vec;
-            COND_RESIZE_CVEC(MPCSize(Tnx, Tnu, 0, Tny, Tph, Tch, Tineq, Teq), ineq_tol_vec, (2 * ph() * ny()));
-            ineq_tol_vec.setOnes();
-
-            cvec<(Size(Tph) * Size(Tnx))> eq_tol_vec;
-            COND_RESIZE_CVEC(MPCSize(Tnx, Tnu, 0, Tny, Tph, Tch, Tineq, Teq), eq_tol_vec, (ph() * nx()));
-            eq_tol_vec.setOnes();
-
             Logger::instance().log(Logger::log_type::DETAIL)
                 << "Setting state space function handle"
                 << std::endl;
 
             bool res = model->setStateModel(handle);
+            return res & bindStateSpace(eq_tol);
+        }
 
-            objF->setModel(model, mapping);
-            conF->setModel(model, mapping);
-            ((NLOptimizer<MPCSize(Tnx, Tnu, 0, Tny, Tph, Tch, Tineq, Teq)> *)optPtr)->setModel(model, mapping);
+        /**
+         * @brief Set the handler to the function defining the state space update function
+         * evaluated on a batch of points. The function receives the states, the inputs and
+         * the steps of the horizon of the points (one column for each point) and fills the
+         * vector fields (or next states) of all the points with a single call. The system's
+         * dynamics constraints and their finite differences Jacobian are evaluated in batches
+         *
+         * @param handle function handler
+         * @param eq_tol equality constraints tolerances (default 1e-10)
+         * @return true
+         * @return false
+         */
+        bool setBatchStateSpaceFunction(const typename IDimensionable<MPCSize(Tnx, Tnu, 0, Tny, Tph, Tch, Tineq, Teq)>::BatchStateFunHandle handle,
+                                        const float eq_tol = 1e-10)
+        {
+            Logger::instance().log(Logger::log_type::DETAIL)
+                << "Setting batched state space function handle"
+                << std::endl;
+
+            bool res = model->setBatchStateModel(handle);
+            return res & bindStateSpace(eq_tol);
+        }
 
+        /**
+         * @brief Set the function defining the state space update function as a callable
+         * whose type is a template parameter (e.g. a lambda or a functor with the signature of
+         * the state space function handle). The callable is wrapped in a batched state space
+         * function, so that within a batch (e.g. the finite differences of the whole horizon)
+         * the calls are statically dispatched and can be inlined by the compiler
+         *
+         * @tparam TStateFun type of the callable
+         * @param fun state space update function
+         * @param eq_tol equality constraints tolerances (default 1e-10)
+         * @return true
+         * @return false
+         */
+        template <typename TStateFun>
+        bool setStaticStateSpaceFunction(TStateFun fun, const float eq_tol = 1e-10)
+        {
             Logger::instance().log(Logger::log_type::DETAIL)
-                << "Binding state space constraints"
+                << "Setting static state space function"
                 << std::endl;
 
-            res = res & ((NLOptimizer<MPCSize(Tnx, Tnu, 0, Tny, Tph, Tch, Tineq, Teq)> *)optPtr)->bindEq(constraints_type::EQ, eq_tol_vec * eq_tol);
+            auto batch = [fun](
+                             mat<Tnx, Eigen::Dynamic> &F,
+                             const mat<Tnx, Eigen::Dynamic> &X,
+                             const mat<Tnu, Eigen::Dynamic> &U,
+                             const std::vector<unsigned int> &steps)
+            {
+                cvec<Tnx> f(X.rows()), x(X.rows());
+                cvec<Tnu> u(U.rows());
+
+                for (size_t j = 0; j < steps.size(); j++)
+                {
+                    x = X.col(j);
+                    u = U.col(j);
+                    fun(f, x, u, steps[j]);
+                    F.col(j) = f;
+                }
+            };
+
+            bool res = model->setBatchStateModel(batch, fun);
+            return res & bindStateSpace(eq_tol);
+        }
 
-            return res;
+        /**
+         * @brief Set the function defining the state space update function evaluated on
+         * packets of points. The function is generic on the type of its arguments, which are
+         * arrays with one column (lane) for each point and contiguous rows, plus the steps of
+         * the horizon of the lanes. The finite differences of the system's dynamics evaluate
+         * as many perturbations as the lanes with each call, the lanes are fixed at compile time
+         * by the width of the Eigen packets (see Model::packetLanes, 2 with the default flags)
+         *
+         * @tparam TPacketFun type of the callable
+         * @param fun state space update function
+         * @param eq_tol equality constraints tolerances (default 1e-10)
+         * @return true
+         * @return false
+         */
+        template <typename TPacketFun>
+        bool setPacketStateSpaceFunction(TPacketFun fun, const float eq_tol = 1e-10)
+        {
+            Logger::instance().log(Logger::log_type::DETAIL)
+                << "Setting packet state space function"
+                << std::endl;
+
+            bool res = model->setPacketStateModel(fun);
+            return res & bindStateSpace(eq_tol);
         }
 
         /**
@@ -251,13 +351,180 @@ namespace mpc
             const typename IDimensionable<MPCSize(Tnx, Tnu, 0, Tny, Tph, Tch, Tineq, Teq)>::EConFunHandle handle, const float tol = 1e-10)
         {
             cvec<Teq> tol_vec;
-            tol_vec = cvec<Teq>::Ones(Size(Teq));
+            tol_vec = cvec<Teq>::Ones(eq());
 
             auto res = conF->setEqConstraints(handle, tol);
             ((NLOptimizer<MPCSize(Tnx, Tnu, 0, Tny, Tph, Tch, Tineq, Teq)> *)optPtr)->bindUserEq(constraints_type::UEQ, tol_vec * tol);
             return res;
         }
 
+        /**
+         * @brief Set the handler to the parametric objective function. The preview
+         * parameters table is passed as last argument to the handler
+         *
+         * @param handle function handler
+         * @return true
+         * @return false
+         */
+        bool setObjectiveFunction(const typename IDimensionable<MPCSize(Tnx, Tnu, 0, Tny, Tph, Tch, Tineq, Teq)>::ParamObjFunHandle handle)
+        {
+            return setObjectiveFunction(
+                [handle, P = &previewParams](
+                    const auto &x, const auto &y,
+                    const auto &u, const double &e)
+                { return handle(x, y, u, e, *P); });
+        }
+
+        /**
+         * @brief Set the handler to the parametric objective function in residual
+         * form. The preview parameters table is passed as last argument to the handler
+         *
+         * @param handle function handler
+         * @param nres number of residuals
+         * @return true
+         * @return false
+         */
+        bool setResidualFunction(const typename IDimensionable<MPCSize(Tnx, Tnu, 0, Tny, Tph, Tch, Tineq, Teq)>::ParamResFunHandle handle, const int nres)
+        {
+            return setResidualFunction(
+                [handle, P = &previewParams](
+                    cvec<> &r, const auto &x, const auto &y,
+                    const auto &u, const double &e)
+                { handle(r, x, y, u, e, *P); },
+                nres);
+        }
+
+        /**
+         * @brief Set the handler to the parametric state space update function. The
+         * preview parameters table is passed as last argument to the handler
+         *
+         * @param handle function handler
+         * @param eq_tol equality constraints tolerances (default 1e-10)
+         * @return true
+         * @return false
+         */
+        bool setStateSpaceFunction(const typename IDimensionable<MPCSize(Tnx, Tnu, 0, Tny, Tph, Tch, Tineq, Teq)>::ParamStateFunHandle handle,
+                                   const float eq_tol = 1e-10)
+        {
+            return setStateSpaceFunction(
+                [handle, P = &previewParams](
+                    cvec<Tnx> &dx, const cvec<Tnx> &x, const cvec<Tnu> &u, const unsigned int &k)
+                { handle(dx, x, u, k, *P); },
+                eq_tol);
+        }
+
+        /**
+         * @brief Set the handler to the parametric output function. The preview
+         * parameters table is passed as last argument to the handler
+         *
+         * @param handle function handler
+         * @return true
+         * @return false
+         */
+        bool setOutputFunction(const typename IDimensionable<MPCSize(Tnx, Tnu, 0, Tny, Tph, Tch, Tineq, Teq)>::ParamOutFunHandle handle)
+        {
+            return setOutputFunction(
+                [handle, P = &previewParams](
+                    cvec<Tny> &y, const cvec<Tnx> &x, const cvec<Tnu> &u, const unsigned int &k)
+                { handle(y, x, u, k, *P); });
+        }
+
+        /**
+         * @brief Set the handler to the parametric user inequality constraints function.
+         * The preview parameters table is passed as last argument to the handler
+         *
+         * @param handle function handler
+         * @param tol inequality constraints tolerances (default 1e-10)
+         * @return true
+         * @return false
+         */
+        bool setIneqConFunction(const typename IDimensionable<MPCSize(Tnx, Tnu, 0, Tny, Tph, Tch, Tineq, Teq)>::ParamIConFunHandle handle, const float tol = 1e-10)
+        {
+            return setIneqConFunction(
+                [handle, P = &previewParams](
+                    cvec<Tineq> &c, const auto &x, const auto &y,
+                    const auto &u, const double &e)
+                { handle(c, x, y, u, e, *P); },
+                tol);
+        }
+
+        /**
+         * @brief Set the handler to the parametric user equality constraints function.
+         * The preview parameters table is passed as last argument to the handler
+         *
+         * @param handle function handler
+         * @param tol equality constraints tolerances (default 1e-10)
+         * @return true
+         * @return false
+         */
+        bool setEqConFunction(const typename IDimensionable<MPCSize(Tnx, Tnu, 0, Tny, Tph, Tch, Tineq, Teq)>::ParamEConFunHandle handle, const float tol = 1e-10)
+        {
+            return setEqConFunction(
+                [handle, P = &previewParams](
+                    cvec<Teq> &c, const auto &x, const auto &u)
+                { handle(c, x, u, *P); },
+                tol);
+        }
+
+        /**
+         * @brief Set the number of preview parameters. The preview parameters table
+         * has one row for each parameter and one column for each step of the horizon
+         * (ph + 1 columns) and it is zero initialized. The table is allocated once here
+         * and it is then updated in place before each optimization
+         *
+         * @param np number of parameters
+         * @return true
+         * @return false
+         */
+        bool setPreviewParametersSize(const int np)
+        {
+            if (np < 0)
+            {
+                Logger::instance().log(Logger::log_type::ERROR)
+                    << "The number of preview parameters must be non-negative"
+                    << std::endl;
+                return false;
+            }
+
+            previewParams = mat<>::Zero(np, ph() + 1);
+            return true;
+        }
+
+        /**
+         * @brief Get a reference to the preview parameters table, the table can be
+         * updated in place (e.g. with the forecast of a disturbance) without any
+         * rebinding of the user functions
+         *
+         * @return mat<>& preview parameters table
+         */
+        mat<> &previewParameters()
+        {
+            return previewParams;
+        }
+
+        /**
+         * @brief Set the preview parameters table. The values are copied in the
+         * table allocated by setPreviewParametersSize
+         *
+         * @param P preview parameters table (np x ph + 1)
+         * @return true
+         * @return false
+         */
+        bool setPreviewParameters(const mat<> &P)
+        {
+            if (P.rows() != previewParams.rows() || P.cols() != previewParams.cols())
+            {
+                Logger::instance().log(Logger::log_type::ERROR)
+                    << "Preview parameters table size mismatch, expected "
+                    << previewParams.rows() << "x" << previewParams.cols()
+                    << std::endl;
+                return false;
+            }
+
+            previewParams.noalias() = P;
+            return true;
+        }
+
         /**
          * @brief Set the state constraints, on the entire horizon length.
          * These constraints are defined as box constraints for the state, input, and output variables
@@ -395,6 +662,55 @@ namespace mpc
             throw std::runtime_error("Output constraints cannot be set for this type of MPC");
         }
 
+        /**
+         * @brief Perform the preparation phase of the real-time iteration scheme.
+         * This method should be called after the optimal command has been applied
+         * and before the new state measurement is available, in this way the next
+         * call to optimize only solves the already linearized sub-problem. This is
+         * available only for the SQP backend (see NLParameters::backend)
+         *
+         * @return true if the preparation phase has been performed
+         * @return false if the backend is not SQP or no previous solution is available
+         */
+        bool prepare()
+        {
+            return ((NLOptimizer<MPCSize(Tnx, Tnu, 0, Tny, Tph, Tch, Tineq, Teq)> *)optPtr)->prepare();
+        }
+
+        /**
+         * @brief Get the multipliers of the constraints of the last optimal solution, in
+         * the order system's dynamics (ph * nx), user inequality and user equality constraints.
+         * These are available only for the SQP, IPM and LTV backends (zeros otherwise)
+         *
+         * @return cvec<> constraints multipliers
+         */
+        cvec<> getDualMultipliers()
+        {
+            return ((NLOptimizer<MPCSize(Tnx, Tnu, 0, Tny, Tph, Tch, Tineq, Teq)> *)optPtr)->getDualMultipliers();
+        }
+
+        /**
+         * @brief Set the multipliers of the constraints used to initialize the next
+         * optimization, in the order system's dynamics (ph * nx), user inequality and
+         * user equality constraints. This is available only for the SQP, IPM and LTV backends
+         *
+         * @param y constraints multipliers
+         * @return true
+         * @return false if the size is wrong or the backend does not accept the multipliers
+         */
+        bool setDualMultipliers(const cvec<> &y)
+        {
+            if (y.size() != (int)((ph() * nx()) + ineq() + eq()))
+            {
+                Logger::instance().log(Logger::log_type::ERROR)
+                    << "The number of multipliers must be equal to the number of constraints"
+                    << std::endl;
+                return false;
+            }
+
+            return ((NLOptimizer<MPCSize(Tnx, Tnu, 0, Tny, Tph, Tch, Tineq, Teq)> *)optPtr)->setDualMultipliers(y);
+        }
+
     protected:
         /**
          * @brief Initilization hook for the interface
@@ -421,6 +737,8 @@ namespace mpc
                 ph(), ch(), ineq(),
                 eq());
 
+            previewParams.resize(0, ph() + 1);
+
             optPtr = new NLOptimizer<MPCSize(Tnx, Tnu, 0, Tny, Tph, Tch, Tineq, Teq)>();
             optPtr->initialize(
                 nx(), nu(), 0, ny(),
@@ -451,6 +769,31 @@ namespace mpc
         }
 
     private:
+        /**
+         * @brief Bind the system's dynamics constraints after the state space
+         * update function has been set
+         *
+         * @param eq_tol equality constraints tolerances
+         * @return true
+         * @return false
+         */
+        bool bindStateSpace(const float eq_tol)
+        {
+            cvec<(Size(Tph) * Size(Tnx))> eq_tol_vec;
+            COND_RESIZE_CVEC(MPCSize(Tnx, Tnu, 0, Tny, Tph, Tch, Tineq, Teq), eq_tol_vec, (ph() * nx()));
+            eq_tol_vec.setOnes();
+
+            objF->setModel(model, mapping);
+            conF->setModel(model, mapping);
+            ((NLOptimizer<MPCSize(Tnx, Tnu, 0, Tny, Tph, Tch, Tineq, Teq)> *)optPtr)->setModel(model, mapping);
+
+            Logger::instance().log(Logger::log_type::DETAIL)
+                << "Binding state space constraints"
+                << std::endl;
+
+            return ((NLOptimizer<MPCSize(Tnx, Tnu, 0, Tny, Tph, Tch, Tineq, Teq)> *)optPtr)->bindEq(constraints_type::EQ, eq_tol_vec * eq_tol);
+        }
+
         void buildInternalModules()
         {
             objF = std::make_shared<Objective<MPCSize(Tnx, Tnu, 0, Tny, Tph, Tch, Tineq, Teq)>>();
@@ -463,6 +806,9 @@ namespace mpc
         std::shared_ptr<Constraints<MPCSize(Tnx, Tnu, 0, Tny, Tph, Tch, Tineq, Teq)>> conF;
         std::shared_ptr<Model<MPCSize(Tnx, Tnu, 0, Tny, Tph, Tch, Tineq, Teq)>> model;
         std::shared_ptr<Mapping<MPCSize(Tnx, Tnu, 0, Tny, Tph, Tch, Tineq, Teq)>> mapping;
+
+        // preview parameters table (np x ph + 1) read by the parametric user functions
+        mat<> previewParams;
     };
 
 } // namespace mpc
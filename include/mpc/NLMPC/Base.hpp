@@ -33,6 +33,7 @@ namespace mpc
         {
             e = 0;
             niteration = 0;
+            fixed_slack = false;
         }
 
         /**
@@ -66,6 +67,52 @@ namespace mpc
             niteration = 1;
         }
 
+        /**
+         * @brief Set if the slack variable is fixed by its bounds, a fixed slack
+         * variable is not perturbed when computing the Jacobian matrices
+         *
+         * @param fixed true if the slack variable is fixed
+         */
+        void setSlackFixed(bool fixed)
+        {
+            fixed_slack = fixed;
+        }
+
+        /**
+         * @brief Return if the slack variable is fixed by its bounds
+         *
+         * @return true
+         * @return false
+         */
+        bool isSlackFixed() const
+        {
+            return fixed_slack;
+        }
+
+        /**
+         * @brief View an iterate of the internal solver as an optimization vector without
+         * copying it, the slack variable removed from the problem is restored (to zero)
+         * in an internal buffer
+         *
+         * @param x iterate of the internal solver
+         * @param n dimension of the iterate
+         * @return Eigen::Map<const cvec<...>> view of the optimization vector
+         */
+        Eigen::Map<const cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)>> restoreSlack(
+            const double *x,
+            unsigned int n)
+        {
+            if (n == (unsigned int)x_restored.size())
+            {
+                return Eigen::Map<const cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)>>(x, n);
+            }
+
+            x_restored.head(n) = Eigen::Map<const cvec<>>(x, n);
+            x_restored(n) = 0;
+
+            return Eigen::Map<const cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)>>(x_restored.data(), x_restored.size());
+        }
+
         // debug information
         int niteration;
 
@@ -78,6 +125,10 @@ namespace mpc
         mat<sizer.ph + 1, sizer.nu> Umat;
 
         double e;
+        bool fixed_slack;
+
+        // optimization vector with the slack variable restored
+        cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> x_restored;
     };
 
 } // namespace mpc
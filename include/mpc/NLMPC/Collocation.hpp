@@ -0,0 +1,325 @@
+/*
+ *   Copyright (c) 2023 Nicola Piccinelli
+ *   All rights reserved.
+ */
+#pragma once
+
+#include <mpc/NLMPC/Base.hpp>
+
+namespace mpc
+{
+    /**
+     * @brief Legendre-Gauss-Radau direct collocation transcription of the non-linear
+     * mpc. Each step of the prediction horizon is a single collocation interval, the
+     * states at the collocation points inside the interval are optimization variables
+     * appended to the optimization vector. The last collocation point is the end of
+     * the interval, so it is the state at the next step already in the optimization
+     * vector. The collocation equations of all the points (the defects) replace the
+     * system's dynamics equality constraints of the multiple shooting formulation
+     *
+     * @tparam sizer.nx dimension of the state space
+     * @tparam sizer.nu dimension of the input space
+     * @tparam Tny dimension of the output space
+     * @tparam Tph length of the prediction horizon
+     * @tparam Tch length of the control horizon
+     * @tparam Tineq number of the user inequality constraints
+     * @tparam Teq number of the user equality constraints
+     */
+    template <MPCSize sizer>
+    class Collocation : public Base<sizer>
+    {
+    private:
+        using IComponent<sizer>::checkOrQuit;
+        using IDimensionable<sizer>::nu;
+        using IDimensionable<sizer>::nx;
+        using IDimensionable<sizer>::ndu;
+        using IDimensionable<sizer>::ny;
+        using IDimensionable<sizer>::ph;
+        using IDimensionable<sizer>::ch;
+        using IDimensionable<sizer>::ineq;
+        using IDimensionable<sizer>::eq;
+
+        using Base<sizer>::mapping;
+        using Base<sizer>::model;
+        using Base<sizer>::x0;
+        using Base<sizer>::Xmat;
+        using Base<sizer>::Umat;
+        using Base<sizer>::e;
+        using Base<sizer>::x_restored;
+
+    public:
+        Collocation() = default;
+        ~Collocation() = default;
+
+        /**
+         * @brief Initialization hook override used to perform the
+         * initialization procedure. Performing initialization in this
+         * method ensures the correct problem dimensions assigment has been
+         * already performed.
+         */
+        void onInit() override
+        {
+            COND_RESIZE_CVEC(sizer, x0, nx());
+            COND_RESIZE_MAT(sizer, Xmat, (ph() + 1), nx());
+            COND_RESIZE_MAT(sizer, Umat, (ph() + 1), nu());
+            COND_RESIZE_CVEC(sizer, x_restored, ((ph() * nx()) + (nu() * ch()) + 1));
+
+            x0.setZero();
+            setPoints(3);
+        }
+
+        /**
+         * @brief Set the number of collocation points of each interval, the order of
+         * the Radau IIA collocation is 2 * points - 1
+         *
+         * @param points number of collocation points, from 1 to 3
+         * @return true
+         * @return false if the number of points is not supported, the current
+         * points are kept
+         */
+        bool setPoints(int points)
+        {
+            if (points < 1 || points > 3)
+            {
+                Logger::instance().log(Logger::log_type::ERROR)
+                    << "The number of collocation points must be from 1 to 3, "
+                    << "keeping "
+                    << c.size()
+                    << " points"
+                    << std::endl;
+                return false;
+            }
+
+            const double r6 = std::sqrt(6.0);
+            switch (points)
+            {
+            case 1:
+                A.resize(1, 1);
+                A << 1.0;
+                c.resize(1);
+                c << 1.0;
+                break;
+            case 2:
+                A.resize(2, 2);
+                A << 5.0 / 12.0, -1.0 / 12.0,
+                    3.0 / 4.0, 1.0 / 4.0;
+                c.resize(2);
+                c << 1.0 / 3.0, 1.0;
+                break;
+            default:
+                A.resize(3, 3);
+                A << (88.0 - (7.0 * r6)) / 360.0, (296.0 - (169.0 * r6)) / 1800.0, (-2.0 + (3.0 * r6)) / 225.0,
+                    (296.0 + (169.0 * r6)) / 1800.0, (88.0 + (7.0 * r6)) / 360.0, (-2.0 - (3.0 * r6)) / 225.0,
+                    (16.0 - r6) / 36.0, (16.0 + r6) / 36.0, 1.0 / 9.0;
+                c.resize(3);
+                c << (4.0 - r6) / 10.0, (4.0 + r6) / 10.0, 1.0;
+                break;
+            }
+
+            return true;
+        }
+
+        /**
+         * @brief Number of collocation points of each interval
+         *
+         * @return size_t number of points
+         */
+        size_t points() const
+        {
+            return c.size();
+        }
+
+        /**
+         * @brief Number of collocation states appended to the optimization vector, the
+         * last point of each interval is the state at the next step
+         *
+         * @return size_t number of optimization variables
+         */
+        size_t size()
+        {
+            return ph() * (points() - 1) * nx();
+        }
+
+        /**
+         * @brief Number of collocation equations (defects) of the prediction horizon
+         *
+         * @return size_t number of equality constraints
+         */
+        size_t defects()
+        {
+            return ph() * points() * nx();
+        }
+
+        /**
+         * @brief Initialize the collocation states interpolating linearly the states
+         * of the optimization vector at the collocation points
+         *
+         * @param x optimization vector
+         * @param states collocation states (scaled as the states of the optimization vector)
+         */
+        void initialStates(
+            const Eigen::Ref<const cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)>> &x,
+            Eigen::Ref<cvec<>> states)
+        {
+            checkOrQuit();
+
+            size_t s = points();
+            for (size_t k = 0; k < ph(); k++)
+            {
+                cvec<sizer.nx> xk, xk1;
+                xk = x0.cwiseProduct(mapping->StateInverseScaling());
+                if (k > 0)
+                {
+                    xk = x.middleRows((k - 1) * nx(), nx());
+                }
+                xk1 = x.middleRows(k * nx(), nx());
+
+                for (size_t j = 0; j + 1 < s; j++)
+                {
+                    states.middleRows(((k * (s - 1)) + j) * nx(), nx()) = xk + (c(j) * (xk1 - xk));
+                }
+            }
+        }
+
+        /**
+         * @brief Evaluate the collocation equations writing the value and the Jacobian
+         * matrix in place (e.g. in the buffers of the internal solver). The defect of
+         * a point only depends on the states of its interval and on the input of its
+         * step, so only the blocks of the Jacobian matrix of the interval are written
+         *
+         * @param x iterate of the internal solver, the optimization vector followed by
+         * the collocation states
+         * @param n dimension of the iterate
+         * @param value defects value
+         * @param jacobian transposed Jacobian matrix (one column for each defect), empty
+         * if not requested
+         */
+        void evaluateDefects(
+            const double *x,
+            unsigned int n,
+            Eigen::Ref<cvec<>> value,
+            Eigen::Ref<mat<>> jacobian)
+        {
+            checkOrQuit();
+
+            bool hasGradient = jacobian.size() > 0;
+            size_t s = points();
+            size_t nz = n - size();
+            double h = model->sampleTime;
+
+            mapping->unwrapVector(this->restoreSlack(x, nz), x0, Xmat, Umat, e);
+            Eigen::Map<const cvec<>> states(x + nz, size());
+
+            // all the collocation points of the horizon are evaluated with a single batch
+            size_t npts = ph() * s;
+            Xb.resize(nx(), npts);
+            Fb.resize(nx(), npts);
+            Ub.resize(nu(), npts);
+            steps.resize(npts);
+
+            for (size_t k = 0; k < ph(); k++)
+            {
+                for (size_t j = 0; j < s; j++)
+                {
+                    size_t p = (k * s) + j;
+                    if (j + 1 < s)
+                    {
+                        Xb.col(p) = states.middleRows(((k * (s - 1)) + j) * nx(), nx()).cwiseProduct(mapping->StateScaling());
+                    }
+                    else
+                    {
+                        Xb.col(p) = Xmat.row(k + 1).transpose();
+                    }
+                    Ub.col(p) = Umat.row(k).transpose();
+                    steps[p] = k;
+                }
+            }
+
+            model->vectorFieldBatch(Fb, Xb, Ub, steps);
+
+            for (size_t k = 0; k < ph(); k++)
+            {
+                for (size_t j = 0; j < s; j++)
+                {
+                    auto d = value.middleRows(((k * s) + j) * nx(), nx());
+                    d = Xb.col((k * s) + j) - Xmat.row(k).transpose();
+                    for (size_t l = 0; l < s; l++)
+                    {
+                        d -= (h * A(j, l)) * Fb.col((k * s) + l);
+                    }
+                    d = d.cwiseProduct(mapping->StateInverseScaling());
+                }
+            }
+
+            Logger::instance().log(Logger::log_type::DETAIL) << "Collocation defects value:\n"
+                                                             << std::setprecision(10) << value << std::endl;
+
+            if (!hasGradient)
+            {
+                return;
+            }
+
+            model->vectorFieldJacobians(Ab, Bb, Xb, Ub, steps, ws);
+
+            jacobian.setZero();
+            Ju.setZero(defects(), ph() * nu());
+
+            mat<sizer.nx, sizer.nx> Sx, Tx;
+            Sx = mapping->StateInverseScaling().asDiagonal();
+            Tx = mapping->StateScaling().asDiagonal();
+
+            for (size_t k = 0; k < ph(); k++)
+            {
+                for (size_t j = 0; j < s; j++)
+                {
+                    size_t row = ((k * s) + j) * nx();
+
+                    // the state at the beginning of the interval
+                    if (k > 0)
+                    {
+                        jacobian.block((k - 1) * nx(), row, nx(), nx()) = -mat<sizer.nx, sizer.nx>::Identity(nx(), nx());
+                    }
+
+                    for (size_t l = 0; l < s; l++)
+                    {
+                        size_t p = (k * s) + l;
+
+                        mat<sizer.nx, sizer.nx> D;
+                        D = -(h * A(j, l)) * Sx * Ab.middleCols(p * nx(), nx()) * Tx;
+                        if (l == j)
+                        {
+                            D.diagonal().array() += 1.0;
+                        }
+
+                        // the last collocation point is the state at the next step
+                        size_t var = (l + 1 < s) ? nz + (((k * (s - 1)) + l) * nx()) : k * nx();
+                        jacobian.block(var, row, nx(), nx()) = D.transpose();
+
+                        Ju.block(row, k * nu(), nx(), nu()) -= (h * A(j, l)) * Sx * Bb.middleCols(p * nu(), nu());
+                    }
+                }
+            }
+
+            Jz.resize(defects(), nu() * ch());
+            mapping->template blockInputJacobian<Eigen::Dynamic>(Ju, Jz);
+            jacobian.middleRows(ph() * nx(), nu() * ch()) = Jz.transpose();
+
+            Logger::instance().log(Logger::log_type::DETAIL) << "Collocation defects gradient:\n"
+                                                             << std::setprecision(10) << jacobian << std::endl;
+        }
+
+    private:
+        // Radau IIA tableau and collocation points (fractions of the interval)
+        mat<Eigen::Dynamic, Eigen::Dynamic> A;
+        cvec<Eigen::Dynamic> c;
+
+        // batch buffers, only reallocated when the horizon or the points change
+        mat<sizer.nx, Eigen::Dynamic> Xb, Fb, Ab, Bb;
+        mat<sizer.nu, Eigen::Dynamic> Ub;
+        std::vector<unsigned int> steps;
+        typename Model<sizer>::Workspace ws;
+
+        mat<Eigen::Dynamic, (sizer.ph * sizer.nu)> Ju;
+        mat<Eigen::Dynamic, (sizer.nu * sizer.ch)> Jz;
+    };
+} // namespace mpc
@@ -89,6 +89,46 @@ namespace mpc
 
             COND_RESIZE_CVEC(sizer, cineq_user, ineq());
             COND_RESIZE_MAT(sizer, Jcineq_user, (ph() * nx()) + (nu() * ch()) + 1, ineq());
+
+            COND_RESIZE_CVEC(sizer, x_restored, (ph() * nx()) + (nu() * ch()) + 1);
+
+            resetJacobianUpdate();
+        }
+
+        /**
+         * @brief Set the update strategy of the constraints Jacobian matrices. With the
+         * Broyden strategy the Jacobian of the system's dynamics is updated stage by stage
+         * using the model evaluations already performed to compute the constraints value,
+         * while the user constraints Jacobian matrices are updated as a whole. The finite
+         * differences are recomputed after a given number of updates or when the step
+         * is larger than the given threshold
+         *
+         * @param update update strategy
+         * @param refreshIterations number of updates between two finite differences evaluations
+         * @param refreshStep infinity norm of the step above which the finite differences are recomputed
+         */
+        void setJacobianUpdate(NLJacobianUpdate update, int refreshIterations, double refreshStep)
+        {
+            checkOrQuit();
+
+            jacobian_update = update;
+            refresh_iterations = std::max(1, refreshIterations);
+            refresh_step = refreshStep;
+
+            resetJacobianUpdate();
+        }
+
+        /**
+         * @brief Discard the Jacobian matrices used by the Broyden update so that
+         * the next request is served with finite differences (e.g. when the scaling
+         * of the optimization vector changes)
+         */
+        void resetJacobianUpdate()
+        {
+            // the continuous time dynamics evaluates the vector field at both ends of each step
+            stage_update.assign(2 * ph(), StageJacobian());
+            ineq_update = UserJacobian<sizer.ineq>();
+            eq_update = UserJacobian<sizer.eq>();
         }
 
         /**
@@ -198,10 +238,36 @@ namespace mpc
          * @param hasGradient request the computation of the gradient
          * @return Cost<sizer.ineq> associated cost
          */
-        Cost<sizer.ineq> evaluateIneq(cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> x, bool hasGradient)
+        Cost<sizer.ineq> evaluateIneq(const Eigen::Ref<const cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)>> &x, bool hasGradient)
+        {
+            Cost<sizer.ineq> c;
+            COND_RESIZE_CVEC(sizer, c.value, ineq());
+            COND_RESIZE_CVEC(sizer, c.grad, ineq() * x.size());
+            c.grad.setZero();
+
+            evaluateIneq(x, c.value, Eigen::Map<mat<>>(c.grad.data(), hasGradient ? x.size() : 0, ineq()));
+            return c;
+        }
+
+        /**
+         * @brief Evaluate the user defined inequality constraints writing the value and
+         * the Jacobian matrix in place (e.g. in the buffers of the internal solver)
+         *
+         * @param x internal optimization vector
+         * @param value constraints value
+         * @param jacobian transposed Jacobian matrix (one column for each constraint), empty
+         * if not requested. When the slack variable is removed from the problem its row is
+         * not written
+         */
+        void evaluateIneq(
+            const Eigen::Ref<const cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)>> &x,
+            Eigen::Ref<cvec<>> value,
+            Eigen::Ref<mat<>> jacobian)
         {
             checkOrQuit();
 
+            bool hasGradient = jacobian.size() > 0;
+
             mapping->unwrapVector(x, x0, Xmat, Umat, e);
 
             if (hasIneqConstraints())
@@ -213,44 +279,34 @@ namespace mpc
                 mat<(sizer.ph + 1), sizer.ny> Ymat = model->getOutput(Xmat, Umat);
                 ieqUser(cineq_user, Xmat, Ymat, Umat, e);
 
-                mat<sizer.ineq, (sizer.ph * sizer.nx)> Jieqx;
-                COND_RESIZE_MAT(sizer, Jieqx, ineq(), (ph() * nx()));
-
-                mat<sizer.ineq, (sizer.ph * sizer.nu)> Jieqmv;
-                COND_RESIZE_MAT(sizer, Jieqmv, ineq(), (ph() * nu()));
+                // the Jacobian matrix is only computed when requested, with the finite differences
+                // skipped when the Broyden update can be applied
+                if (hasGradient && !updateUserJacobian<sizer.ineq>(ineq_update, Jcineq_user, x, cineq_user))
+                {
+                    mat<sizer.ineq, (sizer.ph * sizer.nx)> Jieqx;
+                    COND_RESIZE_MAT(sizer, Jieqx, ineq(), (ph() * nx()));
 
-                cvec<sizer.ineq> Jie;
-                COND_RESIZE_CVEC(sizer, Jie, ineq());
+                    mat<sizer.ineq, (sizer.nu * sizer.ch)> Jieqmv;
+                    COND_RESIZE_MAT(sizer, Jieqmv, ineq(), (nu() * ch()));
 
-                computeIneqJacobian(Jieqx, Jieqmv, Jie, Xmat, Umat, e);
+                    cvec<sizer.ineq> Jie;
+                    COND_RESIZE_CVEC(sizer, Jie, ineq());
 
-                Logger::instance().log(Logger::log_type::DETAIL) << "User inequality state constraints gradient:\n"
-                                                                 << std::setprecision(10) << Jieqx << std::endl;
+                    computeIneqJacobian(Jieqx, Jieqmv, Jie, Xmat, Umat, x.middleRows((ph() * nx()), (nu() * ch())), e);
 
-                Logger::instance().log(Logger::log_type::DETAIL) << "User inequality inputs constraints gradient:\n"
-                                                                 << std::setprecision(10) << Jieqmv << std::endl;
+                    Logger::instance().log(Logger::log_type::DETAIL) << "User inequality state constraints gradient:\n"
+                                                                     << std::setprecision(10) << Jieqx << std::endl;
 
-                Logger::instance().log(Logger::log_type::DETAIL) << "User inequality slack constraints gradient:\n"
-                                                                 << std::setprecision(10) << Jie << std::endl;
+                    Logger::instance().log(Logger::log_type::DETAIL) << "User inequality inputs constraints gradient:\n"
+                                                                     << std::setprecision(10) << Jieqmv << std::endl;
 
-                glueJacobian<sizer.ineq>(Jcineq_user, Jieqx, Jieqmv, Jie);
+                    Logger::instance().log(Logger::log_type::DETAIL) << "User inequality slack constraints gradient:\n"
+                                                                     << std::setprecision(10) << Jie << std::endl;
 
-                auto scaled_Jcineq_user = Jcineq_user;
-                for (int j = 0; j < Jcineq_user.cols(); j++)
-                {
-                    int ioff = 0;
-                    for (size_t k = 0; k < ph(); k++)
-                    {
-                        for (size_t ix = 0; ix < nx(); ix++)
-                        {
-                            scaled_Jcineq_user(ioff + ix, j) = scaled_Jcineq_user(ioff + ix, j) * mapping->StateScaling()(ix);
-                        }
-
-                        ioff = ioff + nx();
-                    }
+                    glueUserJacobian<sizer.ineq>(Jcineq_user, Jieqx, Jieqmv, Jie);
+                    scaleStateRows<sizer.ineq>(Jcineq_user);
+                    storeUserJacobian<sizer.ineq>(ineq_update, x, cineq_user);
                 }
-
-                Jcineq_user = scaled_Jcineq_user;
             }
             else
             {
@@ -260,13 +316,14 @@ namespace mpc
                 Jcineq_user.setZero();
             }
 
-            Cost<sizer.ineq> c;
-            c.value = cineq_user;
-            c.grad = Eigen::Map<cvec<(sizer.ineq * ((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1))>>(Jcineq_user.data(),
-                                                                                                          Jcineq_user.size());
+            value = cineq_user;
+            if (hasGradient)
+            {
+                jacobian = Jcineq_user.topRows(jacobian.rows());
+            }
 
             Logger::instance().log(Logger::log_type::DETAIL) << "User inequality constraints value:\n"
-                                                             << std::setprecision(10) << c.value << std::endl;
+                                                             << std::setprecision(10) << value << std::endl;
 
             if (!hasGradient)
             {
@@ -276,10 +333,8 @@ namespace mpc
             else
             {
                 Logger::instance().log(Logger::log_type::DETAIL) << "User inequality constraints gradient:\n"
-                                                                 << std::setprecision(10) << c.grad << std::endl;
+                                                                 << std::setprecision(10) << jacobian << std::endl;
             }
-
-            return c;
         }
 
         /**
@@ -289,22 +344,49 @@ namespace mpc
          * @param hasGradient request the computation of the gradient
          * @return Cost<(sizer.ph * sizer.nx)> associated cost
          */
-        Cost<(sizer.ph * sizer.nx)> evaluateStateModelEq(cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> x,
+        Cost<(sizer.ph * sizer.nx)> evaluateStateModelEq(const Eigen::Ref<const cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)>> &x,
                                                          bool hasGradient)
+        {
+            Cost<(sizer.ph * sizer.nx)> c;
+            COND_RESIZE_CVEC(sizer, c.value, ph() * nx());
+            COND_RESIZE_CVEC(sizer, c.grad, (ph() * nx()) * x.size());
+            c.grad.setZero();
+
+            evaluateStateModelEq(x, c.value, Eigen::Map<mat<>>(c.grad.data(), hasGradient ? x.size() : 0, ph() * nx()));
+            return c;
+        }
+
+        /**
+         * @brief Evaluate the equality constraints for the system's dynamic writing the
+         * value and the Jacobian matrix in place (e.g. in the buffers of the internal solver)
+         *
+         * @param x internal optimization vector
+         * @param value constraints value
+         * @param jacobian transposed Jacobian matrix (one column for each constraint), empty
+         * if not requested. When the slack variable is removed from the problem its row is
+         * not written
+         */
+        void evaluateStateModelEq(
+            const Eigen::Ref<const cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)>> &x,
+            Eigen::Ref<cvec<>> value,
+            Eigen::Ref<mat<>> jacobian)
         {
             checkOrQuit();
+
+            bool hasGradient = jacobian.size() > 0;
             mapping->unwrapVector(x, x0, Xmat, Umat, e);
 
             // Set MPC constraints
             getStateEqConstraints(hasGradient);
 
-            Cost<(sizer.ph * sizer.nx)> c;
-            c.value = ceq;
-            c.grad = Eigen::Map<cvec<((sizer.ph * sizer.nx) * ((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1))>>(
-                Jceq.data(), Jceq.size());
+            value = ceq;
+            if (hasGradient)
+            {
+                jacobian = Jceq.topRows(jacobian.rows());
+            }
 
             Logger::instance().log(Logger::log_type::DETAIL) << "State equality constraints value:\n"
-                                                             << std::setprecision(10) << c.value << std::endl;
+                                                             << std::setprecision(10) << value << std::endl;
             if (!hasGradient)
             {
                 Logger::instance().log(Logger::log_type::DETAIL)
@@ -313,10 +395,8 @@ namespace mpc
             else
             {
                 Logger::instance().log(Logger::log_type::DETAIL) << "State equality constraints gradient:\n"
-                                                                 << std::setprecision(10) << c.grad << std::endl;
+                                                                 << std::setprecision(10) << jacobian << std::endl;
             }
-
-            return c;
         }
 
         /**
@@ -326,9 +406,35 @@ namespace mpc
          * @param hasGradient request the computation of the gradient
          * @return Cost<sizer.eq> associated cost
          */
-        Cost<sizer.eq> evaluateEq(cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> x, bool hasGradient)
+        Cost<sizer.eq> evaluateEq(const Eigen::Ref<const cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)>> &x, bool hasGradient)
+        {
+            Cost<sizer.eq> c;
+            COND_RESIZE_CVEC(sizer, c.value, eq());
+            COND_RESIZE_CVEC(sizer, c.grad, eq() * x.size());
+            c.grad.setZero();
+
+            evaluateEq(x, c.value, Eigen::Map<mat<>>(c.grad.data(), hasGradient ? x.size() : 0, eq()));
+            return c;
+        }
+
+        /**
+         * @brief Evaluate the user defined equality constraints writing the value and
+         * the Jacobian matrix in place (e.g. in the buffers of the internal solver)
+         *
+         * @param x internal optimization vector
+         * @param value constraints value
+         * @param jacobian transposed Jacobian matrix (one column for each constraint), empty
+         * if not requested. When the slack variable is removed from the problem its row is
+         * not written
+         */
+        void evaluateEq(
+            const Eigen::Ref<const cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)>> &x,
+            Eigen::Ref<cvec<>> value,
+            Eigen::Ref<mat<>> jacobian)
         {
             checkOrQuit();
+
+            bool hasGradient = jacobian.size() > 0;
             mapping->unwrapVector(x, x0, Xmat, Umat, e);
 
             // Add user defined constraints
@@ -338,31 +444,22 @@ namespace mpc
 
                 eqUser(ceq_user, Xmat, Umat);
 
-                mat<sizer.eq, (sizer.ph * sizer.nx)> Jeqx;
-                COND_RESIZE_MAT(sizer, Jeqx, eq(), (ph() * nx()));
-
-                mat<sizer.eq, (sizer.ph * sizer.nu)> Jeqmv;
-                COND_RESIZE_MAT(sizer, Jeqmv, eq(), (ph() * nu()));
+                // the Jacobian matrix is only computed when requested, with the finite differences
+                // skipped when the Broyden update can be applied
+                if (hasGradient && !updateUserJacobian<sizer.eq>(eq_update, Jceq_user, x, ceq_user))
+                {
+                    mat<sizer.eq, (sizer.ph * sizer.nx)> Jeqx;
+                    COND_RESIZE_MAT(sizer, Jeqx, eq(), (ph() * nx()));
 
-                computeEqJacobian(Jeqx, Jeqmv, Xmat, Umat);
+                    mat<sizer.eq, (sizer.nu * sizer.ch)> Jeqmv;
+                    COND_RESIZE_MAT(sizer, Jeqmv, eq(), (nu() * ch()));
 
-                glueJacobian<sizer.eq>(Jceq_user, Jeqx, Jeqmv, cvec<sizer.eq>::Zero(eq()));
+                    computeEqJacobian(Jeqx, Jeqmv, Xmat, Umat, x.middleRows((ph() * nx()), (nu() * ch())));
 
-                auto scaled_Jceq_user = Jceq_user;
-                for (int j = 0; j < Jceq_user.cols(); j++)
-                {
-                    int ioff = 0;
-                    for (size_t k = 0; k < ph(); k++)
-                    {
-                        for (size_t ix = 0; ix < nx(); ix++)
-                        {
-                            scaled_Jceq_user(ioff + ix, j) = scaled_Jceq_user(ioff + ix, j) * mapping->StateScaling()(ix);
-                        }
-                        ioff = ioff + nx();
-                    }
+                    glueUserJacobian<sizer.eq>(Jceq_user, Jeqx, Jeqmv, cvec<sizer.eq>::Zero(eq()));
+                    scaleStateRows<sizer.eq>(Jceq_user);
+                    storeUserJacobian<sizer.eq>(eq_update, x, ceq_user);
                 }
-
-                Jceq_user = scaled_Jceq_user;
             }
             else
             {
@@ -372,13 +469,14 @@ namespace mpc
                 Jceq_user.setZero();
             }
 
-            Cost<sizer.eq> c;
-            c.value = ceq_user;
-            c.grad = Eigen::Map<cvec<(sizer.eq * ((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1))>>(Jceq_user.data(),
-                                                                                                        Jceq_user.size());
+            value = ceq_user;
+            if (hasGradient)
+            {
+                jacobian = Jceq_user.topRows(jacobian.rows());
+            }
 
             Logger::instance().log(Logger::log_type::DETAIL) << "User equality constraints value:\n"
-                                                             << std::setprecision(10) << c.value << std::endl;
+                                                             << std::setprecision(10) << value << std::endl;
             if (!hasGradient)
             {
                 Logger::instance().log(Logger::log_type::DETAIL)
@@ -387,13 +485,27 @@ namespace mpc
             else
             {
                 Logger::instance().log(Logger::log_type::DETAIL) << "User equality constraints gradient:\n"
-                                                                 << std::setprecision(10) << c.grad << std::endl;
+                                                                 << std::setprecision(10) << jacobian << std::endl;
             }
-
-            return c;
         }
 
     private:
+        /**
+         * @brief Scale in place the rows of a (transposed) Jacobian matrix w.r.t. the
+         * states, the optimization vector holds the scaled states
+         *
+         * @tparam Tnc number of constraints
+         * @param JT transposed Jacobian matrix
+         */
+        template <int Tnc>
+        void scaleStateRows(mat<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1), Tnc> &JT)
+        {
+            for (size_t k = 0; k < ph(); k++)
+            {
+                JT.middleRows(k * nx(), nx()) = mapping->StateScaling().asDiagonal() * JT.middleRows(k * nx(), nx());
+            }
+        }
+
         /**
          * @brief Combines the Jacobian matrices of the system's dynamics,
          * the optimal control inputs and a set of constraints together
@@ -415,16 +527,37 @@ namespace mpc
                 Jres.middleRows(i * nx(), nx()) = Jstate.middleCols(i * nx(), nx()).transpose();
             }
 
-            mat<Tnc, sizer.ph * sizer.nu> Jmanvar_mat;
-            COND_RESIZE_MAT(sizer, Jmanvar_mat, Jres.cols(), ph() * nu());
+            mat<Tnc, sizer.nu * sizer.ch> Jblock;
+            COND_RESIZE_MAT(sizer, Jblock, Jres.cols(), nu() * ch());
 
-            // #pragma omp parallel for
+            mapping->template blockInputJacobian<Tnc>(Jmanvar, Jblock);
+
+            Jres.middleRows(ph() * nx(), nu() * ch()) = Jblock.transpose();
+            Jres.bottomRows(1) = Jcon.transpose();
+        }
+
+        /**
+         * @brief Combines the Jacobian matrices of a set of user constraints, the
+         * Jacobian matrix of the control inputs is already expressed w.r.t. the
+         * input elements of the optimization vector
+         *
+         * @tparam Tnc number of constraints
+         * @param Jres reference to the resulting Jacobian matrix
+         * @param Jstate Jacobian matrix w.r.t. the states
+         * @param Jmanvar Jacobian matrix w.r.t. the input elements of the optimization vector
+         * @param Jcon Jacobian matrix w.r.t. the slack variable
+         */
+        template <int Tnc>
+        void glueUserJacobian(mat<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1), Tnc> &Jres,
+                              const mat<Tnc, (sizer.ph * sizer.nx)> &Jstate, const mat<Tnc, (sizer.nu * sizer.ch)> &Jmanvar,
+                              const cvec<Tnc> &Jcon)
+        {
             for (size_t i = 0; i < ph(); i++)
             {
-                Jmanvar_mat.block(0, i * nu(), Jres.cols(), nu()) = Jmanvar.middleCols(i * nu(), nu());
+                Jres.middleRows(i * nx(), nx()) = Jstate.middleCols(i * nx(), nx()).transpose();
             }
 
-            Jres.middleRows(ph() * nx(), nu() * ch()) = (Jmanvar_mat * mapping->Iz2u()).transpose();
+            Jres.middleRows(ph() * nx(), nu() * ch()) = Jmanvar.transpose();
             Jres.bottomRows(1) = Jcon.transpose();
         }
 
@@ -462,33 +595,83 @@ namespace mpc
             Sx = mapping->StateInverseScaling().asDiagonal();
             Tx = mapping->StateScaling().asDiagonal();
 
-            // TODO bind for continuous time
-            if (model->isContinuousTime)
+            // the integrated continuous time model is a discrete time transition
+            bool continuous = model->isContinuousTime && !model->isIntegrated();
+            if (continuous)
             {
                 Logger::instance().log(Logger::log_type::DETAIL)
                     << "Continuous time model detected, using finite differences" << std::endl;
+            }
+            else if (model->isIntegrated())
+            {
+                Logger::instance().log(Logger::log_type::DETAIL)
+                    << "Continuous time model detected, integrating each step" << std::endl;
+            }
+            else
+            {
+                Logger::instance().log(Logger::log_type::DETAIL) << "Discrete time model detected" << std::endl;
+            }
 
-                // #pragma omp parallel for
-                for (size_t i = 0; i < ph(); i++)
+            // the model is evaluated on all the steps of the horizon with a single batch,
+            // the continuous time model is evaluated at both the ends of each step
+            size_t npts = continuous ? 2 * ph() : ph();
+
+            // the batch buffers are only reallocated when the horizon or the model changes
+            Xb.resize(nx(), npts);
+            Fb.resize(nx(), npts);
+            Ub.resize(nu(), npts);
+            steps.resize(npts);
+
+            for (size_t i = 0; i < ph(); i++)
+            {
+                if (continuous)
+                {
+                    Xb.col(2 * i) = Xmat.row(i).transpose();
+                    Xb.col((2 * i) + 1) = Xmat.row(i + 1).transpose();
+                    Ub.col(2 * i) = Umat.row(i).transpose();
+                    Ub.col((2 * i) + 1) = Umat.row(i).transpose();
+                    steps[2 * i] = i;
+                    steps[(2 * i) + 1] = i;
+                }
+                else
                 {
-                    cvec<sizer.nu> uk;
-                    uk = Umat.row(i).transpose();
+                    Xb.col(i) = Xmat.row(i).transpose();
+                    Ub.col(i) = Umat.row(i).transpose();
+                    steps[i] = i;
+                }
+            }
 
-                    cvec<sizer.nx> xk;
-                    xk = Xmat.row(i).transpose();
+            model->transitionBatch(Fb, Xb, Ub, steps, model_ws);
 
-                    double h = model->sampleTime / 2.0;
-                    cvec<sizer.nx> xk1;
-                    xk1 = Xmat.row(i + 1).transpose();
+            // with finite differences the perturbations of all the points are
+            // evaluated with a single batch as well
+            bool batchJacobian = hasGradient && jacobian_update == NLJacobianUpdate::FINITE_DIFFERENCE;
 
-                    cvec<sizer.nx> fk, fk1;
-                    COND_RESIZE_CVEC(sizer, fk, nx());
-                    COND_RESIZE_CVEC(sizer, fk1, nx());
+            if (batchJacobian)
+            {
+                model->transitionJacobians(Ab, Bb, Xb, Ub, steps, model_ws);
+            }
+
+            auto pointJacobian = [&](mat<sizer.nx, sizer.nx> &Ak, mat<sizer.nx, sizer.nu> &Bk, size_t slot)
+            {
+                if (batchJacobian)
+                {
+                    Ak = Ab.middleCols(slot * nx(), nx());
+                    Bk = Bb.middleCols(slot * nu(), nu());
+                }
+                else
+                {
+                    stateEqJacobian(Ak, Bk, Xb.col(slot), Ub.col(slot), Fb.col(slot), steps[slot], slot);
+                }
+            };
 
-                    model->vectorField(fk, xk, uk, i);
-                    model->vectorField(fk1, xk1, uk, i);
+            if (continuous)
+            {
+                for (size_t i = 0; i < ph(); i++)
+                {
+                    double h = model->sampleTime / 2.0;
 
-                    ceq.middleRows(ic, nx()) = xk + (h * (fk + fk1)) - xk1;
+                    ceq.middleRows(ic, nx()) = Xb.col(2 * i) + (h * (Fb.col(2 * i) + Fb.col((2 * i) + 1))) - Xb.col((2 * i) + 1);
                     ceq.middleRows(ic, nx()) = ceq.middleRows(ic, nx()).array() / mapping->StateScaling().array();
 
                     if (hasGradient)
@@ -499,7 +682,7 @@ namespace mpc
                         mat<sizer.nx, sizer.nu> Bk;
                         COND_RESIZE_MAT(sizer, Bk, nx(), nu());
 
-                        computeStateEqJacobian(Ak, Bk, xk, uk, i);
+                        pointJacobian(Ak, Bk, 2 * i);
 
                         mat<sizer.nx, sizer.nx> Ak1;
                         COND_RESIZE_MAT(sizer, Ak1, nx(), nx());
@@ -507,7 +690,7 @@ namespace mpc
                         mat<sizer.nx, sizer.nu> Bk1;
                         COND_RESIZE_MAT(sizer, Bk1, nx(), nu());
 
-                        computeStateEqJacobian(Ak1, Bk1, xk1, uk, i);
+                        pointJacobian(Ak1, Bk1, (2 * i) + 1);
 
                         if (i > 0)
                         {
@@ -523,22 +706,9 @@ namespace mpc
             }
             else
             {
-                Logger::instance().log(Logger::log_type::DETAIL) << "Discrete time model detected" << std::endl;
-
-                // #pragma omp parallel for
                 for (size_t i = 0; i < ph(); i++)
                 {
-                    cvec<sizer.nu> uk;
-                    uk = Umat.row(i).transpose();
-                    cvec<sizer.nx> xk;
-                    xk = Xmat.row(i).transpose();
-
-                    cvec<sizer.nx> xk1;
-                    COND_RESIZE_CVEC(sizer, xk1, nx());
-
-                    model->vectorField(xk1, xk, uk, i);
-
-                    ceq.middleRows(ic, nx()) = Xmat.row(i + 1).transpose() - xk1;
+                    ceq.middleRows(ic, nx()) = Xmat.row(i + 1).transpose() - Fb.col(i);
                     ceq.middleRows(ic, nx()) = ceq.middleRows(ic, nx()).array() / mapping->StateScaling().array();
 
                     if (hasGradient)
@@ -549,7 +719,7 @@ namespace mpc
                         mat<sizer.nx, sizer.nu> Bk;
                         COND_RESIZE_MAT(sizer, Bk, nx(), nu());
 
-                        computeStateEqJacobian(Ak, Bk, xk, uk, i);
+                        pointJacobian(Ak, Bk, i);
 
                         Ak = Sx * Ak * Tx;
                         Bk = Sx * Bk;
@@ -574,18 +744,22 @@ namespace mpc
 
         /**
          * Computes the inequality Jacobian matrix for the given inputs.
-         * The Jacobian is computed using the central difference method.
+         * The Jacobian is computed using the central difference method, the inputs are
+         * perturbed along the input elements of the optimization vector so that the steps
+         * sharing the same element of the control horizon are perturbed once.
          *
          * @param Jconx The output matrix for the inequality Jacobian with respect to x.
-         * @param Jconmv The output matrix for the inequality Jacobian with respect to u.
+         * @param Jconmv The output matrix for the inequality Jacobian with respect to the input elements of the optimization vector.
          * @param Jcone The output vector for the inequality Jacobian with respect to e.
          * @param x0 The input matrix representing the initial state trajectory.
          * @param u0 The input matrix representing the control trajectory.
+         * @param z0 The input elements of the optimization vector.
          * @param e0 The input value representing the error.
          */
         void computeIneqJacobian(mat<sizer.ineq, (sizer.ph * sizer.nx)> &Jconx,
-                                 mat<sizer.ineq, (sizer.ph * sizer.nu)> &Jconmv, cvec<sizer.ineq> &Jcone,
-                                 mat<(sizer.ph + 1), sizer.nx> x0, mat<(sizer.ph + 1), sizer.nu> u0, double e0)
+                                 mat<sizer.ineq, (sizer.nu * sizer.ch)> &Jconmv, cvec<sizer.ineq> &Jcone,
+                                 mat<(sizer.ph + 1), sizer.nx> x0, mat<(sizer.ph + 1), sizer.nu> u0,
+                                 const cvec<(sizer.nu * sizer.ch)> &z0, double e0)
         {
             Jconx.setZero();
             Jconmv.setZero();
@@ -619,31 +793,33 @@ namespace mpc
                 }
             }
 
-            mat<(sizer.ph + 1), sizer.nu> Ua;
-            Ua = u0.cwiseAbs().cwiseMax(1.0);
+            mat<(sizer.ph + 1), sizer.nu> D;
+            COND_RESIZE_MAT(sizer, D, (ph() + 1), nu());
 
-            for (size_t i = 0; i < ph(); i++)
+            for (size_t c = 0; c < (nu() * ch()); c++)
             {
-                for (size_t j = 0; j < nu(); j++)
-                {
-                    double du = dv * Ua.array()(j);
-                    u0(i, j) += du;
-                    cvec<sizer.ineq> f_plus, f_minus;
-                    COND_RESIZE_CVEC(sizer, f_plus, ineq());
-                    COND_RESIZE_CVEC(sizer, f_minus, ineq());
+                mapping->inputDirection(c, D);
 
-                    mat<(sizer.ph + 1), sizer.ny> y0_plus = model->getOutput(x0, u0);
-                    ieqUser(f_plus, x0, y0_plus, u0, e0);
+                double dz = dv * std::max(1.0, std::fabs(z0(c)));
+                cvec<sizer.ineq> f_plus, f_minus;
+                COND_RESIZE_CVEC(sizer, f_plus, ineq());
+                COND_RESIZE_CVEC(sizer, f_minus, ineq());
 
-                    u0(i, j) -= 2 * du;
-                    mat<(sizer.ph + 1), sizer.ny> y0_minus = model->getOutput(x0, u0);
-                    ieqUser(f_minus, x0, y0_minus, u0, e0);
+                mat<(sizer.ph + 1), sizer.nu> u_plus = u0 + (dz * D);
+                mat<(sizer.ph + 1), sizer.ny> y0_plus = model->getOutput(x0, u_plus);
+                ieqUser(f_plus, x0, y0_plus, u_plus, e0);
 
-                    u0(i, j) += du;
+                mat<(sizer.ph + 1), sizer.nu> u_minus = u0 - (dz * D);
+                mat<(sizer.ph + 1), sizer.ny> y0_minus = model->getOutput(x0, u_minus);
+                ieqUser(f_minus, x0, y0_minus, u_minus, e0);
 
-                    cvec<sizer.ineq> df = (f_plus - f_minus) / (2 * du);
-                    Jconmv.middleCols(i * nu(), nu()).col(j) = df;
-                }
+                Jconmv.col(c) = (f_plus - f_minus) / (2 * dz);
+            }
+
+            // the slack variable fixed by its bounds is not perturbed
+            if (fixed_slack)
+            {
+                return;
             }
 
             double ea = fmax(dv, fabs(e0));
@@ -662,15 +838,19 @@ namespace mpc
         }
 
         /**
-         * Computes the Jacobian matrix of equality constraints using the central difference method.
+         * Computes the Jacobian matrix of equality constraints using the central difference method,
+         * the inputs are perturbed along the input elements of the optimization vector.
          *
          * @param Jconx The output matrix for the Jacobian of equality constraints with respect to the state variables.
-         * @param Jconmv The output matrix for the Jacobian of equality constraints with respect to the control variables.
+         * @param Jconmv The output matrix for the Jacobian of equality constraints with respect to the input elements
+         * of the optimization vector.
          * @param x0 The initial state vector.
          * @param u0 The initial control vector.
+         * @param z0 The input elements of the optimization vector.
          */
-        void computeEqJacobian(mat<sizer.eq, (sizer.ph * sizer.nx)> &Jconx, mat<sizer.eq, (sizer.ph * sizer.nu)> &Jconmv,
-                               mat<(sizer.ph + 1), sizer.nx> x0, mat<(sizer.ph + 1), sizer.nu> u0)
+        void computeEqJacobian(mat<sizer.eq, (sizer.ph * sizer.nx)> &Jconx, mat<sizer.eq, (sizer.nu * sizer.ch)> &Jconmv,
+                               mat<(sizer.ph + 1), sizer.nx> x0, mat<(sizer.ph + 1), sizer.nu> u0,
+                               const cvec<(sizer.nu * sizer.ch)> &z0)
         {
             Jconx.setZero();
             Jconmv.setZero();
@@ -706,142 +886,240 @@ namespace mpc
                 }
             }
 
-            mat<(sizer.ph + 1), sizer.nu> Ua;
-            Ua = u0.cwiseAbs().cwiseMax(1.0);
+            mat<(sizer.ph + 1), sizer.nu> D;
+            COND_RESIZE_MAT(sizer, D, (ph() + 1), nu());
 
             // Compute Jconmv using central difference method
-            for (size_t i = 0; i < (ph() - 1); i++)
-            {
-                for (size_t j = 0; j < nu(); j++)
-                {
-                    // Calculate perturbation
-                    double du = dv * Ua(ph() - 1, j);
-                    // Forward perturbation
-                    u0(i, j) += du;
-                    cvec<sizer.eq> f_plus;
-                    COND_RESIZE_CVEC(sizer, f_plus, eq());
-                    // Compute equality constraints with perturbed control
-                    eqUser(f_plus, x0, u0);
-                    // Backward perturbation
-                    u0(i, j) -= 2 * du;
-                    cvec<sizer.eq> f_minus;
-                    COND_RESIZE_CVEC(sizer, f_minus, eq());
-                    // Compute equality constraints with perturbed control
-                    eqUser(f_minus, x0, u0);
-                    // Restore original control
-                    u0(i, j) += du;
-                    // Compute central difference
-                    cvec<sizer.eq> df = (f_plus - f_minus) / (2 * du);
-                    // Update Jconmv
-                    Jconmv.middleCols(i * nu(), nu()).col(j) = df;
-                }
-            }
-
-            // Compute Jconmv for the last time step using central difference method
-            for (size_t j = 0; j < nu(); j++)
+            for (size_t c = 0; c < (nu() * ch()); c++)
             {
+                // Steps of the horizon moved by the element of the optimization vector
+                mapping->inputDirection(c, D);
                 // Calculate perturbation
-                double du = dv * Ua(ph() - 1, j);
-                // Forward perturbation
-                u0((ph() - 1), j) += du;
-                // Forward perturbation
-                u0(ph(), j) += du;
+                double dz = dv * std::max(1.0, std::fabs(z0(c)));
                 cvec<sizer.eq> f_plus;
                 COND_RESIZE_CVEC(sizer, f_plus, eq());
-                // Compute equality constraints with perturbed control
-                eqUser(f_plus, x0, u0);
-                // Backward perturbation
-                u0((ph() - 1), j) -= 2 * du;
-                // Backward perturbation
-                u0(ph(), j) -= 2 * du;
+                // Compute equality constraints with forward perturbed control
+                eqUser(f_plus, x0, u0 + (dz * D));
                 cvec<sizer.eq> f_minus;
                 COND_RESIZE_CVEC(sizer, f_minus, eq());
-                // Compute equality constraints with perturbed control
-                eqUser(f_minus, x0, u0);
-                // Restore original control
-                u0((ph() - 1), j) += du;
-                // Restore original control
-                u0(ph(), j) += du;
+                // Compute equality constraints with backward perturbed control
+                eqUser(f_minus, x0, u0 - (dz * D));
                 // Compute central difference
-                cvec<sizer.eq> df = (f_plus - f_minus) / (2 * du);
-                // Update Jconmv
-                Jconmv.middleCols(((ph() - 1) * nu()), nu()).col(j) = df;
+                Jconmv.col(c) = (f_plus - f_minus) / (2 * dz);
             }
         }
 
         /**
-         * Computes the Jacobian matrices Jx and Jmv for the state equation.
-         * The Jacobian matrices are computed using the central difference method.
+         * @brief Jacobian matrices of the system's dynamics at one point of the horizon
+         * together with the point and the vector field value used by the Broyden update
+         */
+        struct StageJacobian
+        {
+            cvec<sizer.nx> x;
+            cvec<sizer.nu> u;
+            cvec<sizer.nx> f;
+            mat<sizer.nx, sizer.nx> Jx;
+            mat<sizer.nx, sizer.nu> Jmv;
+            int updates = 0;
+            bool valid = false;
+        };
+
+        /**
+         * @brief Point and value of the user constraints at the last Jacobian evaluation
+         * (the Jacobian matrix itself is kept in the constraints class)
          *
-         * @param Jx   Reference to the matrix Jx where the computed Jacobian matrix for the state variables will be stored.
-         * @param Jmv  Reference to the matrix Jmv where the computed Jacobian matrix for the control variables will be
-         * stored.
-         * @param x0   Constant reference to the vector x0 representing the current state variables.
-         * @param u0   Constant reference to the vector u0 representing the current control variables.
-         * @param p    Unsigned integer representing the current parameter.
+         * @tparam Tnc number of constraints
          */
-        void computeStateEqJacobian(mat<sizer.nx, sizer.nx> &Jx, mat<sizer.nx, sizer.nu> &Jmv, cvec<sizer.nx> x0,
-                                    cvec<sizer.nu> u0, unsigned int p)
+        template <int Tnc>
+        struct UserJacobian
         {
-            Jx.setZero();
-            Jmv.setZero();
+            cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> x;
+            cvec<sizer.nx> x0;
+            cvec<Tnc> value;
+            int updates = 0;
+            bool valid = false;
+        };
+
+        /**
+         * @brief Compute the Jacobian matrices of the system's dynamics according to the
+         * selected update strategy. The Broyden update uses the vector field value already
+         * computed for the constraints so that no additional model evaluation is required
+         *
+         * @param Jx Jacobian matrix with respect to the state
+         * @param Jmv Jacobian matrix with respect to the control input
+         * @param xk state
+         * @param uk control input
+         * @param fk vector field value at the given state and control input
+         * @param p step of the horizon
+         * @param slot index of the stored Jacobian matrices
+         */
+        void stateEqJacobian(mat<sizer.nx, sizer.nx> &Jx, mat<sizer.nx, sizer.nu> &Jmv,
+                             const cvec<sizer.nx> &xk, const cvec<sizer.nu> &uk, const cvec<sizer.nx> &fk,
+                             unsigned int p, size_t slot)
+        {
+            if (jacobian_update == NLJacobianUpdate::FINITE_DIFFERENCE)
+            {
+                computeStateEqJacobian(Jx, Jmv, xk, uk, p);
+                return;
+            }
 
-            // this is computing the max(abs(x0), 1) for each
-            // element of the state vector x0. This is then used
-            // to scale the perturbation for each element of the state
-            // vector.
-            cvec<sizer.nx> Xa = x0.cwiseAbs().cwiseMax(1.0);
+            StageJacobian &stage = stage_update[slot];
 
-            // Compute Jx using central difference method
-            for (size_t i = 0; i < nx(); i++)
+            bool refresh = !stage.valid || stage.updates >= refresh_iterations;
+            if (!refresh)
             {
-                double dx = dv * Xa(i);
+                cvec<sizer.nx> dx = xk - stage.x;
+                cvec<sizer.nu> du = uk - stage.u;
 
-                cvec<sizer.nx> x_plus = x0;
-                cvec<sizer.nx> x_minus = x0;
+                double step = std::max(dx.template lpNorm<Eigen::Infinity>(), du.template lpNorm<Eigen::Infinity>());
+                double stepNorm = dx.squaredNorm() + du.squaredNorm();
 
-                x_plus(i) += dx;
-                x_minus(i) -= dx;
+                if (step > refresh_step)
+                {
+                    refresh = true;
+                }
+                else if (stepNorm > 0)
+                {
+                    // rank-one correction satisfying the secant condition along the step
+                    cvec<sizer.nx> r = (fk - stage.f) - (stage.Jx * dx) - (stage.Jmv * du);
+                    stage.Jx += (r * dx.transpose()) / stepNorm;
+                    stage.Jmv += (r * du.transpose()) / stepNorm;
+                    stage.updates++;
+                }
+            }
 
-                cvec<sizer.nx> f_plus, f_minus;
-                COND_RESIZE_CVEC(sizer, f_plus, nx());
-                COND_RESIZE_CVEC(sizer, f_minus, nx());
+            if (refresh)
+            {
+                COND_RESIZE_MAT(sizer, stage.Jx, nx(), nx());
+                COND_RESIZE_MAT(sizer, stage.Jmv, nx(), nu());
 
-                model->vectorField(f_plus, x_plus, u0, p);
-                model->vectorField(f_minus, x_minus, u0, p);
+                computeStateEqJacobian(stage.Jx, stage.Jmv, xk, uk, p);
+                stage.updates = 0;
+                stage.valid = true;
+            }
 
-                cvec<sizer.nx> df = (f_plus - f_minus) / (2 * dx);
-                Jx.col(i) = df;
+            stage.x = xk;
+            stage.u = uk;
+            stage.f = fk;
+
+            Jx = stage.Jx;
+            Jmv = stage.Jmv;
+        }
+
+        /**
+         * @brief Update the (transposed) Jacobian matrix of the user constraints with
+         * the Broyden formula. When the initial condition has changed since the last
+         * evaluation the secant condition is not meaningful and the Jacobian matrix
+         * is reused as is
+         *
+         * @tparam Tnc number of constraints
+         * @param update data of the last Jacobian evaluation
+         * @param JT transposed Jacobian matrix to update
+         * @param x internal optimization vector
+         * @param value constraints value at the optimization vector
+         * @return true if the Jacobian matrix has been updated
+         * @return false if the finite differences have to be recomputed
+         */
+        template <int Tnc>
+        bool updateUserJacobian(UserJacobian<Tnc> &update,
+                                mat<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1), Tnc> &JT,
+                                const Eigen::Ref<const cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)>> &x,
+                                const cvec<Tnc> &value)
+        {
+            if (jacobian_update == NLJacobianUpdate::FINITE_DIFFERENCE ||
+                !update.valid || update.updates >= refresh_iterations)
+            {
+                return false;
             }
 
-            cvec<sizer.nu> Ua = u0.cwiseAbs().cwiseMax(1.0);
+            cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> dx = x - update.x;
+            if (dx.template lpNorm<Eigen::Infinity>() > refresh_step)
+            {
+                return false;
+            }
 
-            // Compute Jmv using central difference method
-            for (size_t i = 0; i < nu(); i++)
+            double stepNorm = dx.squaredNorm();
+            if (stepNorm > 0 && update.x0 == x0)
             {
-                // TODO support measured disturbances
-                double du = dv * Ua(i);
-                cvec<sizer.nu> u_plus = u0;
-                cvec<sizer.nu> u_minus = u0;
+                cvec<Tnc> r = (value - update.value) - (JT.transpose() * dx);
+                JT += (dx * r.transpose()) / stepNorm;
+            }
+
+            update.updates++;
+            update.x = x;
+            update.x0 = x0;
+            update.value = value;
 
-                u_plus(i) += du;
-                u_minus(i) -= du;
+            return true;
+        }
 
-                cvec<sizer.nx> f_plus, f_minus;
-                COND_RESIZE_CVEC(sizer, f_plus, nx());
-                COND_RESIZE_CVEC(sizer, f_minus, nx());
+        /**
+         * @brief Store the point of a finite differences evaluation of the user
+         * constraints Jacobian matrix
+         *
+         * @tparam Tnc number of constraints
+         * @param update data of the last Jacobian evaluation
+         * @param x internal optimization vector
+         * @param value constraints value at the optimization vector
+         */
+        template <int Tnc>
+        void storeUserJacobian(UserJacobian<Tnc> &update,
+                               const Eigen::Ref<const cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)>> &x,
+                               const cvec<Tnc> &value)
+        {
+            update.x = x;
+            update.x0 = x0;
+            update.value = value;
+            update.updates = 0;
+            update.valid = true;
+        }
 
-                model->vectorField(f_plus, x0, u_plus, p);
-                model->vectorField(f_minus, x0, u_minus, p);
+        /**
+         * Computes the Jacobian matrices Jx and Jmv for the state equation.
+         * The Jacobian matrices are computed using the central difference method.
+         *
+         * @param Jx   Reference to the matrix Jx where the computed Jacobian matrix for the state variables will be stored.
+         * @param Jmv  Reference to the matrix Jmv where the computed Jacobian matrix for the control variables will be
+         * stored.
+         * @param x0   Constant reference to the vector x0 representing the current state variables.
+         * @param u0   Constant reference to the vector u0 representing the current control variables.
+         * @param p    Unsigned integer representing the current parameter.
+         */
+        void computeStateEqJacobian(mat<sizer.nx, sizer.nx> &Jx, mat<sizer.nx, sizer.nu> &Jmv, cvec<sizer.nx> x0,
+                                    cvec<sizer.nu> u0, unsigned int p)
+        {
+            // batch of a single point with its own work buffers, the batch of the
+            // horizon keeps the size of its buffers
+            Xr.resize(nx(), 1);
+            Ur.resize(nu(), 1);
+            steps_r.resize(1);
 
-                cvec<sizer.nx> df = (f_plus - f_minus) / (2 * du);
-                Jmv.col(i) = df;
-            }
+            Xr.col(0) = x0;
+            Ur.col(0) = u0;
+            steps_r[0] = p;
+
+            model->transitionJacobians(Ar, Br, Xr, Ur, steps_r, point_ws);
+
+            Jx = Ar;
+            Jmv = Br;
         }
 
         cvec<sizer.ph * sizer.nx> ceq;
         mat<(sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1, sizer.ph * sizer.nx> Jceq;
 
+        // batch of points of the system's dynamics, their Jacobian matrices and the
+        // work buffers of the finite differences
+        mat<sizer.nx, Eigen::Dynamic> Xb, Fb, Ab, Bb;
+        mat<sizer.nu, Eigen::Dynamic> Ub;
+        std::vector<unsigned int> steps;
+        typename Model<sizer>::Workspace model_ws;
+
+        // single point refreshed by the Broyden update and its work buffers
+        mat<sizer.nx, Eigen::Dynamic> Xr, Ar, Br;
+        mat<sizer.nu, Eigen::Dynamic> Ur;
+        std::vector<unsigned int> steps_r;
+        typename Model<sizer>::Workspace point_ws;
+
         cvec<2 * sizer.ph * sizer.ny> cineq;
         mat<(sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1, 2 * sizer.ph * sizer.ny> Jcineq;
 
@@ -861,8 +1139,18 @@ namespace mpc
         using Base<sizer>::Umat;
         using Base<sizer>::e;
         using Base<sizer>::niteration;
+        using Base<sizer>::fixed_slack;
+        using Base<sizer>::x_restored;
 
         const double dv = sqrt(std::numeric_limits<double>::epsilon());
         double ieq_tolerance, eq_tolerance;
+
+        NLJacobianUpdate jacobian_update = NLJacobianUpdate::FINITE_DIFFERENCE;
+        int refresh_iterations = 10;
+        double refresh_step = 0.1;
+
+        std::vector<StageJacobian> stage_update;
+        UserJacobian<sizer.ineq> ineq_update;
+        UserJacobian<sizer.eq> eq_update;
     };
 } // namespace mpc
\ No newline at end of file
@@ -0,0 +1,249 @@
+/*
+ *   Copyright (c) 2023 Nicola Piccinelli
+ *   All rights reserved.
+ */
+#pragma once
+
+#include <mpc/Logger.hpp>
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace mpc
+{
+    /**
+     * @brief Small fixed team of threads, each thread owns a task that is executed
+     * every time it is launched. The threads are created once and wait for the next
+     * launch between the executions, so that launching a task does not create threads
+     * nor allocate memory. The messages logged by the threads are muted
+     */
+    class EvaluationTeam
+    {
+    public:
+        /**
+         * @brief Wait for the tasks of the team when leaving the scope, so that no task
+         * is still running on the data of the caller on any exit path. The errors of the
+         * tasks are discarded only while unwinding from another error, otherwise they
+         * are expected to be collected with EvaluationTeam::wait
+         */
+        class Guard
+        {
+        public:
+            explicit Guard(EvaluationTeam *team) : team(team) {}
+
+            ~Guard()
+            {
+                if (team)
+                {
+                    team->join();
+                }
+            }
+
+            Guard(const Guard &) = delete;
+            Guard &operator=(const Guard &) = delete;
+
+        private:
+            EvaluationTeam *team;
+        };
+
+        EvaluationTeam() = default;
+
+        EvaluationTeam(const EvaluationTeam &) = delete;
+        EvaluationTeam &operator=(const EvaluationTeam &) = delete;
+
+        ~EvaluationTeam()
+        {
+            stop();
+        }
+
+        /**
+         * @brief Create one thread for each task, the threads of the previous tasks
+         * are stopped
+         *
+         * @param tasks tasks executed by the threads
+         */
+        void start(const std::vector<std::function<void()>> &tasks)
+        {
+            stop();
+
+            for (auto &task : tasks)
+            {
+                auto w = std::make_unique<Worker>();
+                w->task = task;
+                w->thread = std::thread(&EvaluationTeam::loop, w.get());
+                workers.push_back(std::move(w));
+            }
+        }
+
+        /**
+         * @brief Stop and join the threads of the team
+         */
+        void stop()
+        {
+            for (auto &w : workers)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(w->mutex);
+                    w->quit = true;
+                }
+
+                w->cv.notify_all();
+                w->thread.join();
+            }
+
+            workers.clear();
+        }
+
+        /**
+         * @brief Return the number of threads of the team
+         *
+         * @return size_t number of threads
+         */
+        size_t size() const
+        {
+            return workers.size();
+        }
+
+        /**
+         * @brief Launch the task of all the threads, the previous executions
+         * must have been waited
+         */
+        void launch()
+        {
+            for (auto &w : workers)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(w->mutex);
+                    w->pending = true;
+                }
+
+                w->cv.notify_all();
+            }
+        }
+
+        /**
+         * @brief Wait for the task of a thread to be completed, the exception
+         * thrown by the task is rethrown
+         *
+         * @param k index of the thread
+         */
+        void wait(size_t k)
+        {
+            auto &w = *workers[k];
+
+            std::unique_lock<std::mutex> lock(w.mutex);
+            w.cv.wait(lock, [&w]()
+                      { return !w.pending; });
+
+            if (w.error)
+            {
+                std::exception_ptr error = w.error;
+                w.error = nullptr;
+                std::rethrow_exception(error);
+            }
+        }
+
+        /**
+         * @brief Wait for the tasks of all the threads to be completed
+         */
+        void wait()
+        {
+            std::exception_ptr error;
+            for (size_t k = 0; k < workers.size(); k++)
+            {
+                try
+                {
+                    wait(k);
+                }
+                catch (...)
+                {
+                    // all the threads are waited before rethrowing
+                    if (!error)
+                    {
+                        error = std::current_exception();
+                    }
+                }
+            }
+
+            if (error)
+            {
+                std::rethrow_exception(error);
+            }
+        }
+
+        /**
+         * @brief Wait for the tasks of all the threads to be completed without
+         * rethrowing, the errors are discarded
+         */
+        void join() noexcept
+        {
+            for (auto &w : workers)
+            {
+                std::unique_lock<std::mutex> lock(w->mutex);
+                w->cv.wait(lock, [&w]()
+                           { return !w->pending; });
+                w->error = nullptr;
+            }
+        }
+
+    private:
+        struct Worker
+        {
+            std::function<void()> task;
+            std::thread thread;
+            std::mutex mutex;
+            std::condition_variable cv;
+            bool pending = false;
+            bool quit = false;
+            std::exception_ptr error;
+        };
+
+        /**
+         * @brief Execution loop of a thread, the task is executed at each launch
+         * until the thread is stopped
+         *
+         * @param w thread of the team
+         */
+        static void loop(Worker *w)
+        {
+            // the messages of the tasks are not interleaved with the ones of the caller
+            Logger::ThreadMute mute;
+
+            std::unique_lock<std::mutex> lock(w->mutex);
+            while (true)
+            {
+                w->cv.wait(lock, [w]()
+                           { return w->pending || w->quit; });
+
+                if (!w->pending)
+                {
+                    return;
+                }
+
+                lock.unlock();
+
+                std::exception_ptr error;
+                try
+                {
+                    w->task();
+                }
+                catch (...)
+                {
+                    error = std::current_exception();
+                }
+
+                lock.lock();
+                w->error = error;
+                w->pending = false;
+                w->cv.notify_all();
+            }
+        }
+
+        std::vector<std::unique_ptr<Worker>> workers;
+    };
+}
@@ -0,0 +1,1191 @@
+/*
+ *   Copyright (c) 2023 Nicola Piccinelli
+ *   All rights reserved.
+ */
+#pragma once
+
+#include <mpc/IComponent.hpp>
+#include <mpc/Logger.hpp>
+#include <mpc/NLMPC/Constraints.hpp>
+#include <mpc/NLMPC/Mapping.hpp>
+#include <mpc/NLMPC/Objective.hpp>
+#include <mpc/NLMPC/SQPProblemBuilder.hpp>
+#include <mpc/Types.hpp>
+
+#include <Eigen/SparseCholesky>
+
+namespace mpc
+{
+    /**
+     * @brief Primal-dual interior point solver for the non-linear mpc.
+     * The user inequality constraints are turned into equalities by means
+     * of non-negative slack variables while the bounds of the optimization
+     * vector are handled by logarithmic barriers. At each iteration the
+     * (quasi-definite) reduced KKT system
+     *
+     *   | H + S   J' | | dx |   | rd |
+     *   |   J    -D  | | dy | = | rp |
+     *
+     * is factorized with a sparse LDL' decomposition (Eigen::SimplicialLDLT with
+     * the natural ordering). The sparsity pattern of the constraints Jacobian
+     * follows the multiple shooting structure of the optimization vector (shared
+     * with the SQP sub-problem), the factorization exploits this sparsity but it
+     * is a general sparse one, not a banded (Riccati) recursion over the stages
+     * of the horizon. The symbolic analysis is performed only when the pattern
+     * changes. The hessian of the lagrangian is
+     * approximated by the curvature of the objective function, the Gauss-Newton
+     * approximation is used for objective functions in residual form (the
+     * curvature of the constraints is neglected). When the warm start is enabled the
+     * multipliers and the barrier parameter of the last solution are used to
+     * initialize the next one, the multipliers of the system's dynamics and of the
+     * bounds are shifted by one stage together with the optimization vector.
+     *
+     * @tparam sizer.nx dimension of the state space
+     * @tparam sizer.nu dimension of the input space
+     * @tparam sizer.ny dimension of the output space
+     * @tparam sizer.ph length of the prediction horizon
+     * @tparam sizer.ch length of the control horizon
+     * @tparam sizer.ineq number of the user inequality constraints
+     * @tparam sizer.eq number of the user equality constraints
+     */
+    template <MPCSize sizer>
+    class IPMSolver : public IComponent<sizer>
+    {
+    private:
+        using IComponent<sizer>::checkOrQuit;
+        using IDimensionable<sizer>::nu;
+        using IDimensionable<sizer>::nx;
+        using IDimensionable<sizer>::ndu;
+        using IDimensionable<sizer>::ny;
+        using IDimensionable<sizer>::ph;
+        using IDimensionable<sizer>::ch;
+        using IDimensionable<sizer>::ineq;
+        using IDimensionable<sizer>::eq;
+
+    public:
+        /**
+         * @brief Interior point solver status
+         */
+        enum Status
+        {
+            SOLVED,
+            MAX_ITER_REACHED,
+            TIME_LIMIT_REACHED,
+            NUMERICAL_ERROR,
+            LINE_SEARCH_FAILED,
+            UNSOLVED
+        };
+
+        IPMSolver() = default;
+        ~IPMSolver() = default;
+
+        /**
+         * @brief Initialization hook override. Performing initialization in this
+         * method ensures the correct problem dimensions assigment has been
+         * already performed
+         */
+        void onInit() override
+        {
+            builder = std::make_shared<SQPProblemBuilder<sizer>>();
+            builder->initialize(nx(), nu(), ndu(), ny(), ph(), ch(), ineq(), eq());
+
+            COND_RESIZE_CVEC(sizer, z, builder->numVars());
+            COND_RESIZE_CVEC(sizer, zl, builder->numVars());
+            COND_RESIZE_CVEC(sizer, zu, builder->numVars());
+            COND_RESIZE_CVEC(sizer, s, ineq());
+            COND_RESIZE_CVEC(sizer, y, numDuals());
+            COND_RESIZE_CVEC(sizer, c, numDuals());
+
+            z.setZero();
+            zl.setZero();
+            zu.setZero();
+            s.setZero();
+            y.setZero();
+            c.setZero();
+
+            has_solution = false;
+            is_analyzed = false;
+        }
+
+        /**
+         * @brief Set the model and the mapping object references
+         *
+         * @param sysModel the model object
+         * @param map the mapping object
+         */
+        void setModel(std::shared_ptr<Model<sizer>> sysModel, std::shared_ptr<Mapping<sizer>> map)
+        {
+            checkOrQuit();
+
+            model = sysModel;
+            mapping = map;
+            builder->setMapping(map);
+        }
+
+        /**
+         * @brief Set the Cost And Constraints object
+         *
+         * @param objFunc
+         * @param conFunc
+         */
+        void setCostAndConstraints(
+            std::shared_ptr<Objective<sizer>> objFunc,
+            std::shared_ptr<Constraints<sizer>> conFunc)
+        {
+            checkOrQuit();
+
+            this->objFunc = objFunc;
+            this->conFunc = conFunc;
+        }
+
+        /**
+         * @brief Set the interior point solver parameters
+         *
+         * @param param parameters desired
+         */
+        void setParameters(const NLParameters &param)
+        {
+            checkOrQuit();
+
+            tolerance = param.ipm_tolerance;
+            barrier_init = param.ipm_barrier_init;
+            maximum_iteration = param.maximum_iteration;
+            time_limit = param.time_limit;
+            warm_start = param.enable_warm_start;
+            dual_warm_start = param.enable_dual_warm_start;
+        }
+
+        /**
+         * @brief Solve the non-linear problem starting from the given optimization vector
+         *
+         * @param x initial guess of the optimization vector
+         * @param x0 system's initial condition
+         * @param lb optimization vector lower bounds
+         * @param ub optimization vector upper bounds
+         * @param xopt resulting optimization vector
+         * @param shifted the initial guess is the last solution shifted by one stage
+         * @return true if the resulting optimization vector can be used
+         * @return false
+         */
+        bool solve(
+            const cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> &x,
+            const cvec<sizer.nx> &x0,
+            const cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> &lb,
+            const cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> &ub,
+            cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> &xopt,
+            bool shifted = false)
+        {
+            checkOrQuit();
+
+            auto start = std::chrono::steady_clock::now();
+
+            objFunc->setCurrentState(x0);
+            conFunc->setCurrentState(x0);
+
+            hasIneq = conFunc->hasIneqConstraints() && ineq() > 0;
+            hasEq = conFunc->hasEqConstraints() && eq() > 0;
+
+            if (!builder->isPatternValid(hasIneq, hasEq))
+            {
+                builder->buildPattern(hasIneq, hasEq);
+                is_analyzed = false;
+                has_solution = false;
+            }
+
+            this->lb = lb;
+            this->ub = ub;
+            initializePoint(x, shifted);
+
+            status = MAX_ITER_REACHED;
+            iterations = 0;
+            double merit_penalty = 1.0;
+
+            for (iterations = 0; iterations < maximum_iteration; iterations++)
+            {
+                if (time_limit > 0 &&
+                    std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() > time_limit)
+                {
+                    status = TIME_LIMIT_REACHED;
+                    break;
+                }
+
+                // objective function and constraints derivatives at the current iterate
+                typename Objective<sizer>::Cost obj;
+                if (objFunc->hasResidual())
+                {
+                    mat<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1), ((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> hessian;
+                    obj = objFunc->evaluateGaussNewton(z, hessian);
+                    hessian.diagonal().array() += hessian_regularization;
+                    if (builder->setHessian(hessian))
+                    {
+                        is_analyzed = false;
+                    }
+                }
+                else
+                {
+                    obj = objFunc->evaluate(z, true);
+                    builder->setHessianDiagonal(
+                        objFunc->evaluateHessianDiagonal(z, obj.value).cwiseMax(hessian_regularization));
+                }
+
+                evaluateConstraints(z, true);
+
+                // residuals of the optimality conditions
+                cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> rd;
+                rd = obj.grad + jacobianTransposeProduct(y) - zl + zu;
+                for (int i = 0; i < builder->numVars(); i++)
+                {
+                    if (fixed[i])
+                    {
+                        rd(i) = 0;
+                    }
+                }
+
+                cvec<((sizer.ph * sizer.nx) + sizer.ineq + sizer.eq)> rp;
+                rp = constraintsViolation(c, s);
+
+                double sd = dualScaling();
+                double sc = complementarityScaling();
+                double err_dual = rd.template lpNorm<Eigen::Infinity>() / sd;
+                double err_primal = rp.size() > 0 ? rp.template lpNorm<Eigen::Infinity>() : 0.0;
+
+                double err = std::max({err_dual, err_primal, complementarityError(0.0) / sc});
+
+                Logger::instance().log(Logger::log_type::DETAIL)
+                    << "IPM iteration " << iterations
+                    << " cost: " << obj.value
+                    << " error: " << err
+                    << " barrier: " << mu
+                    << std::endl;
+
+                if (err <= tolerance)
+                {
+                    status = SOLVED;
+                    break;
+                }
+
+                // monotone update of the barrier parameter
+                while (mu > (tolerance / 10.0) &&
+                       std::max({err_dual, err_primal, complementarityError(mu) / sc}) <= barrier_kappa_eps * mu)
+                {
+                    mu = std::max(tolerance / 10.0, std::min(barrier_kappa_mu * mu, std::pow(mu, barrier_theta_mu)));
+                }
+
+                // newton step
+                cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> sigma, dz, gb;
+                COND_RESIZE_CVEC(sizer, sigma, builder->numVars());
+                COND_RESIZE_CVEC(sizer, gb, builder->numVars());
+                for (int i = 0; i < builder->numVars(); i++)
+                {
+                    sigma(i) = 0;
+                    gb(i) = obj.grad(i);
+
+                    if (hasLower[i])
+                    {
+                        sigma(i) += zl(i) / (z(i) - lb(i));
+                        gb(i) -= mu / (z(i) - lb(i));
+                    }
+
+                    if (hasUpper[i])
+                    {
+                        sigma(i) += zu(i) / (ub(i) - z(i));
+                        gb(i) += mu / (ub(i) - z(i));
+                    }
+
+                    if (fixed[i])
+                    {
+                        gb(i) = 0;
+                    }
+                }
+
+                cvec<((sizer.ph * sizer.nx) + sizer.ineq + sizer.eq)> dy;
+                if (!computeStep(sigma, gb, dz, dy))
+                {
+                    status = NUMERICAL_ERROR;
+                    break;
+                }
+
+                cvec<sizer.ineq> ds;
+                COND_RESIZE_CVEC(sizer, ds, ineq());
+                ds.setZero();
+
+                cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> dzl, dzu;
+                COND_RESIZE_CVEC(sizer, dzl, builder->numVars());
+                COND_RESIZE_CVEC(sizer, dzu, builder->numVars());
+                dzl.setZero();
+                dzu.setZero();
+
+                int ineqOffset = ph() * nx();
+                if (hasIneq)
+                {
+                    for (size_t j = 0; j < ineq(); j++)
+                    {
+                        double yj = y(ineqOffset + j);
+                        ds(j) = (mu / yj) - s(j) - ((s(j) / yj) * dy(ineqOffset + j));
+                    }
+                }
+
+                for (int i = 0; i < builder->numVars(); i++)
+                {
+                    if (hasLower[i])
+                    {
+                        dzl(i) = (mu / (z(i) - lb(i))) - zl(i) - ((zl(i) / (z(i) - lb(i))) * dz(i));
+                    }
+
+                    if (hasUpper[i])
+                    {
+                        dzu(i) = (mu / (ub(i) - z(i))) - zu(i) + ((zu(i) / (ub(i) - z(i))) * dz(i));
+                    }
+                }
+
+                // fraction to the boundary rule
+                double tau = std::max(0.99, 1.0 - mu);
+                double alpha_primal = 1.0;
+                double alpha_dual = 1.0;
+
+                for (int i = 0; i < builder->numVars(); i++)
+                {
+                    if (hasLower[i] && dz(i) < 0)
+                    {
+                        alpha_primal = std::min(alpha_primal, -tau * (z(i) - lb(i)) / dz(i));
+                    }
+
+                    if (hasUpper[i] && dz(i) > 0)
+                    {
+                        alpha_primal = std::min(alpha_primal, tau * (ub(i) - z(i)) / dz(i));
+                    }
+
+                    if (hasLower[i] && dzl(i) < 0)
+                    {
+                        alpha_dual = std::min(alpha_dual, -tau * zl(i) / dzl(i));
+                    }
+
+                    if (hasUpper[i] && dzu(i) < 0)
+                    {
+                        alpha_dual = std::min(alpha_dual, -tau * zu(i) / dzu(i));
+                    }
+                }
+
+                if (hasIneq)
+                {
+                    for (size_t j = 0; j < ineq(); j++)
+                    {
+                        if (ds(j) < 0)
+                        {
+                            alpha_primal = std::min(alpha_primal, -tau * s(j) / ds(j));
+                        }
+
+                        if (dy(ineqOffset + j) < 0)
+                        {
+                            alpha_dual = std::min(alpha_dual, -tau * y(ineqOffset + j) / dy(ineqOffset + j));
+                        }
+                    }
+                }
+
+                // backtracking line search on the l1 merit function
+                double theta = rp.template lpNorm<1>();
+                double dphi_barrier = gb.dot(dz);
+                double curvature = hessianProduct(dz) + (sigma.array() * dz.array().square()).sum();
+                if (hasIneq)
+                {
+                    for (size_t j = 0; j < ineq(); j++)
+                    {
+                        dphi_barrier -= mu * ds(j) / s(j);
+                        curvature += (y(ineqOffset + j) / s(j)) * ds(j) * ds(j);
+                    }
+                }
+
+                if (theta > 0)
+                {
+                    double required = (dphi_barrier + 0.5 * std::max(curvature, 0.0)) / ((1.0 - merit_rho) * theta);
+                    merit_penalty = std::max(merit_penalty, required);
+                }
+
+                double phi0 = obj.value - (mu * barrierTerm(z, s)) + (merit_penalty * theta);
+                double dphi = dphi_barrier - (merit_penalty * theta);
+
+                cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> z_trial;
+                cvec<sizer.ineq> s_trial;
+                double alpha = alpha_primal;
+                bool accepted = false;
+                for (int k = 0; k < max_backtracking; k++)
+                {
+                    z_trial = z + (alpha * dz);
+                    s_trial = s + (alpha * ds);
+
+                    double f_trial = objFunc->evaluate(z_trial, false).value;
+                    evaluateConstraints(z_trial, false);
+                    double phi = f_trial - (mu * barrierTerm(z_trial, s_trial)) +
+                                 (merit_penalty * constraintsViolation(c, s_trial).template lpNorm<1>());
+
+                    if (std::isfinite(phi) && phi <= phi0 + (merit_eta * alpha * dphi))
+                    {
+                        accepted = true;
+                        break;
+                    }
+
+                    alpha *= 0.5;
+                }
+
+                // the last accepted iterate is kept when no trial step decreases the merit function
+                if (!accepted)
+                {
+                    Logger::instance().log(Logger::log_type::DETAIL)
+                        << "IPM line search failed after "
+                        << max_backtracking
+                        << " backtracking steps"
+                        << std::endl;
+
+                    status = LINE_SEARCH_FAILED;
+                    break;
+                }
+
+                Logger::instance().log(Logger::log_type::DETAIL)
+                    << "IPM step length primal: " << alpha
+                    << " dual: " << alpha_dual
+                    << std::endl;
+
+                // the equality multipliers follow the accepted primal step while
+                // the multipliers which have to be positive the dual one
+                z = z_trial;
+                s = s_trial;
+                y.head(ph() * nx()) += alpha * dy.head(ph() * nx());
+                y.tail(eq()) += alpha * dy.tail(eq());
+                if (hasIneq)
+                {
+                    y.segment(ineqOffset, ineq()) += alpha_dual * dy.segment(ineqOffset, ineq());
+                }
+                zl += alpha_dual * dzl;
+                zu += alpha_dual * dzu;
+
+                resetPositiveMultipliers();
+            }
+
+            Logger::instance().log(Logger::log_type::DETAIL)
+                << "IPM end after " << iterations
+                << " iterations with status: " << status
+                << std::endl;
+
+            if (status == NUMERICAL_ERROR)
+            {
+                has_solution = false;
+                return false;
+            }
+
+            xopt = z;
+            mu_last = mu;
+            has_solution = true;
+
+            return true;
+        }
+
+        /**
+         * @brief Get the status code of the last solve
+         *
+         * @return int interior point status code
+         */
+        int solverStatus() const
+        {
+            return status;
+        }
+
+        /**
+         * @brief Get the number of iterations of the last solve
+         *
+         * @return int number of iterations
+         */
+        int solverIterations() const
+        {
+            return iterations;
+        }
+
+        /**
+         * @brief Get the multipliers of the constraints of the last solution in the order
+         * system's dynamics, user inequality and user equality constraints
+         *
+         * @return cvec<((sizer.ph * sizer.nx) + sizer.ineq + sizer.eq)> multipliers
+         */
+        cvec<((sizer.ph * sizer.nx) + sizer.ineq + sizer.eq)> dualMultipliers() const
+        {
+            return y;
+        }
+
+        /**
+         * @brief Set the multipliers of the constraints used to initialize the next solve,
+         * they replace the ones of the last solution
+         *
+         * @param guess multipliers in the order system's dynamics, user inequality and
+         * user equality constraints
+         */
+        void setDualMultipliers(const cvec<((sizer.ph * sizer.nx) + sizer.ineq + sizer.eq)> &guess)
+        {
+            checkOrQuit();
+
+            dual_guess = guess;
+            has_dual_guess = true;
+        }
+
+        /**
+         * @brief Discard the multipliers and the barrier parameter of the last solution,
+         * the next solve starts from the central path (e.g. when the scaling of the
+         * optimization vector changes)
+         */
+        void resetWarmStart()
+        {
+            checkOrQuit();
+
+            has_solution = false;
+        }
+
+        /**
+         * @brief Converts the status of the interior point solver to the corresponding ResultStatus enum value.
+         *
+         * @param status The interior point status value to convert.
+         * @return The corresponding ResultStatus enum value.
+         *
+         * @see ResultStatus
+         */
+        static ResultStatus convertToResultStatus(int status)
+        {
+            switch (status)
+            {
+            case SOLVED:
+                return ResultStatus::SUCCESS;
+            case MAX_ITER_REACHED:
+            case TIME_LIMIT_REACHED:
+                return ResultStatus::MAX_ITERATION;
+            case NUMERICAL_ERROR:
+                return ResultStatus::ERROR;
+            case LINE_SEARCH_FAILED:
+            case UNSOLVED:
+                return ResultStatus::UNKNOWN;
+            default:
+                return ResultStatus::UNKNOWN;
+            }
+        }
+
+        /**
+         * @brief Converts the status of the interior point solver to a description string
+         *
+         * @param status The interior point status value to convert.
+         * @return std::string status description
+         */
+        static std::string statusMessage(int status)
+        {
+            switch (status)
+            {
+            case SOLVED:
+                return "Solved";
+            case MAX_ITER_REACHED:
+                return "Maximum number of iterations reached";
+            case TIME_LIMIT_REACHED:
+                return "Time limit reached";
+            case NUMERICAL_ERROR:
+                return "Unable to factorize the KKT system";
+            case LINE_SEARCH_FAILED:
+                return "Line search failed, the last accepted iterate is returned";
+            default:
+                return "Unsolved";
+            }
+        }
+
+    private:
+        /**
+         * @brief Get the number of multipliers of the constraints
+         * (system's dynamics, user inequality and user equality)
+         *
+         * @return int number of multipliers
+         */
+        int numDuals()
+        {
+            return (ph() * nx()) + ineq() + eq();
+        }
+
+        /**
+         * @brief Move the initial guess strictly inside the bounds and
+         * initialize the slack variables, the multipliers and the barrier
+         *
+         * @param x initial guess of the optimization vector
+         * @param shifted the initial guess is the last solution shifted by one stage
+         */
+        void initializePoint(const cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> &x, bool shifted)
+        {
+            int n = builder->numVars();
+            hasLower.assign(n, false);
+            hasUpper.assign(n, false);
+            fixed.assign(n, false);
+
+            z = x;
+            for (int i = 0; i < n; i++)
+            {
+                bool l = std::isfinite(lb(i));
+                bool u = std::isfinite(ub(i));
+
+                if (l && u && (ub(i) - lb(i)) <= fixed_tolerance)
+                {
+                    // a variable with coincident bounds is removed from the problem
+                    fixed[i] = true;
+                    z(i) = lb(i);
+                    continue;
+                }
+
+                hasLower[i] = l;
+                hasUpper[i] = u;
+
+                if (l)
+                {
+                    double push = bound_push * std::max(1.0, std::fabs(lb(i)));
+                    if (u)
+                    {
+                        push = std::min(push, bound_push * (ub(i) - lb(i)));
+                    }
+                    z(i) = std::max(z(i), lb(i) + push);
+                }
+
+                if (u)
+                {
+                    double push = bound_push * std::max(1.0, std::fabs(ub(i)));
+                    if (l)
+                    {
+                        push = std::min(push, bound_push * (ub(i) - lb(i)));
+                    }
+                    z(i) = std::min(z(i), ub(i) - push);
+                }
+            }
+
+            evaluateConstraints(z, false);
+
+            int ineqOffset = ph() * nx();
+            s.setZero();
+            if (hasIneq)
+            {
+                s = (-c.segment(ineqOffset, ineq())).cwiseMax(bound_push);
+            }
+
+            bool warm = warm_start && dual_warm_start && has_solution;
+            if (warm)
+            {
+                // the barrier restarts close to the last one, since the new
+                // problem is expected to be a small perturbation of the last one
+                mu = std::min(barrier_init, std::max(barrier_warm_factor * mu_last, tolerance));
+
+                if (shifted)
+                {
+                    shiftMultipliers();
+                }
+
+                resetPositiveMultipliers();
+            }
+            else
+            {
+                mu = barrier_init;
+
+                y.setZero();
+                zl.setZero();
+                zu.setZero();
+
+                if (hasIneq)
+                {
+                    for (size_t j = 0; j < ineq(); j++)
+                    {
+                        y(ineqOffset + j) = mu / s(j);
+                    }
+                }
+
+                for (int i = 0; i < n; i++)
+                {
+                    if (hasLower[i])
+                    {
+                        zl(i) = mu / (z(i) - lb(i));
+                    }
+
+                    if (hasUpper[i])
+                    {
+                        zu(i) = mu / (ub(i) - z(i));
+                    }
+                }
+            }
+
+            // the multipliers provided by the user replace the ones of the constraints
+            if (has_dual_guess)
+            {
+                y = dual_guess;
+                for (size_t j = 0; j < ineq(); j++)
+                {
+                    y(ineqOffset + j) = hasIneq ? clampMultiplier(y(ineqOffset + j), s(j)) : 0.0;
+                }
+
+                if (!hasEq)
+                {
+                    y.segment(ineqOffset + ineq(), eq()).setZero();
+                }
+
+                has_dual_guess = false;
+            }
+
+            Logger::instance().log(Logger::log_type::DETAIL)
+                << "IPM initialized with barrier: " << mu
+                << (warm ? " (warm start)" : "")
+                << std::endl;
+        }
+
+        /**
+         * @brief Shift the multipliers of the system's dynamics and of the bounds by
+         * one stage, the multipliers of the user constraints are kept since their
+         * dependency on the stages is not known
+         */
+        void shiftMultipliers()
+        {
+            for (size_t i = 0; i + 1 < ph(); i++)
+            {
+                y.middleRows(i * nx(), nx()) = y.middleRows((i + 1) * nx(), nx());
+            }
+
+            mapping->shiftVector(zl);
+            mapping->shiftVector(zu);
+        }
+
+        /**
+         * @brief Keep the multipliers which have to be positive close to the
+         * central path (and restore the ones of the inactive bounds to zero)
+         */
+        void resetPositiveMultipliers()
+        {
+            for (int i = 0; i < builder->numVars(); i++)
+            {
+                zl(i) = hasLower[i] ? clampMultiplier(zl(i), z(i) - lb(i)) : 0.0;
+                zu(i) = hasUpper[i] ? clampMultiplier(zu(i), ub(i) - z(i)) : 0.0;
+            }
+
+            int ineqOffset = ph() * nx();
+            for (size_t j = 0; j < ineq(); j++)
+            {
+                y(ineqOffset + j) = hasIneq ? clampMultiplier(y(ineqOffset + j), s(j)) : 0.0;
+            }
+        }
+
+        /**
+         * @brief Clamp a multiplier to a safeguarded neighborhood of the central path
+         *
+         * @param v current multiplier value
+         * @param distance distance of the associated variable from its bound
+         * @return double clamped multiplier
+         */
+        double clampMultiplier(double v, double distance) const
+        {
+            double center = mu / distance;
+            return std::max(center / multiplier_kappa, std::min(v, center * multiplier_kappa));
+        }
+
+        /**
+         * @brief Evaluate the value of the constraints in the order system's dynamics,
+         * user inequality and user equality. If requested the Jacobian matrices are
+         * stored in the sparse pattern of the builder
+         *
+         * @param x optimization vector
+         * @param hasGradient request the computation of the Jacobian matrices
+         */
+        void evaluateConstraints(
+            const cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> &x,
+            bool hasGradient)
+        {
+            int ineqOffset = ph() * nx();
+            int eqOffset = ineqOffset + ineq();
+
+            c.setZero();
+
+            auto cs = conFunc->evaluateStateModelEq(x, hasGradient);
+            c.head(ph() * nx()) = cs.value;
+
+            mat<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1), sizer.ineq> JineqT;
+            COND_RESIZE_MAT(sizer, JineqT, builder->numVars(), ineq());
+            JineqT.setZero();
+            // skip the evaluation when the user constraints are statically empty
+            if constexpr (sizer.ineq.value != 0)
+            {
+                if (hasIneq)
+                {
+                    auto ci = conFunc->evaluateIneq(x, hasGradient);
+                    c.segment(ineqOffset, ineq()) = ci.value;
+                    if (hasGradient)
+                    {
+                        JineqT = Eigen::Map<mat<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1), sizer.ineq>>(
+                            ci.grad.data(), builder->numVars(), ineq());
+                    }
+                }
+            }
+
+            mat<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1), sizer.eq> JeqT;
+            COND_RESIZE_MAT(sizer, JeqT, builder->numVars(), eq());
+            JeqT.setZero();
+            if constexpr (sizer.eq.value != 0)
+            {
+                if (hasEq)
+                {
+                    auto ce = conFunc->evaluateEq(x, hasGradient);
+                    c.segment(eqOffset, eq()) = ce.value;
+                    if (hasGradient)
+                    {
+                        JeqT = Eigen::Map<mat<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1), sizer.eq>>(
+                            ce.grad.data(), builder->numVars(), eq());
+                    }
+                }
+            }
+
+            if (hasGradient)
+            {
+                mat<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1), (sizer.ph * sizer.nx)> JstateT;
+                JstateT = Eigen::Map<mat<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1), (sizer.ph * sizer.nx)>>(
+                    cs.grad.data(), builder->numVars(), (ph() * nx()));
+
+                builder->setJacobian(JstateT, JineqT, JeqT);
+            }
+        }
+
+        /**
+         * @brief Compute the violation of the constraints, the user inequality
+         * constraints are shifted by the slack variables
+         *
+         * @param cval constraints value
+         * @param sval slack variables value
+         * @return cvec<((sizer.ph * sizer.nx) + sizer.ineq + sizer.eq)> constraints violation
+         */
+        cvec<((sizer.ph * sizer.nx) + sizer.ineq + sizer.eq)> constraintsViolation(
+            const cvec<((sizer.ph * sizer.nx) + sizer.ineq + sizer.eq)> &cval,
+            const cvec<sizer.ineq> &sval)
+        {
+            cvec<((sizer.ph * sizer.nx) + sizer.ineq + sizer.eq)> r;
+            r = cval;
+            if (hasIneq)
+            {
+                r.segment(ph() * nx(), ineq()) += sval;
+            }
+
+            return r;
+        }
+
+        /**
+         * @brief Compute the product between the transposed constraints Jacobian
+         * and the given multipliers (the fixed variables are excluded)
+         *
+         * @param v multipliers
+         * @return cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> product
+         */
+        cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> jacobianTransposeProduct(
+            const cvec<((sizer.ph * sizer.nx) + sizer.ineq + sizer.eq)> &v)
+        {
+            cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> res;
+            COND_RESIZE_CVEC(sizer, res, builder->numVars());
+            res.setZero();
+
+            int m = numDuals();
+            for (int k = 0; k < builder->A.outerSize(); ++k)
+            {
+                for (smat::InnerIterator it(builder->A, k); it; ++it)
+                {
+                    if (it.row() < m)
+                    {
+                        res(it.col()) += it.value() * v(it.row());
+                    }
+                }
+            }
+
+            return res;
+        }
+
+        /**
+         * @brief Assemble and factorize the reduced KKT system and compute the step
+         *
+         * @param sigma barrier contribution to the diagonal of the primal block
+         * @param gb gradient of the barrier problem
+         * @param dz primal step
+         * @param dy multipliers step
+         * @return true
+         * @return false
+         */
+        bool computeStep(
+            const cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> &sigma,
+            const cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> &gb,
+            cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> &dz,
+            cvec<((sizer.ph * sizer.nx) + sizer.ineq + sizer.eq)> &dy)
+        {
+            int n = builder->numVars();
+            int m = numDuals();
+            int ineqOffset = ph() * nx();
+            int eqOffset = ineqOffset + ineq();
+
+            cvec<> rhs(n + m);
+            rhs.head(n) = -(gb + jacobianTransposeProduct(y));
+            rhs.tail(m) = -c;
+
+            // only the lower triangular part is used by the factorization,
+            // the pattern does not depend on the current values
+            std::vector<Eigen::Triplet<double>> triplets;
+            triplets.reserve(n + m + builder->A.nonZeros());
+
+            // the hessian is stored upper triangular
+            for (int k = 0; k < builder->P.outerSize(); ++k)
+            {
+                for (smat::InnerIterator it(builder->P, k); it; ++it)
+                {
+                    int r = it.row();
+                    int col = it.col();
+
+                    if (r == col)
+                    {
+                        triplets.push_back(Eigen::Triplet<double>(r, r, fixed[r] ? 1.0 : it.value() + sigma(r)));
+                    }
+                    else
+                    {
+                        triplets.push_back(Eigen::Triplet<double>(col, r, (fixed[r] || fixed[col]) ? 0.0 : it.value()));
+                    }
+                }
+            }
+
+            for (int i = 0; i < n; i++)
+            {
+                if (fixed[i])
+                {
+                    rhs(i) = 0;
+                }
+            }
+
+            for (int k = 0; k < builder->A.outerSize(); ++k)
+            {
+                for (smat::InnerIterator it(builder->A, k); it; ++it)
+                {
+                    if (it.row() < m)
+                    {
+                        triplets.push_back(Eigen::Triplet<double>(
+                            n + it.row(), it.col(), fixed[it.col()] ? 0.0 : it.value()));
+                    }
+                }
+            }
+
+            for (int r = 0; r < m; r++)
+            {
+                double d = -dual_regularization;
+
+                if (r >= ineqOffset && r < eqOffset)
+                {
+                    if (hasIneq)
+                    {
+                        int j = r - ineqOffset;
+                        d -= s(j) / y(r);
+                        rhs(n + r) = -c(r) - (mu / y(r));
+                    }
+                    else
+                    {
+                        d = -1.0;
+                        rhs(n + r) = 0;
+                    }
+                }
+                else if (r >= eqOffset && !hasEq)
+                {
+                    d = -1.0;
+                    rhs(n + r) = 0;
+                }
+
+                triplets.push_back(Eigen::Triplet<double>(n + r, n + r, d));
+            }
+
+            smat K(n + m, n + m);
+            K.setFromTriplets(triplets.begin(), triplets.end());
+
+            if (!is_analyzed)
+            {
+                kkt.analyzePattern(K);
+                is_analyzed = true;
+            }
+
+            kkt.factorize(K);
+            if (kkt.info() != Eigen::Success)
+            {
+                Logger::instance().log(Logger::log_type::ERROR)
+                    << "Unable to factorize the IPM KKT system" << std::endl;
+                is_analyzed = false;
+                return false;
+            }
+
+            cvec<> sol = kkt.solve(rhs);
+            if (kkt.info() != Eigen::Success || !sol.allFinite())
+            {
+                Logger::instance().log(Logger::log_type::ERROR)
+                    << "Unable to solve the IPM KKT system" << std::endl;
+                return false;
+            }
+
+            dz = sol.head(n);
+            dy = sol.tail(m);
+
+            return true;
+        }
+
+        /**
+         * @brief Compute the quadratic form of the hessian approximation
+         *
+         * @param v primal direction
+         * @return double v'Hv
+         */
+        double hessianProduct(const cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> &v)
+        {
+            double res = 0;
+            for (int k = 0; k < builder->P.outerSize(); ++k)
+            {
+                for (smat::InnerIterator it(builder->P, k); it; ++it)
+                {
+                    double w = it.row() == it.col() ? 1.0 : 2.0;
+                    res += w * it.value() * v(it.row()) * v(it.col());
+                }
+            }
+
+            return res;
+        }
+
+        /**
+         * @brief Compute the logarithmic barrier term of the bounds and of the slack variables
+         *
+         * @param zval optimization vector
+         * @param sval slack variables
+         * @return double barrier value
+         */
+        double barrierTerm(
+            const cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> &zval,
+            const cvec<sizer.ineq> &sval)
+        {
+            double b = 0;
+            for (int i = 0; i < builder->numVars(); i++)
+            {
+                if (hasLower[i])
+                {
+                    b += std::log(zval(i) - lb(i));
+                }
+
+                if (hasUpper[i])
+                {
+                    b += std::log(ub(i) - zval(i));
+                }
+            }
+
+            if (hasIneq)
+            {
+                b += sval.array().log().sum();
+            }
+
+            return b;
+        }
+
+        /**
+         * @brief Compute the maximum deviation of the complementarity products
+         * from the given barrier value
+         *
+         * @param target barrier value
+         * @return double complementarity error
+         */
+        double complementarityError(double target)
+        {
+            double err = 0;
+            for (int i = 0; i < builder->numVars(); i++)
+            {
+                if (hasLower[i])
+                {
+                    err = std::max(err, std::fabs(((z(i) - lb(i)) * zl(i)) - target));
+                }
+
+                if (hasUpper[i])
+                {
+                    err = std::max(err, std::fabs(((ub(i) - z(i)) * zu(i)) - target));
+                }
+            }
+
+            if (hasIneq)
+            {
+                for (size_t j = 0; j < ineq(); j++)
+                {
+                    err = std::max(err, std::fabs((s(j) * y((ph() * nx()) + j)) - target));
+                }
+            }
+
+            return err;
+        }
+
+        /**
+         * @brief Scaling of the dual infeasibility, large multipliers
+         * would otherwise prevent the convergence check
+         *
+         * @return double scaling factor
+         */
+        double dualScaling()
+        {
+            double total = y.template lpNorm<1>() + zl.template lpNorm<1>() + zu.template lpNorm<1>();
+            double count = numDuals() + (2.0 * builder->numVars());
+            return std::max(scaling_max, total / count) / scaling_max;
+        }
+
+        /**
+         * @brief Scaling of the complementarity error
+         *
+         * @return double scaling factor
+         */
+        double complementarityScaling()
+        {
+            double total = zl.template lpNorm<1>() + zu.template lpNorm<1>();
+            if (hasIneq)
+            {
+                total += y.segment(ph() * nx(), ineq()).template lpNorm<1>();
+            }
+            double count = ineq() + (2.0 * builder->numVars());
+            return std::max(scaling_max, total / count) / scaling_max;
+        }
+
+        std::shared_ptr<SQPProblemBuilder<sizer>> builder;
+
+        std::shared_ptr<Objective<sizer>> objFunc;
+        std::shared_ptr<Constraints<sizer>> conFunc;
+        std::shared_ptr<Mapping<sizer>> mapping;
+        std::shared_ptr<Model<sizer>> model;
+
+        Eigen::SimplicialLDLT<smat, Eigen::Lower, Eigen::NaturalOrdering<int>> kkt;
+        bool is_analyzed = false;
+
+        // primal-dual iterate
+        cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> z, zl, zu;
+        cvec<sizer.ineq> s;
+        cvec<((sizer.ph * sizer.nx) + sizer.ineq + sizer.eq)> y, c;
+        double mu = 0.1;
+
+        cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> lb, ub;
+        std::vector<bool> hasLower, hasUpper, fixed;
+        bool hasIneq = false;
+        bool hasEq = false;
+
+        bool has_solution = false;
+        double mu_last = 0.1;
+        int status = UNSOLVED;
+        int iterations = 0;
+
+        double tolerance = 1e-6;
+        double barrier_init = 0.1;
+        int maximum_iteration = 100;
+        double time_limit = 0;
+        bool warm_start = false;
+        bool dual_warm_start = true;
+
+        cvec<((sizer.ph * sizer.nx) + sizer.ineq + sizer.eq)> dual_guess;
+        bool has_dual_guess = false;
+
+        const double hessian_regularization = 1e-6;
+        const double dual_regularization = 1e-9;
+        const double fixed_tolerance = 1e-12;
+        const double bound_push = 1e-2;
+        const double barrier_kappa_eps = 10.0;
+        const double barrier_kappa_mu = 0.2;
+        const double barrier_theta_mu = 1.5;
+        const double barrier_warm_factor = 10.0;
+        const double multiplier_kappa = 1e10;
+        const double scaling_max = 100.0;
+        const double merit_rho = 0.1;
+        const double merit_eta = 1e-4;
+        const int max_backtracking = 30;
+    };
+} // namespace mpc
@@ -51,6 +51,8 @@ namespace mpc
             COND_RESIZE_MAT(sizer,Iu2zMat,(nu() * ch()), (ph() * nu()));
             COND_RESIZE_MAT(sizer,Sz2uMat,nu(), nu());
             COND_RESIZE_MAT(sizer,Su2zMat,nu(), nu());
+            COND_RESIZE_MAT(sizer,basis,ph(), ch());
+            COND_RESIZE_MAT(sizer,basis_projection,ch(), ph());
 
             COND_RESIZE_CVEC(sizer,input_scaling,nu());
             COND_RESIZE_CVEC(sizer,state_scaling, nx());
@@ -74,6 +76,78 @@ namespace mpc
             computeMapping();
         }
 
+        /**
+         * @brief Set the parameterization of the inputs along the prediction horizon, each
+         * input is the combination of ch basis functions weighted by the input elements
+         * of the optimization vector
+         *
+         * @param type basis functions
+         * @param pole pole of the discrete Laguerre functions, in [0, 1)
+         * @param degree degree of the B-splines
+         * @param knots interior knots of the B-splines as increasing fractions of the
+         * prediction horizon in (0, 1), uniform knots are used when empty
+         * @return true
+         * @return false
+         */
+        bool setInputBasis(NLInputBasis type, double pole, int degree, const std::vector<double> &knots)
+        {
+            checkOrQuit();
+
+            if (type == NLInputBasis::LAGUERRE && (pole < 0 || pole >= 1))
+            {
+                Logger::instance().log(Logger::log_type::ERROR)
+                    << "The pole of the Laguerre functions must be in [0, 1)"
+                    << std::endl;
+                return false;
+            }
+
+            if (type == NLInputBasis::BSPLINE)
+            {
+                if (degree < 0)
+                {
+                    Logger::instance().log(Logger::log_type::ERROR)
+                        << "The degree of the B-splines must be non negative"
+                        << std::endl;
+                    return false;
+                }
+
+                size_t d = std::min((size_t)degree, ch() - 1);
+                bool valid = knots.empty() || knots.size() == (ch() - d - 1);
+                for (size_t i = 0; valid && i < knots.size(); i++)
+                {
+                    valid = knots[i] > (i == 0 ? 0.0 : knots[i - 1]) && knots[i] < 1.0;
+                }
+
+                if (!valid)
+                {
+                    Logger::instance().log(Logger::log_type::ERROR)
+                        << "The B-splines require "
+                        << (ch() - d - 1)
+                        << " increasing interior knots in (0, 1)"
+                        << std::endl;
+                    return false;
+                }
+            }
+
+            input_basis = type;
+            laguerre_pole = pole;
+            spline_degree = degree;
+            spline_knots = knots;
+
+            computeMapping();
+            return true;
+        }
+
+        /**
+         * @brief Get the current parameterization of the inputs
+         *
+         * @return NLInputBasis basis functions
+         */
+        NLInputBasis InputBasis() const
+        {
+            return input_basis;
+        }
+
         /**
          * @brief Set the state scaling matrix
          *
@@ -86,11 +160,13 @@ namespace mpc
         }
 
         /**
-         * @brief Accesor to the optimal vector to input mapping matrix
+         * @brief Accesor to the optimal vector to input mapping matrix. The matrix is
+         * kept for inspection, the internal computations apply the move-blocking with
+         * the structured operators (unwrapInputs, wrapInputs, blockInputJacobian)
          *
-         * @return mat<(sizer.ph * sizer.nu), (sizer.nu * sizer.ch)> mapping matrix
+         * @return const mat<(sizer.ph * sizer.nu), (sizer.nu * sizer.ch)>& mapping matrix
          */
-        mat<(sizer.ph * sizer.nu), (sizer.nu * sizer.ch)> Iz2u()
+        const mat<(sizer.ph * sizer.nu), (sizer.nu * sizer.ch)> &Iz2u()
         {
             checkOrQuit();
             return Iz2uMat;
@@ -99,9 +175,9 @@ namespace mpc
         /**
          * @brief Accesor to the inverse of the optimal vector to input mapping matrix
          *
-         * @return mat<(sizer.nu * sizer.ch), (sizer.ph * sizer.nu)> mapping matrix
+         * @return const mat<(sizer.nu * sizer.ch), (sizer.ph * sizer.nu)>& mapping matrix
          */
-        mat<(sizer.nu * sizer.ch), (sizer.ph * sizer.nu)> Iu2z()
+        const mat<(sizer.nu * sizer.ch), (sizer.ph * sizer.nu)> &Iu2z()
         {
             checkOrQuit();
             return Iu2zMat;
@@ -110,9 +186,9 @@ namespace mpc
         /**
          * @brief Accesor to the scaled optimal vector to input mapping matrix
          *
-         * @return mat<sizer.nu, sizer.nu> mapping matrix
+         * @return const mat<sizer.nu, sizer.nu>& mapping matrix
          */
-        mat<sizer.nu, sizer.nu> Sz2u()
+        const mat<sizer.nu, sizer.nu> &Sz2u()
         {
             checkOrQuit();
             return Sz2uMat;
@@ -121,9 +197,9 @@ namespace mpc
         /**
          * @brief Accesor to the inverse of scaled optimal vector to input mapping matrix
          *
-         * @return mat<sizer.nu, sizer.nu> mapping matrix
+         * @return const mat<sizer.nu, sizer.nu>& mapping matrix
          */
-        mat<sizer.nu, sizer.nu> Su2z()
+        const mat<sizer.nu, sizer.nu> &Su2z()
         {
             checkOrQuit();
             return Su2zMat;
@@ -132,9 +208,9 @@ namespace mpc
         /**
          * @brief Get the current state scaling vector
          *
-         * @return cvec<Tnx> scaling vector
+         * @return const cvec<Tnx>& scaling vector
          */
-        cvec<sizer.nx> StateScaling()
+        const cvec<sizer.nx> &StateScaling()
         {
             checkOrQuit();
             return state_scaling;
@@ -143,9 +219,9 @@ namespace mpc
         /**
          * @brief Get the inverse of the current state scaling vector
          *
-         * @return cvec<Tnx> scaling vector
+         * @return const cvec<Tnx>& scaling vector
          */
-        cvec<sizer.nx> StateInverseScaling()
+        const cvec<sizer.nx> &StateInverseScaling()
         {
             checkOrQuit();
             return inverse_state_scaling;
@@ -154,9 +230,9 @@ namespace mpc
         /**
          * @brief Get the current input scaling vector
          *
-         * @return cvec<Tnx> scaling vector
+         * @return const cvec<Tnu>& scaling vector
          */
-        cvec<sizer.nu> InputScaling()
+        const cvec<sizer.nu> &InputScaling()
         {
             checkOrQuit();
             return input_scaling;
@@ -172,46 +248,210 @@ namespace mpc
          * @param slack slackness values along the prediction horizon
          */
         void unwrapVector(
-            const cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> x,
-            const cvec<sizer.nx> x0,
+            const Eigen::Ref<const cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)>> &x,
+            const cvec<sizer.nx> &x0,
             mat<(sizer.ph + 1), sizer.nx> &Xmat,
             mat<(sizer.ph + 1), sizer.nu> &Umat,
             double &slack)
         {
             checkOrQuit();
 
-            cvec<(sizer.nu * sizer.ch)> u_vec;
-            u_vec = x.middleRows((ph() * nx()), (nu() * ch()));
+            // the initial condition is not part of the optimization vector
+            // and it is already expressed in the system's units
+            Xmat.setZero();
+            Xmat.row(0) = x0.transpose();
+            for (size_t i = 1; i < (ph() + 1); i++)
+            {
+                Xmat.row(i) = x.middleRows(((i - 1) * nx()), nx()).cwiseProduct(state_scaling).transpose();
+            }
 
-            mat<sizer.ph + 1, sizer.nu> Umv;
-            COND_RESIZE_MAT(sizer,Umv,(ph() + 1), nu());
+            // TODO add disturbaces manipulated vars
+            unwrapInputs(x, Umat);
 
-            cvec<(sizer.ph * sizer.nu)> tmp_mult;
-            tmp_mult = Iz2uMat * u_vec;
-            mat<sizer.nu, sizer.ph> tmp_mapped;
-            tmp_mapped = Eigen::Map<mat<sizer.nu, sizer.ph>>(tmp_mult.data(), nu(), ph());
+            slack = x(x.size() - 1);
+        }
 
-            Umv.setZero();
-            Umv.middleRows(0, ph()) = tmp_mapped.transpose();
-            Umv.row(ph()) = Umv.row(ph() - 1);
+        /**
+         * @brief Weight of a basis function of the inputs at a step of the prediction
+         * horizon, with the piecewise constant blocking the weight is one on the steps
+         * mapped on the block and zero elsewhere
+         *
+         * @param k step of the prediction horizon
+         * @param j index of the basis function (input block of the optimization vector)
+         * @return double weight of the basis function
+         */
+        double inputWeight(size_t k, size_t j) const
+        {
+            return basis(k, j);
+        }
 
-            Xmat.setZero();
-            Xmat.row(0) = x0.transpose();
-            for (size_t i = 1; i < (ph() + 1); i++)
+        /**
+         * @brief Convert the input blocks of the optimization vector to the input
+         * sequence along the prediction horizon, each block is scaled and replicated
+         * on the steps it is mapped on (equivalent to Iz2u without the product)
+         *
+         * @param x optimization vector
+         * @param Umat input sequence along the prediction horizon
+         */
+        void unwrapInputs(
+            const Eigen::Ref<const cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)>> &x,
+            mat<(sizer.ph + 1), sizer.nu> &Umat)
+        {
+            checkOrQuit();
+
+            if (input_basis == NLInputBasis::BLOCKING)
+            {
+                for (size_t k = 0; k < ph(); k++)
+                {
+                    Umat.row(k) = x.middleRows((ph() * nx()) + (step_block[k] * nu()), nu()).cwiseProduct(input_scaling).transpose();
+                }
+            }
+            else
             {
-                Xmat.row(i) = x.middleRows(((i - 1) * nx()), nx()).transpose();
+                // the coefficients of each basis function are stored contiguously
+                Umat.topRows(ph()) = basis *
+                                     Eigen::Map<const mat<sizer.nu, sizer.ch>>(x.data() + (ph() * nx()), nu(), ch()).transpose() *
+                                     input_scaling.asDiagonal();
             }
+            Umat.row(ph()) = Umat.row(ph() - 1);
+        }
 
-            for (int i = 0; i < Xmat.cols(); i++)
+        /**
+         * @brief Convert the input sequence along the prediction horizon to the input
+         * blocks of the optimization vector, each block takes the scaled input of the
+         * first step it is mapped on (equivalent to Iu2z without the product). With the
+         * basis functions the sequence is projected on the basis in the least squares sense
+         *
+         * @param Umat input sequence along the prediction horizon
+         * @param x optimization vector
+         */
+        void wrapInputs(
+            const mat<(sizer.ph + 1), sizer.nu> &Umat,
+            cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> &x)
+        {
+            checkOrQuit();
+
+            if (input_basis == NLInputBasis::BLOCKING)
             {
-                Xmat.col(i) /= 1.0 / state_scaling(i);
+                for (size_t i = 0; i < ch(); i++)
+                {
+                    x.middleRows((ph() * nx()) + (i * nu()), nu()) = Umat.row(block_first_step[i]).transpose().cwiseQuotient(input_scaling);
+                }
+                return;
             }
 
-            // TODO add disturbaces manipulated vars
-            Umat.setZero();
-            Umat.block(0, 0, ph() + 1, nu()) = Umv;
+            mat<sizer.ch, sizer.nu> Z;
+            Z = basis_projection * Umat.topRows(ph());
+            for (size_t i = 0; i < ch(); i++)
+            {
+                x.middleRows((ph() * nx()) + (i * nu()), nu()) = Z.row(i).transpose().cwiseQuotient(input_scaling);
+            }
+        }
 
-            slack = x(x.size() - 1);
+        /**
+         * @brief Convert a Jacobian matrix w.r.t. the inputs along the prediction horizon
+         * to the Jacobian matrix w.r.t. the input blocks of the optimization vector, the
+         * columns of the steps mapped on the same block are scaled and summed
+         * (equivalent to the product by Iz2u)
+         *
+         * @tparam Tnc number of rows of the Jacobian matrix
+         * @param Ju Jacobian matrix w.r.t. the inputs along the prediction horizon
+         * @param Jz Jacobian matrix w.r.t. the input blocks of the optimization vector
+         */
+        template <int Tnc>
+        void blockInputJacobian(
+            const mat<Tnc, (sizer.ph * sizer.nu)> &Ju,
+            mat<Tnc, (sizer.nu * sizer.ch)> &Jz)
+        {
+            checkOrQuit();
+
+            Jz.setZero();
+            if (input_basis == NLInputBasis::BLOCKING)
+            {
+                for (size_t k = 0; k < ph(); k++)
+                {
+                    Jz.middleCols(step_block[k] * nu(), nu()) += Ju.middleCols(k * nu(), nu()) * input_scaling.asDiagonal();
+                }
+                return;
+            }
+
+            for (size_t k = 0; k < ph(); k++)
+            {
+                for (size_t j = 0; j < ch(); j++)
+                {
+                    if (basis(k, j) != 0)
+                    {
+                        Jz.middleCols(j * nu(), nu()) += basis(k, j) * Ju.middleCols(k * nu(), nu()) * input_scaling.asDiagonal();
+                    }
+                }
+            }
+        }
+
+        /**
+         * @brief Compute the change of the inputs along the prediction horizon due to a
+         * unit change of an input element of the optimization vector. The steps mapped
+         * on the same element (e.g. the ones past the control horizon) move together
+         *
+         * @param c index of the element in the inputs part of the optimization vector
+         * @param D change of the inputs along the prediction horizon
+         */
+        void inputDirection(size_t c, mat<(sizer.ph + 1), sizer.nu> &D)
+        {
+            checkOrQuit();
+
+            D.setZero();
+            for (size_t k = 0; k < ph(); k++)
+            {
+                D(k, c % nu()) = basis(k, c / nu()) * input_scaling(c % nu());
+            }
+            D.row(ph()) = D.row(ph() - 1);
+        }
+
+        /**
+         * @brief Check which input blocks of the optimization vector can be shifted
+         * by one stage. A block can be shifted only if both the block and the next
+         * one are mapped on a single step of the prediction horizon (the coefficients
+         * of the basis functions are never shifted)
+         *
+         * @return std::vector<bool> flag of each input block of the control horizon
+         */
+        std::vector<bool> shiftableInputBlocks()
+        {
+            checkOrQuit();
+
+            std::vector<bool> shiftable(ch(), false);
+            for (size_t i = 0; input_basis == NLInputBasis::BLOCKING && i + 1 < ch(); i++)
+            {
+                shiftable[i] = block_steps[i] == 1 && block_steps[i + 1] == 1;
+            }
+
+            return shiftable;
+        }
+
+        /**
+         * @brief Shift a vector with the layout of the optimization vector (e.g. the
+         * multipliers of the bounds) by one stage. The blocks of the last stage, the
+         * input blocks spanning more steps and the slack variable are kept
+         *
+         * @param v vector to shift
+         */
+        void shiftVector(cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> &v)
+        {
+            checkOrQuit();
+
+            for (size_t i = 0; i + 1 < ph(); i++)
+            {
+                v.middleRows(i * nx(), nx()) = v.middleRows((i + 1) * nx(), nx());
+            }
+
+            auto shiftable = shiftableInputBlocks();
+            for (size_t i = 0; i + 1 < ch(); i++)
+            {
+                if (shiftable[i])
+                {
+                    v.middleRows((ph() * nx()) + (i * nu()), nu()) = v.middleRows((ph() * nx()) + ((i + 1) * nu()), nu());
+                }
+            }
         }
 
     protected:
@@ -245,18 +485,157 @@ namespace mpc
                 Su2zMat(i, i) = 1.0 / input_scaling(i);
             }
 
-            // TODO implement linear interpolation
-            int ix = 0;
-            int jx = 0;
+            step_block.assign(ph(), 0);
+            block_first_step.assign(ch(), 0);
+            block_steps.assign(ch(), 0);
+
+            size_t k = 0;
             for (size_t i = 0; i < ch(); i++)
             {
-                Iu2zMat.block(ix, jx, nu(), nu()) = Su2zMat;
+                block_first_step[i] = k;
+                block_steps[i] = m[i];
                 for (int j = 0; j < m[i]; j++)
                 {
-                    Iz2uMat.block(jx, ix, nu(), nu()) = Sz2uMat;
-                    jx += nu();
+                    step_block[k++] = i;
+                }
+            }
+
+            computeBasis();
+
+            // the dense matrices are the kronecker products of the basis (and of
+            // its projection) with the scaling matrices
+            for (size_t i = 0; i < ph(); i++)
+            {
+                for (size_t j = 0; j < ch(); j++)
+                {
+                    Iz2uMat.block(i * nu(), j * nu(), nu(), nu()) = basis(i, j) * Sz2uMat;
+                    Iu2zMat.block(j * nu(), i * nu(), nu(), nu()) = basis_projection(j, i) * Su2zMat;
+                }
+            }
+        }
+
+        /**
+         * @brief Utility function to compute the basis functions of the inputs at each
+         * step of the prediction horizon and their projection
+         */
+        void computeBasis()
+        {
+            basis.setZero();
+            basis_projection.setZero();
+
+            switch (input_basis)
+            {
+            case NLInputBasis::LAGUERRE:
+            {
+                // the functions at the next step are obtained by a lower triangular recursion
+                double a = laguerre_pole;
+                double b = 1.0 - (a * a);
+
+                mat<> A = mat<>::Zero(ch(), ch());
+                cvec<> l(ch());
+                for (size_t i = 0; i < ch(); i++)
+                {
+                    l(i) = std::sqrt(b) * std::pow(-a, (double)i);
+                    A(i, i) = a;
+                    for (size_t j = 0; j < i; j++)
+                    {
+                        A(i, j) = std::pow(-a, (double)(i - j - 1)) * b;
+                    }
+                }
+
+                for (size_t k = 0; k < ph(); k++)
+                {
+                    basis.row(k) = l.transpose();
+                    l = A * l;
+                }
+                break;
+            }
+            case NLInputBasis::CHEBYSHEV:
+            {
+                // the prediction horizon is mapped on [-1, 1]
+                for (size_t k = 0; k < ph(); k++)
+                {
+                    double t = ph() > 1 ? ((2.0 * k) / (ph() - 1.0)) - 1.0 : 0.0;
+                    for (size_t j = 0; j < ch(); j++)
+                    {
+                        basis(k, j) = j == 0 ? 1.0 : (j == 1 ? t : (2.0 * t * basis(k, j - 1)) - basis(k, j - 2));
+                    }
+                }
+                break;
+            }
+            case NLInputBasis::BSPLINE:
+                computeSplineBasis();
+                break;
+            default:
+                for (size_t k = 0; k < ph(); k++)
+                {
+                    basis(k, step_block[k]) = 1.0;
+                }
+                for (size_t i = 0; i < ch(); i++)
+                {
+                    basis_projection(i, block_first_step[i]) = 1.0;
+                }
+                return;
+            }
+
+            // least squares projection of an input sequence on the basis functions
+            mat<> B = basis;
+            basis_projection = B.completeOrthogonalDecomposition().pseudoInverse();
+        }
+
+        /**
+         * @brief Utility function to compute the clamped B-splines on the steps of the
+         * prediction horizon (Cox-de Boor recursion), the splines of a degree d have
+         * ch - d - 1 interior knots
+         */
+        void computeSplineBasis()
+        {
+            size_t d = std::min((size_t)spline_degree, ch() - 1);
+            double length = std::max(1.0, ph() - 1.0);
+
+            std::vector<double> knots(ch() + d + 1, 0.0);
+            for (size_t i = 0; i < ch() - d - 1; i++)
+            {
+                double f = spline_knots.empty() ? (i + 1.0) / (ch() - d) : spline_knots[i];
+                knots[d + 1 + i] = f * length;
+            }
+            for (size_t i = ch(); i < knots.size(); i++)
+            {
+                knots[i] = length;
+            }
+
+            std::vector<double> N(d + 1), left(d + 1), right(d + 1);
+            for (size_t k = 0; k < ph(); k++)
+            {
+                double t = (double)k;
+
+                // knot span of the step, the end of the horizon belongs to the last span
+                size_t span = ch() - 1;
+                while (span > d && t < knots[span])
+                {
+                    span--;
+                }
+
+                N[0] = 1.0;
+                for (size_t j = 1; j <= d; j++)
+                {
+                    left[j] = t - knots[span + 1 - j];
+                    right[j] = knots[span + j] - t;
+
+                    double saved = 0.0;
+                    for (size_t r = 0; r < j; r++)
+                    {
+                        double temp = N[r] / (right[r + 1] + left[j - r]);
+                        N[r] = saved + (right[r + 1] * temp);
+                        saved = left[j - r] * temp;
+                    }
+                    N[j] = saved;
+                }
+
+                for (size_t r = 0; r <= d; r++)
+                {
+                    basis(k, span - d + r) = N[r];
                 }
-                ix += nu();
             }
         }
 
@@ -264,5 +643,19 @@ namespace mpc
         mat<(sizer.nu * sizer.ch), (sizer.ph * sizer.nu)> Iu2zMat;
         mat<sizer.nu, sizer.nu> Sz2uMat;
         mat<sizer.nu, sizer.nu> Su2zMat;
+
+        // move-blocking structure: input block of each step, first step and
+        // number of steps of each block
+        std::vector<size_t> step_block;
+        std::vector<size_t> block_first_step;
+        std::vector<size_t> block_steps;
+
+        // basis functions of the inputs at each step and their projection
+        NLInputBasis input_basis = NLInputBasis::BLOCKING;
+        double laguerre_pole = 0.5;
+        int spline_degree = 3;
+        std::vector<double> spline_knots;
+        mat<sizer.ph, sizer.ch> basis;
+        mat<sizer.ch, sizer.ph> basis_projection;
     };
 } // namespace mpc
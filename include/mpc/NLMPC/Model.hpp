@@ -35,6 +35,38 @@ namespace mpc
         using IDimensionable<sizer>::eq;
 
     public:
+        /**
+         * @brief Work buffers of the stages of the integrators on a batch of points
+         */
+        struct Stages
+        {
+            std::array<mat<sizer.nx, Eigen::Dynamic>, 5> K, dKx, dKu;
+            mat<sizer.nx, Eigen::Dynamic> Y, base, next, fy, g, A, B;
+            rvec<Eigen::Dynamic> t, h, hk;
+            std::vector<bool> flags;
+            std::vector<Eigen::PartialPivLU<mat<sizer.nx, sizer.nx>>> lu;
+        };
+
+        /**
+         * @brief Work buffers of the central differences and of the integrators on a
+         * batch of points. They are owned by the caller, so that the model can be shared
+         * by concurrent evaluations, and they are only reallocated when the batch size
+         * changes, i.e. a workspace should be used for batches of the same size
+         */
+        struct Workspace
+        {
+            mat<sizer.nx, Eigen::Dynamic> Xp, Fp, Xa, F0;
+            mat<sizer.nu, Eigen::Dynamic> Up, Ua;
+            std::vector<unsigned int> sp;
+            // batch of a single point
+            mat<sizer.nx, Eigen::Dynamic> Xs, Fs;
+            mat<sizer.nu, Eigen::Dynamic> Us;
+            std::vector<unsigned int> ss;
+            std::vector<std::vector<double>> hs;
+            // stages of the integration of the points and of their perturbations
+            Stages points, perturbations;
+        };
+
         Model() : IComponent<sizer>()
         {
             isContinuousTime = false;
@@ -121,9 +153,335 @@ namespace mpc
             const typename IDimensionable<sizer>::StateFunHandle handle)
         {
             checkOrQuit();
+            batchField = nullptr;
             return vectorField = handle, true;
         }
 
+        /**
+         * @brief Set the system's states update function evaluated on a batch of
+         * points (one column for each point). The state update function used on
+         * single points is derived from the batched one, unless it is provided
+         *
+         * @param handle function handler
+         * @param pointHandle function handler used on single points (optional)
+         * @return true
+         * @return false
+         */
+        bool setBatchStateModel(
+            const typename IDimensionable<sizer>::BatchStateFunHandle handle,
+            const typename IDimensionable<sizer>::StateFunHandle pointHandle = nullptr)
+        {
+            checkOrQuit();
+
+            if (pointHandle)
+            {
+                vectorField = pointHandle;
+                return batchField = handle, true;
+            }
+
+            vectorField = [handle](
+                              cvec<sizer.nx> &f,
+                              const cvec<sizer.nx> &x,
+                              const cvec<sizer.nu> &u,
+                              const unsigned int &k)
+            {
+                // the model is shared by concurrent evaluations, each thread
+                // keeps its own single point batch
+                static thread_local Workspace ws;
+
+                loadPoint(ws, x, u, k);
+                handle(ws.Fs, ws.Xs, ws.Us, ws.ss);
+                f = ws.Fs.col(0);
+            };
+
+            return batchField = handle, true;
+        }
+
+        /**
+         * @brief Set the system's states update function evaluated on packets of points.
+         * The function is called with arrays whose columns (lanes) hold different points,
+         * e.g. the perturbations of the finite differences, and whose rows are stored
+         * contiguously so that the operations on the rows are vectorized by Eigen. The
+         * number of lanes is the width of the Eigen packets of the instruction set the
+         * library is compiled for, and the last argument holds the step of the horizon
+         * of each lane
+         *
+         * @tparam TPacketFun type of the function (generic on the arrays type)
+         * @param fun function evaluated on the packets
+         * @return true
+         * @return false
+         */
+        template <typename TPacketFun>
+        bool setPacketStateModel(TPacketFun fun)
+        {
+            auto batch = [fun](
+                             mat<sizer.nx, Eigen::Dynamic> &F,
+                             const mat<sizer.nx, Eigen::Dynamic> &X,
+                             const mat<sizer.nu, Eigen::Dynamic> &U,
+                             const std::vector<unsigned int> &steps)
+            {
+                evaluatePackets<packetLanes()>(fun, F, X, U, steps);
+            };
+
+            auto point = [fun](
+                             cvec<sizer.nx> &f,
+                             const cvec<sizer.nx> &x,
+                             const cvec<sizer.nu> &u,
+                             const unsigned int &k)
+            {
+                PacketArray<sizer.nx, 1> fa(x.rows(), 1), xa = x.array();
+                PacketArray<sizer.nu, 1> ua = u.array();
+
+                fun(fa, xa, ua, std::array<unsigned int, 1>{k});
+                f = fa.matrix();
+            };
+
+            return setBatchStateModel(batch, point);
+        }
+
+        /**
+         * @brief Number of lanes of the packets, i.e. the number of double precision
+         * values held by an Eigen packet with the compiler flags in use (at least 2)
+         *
+         * @return int number of lanes
+         */
+        static constexpr int packetLanes()
+        {
+            return std::max(2, (int)Eigen::internal::packet_traits<double>::size);
+        }
+
+        /**
+         * @brief Set the integration of the continuous time system's dynamics over each
+         * step of the prediction horizon
+         *
+         * @param method integration method
+         * @param steps number of (initial) sub-steps of each step
+         * @param tolerance local error tolerance of the adaptive methods, or of the
+         * Newton iterations of the implicit methods
+         */
+        void setIntegrator(NLIntegrator method, int steps, double tolerance)
+        {
+            integrator = method;
+            integrator_steps = std::max(1, steps);
+            integrator_tolerance = tolerance;
+        }
+
+        /**
+         * @brief Return if the system's dynamics is integrated over each step of the
+         * horizon, so that the states update is a discrete time transition
+         *
+         * @return true
+         * @return false
+         */
+        bool isIntegrated()
+        {
+            return isContinuousTime && integrator != NLIntegrator::TRAPEZOIDAL;
+        }
+
+        /**
+         * @brief Evaluate the transition of the system on a batch of points: the next states
+         * for the discrete time and the integrated systems, the vector fields otherwise. The
+         * work buffers of the integrators are allocated at each call
+         *
+         * @param F transitions of the points, one column for each point
+         * @param X states of the points
+         * @param U inputs of the points
+         * @param steps steps of the horizon of the points
+         */
+        void transitionBatch(
+            mat<sizer.nx, Eigen::Dynamic> &F,
+            const mat<sizer.nx, Eigen::Dynamic> &X,
+            const mat<sizer.nu, Eigen::Dynamic> &U,
+            const std::vector<unsigned int> &steps)
+        {
+            Workspace ws;
+            transitionBatch(F, X, U, steps, ws);
+        }
+
+        /**
+         * @brief Evaluate the transition of the system on a batch of points reusing the
+         * work buffers of the caller
+         *
+         * @param F transitions of the points, one column for each point
+         * @param X states of the points
+         * @param U inputs of the points
+         * @param steps steps of the horizon of the points
+         * @param ws work buffers of the integrators
+         */
+        void transitionBatch(
+            mat<sizer.nx, Eigen::Dynamic> &F,
+            const mat<sizer.nx, Eigen::Dynamic> &X,
+            const mat<sizer.nu, Eigen::Dynamic> &U,
+            const std::vector<unsigned int> &steps,
+            Workspace &ws)
+        {
+            integrateBatch(F, X, U, steps, ws, ws.points);
+        }
+
+        /**
+         * @brief Compute the Jacobian matrices of the transition of the system on a batch
+         * of points. The sensitivities of the implicit integrators are propagated through
+         * their stages, the central difference method is used otherwise. The work buffers
+         * are allocated at each call
+         *
+         * @param Jx Jacobian matrices w.r.t. the states, side by side (nx x npts * nx)
+         * @param Jmv Jacobian matrices w.r.t. the inputs, side by side (nx x npts * nu)
+         * @param X0 states of the points, one column for each point
+         * @param U0 inputs of the points
+         * @param steps steps of the horizon of the points
+         */
+        void transitionJacobians(
+            mat<sizer.nx, Eigen::Dynamic> &Jx,
+            mat<sizer.nx, Eigen::Dynamic> &Jmv,
+            const mat<sizer.nx, Eigen::Dynamic> &X0,
+            const mat<sizer.nu, Eigen::Dynamic> &U0,
+            const std::vector<unsigned int> &steps)
+        {
+            Workspace ws;
+            transitionJacobians(Jx, Jmv, X0, U0, steps, ws);
+        }
+
+        /**
+         * @brief Compute the Jacobian matrices of the transition of the system on a batch
+         * of points reusing the work buffers of the caller
+         *
+         * @param Jx Jacobian matrices w.r.t. the states, side by side (nx x npts * nx)
+         * @param Jmv Jacobian matrices w.r.t. the inputs, side by side (nx x npts * nu)
+         * @param X0 states of the points, one column for each point
+         * @param U0 inputs of the points
+         * @param steps steps of the horizon of the points
+         * @param ws work buffers of the central differences and of the integrators
+         */
+        void transitionJacobians(
+            mat<sizer.nx, Eigen::Dynamic> &Jx,
+            mat<sizer.nx, Eigen::Dynamic> &Jmv,
+            const mat<sizer.nx, Eigen::Dynamic> &X0,
+            const mat<sizer.nu, Eigen::Dynamic> &U0,
+            const std::vector<unsigned int> &steps,
+            Workspace &ws)
+        {
+            if (isIntegrated() && integrator == NLIntegrator::SDIRK)
+            {
+                integrateSDIRK(ws.F0, X0, U0, steps, ws, ws.points, &Jx, &Jmv);
+                return;
+            }
+
+            centralDifferences(Jx, Jmv, X0, U0, steps, true, ws);
+        }
+
+        /**
+         * @brief Evaluate the transition of the system on a single point
+         *
+         * @param f transition of the point
+         * @param x state of the point
+         * @param u input of the point
+         * @param k step of the horizon of the point
+         */
+        void transition(
+            cvec<sizer.nx> &f,
+            const cvec<sizer.nx> &x,
+            const cvec<sizer.nu> &u,
+            unsigned int k)
+        {
+            // the model is shared by concurrent evaluations, each thread
+            // keeps its own work buffers
+            static thread_local Workspace ws;
+            transition(f, x, u, k, ws);
+        }
+
+        /**
+         * @brief Evaluate the transition of the system on a single point reusing the
+         * work buffers of the caller
+         *
+         * @param f transition of the point
+         * @param x state of the point
+         * @param u input of the point
+         * @param k step of the horizon of the point
+         * @param ws work buffers of the integrators
+         */
+        void transition(
+            cvec<sizer.nx> &f,
+            const cvec<sizer.nx> &x,
+            const cvec<sizer.nu> &u,
+            unsigned int k,
+            Workspace &ws)
+        {
+            if (!isIntegrated())
+            {
+                vectorField(f, x, u, k);
+                return;
+            }
+
+            loadPoint(ws, x, u, k);
+            transitionBatch(ws.Fs, ws.Xs, ws.Us, ws.ss, ws);
+            f = ws.Fs.col(0);
+        }
+
+        /**
+         * @brief Return if the dynamical system has a batched states update function
+         *
+         * @return true
+         * @return false
+         */
+        bool hasBatchStateModel()
+        {
+            return batchField != nullptr;
+        }
+
+        /**
+         * @brief Evaluate the system's states update function on a batch of points
+         * with a single call to the batched function, if available, or point by point
+         *
+         * @param F vector fields (or next states) of the points, one column for each point
+         * @param X states of the points
+         * @param U inputs of the points
+         * @param steps steps of the horizon of the points
+         */
+        void vectorFieldBatch(
+            mat<sizer.nx, Eigen::Dynamic> &F,
+            const mat<sizer.nx, Eigen::Dynamic> &X,
+            const mat<sizer.nu, Eigen::Dynamic> &U,
+            const std::vector<unsigned int> &steps)
+        {
+            if (batchField)
+            {
+                batchField(F, X, U, steps);
+                return;
+            }
+
+            cvec<sizer.nx> f;
+            COND_RESIZE_CVEC(sizer, f, nx());
+
+            for (size_t j = 0; j < steps.size(); j++)
+            {
+                vectorField(f, X.col(j), U.col(j), steps[j]);
+                F.col(j) = f;
+            }
+        }
+
+        /**
+         * @brief Compute the Jacobian matrices of the system's states update function on
+         * a batch of points with the central difference method, whatever the integration
+         * of the continuous time system
+         *
+         * @param Jx Jacobian matrices w.r.t. the states, side by side (nx x npts * nx)
+         * @param Jmv Jacobian matrices w.r.t. the inputs, side by side (nx x npts * nu)
+         * @param X0 states of the points, one column for each point
+         * @param U0 inputs of the points
+         * @param steps steps of the horizon of the points
+         * @param ws work buffers of the central differences
+         */
+        void vectorFieldJacobians(
+            mat<sizer.nx, Eigen::Dynamic> &Jx,
+            mat<sizer.nx, Eigen::Dynamic> &Jmv,
+            const mat<sizer.nx, Eigen::Dynamic> &X0,
+            const mat<sizer.nu, Eigen::Dynamic> &U0,
+            const std::vector<unsigned int> &steps,
+            Workspace &ws)
+        {
+            centralDifferences(Jx, Jmv, X0, U0, steps, false, ws);
+        }
+
         /**
          * @brief Set the system's output function (e.g. the state/output mapping)
          *
@@ -144,6 +502,600 @@ namespace mpc
         typename IDimensionable<sizer>::StateFunHandle vectorField = nullptr;
 
     private:
+        /**
+         * @brief Copy a single point in the one column batch of the work buffers, which
+         * are only reallocated when the dimensions change
+         *
+         * @param ws work buffers
+         * @param x state of the point
+         * @param u input of the point
+         * @param k step of the horizon of the point
+         */
+        static void loadPoint(
+            Workspace &ws,
+            const cvec<sizer.nx> &x,
+            const cvec<sizer.nu> &u,
+            unsigned int k)
+        {
+            ws.Xs.resize(x.rows(), 1);
+            ws.Us.resize(u.rows(), 1);
+            ws.Fs.resize(x.rows(), 1);
+
+            ws.Xs.col(0) = x;
+            ws.Us.col(0) = u;
+            ws.ss.assign(1, k);
+        }
+
+        // packet of points, the rows are contiguous unless the packet has a single lane
+        template <int Rows, int Lanes>
+        using PacketArray = Eigen::Array<double, Rows, Lanes, (Lanes == 1) ? Eigen::ColMajor : Eigen::RowMajor>;
+
+        /**
+         * @brief Evaluate a batch of points in packets of a fixed number of lanes, the
+         * lanes past the end of the batch repeat its last point
+         */
+        template <int Lanes, typename TPacketFun>
+        static void evaluatePackets(
+            const TPacketFun &fun,
+            mat<sizer.nx, Eigen::Dynamic> &F,
+            const mat<sizer.nx, Eigen::Dynamic> &X,
+            const mat<sizer.nu, Eigen::Dynamic> &U,
+            const std::vector<unsigned int> &steps)
+        {
+            PacketArray<sizer.nx, Lanes> x(X.rows(), Lanes), f(X.rows(), Lanes);
+            PacketArray<sizer.nu, Lanes> u(U.rows(), Lanes);
+            std::array<unsigned int, Lanes> k;
+
+            for (size_t c = 0; c < steps.size(); c += Lanes)
+            {
+                size_t m = std::min<size_t>(Lanes, steps.size() - c);
+
+                for (size_t l = 0; l < (size_t)Lanes; l++)
+                {
+                    size_t j = c + std::min(l, m - 1);
+                    x.col(l) = X.col(j).array();
+                    u.col(l) = U.col(j).array();
+                    k[l] = steps[j];
+                }
+
+                fun(f, x, u, k);
+                F.middleCols(c, m) = f.leftCols(m).matrix();
+            }
+        }
+
+        /**
+         * @brief Evaluate the transition of the batch with the stages buffers of the
+         * caller (the points or their perturbations)
+         */
+        void integrateBatch(
+            mat<sizer.nx, Eigen::Dynamic> &F,
+            const mat<sizer.nx, Eigen::Dynamic> &X,
+            const mat<sizer.nu, Eigen::Dynamic> &U,
+            const std::vector<unsigned int> &steps,
+            Workspace &ws,
+            Stages &st)
+        {
+            if (!isIntegrated())
+            {
+                vectorFieldBatch(F, X, U, steps);
+            }
+            else if (integrator == NLIntegrator::RK4)
+            {
+                integrateRK4(F, X, U, steps, st);
+            }
+            else if (integrator == NLIntegrator::SDIRK)
+            {
+                integrateSDIRK(F, X, U, steps, ws, st);
+            }
+            else
+            {
+                integrateRKF32(F, X, U, steps, st);
+            }
+        }
+
+        /**
+         * @brief Integrate the batch over the sampling time with the Runge-Kutta method
+         * of the 4th order, all the points share the same sub-steps
+         */
+        void integrateRK4(
+            mat<sizer.nx, Eigen::Dynamic> &F,
+            const mat<sizer.nx, Eigen::Dynamic> &X,
+            const mat<sizer.nu, Eigen::Dynamic> &U,
+            const std::vector<unsigned int> &steps,
+            Stages &st)
+        {
+            double h = sampleTime / integrator_steps;
+
+            auto &k1 = st.K[0];
+            auto &k2 = st.K[1];
+            auto &k3 = st.K[2];
+            auto &k4 = st.K[3];
+            k1.resize(X.rows(), X.cols());
+            k2.resize(X.rows(), X.cols());
+            k3.resize(X.rows(), X.cols());
+            k4.resize(X.rows(), X.cols());
+
+            F = X;
+            for (int s = 0; s < integrator_steps; s++)
+            {
+                vectorFieldBatch(k1, F, U, steps);
+                st.Y = F + ((h / 2.0) * k1);
+                vectorFieldBatch(k2, st.Y, U, steps);
+                st.Y = F + ((h / 2.0) * k2);
+                vectorFieldBatch(k3, st.Y, U, steps);
+                st.Y = F + (h * k3);
+                vectorFieldBatch(k4, st.Y, U, steps);
+
+                F += (h / 6.0) * (k1 + (2.0 * k2) + (2.0 * k3) + k4);
+            }
+        }
+
+        /**
+         * @brief Integrate the batch over the sampling time with the embedded
+         * Runge-Kutta-Fehlberg 3(2) method. The sub-step is adapted for each point, so
+         * that the transition of a point does not depend on the other points of the
+         * batch. A point whose vector field is not finite stops with the non-finite
+         * state, a point which does not reach the sampling time within the maximum
+         * number of sub-steps is not finite too
+         *
+         * @param F transitions of the points
+         * @param X states of the points
+         * @param U inputs of the points
+         * @param steps steps of the horizon of the points
+         * @param st work buffers of the stages
+         * @param hs if not null, the accepted sub-steps of each point
+         */
+        void integrateRKF32(
+            mat<sizer.nx, Eigen::Dynamic> &F,
+            const mat<sizer.nx, Eigen::Dynamic> &X,
+            const mat<sizer.nu, Eigen::Dynamic> &U,
+            const std::vector<unsigned int> &steps,
+            Stages &st,
+            std::vector<std::vector<double>> *hs = nullptr)
+        {
+            size_t npts = steps.size();
+            double hmin = sampleTime * 1e-6;
+
+            auto &t = st.t;
+            auto &h = st.h;
+            auto &hk = st.hk;
+            auto &done = st.flags;
+            t.setZero(npts);
+            h.setConstant(npts, sampleTime / integrator_steps);
+            hk.setZero(npts);
+            done.assign(npts, false);
+
+            if (hs)
+            {
+                hs->resize(npts);
+                for (auto &seq : *hs)
+                {
+                    seq.clear();
+                }
+            }
+
+            auto &k1 = st.K[0];
+            auto &k2 = st.K[1];
+            auto &k3 = st.K[2];
+            auto &next = st.next;
+            k1.resize(X.rows(), X.cols());
+            k2.resize(X.rows(), X.cols());
+            k3.resize(X.rows(), X.cols());
+
+            F = X;
+            size_t active = npts;
+            for (int it = 0; it < max_substeps && active > 0; it++)
+            {
+                // the points at the end of the sampling time do not move
+                for (size_t j = 0; j < npts; j++)
+                {
+                    hk(j) = done[j] ? 0.0 : std::min(h(j), sampleTime - t(j));
+                }
+
+                vectorFieldBatch(k1, F, U, steps);
+                st.Y = F + (k1 * hk.asDiagonal());
+                vectorFieldBatch(k2, st.Y, U, steps);
+                st.Y = F + ((k1 + k2) * (hk / 4.0).asDiagonal());
+                vectorFieldBatch(k3, st.Y, U, steps);
+
+                // third order solution, the second order one is the Heun's method
+                next = F + ((k1 + k2 + (4.0 * k3)) * (hk / 6.0).asDiagonal());
+
+                for (size_t j = 0; j < npts; j++)
+                {
+                    if (done[j])
+                    {
+                        continue;
+                    }
+
+                    double err = ((hk(j) / 3.0) * (k1.col(j) + k2.col(j) - (2.0 * k3.col(j)))).cwiseAbs().cwiseQuotient(
+                                                                                                         (integrator_tolerance * (1.0 + next.col(j).array().abs())).matrix())
+                                     .maxCoeff();
+
+                    // the non-finite state is returned as is, the step cannot be adapted
+                    if (!std::isfinite(err))
+                    {
+                        F.col(j) = next.col(j);
+                        done[j] = true;
+                        active--;
+                        continue;
+                    }
+
+                    if (err <= 1.0 || hk(j) <= hmin)
+                    {
+                        F.col(j) = next.col(j);
+                        if (hs)
+                        {
+                            (*hs)[j].push_back(hk(j));
+                        }
+
+                        if (hk(j) >= sampleTime - t(j))
+                        {
+                            t(j) = sampleTime;
+                            done[j] = true;
+                            active--;
+                            continue;
+                        }
+                        t(j) += hk(j);
+                    }
+
+                    h(j) = std::max(hk(j) * std::clamp(0.9 * std::pow(std::max(err, 1e-12), -1.0 / 3.0), 0.2, 5.0), hmin);
+                }
+            }
+
+            for (size_t j = 0; j < npts; j++)
+            {
+                if (!done[j])
+                {
+                    F.col(j).setConstant(std::numeric_limits<double>::quiet_NaN());
+                }
+            }
+        }
+
+        /**
+         * @brief Integrate the batch over the sampling time with the Runge-Kutta-Fehlberg
+         * 3(2) method on given sub-steps, the group of consecutive points j * group ...
+         * (j + 1) * group - 1 follows the sub-steps of the j-th sequence. The perturbations
+         * of the finite differences follow the sub-steps accepted for their nominal point,
+         * so that their transitions are smooth functions of the perturbation
+         *
+         * @param F transitions of the points
+         * @param X states of the points
+         * @param U inputs of the points
+         * @param steps steps of the horizon of the points
+         * @param st work buffers of the stages
+         * @param hs sub-steps of each group of points
+         * @param group number of consecutive points of each group
+         */
+        void integrateRKF32(
+            mat<sizer.nx, Eigen::Dynamic> &F,
+            const mat<sizer.nx, Eigen::Dynamic> &X,
+            const mat<sizer.nu, Eigen::Dynamic> &U,
+            const std::vector<unsigned int> &steps,
+            Stages &st,
+            const std::vector<std::vector<double>> &hs,
+            size_t group)
+        {
+            size_t npts = steps.size();
+            size_t len = 0;
+            for (auto &seq : hs)
+            {
+                len = std::max(len, seq.size());
+            }
+
+            auto &hk = st.hk;
+            auto &k1 = st.K[0];
+            auto &k2 = st.K[1];
+            auto &k3 = st.K[2];
+            hk.resize(npts);
+            k1.resize(X.rows(), X.cols());
+            k2.resize(X.rows(), X.cols());
+            k3.resize(X.rows(), X.cols());
+
+            F = X;
+            for (size_t s = 0; s < len; s++)
+            {
+                for (size_t j = 0; j < npts; j++)
+                {
+                    auto &seq = hs[j / group];
+                    hk(j) = s < seq.size() ? seq[s] : 0.0;
+                }
+
+                vectorFieldBatch(k1, F, U, steps);
+                st.Y = F + (k1 * hk.asDiagonal());
+                vectorFieldBatch(k2, st.Y, U, steps);
+                st.Y = F + ((k1 + k2) * (hk / 4.0).asDiagonal());
+                vectorFieldBatch(k3, st.Y, U, steps);
+
+                F += (k1 + k2 + (4.0 * k3)) * (hk / 6.0).asDiagonal();
+            }
+        }
+
+        /**
+         * @brief Integrate the batch over the sampling time with the L-stable singly
+         * diagonally implicit Runge-Kutta method of the 4th order (SDIRK4 of Hairer and
+         * Wanner), all the points share the same sub-steps. Each stage is solved with
+         * simplified Newton iterations, the iteration matrix of each point is factorized
+         * once for each sub-step. When requested, the sensitivities w.r.t. the initial
+         * states and the inputs are propagated through the converged stages with the
+         * implicit function theorem. A point whose stages do not converge within the
+         * Newton iterations is not finite, as well as its sensitivities
+         */
+        void integrateSDIRK(
+            mat<sizer.nx, Eigen::Dynamic> &F,
+            const mat<sizer.nx, Eigen::Dynamic> &X,
+            const mat<sizer.nu, Eigen::Dynamic> &U,
+            const std::vector<unsigned int> &steps,
+            Workspace &ws,
+            Stages &st,
+            mat<sizer.nx, Eigen::Dynamic> *Jx = nullptr,
+            mat<sizer.nx, Eigen::Dynamic> *Jmv = nullptr)
+        {
+            static constexpr int stages = 5;
+            static constexpr double gamma = 1.0 / 4.0;
+            static constexpr double a[stages][stages] = {
+                {1.0 / 4.0, 0, 0, 0, 0},
+                {1.0 / 2.0, 1.0 / 4.0, 0, 0, 0},
+                {17.0 / 50.0, -1.0 / 25.0, 1.0 / 4.0, 0, 0},
+                {371.0 / 1360.0, -137.0 / 2720.0, 15.0 / 544.0, 1.0 / 4.0, 0},
+                {25.0 / 24.0, -49.0 / 48.0, 125.0 / 16.0, -85.0 / 12.0, 1.0 / 4.0}};
+
+            size_t npts = steps.size();
+            size_t n = X.rows();
+            size_t m = U.rows();
+            double h = sampleTime / integrator_steps;
+            bool sensitivities = Jx != nullptr && Jmv != nullptr;
+
+            auto &K = st.K;
+            auto &dKx = st.dKx;
+            auto &dKu = st.dKu;
+            auto &lu = st.lu;
+            auto &base = st.base;
+            auto &Y = st.Y;
+            auto &fy = st.fy;
+            auto &g = st.g;
+            auto &A = st.A;
+            auto &B = st.B;
+            auto &failed = st.flags;
+            lu.resize(npts);
+            fy.resize(n, npts);
+            failed.assign(npts, false);
+
+            // the stage matrices of a single point have a fixed size
+            mat<sizer.nx, sizer.nx> Ix, Aj, Dx;
+            COND_RESIZE_MAT(sizer, Ix, n, n);
+            Ix.setIdentity();
+
+            mat<sizer.nx, sizer.nu> Du;
+            COND_RESIZE_MAT(sizer, Du, n, m);
+
+            Eigen::PartialPivLU<mat<sizer.nx, sizer.nx>> M(n);
+
+            F = X;
+            if (sensitivities)
+            {
+                Jx->resize(n, npts * n);
+                Jmv->resize(n, npts * m);
+                for (size_t j = 0; j < npts; j++)
+                {
+                    Jx->middleCols(j * n, n) = Ix;
+                }
+                Jmv->setZero();
+            }
+
+            for (int s = 0; s < integrator_steps; s++)
+            {
+                // the iteration matrix is frozen at the beginning of the sub-step
+                centralDifferences(A, B, F, U, steps, false, ws);
+                for (size_t j = 0; j < npts; j++)
+                {
+                    lu[j].compute(Ix - ((h * gamma) * A.middleCols(j * n, n)));
+                }
+
+                vectorFieldBatch(fy, F, U, steps);
+
+                for (int i = 0; i < stages; i++)
+                {
+                    base = F;
+                    for (int l = 0; l < i; l++)
+                    {
+                        base += (h * a[i][l]) * K[l];
+                    }
+
+                    // the previous stage derivative is the initial guess of the stage
+                    Y = base + ((h * gamma) * fy);
+                    vectorFieldBatch(fy, Y, U, steps);
+
+                    for (int it = 0; it < newton_iterations; it++)
+                    {
+                        g = Y - base - ((h * gamma) * fy);
+                        for (size_t j = 0; j < npts; j++)
+                        {
+                            g.col(j) = lu[j].solve(g.col(j));
+                        }
+
+                        Y -= g;
+                        vectorFieldBatch(fy, Y, U, steps);
+
+                        if ((g.cwiseAbs().array() <= integrator_tolerance * (1.0 + Y.array().abs())).all())
+                        {
+                            break;
+                        }
+                    }
+
+                    // the last correction of an unconverged (or not finite) stage is above the tolerance
+                    for (size_t j = 0; j < npts; j++)
+                    {
+                        if (!(g.col(j).cwiseAbs().array() <= integrator_tolerance * (1.0 + Y.col(j).array().abs())).all())
+                        {
+                            failed[j] = true;
+                        }
+                    }
+
+                    K[i] = fy;
+
+                    if (!sensitivities)
+                    {
+                        continue;
+                    }
+
+                    // implicit function theorem applied to the stage equation
+                    // (I - h gamma A_i) dK_i = A_i (dx + h sum_l a_il dK_l) + B_i du
+                    centralDifferences(A, B, Y, U, steps, false, ws);
+
+                    dKx[i] = *Jx;
+                    dKu[i] = *Jmv;
+                    for (int l = 0; l < i; l++)
+                    {
+                        dKx[i] += (h * a[i][l]) * dKx[l];
+                        dKu[i] += (h * a[i][l]) * dKu[l];
+                    }
+
+                    for (size_t j = 0; j < npts; j++)
+                    {
+                        Aj = A.middleCols(j * n, n);
+                        M.compute(Ix - ((h * gamma) * Aj));
+
+                        Dx.noalias() = Aj * dKx[i].middleCols(j * n, n);
+                        dKx[i].middleCols(j * n, n) = M.solve(Dx);
+
+                        Du = B.middleCols(j * m, m);
+                        Du.noalias() += Aj * dKu[i].middleCols(j * m, m);
+                        dKu[i].middleCols(j * m, m) = M.solve(Du);
+                    }
+                }
+
+                // the method is stiffly accurate, the weights are the last row of the tableau
+                for (int i = 0; i < stages; i++)
+                {
+                    F += (h * a[stages - 1][i]) * K[i];
+
+                    if (sensitivities)
+                    {
+                        *Jx += (h * a[stages - 1][i]) * dKx[i];
+                        *Jmv += (h * a[stages - 1][i]) * dKu[i];
+                    }
+                }
+            }
+
+            for (size_t j = 0; j < npts; j++)
+            {
+                if (!failed[j])
+                {
+                    continue;
+                }
+
+                F.col(j).setConstant(std::numeric_limits<double>::quiet_NaN());
+                if (sensitivities)
+                {
+                    Jx->middleCols(j * n, n).setConstant(std::numeric_limits<double>::quiet_NaN());
+                    Jmv->middleCols(j * m, m).setConstant(std::numeric_limits<double>::quiet_NaN());
+                }
+            }
+        }
+
+        /**
+         * @brief Compute the Jacobian matrices of the transition (or of the vector field)
+         * on a batch of points using the central difference method. The perturbations of
+         * all the points are packed in a single evaluation of the batch
+         */
+        void centralDifferences(
+            mat<sizer.nx, Eigen::Dynamic> &Jx,
+            mat<sizer.nx, Eigen::Dynamic> &Jmv,
+            const mat<sizer.nx, Eigen::Dynamic> &X0,
+            const mat<sizer.nu, Eigen::Dynamic> &U0,
+            const std::vector<unsigned int> &steps,
+            bool useTransition,
+            Workspace &ws)
+        {
+            size_t npts = steps.size();
+            size_t n = X0.rows();
+            size_t m = U0.rows();
+            size_t nper = 2 * (n + m);
+
+            auto &Xp = ws.Xp;
+            auto &Fp = ws.Fp;
+            auto &Up = ws.Up;
+            auto &sp = ws.sp;
+            Xp.resize(n, npts * nper);
+            Fp.resize(n, npts * nper);
+            Up.resize(m, npts * nper);
+            sp.resize(npts * nper);
+
+            // this is computing the max(abs(x0), 1) for each
+            // element of the state and input vectors. This is then
+            // used to scale the perturbation for each element
+            auto &Xa = ws.Xa;
+            auto &Ua = ws.Ua;
+            Xa = X0.cwiseAbs().cwiseMax(1.0);
+            Ua = U0.cwiseAbs().cwiseMax(1.0);
+
+            for (size_t j = 0; j < npts; j++)
+            {
+                size_t base = j * nper;
+
+                Xp.middleCols(base, nper).colwise() = X0.col(j);
+                Up.middleCols(base, nper).colwise() = U0.col(j);
+                std::fill(sp.begin() + base, sp.begin() + base + nper, steps[j]);
+
+                for (size_t i = 0; i < n; i++)
+                {
+                    Xp(i, base + (2 * i)) += dv * Xa(i, j);
+                    Xp(i, base + (2 * i) + 1) -= dv * Xa(i, j);
+                }
+
+                // TODO support measured disturbances
+                for (size_t i = 0; i < m; i++)
+                {
+                    Up(i, base + (2 * n) + (2 * i)) += dv * Ua(i, j);
+                    Up(i, base + (2 * n) + (2 * i) + 1) -= dv * Ua(i, j);
+                }
+            }
+
+            if (useTransition && isIntegrated() && integrator == NLIntegrator::RKF32)
+            {
+                // the perturbations of each point follow the sub-steps of the point
+                integrateRKF32(ws.F0, X0, U0, steps, ws.points, &ws.hs);
+                integrateRKF32(Fp, Xp, Up, sp, ws.perturbations, ws.hs, nper);
+            }
+            else if (useTransition)
+            {
+                integrateBatch(Fp, Xp, Up, sp, ws, ws.perturbations);
+            }
+            else
+            {
+                vectorFieldBatch(Fp, Xp, Up, sp);
+            }
+
+            Jx.resize(n, npts * n);
+            Jmv.resize(n, npts * m);
+
+            for (size_t j = 0; j < npts; j++)
+            {
+                size_t base = j * nper;
+
+                for (size_t i = 0; i < n; i++)
+                {
+                    Jx.col((j * n) + i) = (Fp.col(base + (2 * i)) - Fp.col(base + (2 * i) + 1)) / (2 * dv * Xa(i, j));
+                }
+
+                for (size_t i = 0; i < m; i++)
+                {
+                    size_t col = base + (2 * n) + (2 * i);
+                    Jmv.col((j * m) + i) = (Fp.col(col) - Fp.col(col + 1)) / (2 * dv * Ua(i, j));
+                }
+            }
+        }
+
         typename IDimensionable<sizer>::OutFunHandle outUser = nullptr;
+        typename IDimensionable<sizer>::BatchStateFunHandle batchField = nullptr;
+
+        NLIntegrator integrator = NLIntegrator::TRAPEZOIDAL;
+        int integrator_steps = 1;
+        double integrator_tolerance = 1e-8;
+
+        const int newton_iterations = 20;
+        const int max_substeps = 10000;
+        const double dv = sqrt(std::numeric_limits<double>::epsilon());
     };
 } // namespace mpc
@@ -4,15 +4,24 @@
  */
 #pragma once
 
+#include <mpc/NLMPC/Collocation.hpp>
 #include <mpc/NLMPC/Constraints.hpp>
+#include <mpc/NLMPC/EvaluationTeam.hpp>
 #include <mpc/IOptimizer.hpp>
+#include <mpc/NLMPC/IPMSolver.hpp>
 #include <mpc/Logger.hpp>
 #include <mpc/NLMPC/Mapping.hpp>
 #include <mpc/NLMPC/Objective.hpp>
+#include <mpc/NLMPC/SingleShooting.hpp>
+#include <mpc/NLMPC/SQPSolver.hpp>
 #include <mpc/Types.hpp>
 
 #include <nlopt.hpp>
 
+#include <atomic>
+#include <mutex>
+#include <thread>
+
 namespace mpc
 {
     /**
@@ -52,6 +61,8 @@ namespace mpc
         {
             checkOrQuit();
             delete innerOpt;
+            delete shootingOpt;
+            delete collocationOpt;
         }
 
         /**
@@ -61,17 +72,45 @@ namespace mpc
          */
         void onInit() override
         {
-            innerOpt = new nlopt::opt(nlopt::LD_SLSQP, ((ph() * nx()) + (nu() * ch()) + 1));
-
             COND_RESIZE_CVEC(sizer,lb,((ph() * nx()) + (nu() * ch()) + 1));
             lb.setConstant(-std::numeric_limits<float>::infinity());
 
             COND_RESIZE_CVEC(sizer,ub, ((ph() * nx()) + (nu() * ch()) + 1));
             ub.setConstant(std::numeric_limits<float>::infinity());
 
+            COND_RESIZE_CVEC(sizer, zlb, ((ph() * nx()) + (nu() * ch()) + 1));
+            COND_RESIZE_CVEC(sizer, zub, ((ph() * nx()) + (nu() * ch()) + 1));
+            COND_RESIZE_CVEC(sizer, scaling, ((ph() * nx()) + (nu() * ch()) + 1));
+            scaling.setOnes();
+
+            COND_RESIZE_CVEC(sizer, state_magnitude, nx());
+            COND_RESIZE_CVEC(sizer, input_magnitude, nu());
+            has_magnitude = false;
+
             COND_RESIZE_CVEC(sizer,opt_vector, ((ph() * nx()) + (nu() * ch()) + 1));
             opt_vector.setZero();
 
+            // the buffers exchanged with NLopt are allocated once
+            opt_x.reserve((ph() * nx()) + (nu() * ch()) + 1);
+            lb_vec.reserve((ph() * nx()) + (nu() * ch()) + 1);
+            ub_vec.reserve((ph() * nx()) + (nu() * ch()) + 1);
+
+            COND_RESIZE_CVEC(sizer, shooting_grad, ((ph() * nx()) + (nu() * ch()) + 1));
+            COND_RESIZE_MAT(sizer, shooting_ineq_jac, ((ph() * nx()) + (nu() * ch()) + 1), ineq());
+            COND_RESIZE_MAT(sizer, shooting_eq_jac, ((ph() * nx()) + (nu() * ch()) + 1), eq());
+
+            sqpSolver = std::make_shared<SQPSolver<sizer>>();
+            sqpSolver->initialize(nx(), nu(), ndu(), ny(), ph(), ch(), ineq(), eq());
+
+            ipmSolver = std::make_shared<IPMSolver<sizer>>();
+            ipmSolver->initialize(nx(), nu(), ndu(), ny(), ph(), ch(), ineq(), eq());
+
+            shooting = std::make_shared<SingleShooting<sizer>>();
+            shooting->initialize(nx(), nu(), ndu(), ny(), ph(), ch(), ineq(), eq());
+
+            collocation = std::make_shared<Collocation<sizer>>();
+            collocation->initialize(nx(), nu(), ndu(), ny(), ph(), ch(), ineq(), eq());
+
             setParameters(NLParameters());
 
             COND_RESIZE_CVEC(sizer,result.cmd, nu());
@@ -100,6 +139,20 @@ namespace mpc
 
             mapping = map;
             model = sysModel;
+
+            // the parameterization of the inputs may be set before the mapping
+            mapping->setInputBasis(
+                parameters.input_basis,
+                parameters.laguerre_pole,
+                parameters.spline_degree,
+                parameters.spline_knots);
+
+            sqpSolver->setModel(sysModel, map);
+            ipmSolver->setModel(sysModel, map);
+            shooting->setModel(sysModel, map);
+            collocation->setModel(sysModel, map);
+
+            starts_changed = team_changed = true;
         }
 
         /**
@@ -116,6 +169,14 @@ namespace mpc
 
             this->objFunc = objFunc;
             this->conFunc = conFunc;
+
+            objFunc->setSlackFixed(fixed_slack);
+            conFunc->setSlackFixed(fixed_slack);
+
+            sqpSolver->setCostAndConstraints(objFunc, conFunc);
+            ipmSolver->setCostAndConstraints(objFunc, conFunc);
+
+            starts_changed = team_changed = true;
         }
 
         /**
@@ -129,19 +190,44 @@ namespace mpc
 
             auto nl_param = dynamic_cast<const NLParameters *>(&param);
 
-            innerOpt->set_ftol_rel(nl_param->relative_ftol);
-            innerOpt->set_xtol_rel(nl_param->relative_xtol);
-            innerOpt->set_ftol_abs(nl_param->absolute_ftol);
-            innerOpt->set_xtol_abs(nl_param->absolute_xtol);
+            // an unsupported number of collocation points is rejected and the current one is kept
+            bool points_changed = (size_t)nl_param->collocation_points != collocation->points() &&
+                                  collocation->setPoints(nl_param->collocation_points);
+
+            // the algorithm and the dimension of the NLopt instances cannot be changed
+            // after their creation, the slack variable fixed by the hard constraints
+            // is removed from the problem
+            if (!innerOpt ||
+                nl_param->algorithm != algorithm ||
+                nl_param->auglag_local_algorithm != auglag_local_algorithm ||
+                nl_param->hard_constraints != fixed_slack ||
+                points_changed)
+            {
+                algorithm = nl_param->algorithm;
+                auglag_local_algorithm = nl_param->auglag_local_algorithm;
+                fixed_slack = nl_param->hard_constraints;
+                buildSolvers();
+            }
 
-            innerOpt->set_x_weights(1.0);
+            if (objFunc)
+            {
+                objFunc->setSlackFixed(fixed_slack);
+            }
 
-            if (nl_param->time_limit > 0)
+            if (conFunc)
             {
-                innerOpt->set_maxtime(nl_param->time_limit);
+                conFunc->setSlackFixed(fixed_slack);
             }
 
-            innerOpt->set_maxeval(nl_param->maximum_iteration);
+            // the same stopping criterias are used by all the formulations
+            setSolverParameters(*innerOpt, *nl_param);
+            setSolverParameters(*shootingOpt, *nl_param);
+            setSolverParameters(*collocationOpt, *nl_param);
+
+            Logger::instance().log(Logger::log_type::DETAIL)
+                << "Setting NLopt algorithm: "
+                << innerOpt->get_algorithm_name()
+                << std::endl;
 
             // print the parameters
             Logger::instance().log(Logger::log_type::DETAIL)
@@ -181,9 +267,89 @@ namespace mpc
                 lb[((ph() * nx()) + (nu() * ch()) + 1) - 1] = 0;
                 ub[((ph() * nx()) + (nu() * ch()) + 1) - 1] = 0;
             }
+            else
+            {
+                lb[((ph() * nx()) + (nu() * ch()) + 1) - 1] = -std::numeric_limits<float>::infinity();
+                ub[((ph() * nx()) + (nu() * ch()) + 1) - 1] = std::numeric_limits<float>::infinity();
+            }
 
             enable_warm_start = nl_param->enable_warm_start;
 
+            backend = nl_param->backend;
+            formulation = nl_param->formulation;
+            sqp_iterations = std::max(1, nl_param->sqp_iterations);
+            sqp_step_tolerance = nl_param->sqp_step_tolerance;
+            initialization = nl_param->initialization;
+            multistart = std::max(1, nl_param->multistart);
+            multistart_cost_tolerance = nl_param->multistart_cost_tolerance;
+            concurrent_evaluation = nl_param->concurrent_evaluation;
+            scaling_mode = nl_param->scaling;
+            scaling_smoothing = nl_param->scaling_smoothing;
+
+            // the previous solution has no meaning with a different input parameterization
+            if (nl_param->input_basis != parameters.input_basis ||
+                nl_param->laguerre_pole != parameters.laguerre_pole ||
+                nl_param->spline_degree != parameters.spline_degree ||
+                nl_param->spline_knots != parameters.spline_knots)
+            {
+                is_first_iteration = true;
+            }
+
+            if (mapping)
+            {
+                mapping->setInputBasis(
+                    nl_param->input_basis,
+                    nl_param->laguerre_pole,
+                    nl_param->spline_degree,
+                    nl_param->spline_knots);
+            }
+
+            // the input bounds set before the change of the basis are removed
+            // since they would be applied to the coefficients of the functions
+            if (hasUnboundedBasis(nl_param->input_basis) &&
+                (lb.segment(ph() * nx(), nu() * ch()).array().isFinite().any() ||
+                 ub.segment(ph() * nx(), nu() * ch()).array().isFinite().any()))
+            {
+                Logger::instance().log(Logger::log_type::ERROR)
+                    << "The input bounds are not supported with the Laguerre or Chebyshev input basis "
+                    << "and have been removed, write them in the user inequality constraints"
+                    << std::endl;
+
+                lb.segment(ph() * nx(), nu() * ch()).setConstant(-std::numeric_limits<float>::infinity());
+                ub.segment(ph() * nx(), nu() * ch()).setConstant(std::numeric_limits<float>::infinity());
+            }
+
+            parameters = *nl_param;
+            starts_changed = team_changed = true;
+            sqpSolver->setParameters(*nl_param);
+            ipmSolver->setParameters(*nl_param);
+
+            if (model)
+            {
+                model->setIntegrator(
+                    nl_param->integrator,
+                    nl_param->integrator_steps,
+                    nl_param->integrator_tolerance);
+            }
+
+            if (conFunc)
+            {
+                conFunc->setJacobianUpdate(
+                    nl_param->jacobian_update,
+                    nl_param->jacobian_refresh_iterations,
+                    nl_param->jacobian_refresh_step);
+            }
+
+            Logger::instance().log(Logger::log_type::DETAIL)
+                << "Setting non-linear backend: "
+                << (backend == NLBackend::SQP ? "SQP" : (backend == NLBackend::IPM ? "IPM" : (backend == NLBackend::LTV ? "LTV" : "NLOPT")))
+                << std::endl;
+
+            Logger::instance().log(Logger::log_type::DETAIL)
+                << "Setting non-linear formulation: "
+                << (formulation == NLFormulation::SINGLE_SHOOTING ? "single shooting" : (formulation == NLFormulation::COLLOCATION ? "collocation" : "multiple shooting"))
+                << std::endl;
+
             updateBounds();
 
             Logger::instance().log(Logger::log_type::DETAIL)
@@ -204,7 +370,10 @@ namespace mpc
 
             try
             {
-                innerOpt->set_min_objective(NLOptimizer::nloptObjFunWrapper, objFunc.get());
+                innerOpt->set_min_objective(NLOptimizer::trackedObjFunWrapper, this);
+                shootingOpt->set_min_objective(NLOptimizer::shootingObjFunWrapper, this);
+                collocationOpt->set_min_objective(NLOptimizer::collocationObjFunWrapper, this);
+                starts_changed = team_changed = true;
                 return true;
             }
             catch (const std::exception &e)
@@ -233,12 +402,8 @@ namespace mpc
 
             try
             {
-                innerOpt->add_equality_mconstraint(
-                    NLOptimizer::nloptEqConFunWrapper,
-                    conFunc.get(),
-                    std::vector<double>(
-                        tol.data(),
-                        tol.data() + tol.rows() * tol.cols()));
+                state_eq_tol.assign(tol.data(), tol.data() + tol.rows() * tol.cols());
+                bindConstraints();
                 Logger::instance().log(Logger::log_type::DETAIL)
                     << "Adding state defined equality constraints"
                     << std::endl;
@@ -270,12 +435,11 @@ namespace mpc
 
             try
             {
-                innerOpt->add_inequality_mconstraint(
-                    NLOptimizer::nloptUserIneqConFunWrapper,
-                    conFunc.get(),
-                    std::vector<double>(
-                        tol.data(),
-                        tol.data() + tol.rows() * tol.cols()));
+                // the single shooting inequality constraints are rebuilt before the
+                // optimization together with the state bounds
+                shooting_ineq_tol.assign(tol.data(), tol.data() + tol.rows() * tol.cols());
+                bindConstraints();
+
                 Logger::instance().log(Logger::log_type::DETAIL)
                     << "Adding user inequality constraints"
                     << std::endl;
@@ -308,12 +472,8 @@ namespace mpc
 
             try
             {
-                innerOpt->add_equality_mconstraint(
-                    NLOptimizer::nloptUserEqConFunWrapper,
-                    conFunc.get(),
-                    std::vector<double>(
-                        tol.data(),
-                        tol.data() + tol.rows() * tol.cols()));
+                user_eq_tol.assign(tol.data(), tol.data() + tol.rows() * tol.cols());
+                bindConstraints();
                 Logger::instance().log(Logger::log_type::DETAIL)
                     << "Adding user equality constraints"
                     << std::endl;
@@ -372,7 +532,8 @@ namespace mpc
          * @param lb The lower bounds for the input variables.
          * @param ub The upper bounds for the input variables.
          * @param slice The slice of the input bounds to set.
-         * @return True if the input bounds were successfully set, false otherwise.
+         * @return True if the input bounds were successfully set, false otherwise (finite
+         * bounds with the Laguerre or Chebyshev input basis).
          */
         bool setInputBounds(
             const cvec<sizer.nu> &lower_bounds,
@@ -385,6 +546,18 @@ namespace mpc
             size_t start = slice.start == -1 ? 0 : slice.start;
             size_t end = slice.end == -1 ? ch() : slice.end;
 
+            // the coefficients of the Laguerre functions and of the Chebyshev polynomials
+            // do not bound the input sequence, the finite bounds are rejected
+            if (hasUnboundedBasis(parameters.input_basis) &&
+                (lower_bounds.array().isFinite().any() || upper_bounds.array().isFinite().any()))
+            {
+                Logger::instance().log(Logger::log_type::ERROR)
+                    << "The input bounds are not supported with the Laguerre or Chebyshev input basis, "
+                    << "write them in the user inequality constraints"
+                    << std::endl;
+                return false;
+            }
+
             // replicate the input bounds for the control horizon
             for (size_t i = start; i < end; i++)
             {
@@ -412,101 +585,177 @@ namespace mpc
         {
             checkOrQuit();
 
+            applyScaling();
+
+            if (backend == NLBackend::SQP || backend == NLBackend::LTV)
+            {
+                runSQP(x0, u0);
+                return;
+            }
+
+            if (backend == NLBackend::IPM)
+            {
+                runIPM(x0, u0);
+                return;
+            }
+
             Result<sizer.nu> r;
 
-            std::vector<double> optX0;
-            optX0.assign(((ph() * nx()) + (nu() * ch()) + 1),0.0);
+            // with the single shooting formulation only the control inputs
+            // and the slack variable are optimized
+            bool singleShooting = formulation == NLFormulation::SINGLE_SHOOTING;
 
-            if(is_first_iteration || !enable_warm_start)
+            // the collocation of a discrete time model falls back to the multiple shooting
+            bool collocate = formulation == NLFormulation::COLLOCATION && model->isContinuousTime;
+            nlopt::opt *opt = singleShooting ? shootingOpt : (collocate ? collocationOpt : innerOpt);
+
+            // the multi-start is available only with the multiple shooting formulation
+            bool multiStart = multistart > 1 && !singleShooting && !collocate;
+
+            // the deadline starts with the control step
+            startTracking(opt, !multiStart);
+
+            cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> guess = initialPoint(x0, u0);
+            // the starting point is copied in the buffer optimized in place by NLopt
+            opt_x.assign(guess.data(), guess.data() + guess.size() - (fixed_slack ? 1 : 0));
+
+            if (singleShooting)
             {
-                // the whole optimization vector is initialized with the initial state x0
-                // and the initial control action u0 for the full prediction horizon
-                // this has to be done only for the first iteration or if the warm start is disabled
-                for (size_t i = 0; i < ph(); i++)
+                shooting->setCurrentState(x0);
+                updateShootingConstraints();
+
+                opt_x.erase(opt_x.begin(), opt_x.begin() + (ph() * nx()));
+            }
+
+            // the collocation states start on the segments between the states of the guess
+            if (collocate)
+            {
+                size_t nz = opt_x.size();
+                opt_x.resize(nz + collocation->size());
+
+                collocation->setCurrentState(x0);
+                collocation->initialStates(guess, Eigen::Map<cvec<>>(opt_x.data() + nz, collocation->size()));
+            }
+
+            // the constraints are evaluated by the team only with a single instance of NLopt
+            team_active = concurrent_evaluation && !singleShooting && !collocate && !multiStart;
+            if (team_active)
+            {
+                prepareTeam(x0);
+            }
+
+            // number of constraints groups evaluated at each feasible iterate
+            anytime.groups = (!shooting_ineq_tol.empty()) + (!user_eq_tol.empty());
+            anytime.groups += singleShooting
+                                  ? ((shooting_lower_bounds.size() + shooting_upper_bounds.size()) > 0)
+                                  : (!state_eq_tol.empty());
+
+            // let's start the optimization
+            bool optimizationSuccess = false;
+            bool deadlineReached = false;
+            double optCost = mpc::inf;
+            int optStatus = nlopt::FAILURE;
+
+            try
+            {
+                std::vector<double> &opt_v = opt_x;
+                if (multiStart)
                 {
-                    for (size_t j = 0; j < nx(); j++)
-                    {
-                        opt_vector[(i * nx()) + j] = x0(j);
-                    }
+                    opt_v = optimizeMultiStart(x0, guess, optCost, optStatus);
                 }
-
-                for (size_t i = 0; i < ch(); i++)
+                else
                 {
-                    for (size_t j = 0; j < nu(); j++)
+                    // the team is idle when leaving this scope on any path, since it
+                    // shares the model and the mapping with the caller
+                    EvaluationTeam::Guard teamGuard(team_active ? team.get() : nullptr);
+
+                    try
                     {
-                        opt_vector[(ph() * nx()) + (i * nu()) + j] = u0(j);
+                        opt->set_force_stop(0);
+                        optStatus = opt->optimize(opt_v, optCost);
                     }
-                }
-            }
-            
-            // fill the remaining elements with the previous state starting from
-            // the third element of the prediction horizon 
-            // (we shift the sequence to the left by one step)
-            for (size_t i = 0; i < ph(); i++)
-            {
-                for (size_t j = 0; j < nx(); j++)
-                {
-                    if(i == ph() - 1)
+                    catch (const nlopt::roundoff_limited &)
                     {
-                        optX0[(i * nx()) + j] = opt_vector[(i * nx()) + j];
+                        // the errors of the team are reported in place of the solver one
+                        if (team_active)
+                        {
+                            team->wait();
+                        }
+                        throw;
                     }
-                    else{
-                        optX0[(i * nx()) + j] = opt_vector[((i+1) * nx()) + j];
+                    catch (const nlopt::forced_stop &)
+                    {
+                        // the deadline stopped the solver from the callbacks
+                        if (!anytime.expired)
+                        {
+                            throw;
+                        }
+                        optStatus = nlopt::FORCED_STOP;
                     }
-                }
-            }
-
-            cvec<(sizer.ph * sizer.nu)> UmvVectorized;
-            COND_RESIZE_CVEC(sizer,UmvVectorized,(ph() * nu()));
 
-            // convert from the optimized vector to the vectorized manipulated variable
-            // using the mapping matrix Iz2u
-            cvec<(sizer.ph * sizer.nu)> tmp_mult;
-            tmp_mult = mapping->Iz2u() * opt_vector.middleRows((ph() * nx()), (nu() * ch()));
+                    // the errors of the evaluations not requested by the solver are reported too
+                    if (team_active)
+                    {
+                        team->wait();
+                    }
 
-            // fill the remaining elements with the previous control action starting from
-            // the third element of the control horizon
-            // (we shift the sequence to the left by one step)
-            for (size_t i = 0; i < ph(); i++)
-            {
-                for (size_t j = 0; j < nu(); j++)
-                {
-                    if (i == ph() - 1)
+                    // on the deadline the best feasible iterate replaces the last one
+                    commitIterate();
+                    deadlineReached = anytime.expired || optStatus == nlopt::MAXTIME_REACHED;
+                    if (deadlineReached && !anytime.best.empty())
+                    {
+                        opt_v = anytime.best;
+                        optCost = anytime.best_cost;
+                    }
+                    else if (anytime.expired)
                     {
-                        UmvVectorized[(i * nu()) + j] = tmp_mult[(i * nu()) + j];
+                        throw std::runtime_error("time limit reached without a feasible iterate");
                     }
                     else
                     {
-                        UmvVectorized[(i * nu()) + j] = tmp_mult[((i+1) * nu()) + j];
+                        deadlineReached = false;
                     }
                 }
-            }
-
-            cvec<(sizer.nu * sizer.ch)> res;
-            res = mapping->Iu2z() * UmvVectorized;
-
-            // put the control action back in the optimization vector
-            for (size_t i = 0; i < (nu() * ch()); i++)
-            {
-                optX0[(ph() * nx()) + i] = res(i);
-            }
 
-            // put the slack variable in the optimization vector
-            optX0[((ph() * nx()) + (nu() * ch()) + 1) - 1] = currentSlack;
+                // the collocation states are not part of the optimal vector
+                if (collocate)
+                {
+                    opt_v.resize(opt_v.size() - collocation->size());
+                }
 
-            // let's start the optimization
-            bool optimizationSuccess = false;
+                // the fixed slack variable removed from the problem is restored
+                if (fixed_slack)
+                {
+                    opt_v.reserve((ph() * nx()) + (nu() * ch()) + 1);
+                    opt_v.push_back(0.0);
+                }
 
-            try
-            {
-                std::vector<double> opt_v = innerOpt->optimize(optX0);
-                // convert from std vector to eigen vector by copying the data
-                Eigen::Map<cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)>>(opt_v.data(), opt_v.size()).swap(opt_vector);
+                if (singleShooting)
+                {
+                    // the optimal states are recovered by rolling the model forward
+                    shooting->expand(
+                        Eigen::Map<cvec<((sizer.nu * sizer.ch) + 1)>>(opt_v.data(), opt_v.size()),
+                        false);
+                    opt_vector = shooting->fullVector();
+                }
+                else
+                {
+                    // convert from std vector to eigen vector by copying the data
+                    Eigen::Map<cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)>>(opt_v.data(), opt_v.size()).swap(opt_vector);
+                }
                 optimizationSuccess = true;
                 is_first_iteration = false;
 
-                // check if the solution vector is feasible or not
+                // check if the solution vector is feasible or not, the states of a
+                // failed single shooting rollout do not satisfy the system's dynamics
                 r.is_feasible = conFunc->isFeasible(opt_vector);
+                if (singleShooting && !shooting->isConverged())
+                {
+                    Logger::instance().log(Logger::log_type::INFO)
+                        << "The single shooting rollout of the solution did not converge"
+                        << std::endl;
+                    r.is_feasible = false;
+                }
 
                 if (r.is_feasible)
                 {
@@ -546,16 +795,21 @@ namespace mpc
 
             if (optimizationSuccess)
             {
-                r.cost = innerOpt->last_optimum_value();
-                r.solver_status = innerOpt->last_optimize_result();
+                r.cost = optCost;
+                r.solver_status = optStatus;
                 // convert from nlopt result code to ResultStatus enum
-                r.status = convertToResultStatus(r.solver_status);
+                r.status = deadlineReached ? ResultStatus::TIME_LIMIT : convertToResultStatus(r.solver_status);
 
-                Logger::instance().log(Logger::log_type::DETAIL)
-                    << "Optimization end after: "
-                    << innerOpt->get_numevals()
-                    << " evaluation steps"
-                    << std::endl;
+                if (!multiStart)
+                {
+                    r.iterations = opt->get_numevals();
+
+                    Logger::instance().log(Logger::log_type::DETAIL)
+                        << "Optimization end after: "
+                        << opt->get_numevals()
+                        << " evaluation steps"
+                        << std::endl;
+                }
 
                 Logger::instance().log(Logger::log_type::DETAIL)
                     << "Optimization end with code: "
@@ -567,28 +821,7 @@ namespace mpc
                     << r.cost
                     << std::endl;
 
-                mat<(sizer.ph + 1), sizer.nx> Xmat;
-                COND_RESIZE_MAT(sizer,Xmat,(ph() + 1), nx());
-
-                mat<(sizer.ph + 1), sizer.nu> Umat;
-                COND_RESIZE_MAT(sizer,Umat,(ph() + 1), nu());
-
-                mapping->unwrapVector(opt_vector, x0, Xmat, Umat, currentSlack);
-
-                Logger::instance().log(Logger::log_type::DETAIL)
-                    << "Optimal predicted state vector\n"
-                    << Xmat
-                    << std::endl;
-                Logger::instance().log(Logger::log_type::DETAIL)
-                    << "Optimal predicted control input vector\n"
-                    << Umat
-                    << std::endl;
-
-                r.cmd = Umat.row(0);
-
-                sequence.state = Xmat.block(0, 0, ph()+1, nx());
-                sequence.input = Umat.block(0, 0, ph()+1, nu());
-                sequence.output = model->getOutput(Xmat, Umat).block(0, 0, ph()+1, ny());
+                updateSequence(x0, r);
             }
             else
             {
@@ -608,133 +841,1447 @@ namespace mpc
         }
 
         /**
-         * @brief Get the lower bound of the optimization variables
+         * @brief Preparation phase of the real-time iteration scheme (SQP backend only).
+         * The problem is linearized around the shifted optimal sequence and the
+         * initial condition predicted by the last optimal sequence, so that the
+         * next call to run only has to solve the prepared sub-problem
          *
-         * @return lower bound
+         * @return true if the sub-problem has been prepared
+         * @return false if the backend is not SQP or no previous solution is available
          */
-        mpc::cvec<(sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1> getLowerBound() const
+        bool prepare()
         {
-            return lb;
-        }
+            checkOrQuit();
 
-        /**
-         * @brief Get the upper bound of the optimization variables
-         *
-         * @return upper bound
-         */
-        mpc::cvec<(sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1> getUpperBound() const
-        {
-            return ub;
+            if (backend != NLBackend::SQP || is_first_iteration)
+            {
+                return false;
+            }
+
+            applyScaling();
+
+            cvec<sizer.nx> x0_pred;
+            x0_pred = sequence.state.row(1).transpose();
+
+            return sqpSolver->prepare(initialGuess(x0_pred, result.cmd), x0_pred, zlb, zub, enable_warm_start);
         }
 
-    private:
         /**
-         * @brief Update the bounds for the internal solver
+         * @brief Get the multipliers of the constraints of the last solution in the order
+         * system's dynamics, user inequality and user equality constraints (SQP and IPM
+         * backends and LTV mode only, NLopt does not expose the multipliers)
+         *
+         * @return cvec<((sizer.ph * sizer.nx) + sizer.ineq + sizer.eq)> multipliers
          */
-        void updateBounds()
+        cvec<((sizer.ph * sizer.nx) + sizer.ineq + sizer.eq)> getDualMultipliers()
         {
-            // convert from eigen vector to std vector
-            std::vector<double> lb_vec(lb.data(), lb.data() + lb.rows() * lb.cols());
-            std::vector<double> ub_vec(ub.data(), ub.data() + ub.rows() * ub.cols());
-
-            innerOpt->set_lower_bounds(lb_vec);
-            innerOpt->set_upper_bounds(ub_vec);
-
-            // get the bounds from the solver
-            auto lb_solver = innerOpt->get_lower_bounds();
-            auto ub_solver = innerOpt->get_upper_bounds();
+            checkOrQuit();
 
-            // print the bounds
-            Logger::instance().log(Logger::log_type::DETAIL)
-                << "Setting lower bounds: "
-                << std::endl;
-            std::stringstream ss_lb;
-            ss_lb << "\n";
-            for (size_t i = 0; i < lb_solver.size(); i++)
+            if (backend == NLBackend::SQP || backend == NLBackend::LTV)
             {
-                ss_lb << lb_solver[i] << "\n";
+                return sqpSolver->dualMultipliers();
             }
-            Logger::instance().log(Logger::log_type::DETAIL) << ss_lb.str() << "\n";
 
-            Logger::instance().log(Logger::log_type::DETAIL)
-                << "Setting upper bounds: "
-                << std::endl;
-            std::stringstream ss_ub;
-            ss_ub << "\n";
-            for (size_t i = 0; i < ub_solver.size(); i++)
+            if (backend == NLBackend::IPM)
             {
-                ss_ub << ub_solver[i] << "\n";
+                return ipmSolver->dualMultipliers();
             }
-            Logger::instance().log(Logger::log_type::DETAIL) << ss_ub.str() << "\n";
 
+            cvec<((sizer.ph * sizer.nx) + sizer.ineq + sizer.eq)> y;
+            COND_RESIZE_CVEC(sizer, y, ((ph() * nx()) + ineq() + eq()));
+            y.setZero();
+            return y;
         }
 
         /**
-         * @brief Converts an integer value to the corresponding ResultStatus enum value.
+         * @brief Set the multipliers of the constraints used to initialize the next
+         * optimization step (SQP and IPM backends and LTV mode only)
          *
-         * This function maps the given integer value to the corresponding ResultStatus enum value.
-         * If the integer value does not match any known result, the function returns ResultStatus::UNKNOWN.
-         *
-         * @param status The integer value to convert.
-         * @return The corresponding ResultStatus enum value.
-         *
-         * @see ResultStatus
+         * @param y multipliers in the order system's dynamics, user inequality and
+         * user equality constraints
+         * @return true
+         * @return false if the backend does not accept the multipliers
          */
-        ResultStatus convertToResultStatus(int status)
+        bool setDualMultipliers(const cvec<((sizer.ph * sizer.nx) + sizer.ineq + sizer.eq)> &y)
         {
-            switch (status)
+            checkOrQuit();
+
+            if (backend == NLBackend::SQP || backend == NLBackend::LTV)
             {
-            case nlopt::FAILURE:
-            case nlopt::INVALID_ARGS:
-            case nlopt::OUT_OF_MEMORY:
-            case nlopt::ROUNDOFF_LIMITED:
-            case nlopt::FORCED_STOP:
-                return ResultStatus::ERROR;
-            case nlopt::SUCCESS:
-            case nlopt::STOPVAL_REACHED:
-            case nlopt::FTOL_REACHED:
-            case nlopt::XTOL_REACHED:
-                return ResultStatus::SUCCESS;
-            case nlopt::MAXEVAL_REACHED:
-            case nlopt::MAXTIME_REACHED:
-                return ResultStatus::MAX_ITERATION;
-            default:
-                return ResultStatus::UNKNOWN;
+                sqpSolver->setDualMultipliers(y);
+                return true;
+            }
+
+            if (backend == NLBackend::IPM)
+            {
+                ipmSolver->setDualMultipliers(y);
+                return true;
             }
+
+            Logger::instance().log(Logger::log_type::ERROR)
+                << "The multipliers can be set only with the SQP, IPM and LTV backends"
+                << std::endl;
+            return false;
         }
 
         /**
-         * @brief Forward the objective function evaluation to the internal solver
+         * @brief Get the lower bound of the optimization variables
          *
-         * @param x current optimization vector
-         * @param grad objective gradient w.r.t. the current optimization vector
-         * @param objFunc reference to the objective class
-         * @return double objective function value
+         * @return lower bound
          */
-        static double nloptObjFunWrapper(
-            const std::vector<double> &x,
-            std::vector<double> &grad,
-            void *objFunc)
+        mpc::cvec<(sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1> getLowerBound() const
         {
-            bool hasGradient = !grad.empty();
-            cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> x_arr;
-            x_arr = Eigen::Map<cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)>>((double *)x.data(), x.size());
-
-            auto res = ((Objective<sizer> *)objFunc)->evaluate(x_arr, hasGradient);
-
-            if (hasGradient)
-            {
-                // The gradient should be transposed since the difference between matlab and nlopt
-                std::copy_n(
-                    &res.grad.transpose()[0],
-                    res.grad.cols() * res.grad.rows(),
-                    grad.begin());
-            }
-            return res.value;
+            return lb;
         }
 
         /**
-         * @brief Forward the system's dynamics equality constraints evaluation to the internal solver
+         * @brief Get the upper bound of the optimization variables
+         *
+         * @return upper bound
+         */
+        mpc::cvec<(sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1> getUpperBound() const
+        {
+            return ub;
+        }
+
+    private:
+        /**
+         * @brief Perform the optimization step using the SQP backend, in the linear
+         * time-varying mode a single sub-problem is solved around the rollout of
+         * the guessed inputs from the measured initial condition
+         *
+         * @param x0 system's variables initial condition
+         * @param u0 control action initial condition for warm start
+         */
+        void runSQP(
+            const cvec<sizer.nx> &x0,
+            const cvec<sizer.nu> &u0)
+        {
+            Result<sizer.nu> r;
+
+            int iterations = backend == NLBackend::LTV ? 1 : sqp_iterations;
+
+            bool optimizationSuccess = true;
+            for (int k = 0; k < iterations && optimizationSuccess; k++)
+            {
+                r.iterations = k + 1;
+
+                // if the preparation phase has not been already performed
+                // the problem is linearized around the measured initial condition
+                if (!sqpSolver->isPrepared())
+                {
+                    cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> guess;
+                    bool shifted = false;
+                    if (k == 0)
+                    {
+                        guess = initialGuess(x0, u0);
+                        shifted = enable_warm_start && !is_first_iteration;
+
+                        if (backend == NLBackend::LTV)
+                        {
+                            // the states are replaced by the rollout of the guessed inputs
+                            shooting->setCurrentState(x0);
+                            shooting->expand(shooting->reduce(guess), false);
+                            guess = shooting->fullVector();
+                        }
+                    }
+                    else
+                    {
+                        guess = opt_vector;
+                    }
+
+                    optimizationSuccess = sqpSolver->prepare(guess, x0, zlb, zub, shifted);
+                }
+
+                optimizationSuccess = optimizationSuccess && sqpSolver->feedback(x0, zlb, zub, opt_vector);
+
+                // stop as soon as the step is negligible
+                if (optimizationSuccess && sqp_step_tolerance > 0 && sqpSolver->stepNorm() <= sqp_step_tolerance)
+                {
+                    break;
+                }
+            }
+
+            r.solver_status = sqpSolver->solverStatus();
+
+            if (optimizationSuccess)
+            {
+                is_first_iteration = false;
+
+                r.status = SQPSolver<sizer>::convertToResultStatus(r.solver_status);
+                r.cost = objFunc->evaluate(opt_vector, false).value;
+                r.is_feasible = conFunc->isFeasible(opt_vector);
+
+                Logger::instance().log(Logger::log_type::DETAIL)
+                    << "SQP step end with code: "
+                    << r.solver_status
+                    << " and cost: "
+                    << r.cost
+                    << std::endl;
+
+                updateSequence(x0, r);
+            }
+            else
+            {
+                r.cost = mpc::inf;
+                r.cmd = result.cmd;
+                r.solver_status_msg = "Unable to solve the SQP sub-problem";
+                // set the result status to error
+                r.status = ResultStatus::ERROR;
+
+                sequence.state.setZero();
+                sequence.input.setZero();
+                sequence.output.setZero();
+            }
+
+            // update the result
+            result = r;
+        }
+
+        /**
+         * @brief Perform the optimization step using the interior point backend
+         *
+         * @param x0 system's variables initial condition
+         * @param u0 control action initial condition for warm start
+         */
+        void runIPM(
+            const cvec<sizer.nx> &x0,
+            const cvec<sizer.nu> &u0)
+        {
+            Result<sizer.nu> r;
+
+            // the initial guess is shifted only if it comes from the last solution
+            bool shifted = enable_warm_start && !is_first_iteration;
+            bool optimizationSuccess = ipmSolver->solve(initialPoint(x0, u0), x0, zlb, zub, opt_vector, shifted);
+
+            r.solver_status = ipmSolver->solverStatus();
+            r.iterations = ipmSolver->solverIterations();
+            r.solver_status_msg = IPMSolver<sizer>::statusMessage(r.solver_status);
+
+            if (optimizationSuccess)
+            {
+                is_first_iteration = false;
+
+                r.status = IPMSolver<sizer>::convertToResultStatus(r.solver_status);
+                r.cost = objFunc->evaluate(opt_vector, false).value;
+                r.is_feasible = conFunc->isFeasible(opt_vector);
+
+                Logger::instance().log(Logger::log_type::DETAIL)
+                    << "IPM end after: "
+                    << ipmSolver->solverIterations()
+                    << " iterations with code: "
+                    << r.solver_status
+                    << " and cost: "
+                    << r.cost
+                    << std::endl;
+
+                updateSequence(x0, r);
+            }
+            else
+            {
+                r.cost = mpc::inf;
+                r.cmd = result.cmd;
+                // set the result status to error
+                r.status = ResultStatus::ERROR;
+
+                sequence.state.setZero();
+                sequence.input.setZero();
+                sequence.output.setZero();
+            }
+
+            // update the result
+            result = r;
+        }
+
+        /**
+         * @brief Apply the stopping criterias of the parameters to an NLopt instance
+         *
+         * @param opt NLopt instance
+         * @param param parameters desired
+         */
+        static void setStoppingCriteria(nlopt::opt &opt, const NLParameters &param)
+        {
+            opt.set_ftol_rel(param.relative_ftol);
+            opt.set_xtol_rel(param.relative_xtol);
+            opt.set_ftol_abs(param.absolute_ftol);
+            opt.set_xtol_abs(param.absolute_xtol);
+
+            opt.set_x_weights(1.0);
+
+            if (param.time_limit > 0)
+            {
+                opt.set_maxtime(param.time_limit);
+            }
+
+            opt.set_maxeval(param.maximum_iteration);
+        }
+
+        /**
+         * @brief Convert the algorithm of the NLopt backend to the NLopt one
+         *
+         * @param algorithm algorithm of the NLopt backend
+         * @return nlopt::algorithm NLopt algorithm
+         */
+        static nlopt::algorithm toNloptAlgorithm(NLAlgorithm algorithm)
+        {
+            switch (algorithm)
+            {
+            case NLAlgorithm::MMA:
+                return nlopt::LD_MMA;
+            case NLAlgorithm::CCSAQ:
+                return nlopt::LD_CCSAQ;
+            case NLAlgorithm::AUGLAG:
+                return nlopt::AUGLAG;
+            case NLAlgorithm::LBFGS:
+                return nlopt::LD_LBFGS;
+            default:
+                return nlopt::LD_SLSQP;
+            }
+        }
+
+        /**
+         * @brief Select the algorithm of an NLopt instance, the algorithms which do not
+         * support the constraints of the problem are wrapped by the augmented lagrangian
+         *
+         * @param equality true if the problem has equality constraints
+         * @return nlopt::algorithm NLopt algorithm
+         */
+        nlopt::algorithm selectAlgorithm(bool equality) const
+        {
+            switch (algorithm)
+            {
+            case NLAlgorithm::MMA:
+            case NLAlgorithm::CCSAQ:
+                // only the equality constraints are penalized, the inequality
+                // constraints are handled by the local algorithm
+                return equality ? nlopt::AUGLAG_EQ : toNloptAlgorithm(algorithm);
+            case NLAlgorithm::AUGLAG:
+            case NLAlgorithm::LBFGS:
+                return nlopt::AUGLAG;
+            default:
+                return nlopt::LD_SLSQP;
+            }
+        }
+
+        /**
+         * @brief Set the stopping criterias of an NLopt instance and, for the augmented
+         * lagrangian, create its local solver with the same stopping criterias
+         *
+         * @param opt NLopt instance
+         * @param param optimizer parameters
+         */
+        void setSolverParameters(nlopt::opt &opt, const NLParameters &param) const
+        {
+            setStoppingCriteria(opt, param);
+
+            if (opt.get_algorithm() != nlopt::AUGLAG && opt.get_algorithm() != nlopt::AUGLAG_EQ)
+            {
+                return;
+            }
+
+            // the wrapped algorithm is the local one, the augmented lagrangian
+            // cannot be used to solve its own sub-problems
+            NLAlgorithm local = auglag_local_algorithm;
+            if (algorithm == NLAlgorithm::MMA || algorithm == NLAlgorithm::CCSAQ || algorithm == NLAlgorithm::LBFGS)
+            {
+                local = algorithm;
+            }
+            else if (local == NLAlgorithm::AUGLAG)
+            {
+                local = NLAlgorithm::LBFGS;
+            }
+
+            nlopt::opt localOpt(toNloptAlgorithm(local), opt.get_dimension());
+            setStoppingCriteria(localOpt, param);
+            opt.set_local_optimizer(localOpt);
+        }
+
+        /**
+         * @brief Create the NLopt instances of both the formulations with the selected
+         * algorithm and bind the objective function and the constraints already bound
+         * to the previous instances
+         */
+        void buildSolvers()
+        {
+            delete innerOpt;
+            delete shootingOpt;
+            delete collocationOpt;
+
+            // the multiple shooting formulation always has the system's dynamics equality constraints
+            innerOpt = new nlopt::opt(selectAlgorithm(true), ((ph() * nx()) + (nu() * ch()) + slackSize()));
+            shootingOpt = new nlopt::opt(selectAlgorithm(eq() > 0), ((nu() * ch()) + slackSize()));
+
+            // the collocation states are appended to the optimization vector
+            collocationOpt = new nlopt::opt(selectAlgorithm(true), ((ph() * nx()) + (nu() * ch()) + slackSize() + collocation->size()));
+
+            if (objFunc)
+            {
+                bindObjective();
+            }
+
+            bindConstraints();
+        }
+
+        /**
+         * @brief Register the constraints bound so far to the NLopt instances, the
+         * previous registrations are removed so that binding the same constraints
+         * again (e.g. when a user function is replaced) does not duplicate them
+         */
+        void bindConstraints()
+        {
+            innerOpt->remove_equality_constraints();
+            innerOpt->remove_inequality_constraints();
+            shootingOpt->remove_equality_constraints();
+            collocationOpt->remove_equality_constraints();
+            collocationOpt->remove_inequality_constraints();
+
+            if (!state_eq_tol.empty())
+            {
+                innerOpt->add_equality_mconstraint(
+                    NLOptimizer::trackedConFunWrapper<NLOptimizer::nloptEqConFunWrapper, &NLOptimizer::state_eq_tol, true, STATE_EQ>,
+                    this,
+                    state_eq_tol);
+
+                // each defect takes the tolerance of the state at the end of its interval
+                size_t s = collocation->points();
+                collocation_tol.resize(collocation->defects());
+                for (size_t k = 0; k < ph(); k++)
+                {
+                    for (size_t j = 0; j < s; j++)
+                    {
+                        std::copy_n(state_eq_tol.begin() + (k * nx()), nx(), collocation_tol.begin() + (((k * s) + j) * nx()));
+                    }
+                }
+
+                collocationOpt->add_equality_mconstraint(
+                    NLOptimizer::collocationDefectsConFunWrapper,
+                    this,
+                    collocation_tol);
+            }
+
+            if constexpr (sizer.ineq.value != 0)
+            {
+                if (!shooting_ineq_tol.empty())
+                {
+                    innerOpt->add_inequality_mconstraint(
+                        NLOptimizer::trackedConFunWrapper<NLOptimizer::nloptUserIneqConFunWrapper, &NLOptimizer::shooting_ineq_tol, false, USER_INEQ>,
+                        this,
+                        shooting_ineq_tol);
+                    collocationOpt->add_inequality_mconstraint(
+                        NLOptimizer::collocationConFunWrapper<NLOptimizer::nloptUserIneqConFunWrapper, &NLOptimizer::shooting_ineq_tol, false>,
+                        this,
+                        shooting_ineq_tol);
+                }
+            }
+
+            if constexpr (sizer.eq.value != 0)
+            {
+                if (!user_eq_tol.empty())
+                {
+                    innerOpt->add_equality_mconstraint(
+                        NLOptimizer::trackedConFunWrapper<NLOptimizer::nloptUserEqConFunWrapper, &NLOptimizer::user_eq_tol, true, USER_EQ>,
+                        this,
+                        user_eq_tol);
+                    shootingOpt->add_equality_mconstraint(
+                        NLOptimizer::shootingUserEqConFunWrapper,
+                        this,
+                        user_eq_tol);
+                    collocationOpt->add_equality_mconstraint(
+                        NLOptimizer::collocationConFunWrapper<NLOptimizer::nloptUserEqConFunWrapper, &NLOptimizer::user_eq_tol, true>,
+                        this,
+                        user_eq_tol);
+                }
+            }
+
+            // the single shooting inequality constraints are rebuilt before the optimization
+            shooting_constraints_changed = true;
+            starts_changed = team_changed = true;
+        }
+
+        /**
+         * @brief Create the NLopt instances of the multi-start. Each start owns a copy
+         * of the objective function and of the constraints classes (the model and the
+         * mapping are shared and only read), so that the starts can run in parallel.
+         * The threads running the starts are created once with the instances
+         */
+        void buildStarts()
+        {
+            if (!multistart_team)
+            {
+                multistart_team = std::make_shared<EvaluationTeam>();
+            }
+            multistart_team->stop();
+
+            starts.clear();
+            starts.resize(multistart);
+
+            std::vector<double> lb_vec(zlb.data(), zlb.data() + zlb.rows() * zlb.cols() - (fixed_slack ? 1 : 0));
+            std::vector<double> ub_vec(zub.data(), zub.data() + zub.rows() * zub.cols() - (fixed_slack ? 1 : 0));
+
+            for (auto &start : starts)
+            {
+                start.objFunc = std::make_shared<Objective<sizer>>(*objFunc);
+                start.conFunc = std::make_shared<Constraints<sizer>>(*conFunc);
+                start.opt = std::make_shared<nlopt::opt>(selectAlgorithm(true), ((ph() * nx()) + (nu() * ch()) + slackSize()));
+                start.stop = &multistart_stop;
+
+                setSolverParameters(*start.opt, parameters);
+                start.opt->set_lower_bounds(lb_vec);
+                start.opt->set_upper_bounds(ub_vec);
+                start.opt->set_min_objective(NLOptimizer::multiStartObjFunWrapper, &start);
+
+                if (!state_eq_tol.empty())
+                {
+                    start.opt->add_equality_mconstraint(
+                        NLOptimizer::nloptEqConFunWrapper, start.conFunc.get(), state_eq_tol);
+                }
+
+                if constexpr (sizer.ineq.value != 0)
+                {
+                    if (!shooting_ineq_tol.empty())
+                    {
+                        start.opt->add_inequality_mconstraint(
+                            NLOptimizer::nloptUserIneqConFunWrapper, start.conFunc.get(), shooting_ineq_tol);
+                    }
+                }
+
+                if constexpr (sizer.eq.value != 0)
+                {
+                    if (!user_eq_tol.empty())
+                    {
+                        start.opt->add_equality_mconstraint(
+                            NLOptimizer::nloptUserEqConFunWrapper, start.conFunc.get(), user_eq_tol);
+                    }
+                }
+            }
+
+            std::vector<std::function<void()>> tasks;
+            for (int k = 0; k < multistart; k++)
+            {
+                tasks.push_back([this, k]()
+                                { optimizeStart(k); });
+            }
+            multistart_team->start(tasks);
+
+            starts_changed = false;
+
+            Logger::instance().log(Logger::log_type::DETAIL)
+                << "Setting multi-start instances: "
+                << multistart
+                << std::endl;
+        }
+
+        /**
+         * @brief Prepare the concurrent evaluation of the constraints for a new control
+         * step. The team evaluates the system's dynamics on a copy of the constraints
+         * class and the user constraints on another copy (the model and the mapping are
+         * shared), the copies are created again when the problem changes
+         *
+         * @param x0 system's variables initial condition
+         */
+        void prepareTeam(const cvec<sizer.nx> &x0)
+        {
+            if (!team)
+            {
+                team = std::make_shared<EvaluationTeam>();
+            }
+
+            if (team_changed || team->size() == 0)
+            {
+                stateConFunc = std::make_shared<Constraints<sizer>>(*conFunc);
+                userConFunc = std::make_shared<Constraints<sizer>>(*conFunc);
+
+                const size_t n = (ph() * nx()) + (nu() * ch()) + 1;
+                const size_t m[] = {state_eq_tol.size(), shooting_ineq_tol.size(), user_eq_tol.size()};
+                for (int k = 0; k < 3; k++)
+                {
+                    cache.groups[k].value.assign(m[k], 0);
+                    cache.groups[k].jacobian.assign(m[k] * n, 0);
+                }
+                cache.x.reserve(n);
+
+                team->start({[this]()
+                             { evaluateGroup(nloptEqConFunWrapper, STATE_EQ, stateConFunc.get()); },
+                             [this]()
+                             {
+                                 evaluateGroup(nloptUserIneqConFunWrapper, USER_INEQ, userConFunc.get());
+                                 evaluateGroup(nloptUserEqConFunWrapper, USER_EQ, userConFunc.get());
+                             }});
+
+                team_changed = false;
+
+                Logger::instance().log(Logger::log_type::DETAIL)
+                    << "Setting concurrent evaluation team: "
+                    << team->size()
+                    << std::endl;
+            }
+
+            stateConFunc->setCurrentState(x0);
+            userConFunc->setCurrentState(x0);
+            cache.valid = false;
+        }
+
+        /**
+         * @brief Launch the evaluation of the constraints at the iterate of the
+         * objective function, the previous evaluation is completed first since the
+         * team reads the iterate from the cache (its errors are rethrown)
+         *
+         * @param x current optimization vector
+         * @param n dimension of the optimization vector
+         * @param hasGradient request the computation of the Jacobian matrices
+         */
+        void launchTeam(const double *x, unsigned int n, bool hasGradient)
+        {
+            team->wait();
+
+            cache.x.assign(x, x + n);
+            cache.gradient = hasGradient;
+            cache.valid = true;
+
+            team->launch();
+        }
+
+        /**
+         * @brief Evaluate a constraints group at the iterate of the cache, executed
+         * by a thread of the team
+         *
+         * @param conFun constraints function wrapper
+         * @param group constraints group in the evaluation cache
+         * @param con constraints class owned by the thread
+         */
+        void evaluateGroup(nlopt::mfunc conFun, int group, Constraints<sizer> *con)
+        {
+            auto &g = cache.groups[group];
+            if (g.value.empty())
+            {
+                return;
+            }
+
+            conFun(
+                g.value.size(),
+                g.value.data(),
+                cache.x.size(),
+                cache.x.data(),
+                cache.gradient ? g.jacobian.data() : nullptr,
+                con);
+        }
+
+        /**
+         * @brief Return the constraints evaluated by the team when the solver requests
+         * them at the iterate of the objective function, at a different iterate (or when
+         * the Jacobian matrix has not been computed) the constraints are evaluated here
+         * on the copy of the constraints class owned by the team
+         *
+         * @param conFun constraints function wrapper
+         * @param group constraints group in the evaluation cache
+         * @param m number of constraints
+         * @param result constraints value
+         * @param n dimension of the optimization vector
+         * @param x current optimization vector
+         * @param grad constraints gradient w.r.t. the current optimization vector
+         */
+        void cachedConstraints(
+            nlopt::mfunc conFun,
+            int group,
+            unsigned int m,
+            double *result,
+            unsigned int n,
+            const double *x,
+            double *grad)
+        {
+            team->wait(group == STATE_EQ ? 0 : 1);
+
+            auto &g = cache.groups[group];
+            if (cache.valid &&
+                (!grad || cache.gradient) &&
+                g.value.size() == m &&
+                cache.x.size() == n &&
+                std::equal(x, x + n, cache.x.begin()))
+            {
+                std::copy_n(g.value.data(), m, result);
+                if (grad)
+                {
+                    std::copy_n(g.jacobian.data(), m * n, grad);
+                }
+                return;
+            }
+
+            conFun(m, result, n, x, grad, group == STATE_EQ ? stateConFunc.get() : userConFunc.get());
+        }
+
+        /**
+         * @brief Compute the starting points of the multi-start: the usual initial guess,
+         * the solution of the problem linearized around it and the rollouts of constant
+         * inputs spread over the input bounds
+         *
+         * @param x0 system's variables initial condition
+         * @param guess usual initial guess of the optimization vector
+         * @return std::vector<cvec<...>> starting points
+         */
+        std::vector<cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)>> multiStartGuesses(
+            const cvec<sizer.nx> &x0,
+            const cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> &guess)
+        {
+            std::vector<cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)>> guesses(multistart, guess);
+
+            // the linearized problem is solved once before launching the starts
+            // since the quadratic sub-problem solver is not shared
+            if (multistart > 1)
+            {
+                if (!(sqpSolver->prepare(guess, x0, zlb, zub) && sqpSolver->feedback(x0, zlb, zub, guesses[1])))
+                {
+                    guesses[1] = guess;
+                }
+            }
+
+            shooting->setCurrentState(x0);
+
+            int variants = multistart - 2;
+            for (int k = 0; k < variants; k++)
+            {
+                double alpha = (k + 1.0) / (variants + 1.0);
+
+                cvec<sizer.nu> v;
+                COND_RESIZE_CVEC(sizer, v, nu());
+
+                for (size_t i = 0; i < nu(); i++)
+                {
+                    int j = (ph() * nx()) + i;
+                    if (std::isfinite(zlb[j]) && std::isfinite(zub[j]))
+                    {
+                        v[i] = zlb[j] + (alpha * (zub[j] - zlb[j]));
+                    }
+                    else
+                    {
+                        // without bounds the inputs are spread around the first guessed input
+                        double u = guess[j];
+                        v[i] = u + ((2.0 * alpha - 1.0) * std::max(1.0, std::fabs(u)));
+                    }
+                }
+
+                // the constant input sequence is projected on the input parameterization
+                mat<(sizer.ph + 1), sizer.nu> U;
+                COND_RESIZE_MAT(sizer, U, (ph() + 1), nu());
+                U = v.cwiseProduct(mapping->InputScaling()).transpose().replicate(ph() + 1, 1);
+
+                cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> start = guess;
+                mapping->wrapInputs(U, start);
+
+                cvec<((sizer.nu * sizer.ch) + 1)> z;
+                z = shooting->reduce(start);
+                shooting->expand(z, false);
+                guesses[k + 2] = shooting->fullVector();
+            }
+
+            return guesses;
+        }
+
+        /**
+         * @brief Optimize the problem from multiple starting points in parallel. When
+         * the usual initial guess (the previous solution shifted forward with the warm
+         * start) is feasible, the first converged and feasible solution with a cost not
+         * larger than its cost (relaxed by the multi-start cost tolerance) stops the other
+         * starts, so that a start stops the others only if it improves the solution
+         * already available. Otherwise all the starts are completed and the feasible
+         * solution with the lowest cost is selected
+         *
+         * @param x0 system's variables initial condition
+         * @param guess usual initial guess of the optimization vector
+         * @param cost optimal cost
+         * @param status NLopt result code
+         * @return std::vector<double> optimal vector
+         */
+        std::vector<double> optimizeMultiStart(
+            const cvec<sizer.nx> &x0,
+            const cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> &guess,
+            double &cost,
+            int &status)
+        {
+            if (starts_changed || starts.size() != (size_t)multistart)
+            {
+                buildStarts();
+            }
+
+            auto guesses = multiStartGuesses(x0, guess);
+
+            multistart_threshold = -mpc::inf;
+            if (multistart_cost_tolerance >= 0 && conFunc->isFeasible(guess))
+            {
+                double reference = objFunc->evaluate(guess, false).value;
+                multistart_threshold = reference + (multistart_cost_tolerance * std::max(1.0, std::fabs(reference)));
+            }
+
+            multistart_stop = false;
+            multistart_winner = -1;
+
+            for (int k = 0; k < multistart; k++)
+            {
+                auto &start = starts[k];
+                start.objFunc->setCurrentState(x0);
+                start.conFunc->setCurrentState(x0);
+                start.opt->set_force_stop(0);
+                start.x.assign(guesses[k].data(), guesses[k].data() + guesses[k].size() - (fixed_slack ? 1 : 0));
+            }
+
+            multistart_team->launch();
+            multistart_team->wait();
+
+            int winner = multistart_winner;
+
+            // without an early winner the best solution is selected, feasible ones first
+            if (winner < 0)
+            {
+                for (int k = 0; k < multistart; k++)
+                {
+                    if (!starts[k].success)
+                    {
+                        continue;
+                    }
+
+                    if (winner < 0 ||
+                        (starts[k].feasible && !starts[winner].feasible) ||
+                        (starts[k].feasible == starts[winner].feasible && starts[k].cost < starts[winner].cost))
+                    {
+                        winner = k;
+                    }
+                }
+            }
+
+            if (winner < 0)
+            {
+                throw std::runtime_error("no starting point reached a solution");
+            }
+
+            Logger::instance().log(Logger::log_type::DETAIL)
+                << "Multi-start solution selected from start: "
+                << winner
+                << " with cost: "
+                << starts[winner].cost
+                << std::endl;
+
+            cost = starts[winner].cost;
+            status = starts[winner].status;
+            return starts[winner].x;
+        }
+
+        /**
+         * @brief Optimize the problem from a starting point of the multi-start, executed
+         * by a thread of the multi-start team
+         *
+         * @param k index of the start
+         */
+        void optimizeStart(int k)
+        {
+            auto &start = starts[k];
+            start.success = false;
+            start.feasible = false;
+            start.cost = mpc::inf;
+
+            try
+            {
+                start.status = start.opt->optimize(start.x, start.cost);
+            }
+            catch (const std::exception &)
+            {
+                // stopped by another start or failed
+                start.status = nlopt::FAILURE;
+                return;
+            }
+
+            auto res = convertToResultStatus(start.status);
+            start.success = res == ResultStatus::SUCCESS || res == ResultStatus::MAX_ITERATION;
+            start.feasible = start.success && start.conFunc->isFeasible(
+                restoreSlack<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)>(start.x.data(), start.x.size(), fixed_slack));
+
+            std::lock_guard<std::mutex> lock(multistart_mutex);
+            if (multistart_winner < 0 && start.feasible && res == ResultStatus::SUCCESS && start.cost <= multistart_threshold)
+            {
+                multistart_winner = k;
+                multistart_stop = true;
+            }
+        }
+
+        /**
+         * @brief Reset the best feasible iterate and start the deadline of the
+         * current optimization (time limit only)
+         *
+         * @param opt internal solver stopped at the deadline
+         * @param enabled true if the iterates are tracked by the callbacks
+         */
+        void startTracking(nlopt::opt *opt, bool enabled)
+        {
+            anytime.enabled = enabled && parameters.time_limit > 0;
+            anytime.expired = false;
+            anytime.deadline = std::chrono::steady_clock::now() +
+                               std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                   std::chrono::duration<double>(parameters.time_limit));
+            anytime.opt = opt;
+            anytime.evaluated = -1;
+            anytime.best.clear();
+            anytime.best_cost = mpc::inf;
+        }
+
+        /**
+         * @brief Record the objective function value of a new iterate and stop the
+         * internal solver once the deadline is reached
+         *
+         * @param x current optimization vector
+         * @param n dimension of the optimization vector
+         * @param value objective function value
+         */
+        void trackObjective(const double *x, unsigned int n, double value)
+        {
+            if (!anytime.enabled)
+            {
+                return;
+            }
+
+            commitIterate();
+
+            anytime.x.assign(x, x + n);
+            anytime.cost = value;
+            anytime.violation = 0;
+            anytime.evaluated = 0;
+
+            if (std::chrono::steady_clock::now() >= anytime.deadline)
+            {
+                anytime.expired = true;
+                anytime.opt->force_stop();
+            }
+        }
+
+        /**
+         * @brief Record the constraints violation of the current iterate
+         *
+         * @param x optimization vector at which the constraints are evaluated
+         * @param n dimension of the optimization vector
+         * @param result constraints value
+         * @param m number of constraints
+         * @param tol constraints tolerances (zero when empty)
+         * @param equality true for equality constraints
+         */
+        void trackConstraints(
+            const double *x,
+            unsigned int n,
+            const double *result,
+            unsigned int m,
+            const std::vector<double> &tol,
+            bool equality)
+        {
+            // the constraints must be evaluated at the point of the last objective evaluation
+            if (!anytime.enabled || anytime.evaluated < 0 ||
+                anytime.x.size() != n || !std::equal(x, x + n, anytime.x.begin()))
+            {
+                return;
+            }
+
+            for (size_t i = 0; i < m; i++)
+            {
+                double value = equality ? std::fabs(result[i]) : result[i];
+                anytime.violation = std::max(anytime.violation, value - (i < tol.size() ? tol[i] : 0.0));
+            }
+            anytime.evaluated++;
+        }
+
+        /**
+         * @brief Prevent the current iterate from being kept as the best feasible one
+         */
+        void rejectIterate()
+        {
+            anytime.violation = mpc::inf;
+        }
+
+        /**
+         * @brief Keep the current iterate if all the constraints have been evaluated,
+         * it is feasible and its cost is lower than the best one
+         */
+        void commitIterate()
+        {
+            if (anytime.evaluated >= anytime.groups &&
+                anytime.violation <= 0 &&
+                anytime.cost < anytime.best_cost)
+            {
+                anytime.best = anytime.x;
+                anytime.best_cost = anytime.cost;
+            }
+            anytime.evaluated = -1;
+        }
+
+        /**
+         * @brief Compute the starting point of the optimization. Without a previous
+         * solution and with the linearized initialization, the guess is replaced by
+         * the solution of the quadratic problem linearized around the initial condition
+         *
+         * @param x0 system's variables initial condition
+         * @param u0 control action initial condition for warm start
+         * @return cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> starting point
+         */
+        cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> initialPoint(
+            const cvec<sizer.nx> &x0,
+            const cvec<sizer.nu> &u0)
+        {
+            bool coldStart = is_first_iteration || !enable_warm_start;
+
+            cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> guess = initialGuess(x0, u0);
+            if (!coldStart || initialization != NLInitialization::LINEARIZED)
+            {
+                return guess;
+            }
+
+            cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> linearized;
+            COND_RESIZE_CVEC(sizer, linearized, ((ph() * nx()) + (nu() * ch()) + 1));
+
+            // the constant guess is the linearization point, so the system's dynamics
+            // is linearized around the initial condition at each stage
+            if (sqpSolver->prepare(guess, x0, zlb, zub) && sqpSolver->feedback(x0, zlb, zub, linearized))
+            {
+                Logger::instance().log(Logger::log_type::DETAIL)
+                    << "Initial guess computed on the linearized problem"
+                    << std::endl;
+
+                return linearized;
+            }
+
+            Logger::instance().log(Logger::log_type::DETAIL)
+                << "Unable to solve the linearized problem, using the constant initial guess"
+                << std::endl;
+
+            return guess;
+        }
+
+        /**
+         * @brief Compute the initial guess of the optimization vector by shifting
+         * the last optimal vector by one step
+         *
+         * @param x0 system's variables initial condition
+         * @param u0 control action initial condition for warm start
+         * @return cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> initial guess
+         */
+        cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> initialGuess(
+            const cvec<sizer.nx> &x0,
+            const cvec<sizer.nu> &u0)
+        {
+            cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> optX0;
+            COND_RESIZE_CVEC(sizer, optX0, ((ph() * nx()) + (nu() * ch()) + 1));
+            optX0.setZero();
+
+            if(is_first_iteration || !enable_warm_start)
+            {
+                // the whole optimization vector is initialized with the initial state x0
+                // and the initial control action u0 for the full prediction horizon
+                // this has to be done only for the first iteration or if the warm start is disabled
+                for (size_t i = 0; i < ph(); i++)
+                {
+                    for (size_t j = 0; j < nx(); j++)
+                    {
+                        opt_vector[(i * nx()) + j] = x0(j) / scaling[(i * nx()) + j];
+                    }
+                }
+
+                // the constant input sequence is projected on the input parameterization
+                mat<(sizer.ph + 1), sizer.nu> U0;
+                COND_RESIZE_MAT(sizer, U0, (ph() + 1), nu());
+                U0 = u0.transpose().replicate(ph() + 1, 1);
+                mapping->wrapInputs(U0, opt_vector);
+            }
+            
+            // fill the remaining elements with the previous state starting from
+            // the third element of the prediction horizon 
+            // (we shift the sequence to the left by one step)
+            for (size_t i = 0; i < ph(); i++)
+            {
+                for (size_t j = 0; j < nx(); j++)
+                {
+                    if(i == ph() - 1)
+                    {
+                        optX0[(i * nx()) + j] = opt_vector[(i * nx()) + j];
+                    }
+                    else{
+                        optX0[(i * nx()) + j] = opt_vector[((i+1) * nx()) + j];
+                    }
+                }
+            }
+
+            mat<(sizer.ph + 1), sizer.nu> Umv;
+            COND_RESIZE_MAT(sizer, Umv, (ph() + 1), nu());
+
+            // convert from the optimized vector to the manipulated variable sequence
+            mapping->unwrapInputs(opt_vector, Umv);
+
+            // fill the remaining elements with the previous control action starting from
+            // the third element of the control horizon
+            // (we shift the sequence to the left by one step)
+            for (size_t i = 0; i + 1 < ph(); i++)
+            {
+                Umv.row(i) = Umv.row(i + 1);
+            }
+
+            // put the control action back in the optimization vector
+            mapping->wrapInputs(Umv, optX0);
+
+            // put the slack variable in the optimization vector
+            optX0[((ph() * nx()) + (nu() * ch()) + 1) - 1] = currentSlack;
+
+            return optX0;
+        }
+
+        /**
+         * @brief Update the optimal sequence and the optimal command from the
+         * current optimization vector
+         *
+         * @param x0 system's variables initial condition
+         * @param r optimization result to update
+         */
+        void updateSequence(const cvec<sizer.nx> &x0, Result<sizer.nu> &r)
+        {
+            mat<(sizer.ph + 1), sizer.nx> Xmat;
+            COND_RESIZE_MAT(sizer,Xmat,(ph() + 1), nx());
+
+            mat<(sizer.ph + 1), sizer.nu> Umat;
+            COND_RESIZE_MAT(sizer,Umat,(ph() + 1), nu());
+
+            mapping->unwrapVector(opt_vector, x0, Xmat, Umat, currentSlack);
+
+            Logger::instance().log(Logger::log_type::DETAIL)
+                << "Optimal predicted state vector\n"
+                << Xmat
+                << std::endl;
+            Logger::instance().log(Logger::log_type::DETAIL)
+                << "Optimal predicted control input vector\n"
+                << Umat
+                << std::endl;
+
+            r.cmd = Umat.row(0);
+
+            sequence.state = Xmat.block(0, 0, ph()+1, nx());
+            sequence.input = Umat.block(0, 0, ph()+1, nu());
+            sequence.output = model->getOutput(Xmat, Umat).block(0, 0, ph()+1, ny());
+
+            // running magnitude of the variables along the optimal sequences
+            cvec<sizer.nx> xm = sequence.state.cwiseAbs().colwise().maxCoeff().transpose();
+            cvec<sizer.nu> um = sequence.input.cwiseAbs().colwise().maxCoeff().transpose();
+
+            state_magnitude = has_magnitude ? ((scaling_smoothing * state_magnitude) + ((1.0 - scaling_smoothing) * xm)).eval() : xm;
+            input_magnitude = has_magnitude ? ((scaling_smoothing * input_magnitude) + ((1.0 - scaling_smoothing) * um)).eval() : um;
+            has_magnitude = true;
+        }
+
+        /**
+         * @brief Update the scaling of the optimization vector. With the automatic scaling
+         * the state and input scalings of the mapping are derived from the bounds or from
+         * the running magnitude of the optimal sequences. When the scaling changes the last
+         * optimal vector (the warm start) and the bounds are converted to the new scaling,
+         * the rest of the state carried over between the solves is discarded
+         */
+        void applyScaling()
+        {
+            if (scaling_mode != NLScaling::MANUAL)
+            {
+                cvec<sizer.nx> sx;
+                COND_RESIZE_CVEC(sizer, sx, nx());
+
+                cvec<sizer.nu> su;
+                COND_RESIZE_CVEC(sizer, su, nu());
+
+                for (size_t j = 0; j < nx(); j++)
+                {
+                    double m = 0;
+                    for (size_t i = 0; i < ph(); i++)
+                    {
+                        m = std::max(m, boundMagnitude((i * nx()) + j));
+                    }
+
+                    if (scaling_mode == NLScaling::TRAJECTORY && has_magnitude && state_magnitude(j) > 0)
+                    {
+                        m = state_magnitude(j);
+                    }
+
+                    sx(j) = powerOfTwo(m);
+                }
+
+                for (size_t j = 0; j < nu(); j++)
+                {
+                    double m = 0;
+                    for (size_t i = 0; i < ch(); i++)
+                    {
+                        m = std::max(m, boundMagnitude((ph() * nx()) + (i * nu()) + j));
+                    }
+
+                    if (scaling_mode == NLScaling::TRAJECTORY && has_magnitude && input_magnitude(j) > 0)
+                    {
+                        m = input_magnitude(j);
+                    }
+
+                    su(j) = powerOfTwo(m);
+                }
+
+                if (sx != mapping->StateScaling())
+                {
+                    mapping->setStateScaling(sx);
+                }
+
+                if (su != mapping->InputScaling())
+                {
+                    mapping->setInputScaling(su);
+                }
+            }
+
+            cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> s;
+            COND_RESIZE_CVEC(sizer, s, ((ph() * nx()) + (nu() * ch()) + 1));
+            s.setOnes();
+            for (size_t i = 0; i < ph(); i++)
+            {
+                s.middleRows(i * nx(), nx()) = mapping->StateScaling();
+            }
+            for (size_t i = 0; i < ch(); i++)
+            {
+                s.middleRows((ph() * nx()) + (i * nu()), nu()) = mapping->InputScaling();
+            }
+
+            if (s == scaling)
+            {
+                return;
+            }
+
+            Logger::instance().log(Logger::log_type::DETAIL)
+                << "Setting optimization vector scaling: "
+                << s.transpose()
+                << std::endl;
+
+            opt_vector = opt_vector.cwiseProduct(scaling).cwiseQuotient(s);
+            scaling = s;
+
+            // the quasi-Newton blocks, the multipliers and the Broyden Jacobian matrices
+            // carried over between the solves are expressed in the old units
+            sqpSolver->resetWarmStart();
+            ipmSolver->resetWarmStart();
+            conFunc->resetJacobianUpdate();
+
+            updateBounds();
+        }
+
+        /**
+         * @brief Largest finite magnitude of the bounds of an element of the optimization vector
+         */
+        double boundMagnitude(size_t i) const
+        {
+            double m = 0;
+            if (std::isfinite(lb[i]))
+            {
+                m = std::max(m, std::fabs(lb[i]));
+            }
+            if (std::isfinite(ub[i]))
+            {
+                m = std::max(m, std::fabs(ub[i]));
+            }
+            return m;
+        }
+
+        /**
+         * @brief Round a magnitude to the nearest power of two (the scaling is exact in
+         * floating point), a null magnitude is not scaled
+         */
+        static double powerOfTwo(double m)
+        {
+            return m > 0 ? std::exp2(std::round(std::log2(m))) : 1.0;
+        }
+
+        /**
+         * @brief Check if the bounds of the coefficients of an input basis do not bound
+         * the input sequence (the basis functions are not a partition of unity)
+         */
+        static bool hasUnboundedBasis(NLInputBasis basis)
+        {
+            return basis == NLInputBasis::LAGUERRE || basis == NLInputBasis::CHEBYSHEV;
+        }
+
+        /**
+         * @brief Update the bounds for the internal solver
+         */
+        void updateBounds()
+        {
+            // the bounds are expressed in the system's units, the internal
+            // solvers work on the scaled optimization vector
+            zlb = lb.cwiseQuotient(scaling);
+            zub = ub.cwiseQuotient(scaling);
+
+            // convert from eigen vector to std vector reusing the buffers, the fixed
+            // slack variable is not part of the problem seen by the NLopt instances
+            lb_vec.assign(zlb.data(), zlb.data() + zlb.size() - (fixed_slack ? 1 : 0));
+            ub_vec.assign(zub.data(), zub.data() + zub.size() - (fixed_slack ? 1 : 0));
+
+            innerOpt->set_lower_bounds(lb_vec);
+            innerOpt->set_upper_bounds(ub_vec);
+
+            // the collocation states are not bounded
+            collocation_lb.assign(lb_vec.begin(), lb_vec.end());
+            collocation_ub.assign(ub_vec.begin(), ub_vec.end());
+            collocation_lb.resize(lb_vec.size() + collocation->size(), -std::numeric_limits<double>::infinity());
+            collocation_ub.resize(ub_vec.size() + collocation->size(), std::numeric_limits<double>::infinity());
+
+            collocationOpt->set_lower_bounds(collocation_lb);
+            collocationOpt->set_upper_bounds(collocation_ub);
+
+            // the single shooting formulation keeps the bounds of the control inputs and
+            // of the slack variable, the state bounds become inequality constraints
+            lb_vec.erase(lb_vec.begin(), lb_vec.begin() + (ph() * nx()));
+            ub_vec.erase(ub_vec.begin(), ub_vec.begin() + (ph() * nx()));
+
+            shootingOpt->set_lower_bounds(lb_vec);
+            shootingOpt->set_upper_bounds(ub_vec);
+            shooting_constraints_changed = true;
+            starts_changed = team_changed = true;
+
+            // print the bounds
+            Logger::instance().log(Logger::log_type::DETAIL)
+                << "Setting lower bounds: \n"
+                << zlb.head(zlb.size() - (fixed_slack ? 1 : 0))
+                << std::endl;
+
+            Logger::instance().log(Logger::log_type::DETAIL)
+                << "Setting upper bounds: \n"
+                << zub.head(zub.size() - (fixed_slack ? 1 : 0))
+                << std::endl;
+        }
+
+        /**
+         * @brief Rebuild the inequality constraints of the single shooting formulation,
+         * the finite state bounds are added to the user inequality constraints since
+         * the states are not optimization variables
+         */
+        void updateShootingConstraints()
+        {
+            if (!shooting_constraints_changed)
+            {
+                return;
+            }
+
+            shootingOpt->remove_inequality_constraints();
+
+            if constexpr (sizer.ineq.value != 0)
+            {
+                if (!shooting_ineq_tol.empty())
+                {
+                    shootingOpt->add_inequality_mconstraint(
+                        NLOptimizer::shootingUserIneqConFunWrapper,
+                        this,
+                        shooting_ineq_tol);
+                }
+            }
+
+            shooting_lower_bounds.clear();
+            shooting_upper_bounds.clear();
+            for (size_t i = 0; i < (ph() * nx()); i++)
+            {
+                if (std::isfinite(zlb[i]))
+                {
+                    shooting_lower_bounds.push_back(i);
+                }
+
+                if (std::isfinite(zub[i]))
+                {
+                    shooting_upper_bounds.push_back(i);
+                }
+            }
+
+            size_t nbounds = shooting_lower_bounds.size() + shooting_upper_bounds.size();
+            if (nbounds > 0)
+            {
+                shootingOpt->add_inequality_mconstraint(
+                    NLOptimizer::shootingStateBoundsConFunWrapper,
+                    this,
+                    std::vector<double>(nbounds, 0.0));
+            }
+
+            Logger::instance().log(Logger::log_type::DETAIL)
+                << "Setting single shooting state bounds constraints: "
+                << nbounds
+                << std::endl;
+
+            shooting_constraints_changed = false;
+        }
+
+        /**
+         * @brief Converts an integer value to the corresponding ResultStatus enum value.
+         *
+         * This function maps the given integer value to the corresponding ResultStatus enum value.
+         * If the integer value does not match any known result, the function returns ResultStatus::UNKNOWN.
+         *
+         * @param status The integer value to convert.
+         * @return The corresponding ResultStatus enum value.
+         *
+         * @see ResultStatus
+         */
+        ResultStatus convertToResultStatus(int status)
+        {
+            switch (status)
+            {
+            case nlopt::FAILURE:
+            case nlopt::INVALID_ARGS:
+            case nlopt::OUT_OF_MEMORY:
+            case nlopt::ROUNDOFF_LIMITED:
+            case nlopt::FORCED_STOP:
+                return ResultStatus::ERROR;
+            case nlopt::SUCCESS:
+            case nlopt::STOPVAL_REACHED:
+            case nlopt::FTOL_REACHED:
+            case nlopt::XTOL_REACHED:
+                return ResultStatus::SUCCESS;
+            case nlopt::MAXEVAL_REACHED:
+            case nlopt::MAXTIME_REACHED:
+                return ResultStatus::MAX_ITERATION;
+            default:
+                return ResultStatus::UNKNOWN;
+            }
+        }
+
+        /**
+         * @brief Forward the objective function evaluation to the internal solver
+         *
+         * @param x current optimization vector
+         * @param grad objective gradient w.r.t. the current optimization vector
+         * @param objFunc reference to the objective class
+         * @return double objective function value
+         */
+        static double nloptObjFunWrapper(
+            const std::vector<double> &x,
+            std::vector<double> &grad,
+            void *objFunc)
+        {
+            auto obj = static_cast<Objective<sizer> *>(objFunc);
+
+            // the iterate and the gradient are the buffers of the internal solver
+            return obj->evaluate(
+                obj->restoreSlack(x.data(), x.size()),
+                Eigen::Map<cvec<>>(grad.data(), grad.size()));
+        }
+
+        /**
+         * @brief Forward the objective function evaluation of a multi-start instance,
+         * the instance is stopped from its own callback once another start has been
+         * selected
+         *
+         * @param x current optimization vector
+         * @param grad objective gradient w.r.t. the current optimization vector
+         * @param start reference to the multi-start instance
+         * @return double objective function value
+         */
+        static double multiStartObjFunWrapper(
+            const std::vector<double> &x,
+            std::vector<double> &grad,
+            void *start)
+        {
+            auto s = static_cast<Start *>(start);
+            if (s->stop->load())
+            {
+                s->opt->force_stop();
+            }
+
+            return nloptObjFunWrapper(x, grad, s->objFunc.get());
+        }
+
+        /**
+         * @brief Forward the system's dynamics equality constraints evaluation to the internal solver
          *
          * @param result constraints value
          * @param n dimension of the optimization vector
@@ -743,32 +2290,21 @@ namespace mpc
          * @param conFunc reference to the constraints class
          */
         static void nloptEqConFunWrapper(
-            unsigned int,
+            unsigned int m,
             double *result,
             unsigned int n,
             const double *x,
             double *grad,
             void *conFunc)
         {
-            bool hasGradient = (grad != NULL);
-            cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> x_arr;
-            x_arr = Eigen::Map<cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)>>((double *)x, n);
-
-            auto res = static_cast<Constraints<sizer> *>(conFunc)->evaluateStateModelEq(x_arr, hasGradient);
-
-            std::memcpy(
-                result,
-                res.value.data(),
-                res.value.size() * sizeof(double));
-
-            if (hasGradient)
-            {
-                // The gradient should be transposed since the difference between matlab and nlopt
-                std::memcpy(
-                    grad,
-                    res.grad.transpose().data(),
-                    res.grad.rows() * res.grad.cols() * sizeof(double));
-            }
+            auto con = static_cast<Constraints<sizer> *>(conFunc);
+
+            // the row-major Jacobian of the internal solver is viewed as the
+            // column-major transposed Jacobian
+            con->evaluateStateModelEq(
+                con->restoreSlack(x, n),
+                Eigen::Map<cvec<>>(result, m),
+                Eigen::Map<mat<>>(grad, grad ? n : 0, m));
         }
 
         /**
@@ -781,32 +2317,21 @@ namespace mpc
          * @param conFunc reference to the constraints class
          */
         static void nloptUserIneqConFunWrapper(
-            unsigned int,
+            unsigned int m,
             double *result,
             unsigned int n,
             const double *x,
             double *grad,
             void *conFunc)
         {
-            bool hasGradient = (grad != NULL);
-            cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> x_arr;
-            x_arr = Eigen::Map<cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)>>((double *)x, n);
-
-            auto res = static_cast<Constraints<sizer> *>(conFunc)->evaluateIneq(x_arr, hasGradient);
-
-            std::memcpy(
-                result,
-                res.value.data(),
-                res.value.size() * sizeof(double));
-
-            if (hasGradient)
-            {
-                // The gradient should be transposed since the difference between matlab and nlopt
-                std::memcpy(
-                    grad,
-                    res.grad.transpose().data(),
-                    res.grad.rows() * res.grad.cols() * sizeof(double));
-            }
+            auto con = static_cast<Constraints<sizer> *>(conFunc);
+
+            // the row-major Jacobian of the internal solver is viewed as the
+            // column-major transposed Jacobian
+            con->evaluateIneq(
+                con->restoreSlack(x, n),
+                Eigen::Map<cvec<>>(result, m),
+                Eigen::Map<mat<>>(grad, grad ? n : 0, m));
         }
 
         /**
@@ -819,35 +2344,455 @@ namespace mpc
          * @param conFunc reference to the constraints class
          */
         static void nloptUserEqConFunWrapper(
-            unsigned int /*m*/,
+            unsigned int m,
             double *result,
             unsigned int n,
             const double *x,
             double *grad,
             void *conFunc)
         {
+            auto con = static_cast<Constraints<sizer> *>(conFunc);
+
+            // the row-major Jacobian of the internal solver is viewed as the
+            // column-major transposed Jacobian
+            con->evaluateEq(
+                con->restoreSlack(x, n),
+                Eigen::Map<cvec<>>(result, m),
+                Eigen::Map<mat<>>(grad, grad ? n : 0, m));
+        }
+
+        /**
+         * @brief Forward the objective function evaluation to the internal solver
+         * recording the iterate for the time limit. With the concurrent evaluation the
+         * constraints are evaluated by the team at the same iterate while the objective
+         * function and its gradient are computed
+         *
+         * @param x current optimization vector
+         * @param grad objective gradient w.r.t. the current optimization vector
+         * @param optimizer reference to the optimizer class
+         * @return double objective function value
+         */
+        static double trackedObjFunWrapper(
+            const std::vector<double> &x,
+            std::vector<double> &grad,
+            void *optimizer)
+        {
+            auto self = static_cast<NLOptimizer<sizer> *>(optimizer);
+
+            if (self->team_active)
+            {
+                self->launchTeam(x.data(), x.size(), !grad.empty());
+            }
+
+            double value = nloptObjFunWrapper(x, grad, self->objFunc.get());
+            self->trackObjective(x.data(), x.size(), value);
+            return value;
+        }
+
+        /**
+         * @brief Forward the constraints evaluation to the internal solver
+         * recording the violation of the iterate for the time limit
+         *
+         * @tparam conFun constraints function wrapper
+         * @tparam tol constraints tolerances
+         * @tparam equality true for equality constraints
+         * @tparam group constraints group in the evaluation cache
+         * @param m number of constraints
+         * @param result constraints value
+         * @param n dimension of the optimization vector
+         * @param x current optimization vector
+         * @param grad constraints gradient w.r.t. the current optimization vector
+         * @param optimizer reference to the optimizer class
+         */
+        template <nlopt::mfunc conFun, std::vector<double> NLOptimizer::*tol, bool equality, int group>
+        static void trackedConFunWrapper(
+            unsigned int m,
+            double *result,
+            unsigned int n,
+            const double *x,
+            double *grad,
+            void *optimizer)
+        {
+            auto self = static_cast<NLOptimizer<sizer> *>(optimizer);
+
+            if (self->team_active)
+            {
+                self->cachedConstraints(conFun, group, m, result, n, x, grad);
+            }
+            else
+            {
+                conFun(m, result, n, x, grad, self->conFunc.get());
+            }
+
+            self->trackConstraints(x, n, result, m, self->*tol, equality);
+        }
+
+        /**
+         * @brief Forward the objective function evaluation to the internal solver
+         * using the single shooting formulation
+         *
+         * @param x current reduced optimization vector
+         * @param grad objective gradient w.r.t. the current reduced optimization vector
+         * @param optimizer reference to the optimizer class
+         * @return double objective function value
+         */
+        static double shootingObjFunWrapper(
+            const std::vector<double> &x,
+            std::vector<double> &grad,
+            void *optimizer)
+        {
+            auto self = static_cast<NLOptimizer<sizer> *>(optimizer);
+
+            bool hasGradient = !grad.empty();
+            self->shooting->expand(
+                restoreSlack<((sizer.nu * sizer.ch) + 1)>(x.data(), x.size(), self->fixed_slack),
+                hasGradient);
+
+            double value = self->objFunc->evaluate(
+                self->shooting->fullVector(),
+                self->shooting_grad.head(hasGradient ? self->shooting_grad.size() : 0));
+
+            if (hasGradient)
+            {
+                // chain rule through the forward sensitivities
+                cvec<((sizer.nu * sizer.ch) + 1)> reduced_grad;
+                reduced_grad.noalias() = self->shooting->sensitivity().transpose() * self->shooting_grad;
+
+                std::copy_n(reduced_grad.data(), grad.size(), grad.begin());
+            }
+
+            self->trackObjective(x.data(), x.size(), value);
+
+            // the predicted states of a failed rollout do not follow the model
+            if (!self->shooting->isConverged())
+            {
+                self->rejectIterate();
+            }
+            return value;
+        }
+
+        /**
+         * @brief Forward the user inequality constraints evaluation to the internal solver
+         * using the single shooting formulation
+         *
+         * @param result constraints value
+         * @param n dimension of the reduced optimization vector
+         * @param x current reduced optimization vector
+         * @param grad inequality constraints gradient w.r.t. the current reduced optimization vector
+         * @param optimizer reference to the optimizer class
+         */
+        static void shootingUserIneqConFunWrapper(
+            unsigned int m,
+            double *result,
+            unsigned int n,
+            const double *x,
+            double *grad,
+            void *optimizer)
+        {
+            auto self = static_cast<NLOptimizer<sizer> *>(optimizer);
+
             bool hasGradient = (grad != NULL);
-            cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> x_arr;
-            x_arr = Eigen::Map<cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)>>((double *)x, n);
+            self->shooting->expand(
+                restoreSlack<((sizer.nu * sizer.ch) + 1)>(x, n, self->fixed_slack),
+                hasGradient);
+
+            self->conFunc->evaluateIneq(
+                self->shooting->fullVector(),
+                Eigen::Map<cvec<>>(result, m),
+                self->shooting_ineq_jac.topRows(hasGradient ? self->shooting_ineq_jac.rows() : 0));
+
+            if (hasGradient)
+            {
+                self->template shootingJacobian<sizer.ineq>(grad, self->shooting_ineq_jac, m, n);
+            }
+
+            self->trackConstraints(x, n, result, m, self->shooting_ineq_tol, false);
+        }
+
+        /**
+         * @brief Forward the user equality constraints evaluation to the internal solver
+         * using the single shooting formulation
+         *
+         * @param result constraints value
+         * @param n dimension of the reduced optimization vector
+         * @param x current reduced optimization vector
+         * @param grad equality constraints gradient w.r.t. the current reduced optimization vector
+         * @param optimizer reference to the optimizer class
+         */
+        static void shootingUserEqConFunWrapper(
+            unsigned int m,
+            double *result,
+            unsigned int n,
+            const double *x,
+            double *grad,
+            void *optimizer)
+        {
+            auto self = static_cast<NLOptimizer<sizer> *>(optimizer);
 
-            auto res = static_cast<Constraints<sizer> *>(conFunc)->evaluateEq(x_arr, hasGradient);
+            bool hasGradient = (grad != NULL);
+            self->shooting->expand(
+                restoreSlack<((sizer.nu * sizer.ch) + 1)>(x, n, self->fixed_slack),
+                hasGradient);
 
-            std::memcpy(
-                result,
-                res.value.data(),
-                res.value.size() * sizeof(double));
+            self->conFunc->evaluateEq(
+                self->shooting->fullVector(),
+                Eigen::Map<cvec<>>(result, m),
+                self->shooting_eq_jac.topRows(hasGradient ? self->shooting_eq_jac.rows() : 0));
 
             if (hasGradient)
             {
-                // The gradient should be transposed since the difference between matlab and nlopt
-                std::memcpy(
-                    grad,
-                    res.grad.transpose().data(),
-                    res.grad.rows() * res.grad.cols() * sizeof(double));
+                self->template shootingJacobian<sizer.eq>(grad, self->shooting_eq_jac, m, n);
+            }
+
+            self->trackConstraints(x, n, result, m, self->user_eq_tol, true);
+        }
+
+        /**
+         * @brief Forward the state bounds evaluation to the internal solver
+         * using the single shooting formulation
+         *
+         * @param result constraints value
+         * @param n dimension of the reduced optimization vector
+         * @param x current reduced optimization vector
+         * @param grad constraints gradient w.r.t. the current reduced optimization vector
+         * @param optimizer reference to the optimizer class
+         */
+        static void shootingStateBoundsConFunWrapper(
+            unsigned int,
+            double *result,
+            unsigned int n,
+            const double *x,
+            double *grad,
+            void *optimizer)
+        {
+            auto self = static_cast<NLOptimizer<sizer> *>(optimizer);
+
+            bool hasGradient = (grad != NULL);
+            self->shooting->expand(
+                restoreSlack<((sizer.nu * sizer.ch) + 1)>(x, n, self->fixed_slack),
+                hasGradient);
+
+            auto &full = self->shooting->fullVector();
+            auto &S = self->shooting->sensitivity();
+
+            // each row of the constraints jacobian is stored contiguously
+            size_t ic = 0;
+            for (int i : self->shooting_lower_bounds)
+            {
+                result[ic] = self->zlb[i] - full[i];
+                if (hasGradient)
+                {
+                    Eigen::Map<rvec<>>(grad + (ic * n), n) = -S.row(i).head(n);
+                }
+                ic++;
+            }
+
+            for (int i : self->shooting_upper_bounds)
+            {
+                result[ic] = full[i] - self->zub[i];
+                if (hasGradient)
+                {
+                    Eigen::Map<rvec<>>(grad + (ic * n), n) = S.row(i).head(n);
+                }
+                ic++;
+            }
+
+            self->trackConstraints(x, n, result, ic, {}, false);
+        }
+
+        /**
+         * @brief Convert the constraints Jacobian w.r.t. the full optimization vector
+         * to the Jacobian w.r.t. the reduced one
+         *
+         * @tparam Tnc number of constraints
+         * @param grad Jacobian w.r.t. the reduced optimization vector (row-major)
+         * @param fullJacobian transposed Jacobian w.r.t. the full optimization vector
+         * @param m number of constraints
+         * @param n dimension of the reduced optimization vector
+         */
+        template <int Tnc>
+        void shootingJacobian(
+            double *grad,
+            const mat<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1), Tnc> &fullJacobian,
+            unsigned int m,
+            unsigned int n)
+        {
+            mat<((sizer.nu * sizer.ch) + 1), Tnc> reduced;
+            reduced.noalias() = shooting->sensitivity().transpose() * fullJacobian;
+
+            // the column-major storage of the transposed Jacobian is the
+            // row-major storage expected by the internal solver
+            copyJacobian(grad, reduced.data(), m, n, reduced.rows());
+        }
+
+        /**
+         * @brief Forward the objective function evaluation to the internal solver
+         * using the collocation formulation, the objective function does not depend
+         * on the collocation states
+         *
+         * @param x current optimization vector followed by the collocation states
+         * @param grad objective gradient w.r.t. the current iterate
+         * @param optimizer reference to the optimizer class
+         * @return double objective function value
+         */
+        static double collocationObjFunWrapper(
+            const std::vector<double> &x,
+            std::vector<double> &grad,
+            void *optimizer)
+        {
+            auto self = static_cast<NLOptimizer<sizer> *>(optimizer);
+
+            size_t nz = x.size() - self->collocation->size();
+            double value = self->objFunc->evaluate(
+                self->objFunc->restoreSlack(x.data(), nz),
+                Eigen::Map<cvec<>>(grad.data(), grad.empty() ? 0 : nz));
+
+            if (!grad.empty())
+            {
+                std::fill(grad.begin() + nz, grad.end(), 0.0);
+            }
+
+            self->trackObjective(x.data(), x.size(), value);
+            return value;
+        }
+
+        /**
+         * @brief Forward the collocation equations evaluation to the internal solver
+         *
+         * @param m number of defects
+         * @param result defects value
+         * @param n dimension of the iterate
+         * @param x current optimization vector followed by the collocation states
+         * @param grad defects gradient w.r.t. the current iterate
+         * @param optimizer reference to the optimizer class
+         */
+        static void collocationDefectsConFunWrapper(
+            unsigned int m,
+            double *result,
+            unsigned int n,
+            const double *x,
+            double *grad,
+            void *optimizer)
+        {
+            auto self = static_cast<NLOptimizer<sizer> *>(optimizer);
+
+            // the row-major Jacobian of the internal solver is viewed as the
+            // column-major transposed Jacobian
+            self->collocation->evaluateDefects(
+                x,
+                n,
+                Eigen::Map<cvec<>>(result, m),
+                Eigen::Map<mat<>>(grad, grad ? n : 0, m));
+
+            self->trackConstraints(x, n, result, m, self->collocation_tol, true);
+        }
+
+        /**
+         * @brief Forward the user constraints evaluation to the internal solver using
+         * the collocation formulation, the user constraints do not depend on the
+         * collocation states
+         *
+         * @tparam conFun constraints function wrapper
+         * @tparam tol constraints tolerances
+         * @tparam equality true for equality constraints
+         * @param m number of constraints
+         * @param result constraints value
+         * @param n dimension of the iterate
+         * @param x current optimization vector followed by the collocation states
+         * @param grad constraints gradient w.r.t. the current iterate
+         * @param optimizer reference to the optimizer class
+         */
+        template <nlopt::mfunc conFun, std::vector<double> NLOptimizer::*tol, bool equality>
+        static void collocationConFunWrapper(
+            unsigned int m,
+            double *result,
+            unsigned int n,
+            const double *x,
+            double *grad,
+            void *optimizer)
+        {
+            auto self = static_cast<NLOptimizer<sizer> *>(optimizer);
+
+            unsigned int nz = n - self->collocation->size();
+            auto &jac = self->collocation_jac;
+            if (grad)
+            {
+                jac.resize(m * nz);
+            }
+
+            conFun(m, result, nz, x, grad ? jac.data() : nullptr, self->conFunc.get());
+
+            for (unsigned int k = 0; grad && k < m; k++)
+            {
+                std::copy_n(jac.data() + (k * nz), nz, grad + (k * n));
+                std::fill(grad + (k * n) + nz, grad + ((k + 1) * n), 0.0);
+            }
+
+            self->trackConstraints(x, n, result, m, self->*tol, equality);
+        }
+
+        /**
+         * @brief Number of slack variables of the problem seen by the NLopt instances,
+         * the slack variable fixed by the hard constraints is removed
+         *
+         * @return size_t number of slack variables
+         */
+        size_t slackSize() const
+        {
+            return fixed_slack ? 0 : 1;
+        }
+
+        /**
+         * @brief Restore an iterate of the NLopt instances to the layout of the
+         * optimization vector, the slack variable removed from the problem is set
+         * to its fixed value
+         *
+         * @tparam Tn dimension of the restored vector
+         * @param x iterate of the internal solver
+         * @param n dimension of the iterate
+         * @param fixedSlack true if the slack variable has been removed
+         * @return cvec<Tn> restored vector
+         */
+        template <int Tn>
+        static cvec<Tn> restoreSlack(const double *x, unsigned int n, bool fixedSlack)
+        {
+            cvec<Tn> v;
+            v.resize(n + (fixedSlack ? 1 : 0));
+            v.head(n) = Eigen::Map<const cvec<>>(x, n);
+            if (fixedSlack)
+            {
+                v(n) = 0;
+            }
+            return v;
+        }
+
+        /**
+         * @brief Copy the constraints Jacobian (one column for each constraint) to the
+         * row-major Jacobian of the internal solver, only the rows of the variables of
+         * the problem seen by the internal solver are copied
+         *
+         * @param grad Jacobian of the internal solver (row-major)
+         * @param full Jacobian matrix storage (column-major)
+         * @param m number of constraints
+         * @param n dimension of the problem seen by the internal solver
+         * @param rows number of rows of the Jacobian matrix
+         */
+        static void copyJacobian(double *grad, const double *full, unsigned int m, unsigned int n, size_t rows)
+        {
+            for (unsigned int k = 0; k < m; k++)
+            {
+                std::memcpy(grad + (k * n), full + (k * rows), n * sizeof(double));
             }
         }
 
-        nlopt::opt *innerOpt;
+        nlopt::opt *innerOpt = nullptr;
+        nlopt::opt *shootingOpt = nullptr;
+        nlopt::opt *collocationOpt = nullptr;
+        bool fixed_slack = false;
+        std::shared_ptr<SQPSolver<sizer>> sqpSolver;
+        std::shared_ptr<IPMSolver<sizer>> ipmSolver;
+        std::shared_ptr<SingleShooting<sizer>> shooting;
+        std::shared_ptr<Collocation<sizer>> collocation;
 
         std::shared_ptr<Objective<sizer>> objFunc;
         std::shared_ptr<Constraints<sizer>> conFunc;
@@ -855,8 +2800,130 @@ namespace mpc
         std::shared_ptr<Model<sizer>> model;
 
         cvec<(sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1>  lb, ub;
+        // bounds and scaling of the (scaled) optimization vector seen by the internal solvers
+        cvec<(sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1> zlb, zub, scaling;
         cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> opt_vector;
         bool is_first_iteration = true;
         bool enable_warm_start = false;
+
+        NLBackend backend = NLBackend::NLOPT;
+        NLFormulation formulation = NLFormulation::MULTIPLE_SHOOTING;
+        NLAlgorithm algorithm = NLAlgorithm::SLSQP;
+        NLAlgorithm auglag_local_algorithm = NLAlgorithm::LBFGS;
+        int sqp_iterations = 1;
+        double sqp_step_tolerance = -1;
+        NLInitialization initialization = NLInitialization::CONSTANT;
+
+        /**
+         * @brief Best feasible iterate seen by the NLopt callbacks during the
+         * optimization, returned when the time limit stops the solver
+         */
+        struct Anytime
+        {
+            bool enabled = false;
+            bool expired = false;
+            std::chrono::steady_clock::time_point deadline;
+            nlopt::opt *opt = nullptr;
+            // number of constraints groups registered in the solver
+            int groups = 0;
+
+            std::vector<double> x;
+            double cost = mpc::inf;
+            double violation = 0;
+            // number of constraints groups evaluated at x, negative if x has been committed
+            int evaluated = -1;
+
+            std::vector<double> best;
+            double best_cost = mpc::inf;
+        };
+
+        Anytime anytime;
+
+        /**
+         * @brief Independent instance of the multi-start
+         */
+        struct Start
+        {
+            std::shared_ptr<Objective<sizer>> objFunc;
+            std::shared_ptr<Constraints<sizer>> conFunc;
+            std::shared_ptr<nlopt::opt> opt;
+            std::atomic<bool> *stop = nullptr;
+
+            std::vector<double> x;
+            double cost = mpc::inf;
+            int status = nlopt::FAILURE;
+            bool success = false;
+            bool feasible = false;
+        };
+
+        NLParameters parameters;
+        int multistart = 1;
+
+        NLScaling scaling_mode = NLScaling::MANUAL;
+        double scaling_smoothing = 0.9;
+        cvec<sizer.nx> state_magnitude;
+        cvec<sizer.nu> input_magnitude;
+        bool has_magnitude = false;
+        double multistart_cost_tolerance = 0;
+        std::vector<Start> starts;
+        std::atomic<bool> multistart_stop{false};
+        double multistart_threshold = -mpc::inf;
+        int multistart_winner = -1;
+        std::mutex multistart_mutex;
+        bool starts_changed = true;
+        std::vector<double> state_eq_tol, user_eq_tol;
+
+        std::vector<double> shooting_ineq_tol;
+        std::vector<int> shooting_lower_bounds, shooting_upper_bounds;
+        bool shooting_constraints_changed = true;
+
+        // buffers exchanged with NLopt (optimized vector and bounds), reused between runs
+        std::vector<double> opt_x, lb_vec, ub_vec;
+
+        // tolerances and bounds of the collocation formulation, Jacobian matrix (row-major)
+        // of the user constraints w.r.t. the optimization vector without the collocation states
+        std::vector<double> collocation_tol, collocation_lb, collocation_ub, collocation_jac;
+
+        // gradient and transposed Jacobian matrices w.r.t. the full optimization vector
+        // evaluated by the single shooting callbacks
+        cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> shooting_grad;
+        mat<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1), sizer.ineq> shooting_ineq_jac;
+        mat<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1), sizer.eq> shooting_eq_jac;
+
+        /**
+         * @brief Constraints groups evaluated by the team
+         */
+        enum ConstraintsGroup
+        {
+            STATE_EQ = 0,
+            USER_INEQ = 1,
+            USER_EQ = 2
+        };
+
+        /**
+         * @brief Constraints evaluated by the team at the last iterate of the objective
+         * function, the Jacobian matrices are stored row-major as in NLopt
+         */
+        struct EvaluationCache
+        {
+            struct Group
+            {
+                std::vector<double> value;
+                std::vector<double> jacobian;
+            };
+
+            std::vector<double> x;
+            bool gradient = false;
+            bool valid = false;
+            Group groups[3];
+        };
+
+        bool concurrent_evaluation = false;
+        bool team_active = false;
+        bool team_changed = true;
+        EvaluationCache cache;
+        std::shared_ptr<Constraints<sizer>> stateConFunc, userConFunc;
+        std::shared_ptr<EvaluationTeam> team;
+        std::shared_ptr<EvaluationTeam> multistart_team;
     };
 } // namespace mpc
@@ -60,7 +60,8 @@ namespace mpc
             COND_RESIZE_MAT(sizer,Xmat, (ph() + 1), nx());
             COND_RESIZE_MAT(sizer,Umat, (ph() + 1), nu());
             COND_RESIZE_MAT(sizer,Jx, nx(), ph());
-            COND_RESIZE_MAT(sizer,Jmv, nu(), ph());
+            COND_RESIZE_CVEC(sizer,Jmv, (nu() * ch()));
+            COND_RESIZE_CVEC(sizer,x_restored, ((ph() * nx()) + (nu() * ch()) + 1));
 
             Je = 0;
         }
@@ -76,9 +77,64 @@ namespace mpc
             const typename Base<sizer>::ObjFunHandle handle)
         {
             checkOrQuit();
+            ruser = nullptr;
             return fuser = handle, true;
         }
 
+        /**
+         * @brief Set the objective function to be minimized in residual form,
+         * the objective function is half the squared norm of the residuals
+         *
+         * @param handle function handler
+         * @param nres number of residuals
+         * @return true
+         * @return false
+         */
+        bool setResidual(
+            const typename Base<sizer>::ResFunHandle handle,
+            int nres)
+        {
+            checkOrQuit();
+
+            if (nres <= 0)
+            {
+                Logger::instance().log(Logger::log_type::ERROR)
+                    << "The number of residuals must be positive"
+                    << std::endl;
+                return false;
+            }
+
+            ruser = handle;
+            this->nres = nres;
+
+            // the residuals buffer is owned by the function, so the copies of the
+            // objective function (e.g. of the multi-start) do not share it and the
+            // evaluations do not allocate memory
+            fuser = [handle, r = cvec<>(nres)](
+                        const mat<sizer.ph + 1, sizer.nx> &X,
+                        const mat<sizer.ph + 1, sizer.ny> &Y,
+                        const mat<sizer.ph + 1, sizer.nu> &U,
+                        const double &slack) mutable
+            {
+                r.setZero();
+                handle(r, X, Y, U, slack);
+                return 0.5 * r.squaredNorm();
+            };
+
+            return true;
+        }
+
+        /**
+         * @brief Check if the objective function is defined in residual form
+         *
+         * @return true
+         * @return false
+         */
+        bool hasResidual() const
+        {
+            return ruser != nullptr;
+        }
+
         /**
          * @brief Evaluate the objective function at the desired optimal vector
          *
@@ -87,59 +143,52 @@ namespace mpc
          * @return Cost associated cost
          */
         Cost evaluate(
-            cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> x,
+            const Eigen::Ref<const cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)>> &x,
             bool hasGradient)
         {
-            checkOrQuit();
-
             Cost c;
             COND_RESIZE_CVEC(sizer,c.grad, ((ph() * nx()) + (nu() * ch()) + 1));
 
-            mapping->unwrapVector(x, x0, Xmat, Umat, e);
-            c.value = fuser(Xmat, model->getOutput(Xmat, Umat), Umat, e);
+            c.value = evaluate(x, hasGradient ? c.grad.head(c.grad.size()) : c.grad.head(0));
+            return c;
+        }
 
-            if (hasGradient)
-            {
-                computeJacobian(Xmat, Umat, c.value, e);
+        /**
+         * @brief Evaluate the objective function at the desired optimal vector writing
+         * the gradient in place (e.g. in the buffer of the internal solver)
+         *
+         * @param x internal optimal vector
+         * @param grad gradient w.r.t. the optimal vector, empty if not requested. When the
+         * slack variable is removed from the problem its element is not written
+         * @return double objective function value
+         */
+        double evaluate(
+            const Eigen::Ref<const cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)>> &x,
+            Eigen::Ref<cvec<>> grad)
+        {
+            checkOrQuit();
 
-                for (int i = 0; i < Xmat.cols(); i++)
-                {
-                    Xmat.col(i) /= 1.0 / mapping->StateScaling()(i);
-                }
+            bool hasGradient = grad.size() > 0;
 
-                int counter = 0;
+            mapping->unwrapVector(x, x0, Xmat, Umat, e);
+            double value = fuser(Xmat, model->getOutput(Xmat, Umat), Umat, e);
 
-                // #pragma omp parallel for
-                for (int j = 0; j < (int)Jx.cols(); j++)
-                {
-                    for (int i = 0; i < (int)Jx.rows(); i++)
-                    {
-                        c.grad(counter++) = Jx(i, j);
-                    }
-                }
+            if (hasGradient)
+            {
+                computeJacobian(Xmat, Umat, x.middleRows((ph() * nx()), (nu() * ch())), value, e);
 
-                cvec<(sizer.ph * sizer.nu)> JmvVectorized;
-                COND_RESIZE_CVEC(sizer,JmvVectorized, (ph() * nu()));
+                // the optimization vector holds the scaled states, the gradient of
+                // each stage is a column of the Jacobian matrix
+                Jx = mapping->StateScaling().asDiagonal() * Jx;
+                grad.head(ph() * nx()) = Eigen::Map<const cvec<>>(Jx.data(), Jx.size());
 
-                int vec_counter = 0;
-                // #pragma omp parallel for
-                for (int j = 0; j < (int)Jmv.cols(); j++)
-                {
-                    for (int i = 0; i < (int)Jmv.rows(); i++)
-                    {
-                        JmvVectorized(vec_counter++) = Jmv(i, j);
-                    }
-                }
+                // the inputs are already differentiated w.r.t. the optimization vector
+                grad.segment((ph() * nx()), (nu() * ch())) = Jmv;
 
-                cvec<(sizer.nu * sizer.ch)> res;
-                res = mapping->Iz2u().transpose() * JmvVectorized;
-                // #pragma omp parallel for
-                for (size_t j = 0; j < (ch() * nu()); j++)
+                if (grad.size() == x.size())
                 {
-                    c.grad(counter++) = res(j);
+                    grad(grad.size() - 1) = Je;
                 }
-
-                c.grad(((ph() * nx()) + (nu() * ch()) + 1) - 1) = Je;
             }
 
             Logger::instance().log(Logger::log_type::DETAIL)
@@ -147,7 +196,7 @@ namespace mpc
                 << niteration
                 << ") Objective function value: \n"
                 << std::setprecision(10)
-                << c.value
+                << value
                 << std::endl;
             if (!hasGradient)
             {
@@ -164,28 +213,141 @@ namespace mpc
                     << niteration
                     << ") Objective function gradient: \n"
                     << std::setprecision(10)
-                    << c.grad
+                    << grad
                     << std::endl;
             }
 
             // debug information
             niteration++;
 
+            return value;
+        }
+
+        /**
+         * @brief Approximate the diagonal of the objective function hessian
+         * at the desired optimal vector (second order central differences)
+         *
+         * @param x internal optimal vector
+         * @param f0 objective function value at the optimal vector
+         * @return cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> diagonal of the hessian
+         */
+        cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> evaluateHessianDiagonal(
+            cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> x,
+            double f0)
+        {
+            checkOrQuit();
+
+            double hv = 1e-4;
+
+            cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> hdiag;
+            COND_RESIZE_CVEC(sizer, hdiag, ((ph() * nx()) + (nu() * ch()) + 1));
+
+            hdiag.setZero();
+
+            // the slack variable fixed by its bounds is not perturbed
+            for (int i = 0; i < x.rows() - (fixed_slack ? 1 : 0); i++)
+            {
+                double xi = x(i);
+                double h = hv * std::max(1.0, std::fabs(xi));
+
+                x(i) = xi + h;
+                double fp = evaluate(x, false).value;
+                x(i) = xi - h;
+                double fm = evaluate(x, false).value;
+                x(i) = xi;
+
+                hdiag(i) = (fp - (2.0 * f0) + fm) / (h * h);
+            }
+
+            return hdiag;
+        }
+
+        /**
+         * @brief Evaluate the objective function defined in residual form at the
+         * desired optimal vector together with the Gauss-Newton approximation of
+         * its hessian J'J, where J is the Jacobian of the residuals with respect
+         * to the optimal vector (the gradient is computed as J'r)
+         *
+         * @param x internal optimal vector
+         * @param hessian Gauss-Newton hessian approximation
+         * @return Cost associated cost
+         */
+        Cost evaluateGaussNewton(
+            cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> x,
+            mat<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1), ((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> &hessian)
+        {
+            checkOrQuit();
+
+            double dv = sqrt(std::numeric_limits<double>::epsilon());
+
+            cvec<> r0 = evaluateResidual(x);
+
+            mat<> Jr(nres, x.rows());
+            Jr.setZero();
+
+            // the slack variable fixed by its bounds is not perturbed
+            for (int i = 0; i < x.rows() - (fixed_slack ? 1 : 0); i++)
+            {
+                double xi = x(i);
+                double h = dv * std::max(1.0, std::fabs(xi));
+
+                x(i) = xi + h;
+                Jr.col(i) = (evaluateResidual(x) - r0) / h;
+                x(i) = xi;
+            }
+
+            Cost c;
+            c.value = 0.5 * r0.squaredNorm();
+            c.grad = Jr.transpose() * r0;
+            hessian = Jr.transpose() * Jr;
+
+            Logger::instance().log(Logger::log_type::DETAIL)
+                << "("
+                << niteration
+                << ") Objective function residuals: \n"
+                << std::setprecision(10)
+                << r0
+                << std::endl;
+
+            // debug information
+            niteration++;
+
             return c;
         }
 
     private:
         /**
-         * @brief Approximate the objective function Jacobian matrices
+         * @brief Evaluate the residuals of the objective function at the desired optimal vector
+         *
+         * @param x internal optimal vector
+         * @return cvec<> residuals
+         */
+        cvec<> evaluateResidual(const cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> &x)
+        {
+            mapping->unwrapVector(x, x0, Xmat, Umat, e);
+
+            cvec<> r(nres);
+            r.setZero();
+            ruser(r, Xmat, model->getOutput(Xmat, Umat), Umat, e);
+
+            return r;
+        }
+
+        /**
+         * @brief Approximate the objective function Jacobian matrices. The inputs are
+         * perturbed along the input elements of the optimization vector, so that the
+         * steps sharing the same element of the control horizon are perturbed once
          *
          * @param x0 current state configuration
          * @param u0 current optimal input configuration
-         * @param f0 current user inequality constraints values
+         * @param z0 current input elements of the optimization vector
+         * @param f0 current objective function value
          * @param e0 current slack value
          */
         void computeJacobian(
             mat<(sizer.ph + 1), sizer.nx> x0,
             mat<(sizer.ph + 1), sizer.nu> u0,
+            const cvec<(sizer.nu * sizer.ch)> &z0,
             double f0,
             double e0)
         {
@@ -214,52 +376,38 @@ namespace mpc
                 }
             }
 
-            mat<(sizer.ph + 1), sizer.nu> Ua;
-            Ua = u0.cwiseAbs().unaryExpr([](double d)
-                                         { return (d < 1) ? 1 : d; });
+            mat<(sizer.ph + 1), sizer.nu> D;
+            COND_RESIZE_MAT(sizer, D, (ph() + 1), nu());
 
-            // #pragma omp parallel for
-            for (size_t i = 0; i < (ph() - 1); i++)
+            // TODO support measured disturbaces
+            for (size_t c = 0; c < (nu() * ch()); c++)
             {
-                // TODO support measured disturbaces
-                for (size_t j = 0; j < nu(); j++)
-                {
-                    int k = j;
-                    double du = dv * Ua.array()(k);
-                    u0(i, k) = u0(i, k) + du;
-                    double f = fuser(x0, model->getOutput(x0, u0), u0, e0);
-                    u0(i, k) = u0(i, k) - du;
-                    double df = (f - f0) / du;
-                    Jmv(j, i) = df;
-                }
+                mapping->inputDirection(c, D);
+
+                double dz = dv * std::max(1.0, std::fabs(z0(c)));
+                mat<(sizer.ph + 1), sizer.nu> u = u0 + (dz * D);
+                double f = fuser(x0, model->getOutput(x0, u), u, e0);
+                Jmv(c) = (f - f0) / dz;
             }
 
-            // TODO support measured disturbaces
-            // #pragma omp parallel for
-            for (size_t j = 0; j < nu(); j++)
+            // the slack variable fixed by its bounds is not perturbed
+            Je = 0;
+            if (!fixed_slack)
             {
-                int k = j;
-                double du = dv * Ua.array()(k);
-                u0((ph() - 1), k) = u0((ph() - 1), k) + du;
-                u0(ph(), k) = u0(ph(), k) + du;
-                double f = fuser(x0, model->getOutput(x0, u0), u0, e0);
-                u0((ph() - 1), k) = u0((ph() - 1), k) - du;
-                u0(ph(), k) = u0(ph(), k) - du;
-                double df = (f - f0) / du;
-                Jmv(j, (ph() - 1)) = df;
+                double ea = fmax(1e-6, abs(e0));
+                double de = ea * dv;
+                double f1 = fuser(x0, model->getOutput(x0, u0), u0, e0 + de);
+                double f2 = fuser(x0, model->getOutput(x0, u0), u0, e0 - de);
+                Je = (f1 - f2) / (2 * de);
             }
-
-            double ea = fmax(1e-6, abs(e0));
-            double de = ea * dv;
-            double f1 = fuser(x0, model->getOutput(x0, u0), u0, e0 + de);
-            double f2 = fuser(x0, model->getOutput(x0, u0), u0, e0 - de);
-            Je = (f1 - f2) / (2 * de);
         }
 
         typename Base<sizer>::ObjFunHandle fuser = nullptr;
+        typename Base<sizer>::ResFunHandle ruser = nullptr;
+        int nres = 0;
 
         mat<sizer.nx, sizer.ph> Jx;
-        mat<sizer.nu, sizer.ph> Jmv;
+        cvec<(sizer.nu * sizer.ch)> Jmv;
 
         double Je;
 
@@ -270,5 +418,7 @@ namespace mpc
         using Base<sizer>::Umat;
         using Base<sizer>::e;
         using Base<sizer>::niteration;
+        using Base<sizer>::fixed_slack;
+        using Base<sizer>::x_restored;
     };
 } // namespace mpc
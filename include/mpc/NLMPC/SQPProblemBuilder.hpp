@@ -0,0 +1,418 @@
+/*
+ *   Copyright (c) 2023 Nicola Piccinelli
+ *   All rights reserved.
+ */
+#pragma once
+
+#include <mpc/IComponent.hpp>
+#include <mpc/NLMPC/Mapping.hpp>
+
+namespace mpc
+{
+    /**
+     * @brief Sparse assembler of the quadratic sub-problem solved at each
+     * iteration of the sequential quadratic programming backend. The problem
+     * is expressed in terms of the step d of the optimization vector
+     *
+     *   min 0.5 d'Pd + q'd
+     *   s.t. l <= Ad <= u
+     *
+     * where P is the (upper triangular) hessian approximation of the objective
+     * function and the rows of A contain (in order) the linearized system's dynamics,
+     * the user inequality constraints, the user equality constraints and the
+     * box constraints on the optimization vector. The sparsity pattern is
+     * computed once, the values are then overwritten at each linearization
+     * so that the pattern seen by the quadratic solver only changes when the
+     * hessian pattern has to be extended.
+     *
+     * @tparam sizer.nx dimension of the state space
+     * @tparam sizer.nu dimension of the input space
+     * @tparam sizer.ny dimension of the output space
+     * @tparam sizer.ph length of the prediction horizon
+     * @tparam sizer.ch length of the control horizon
+     * @tparam sizer.ineq number of the user inequality constraints
+     * @tparam sizer.eq number of the user equality constraints
+     */
+    template <MPCSize sizer>
+    class SQPProblemBuilder : public IComponent<sizer>
+    {
+    private:
+        using IComponent<sizer>::checkOrQuit;
+        using IDimensionable<sizer>::nu;
+        using IDimensionable<sizer>::nx;
+        using IDimensionable<sizer>::ndu;
+        using IDimensionable<sizer>::ny;
+        using IDimensionable<sizer>::ph;
+        using IDimensionable<sizer>::ch;
+        using IDimensionable<sizer>::ineq;
+        using IDimensionable<sizer>::eq;
+
+    public:
+        SQPProblemBuilder() = default;
+        ~SQPProblemBuilder() = default;
+
+        /**
+         * @brief Initialization hook override used to perform the
+         * initialization procedure. Performing initialization in this
+         * method ensures the correct problem dimensions assigment has been
+         * already performed.
+         */
+        void onInit() override
+        {
+            COND_RESIZE_CVEC(sizer, q, numVars());
+            COND_RESIZE_CVEC(sizer, l, numConstraints());
+            COND_RESIZE_CVEC(sizer, u, numConstraints());
+
+            q.setZero();
+            l.setZero();
+            u.setZero();
+
+            hasPattern = false;
+        }
+
+        /**
+         * @brief Set the mapping object reference used to recover the
+         * structure of the control horizon
+         *
+         * @param map the mapping object
+         */
+        void setMapping(std::shared_ptr<Mapping<sizer>> map)
+        {
+            checkOrQuit();
+            mapping = map;
+        }
+
+        /**
+         * @brief Compute the sparsity pattern of the quadratic sub-problem
+         *
+         * @param hasIneq the user inequality constraints are defined
+         * @param hasEq the user equality constraints are defined
+         */
+        void buildPattern(bool hasIneq, bool hasEq)
+        {
+            checkOrQuit();
+
+            std::vector<Eigen::Triplet<double>> triplets;
+            blockingPattern = mapping->InputBasis() == NLInputBasis::BLOCKING;
+
+            // the hessian approximation starts diagonal (it is extended only if a full
+            // hessian approximation is provided), we only store the upper triangular part
+            P.resize(numVars(), numVars());
+            for (int i = 0; i < numVars(); i++)
+            {
+                triplets.push_back(Eigen::Triplet<double>(i, i, 0.0));
+            }
+            P.setFromTriplets(triplets.begin(), triplets.end());
+            P.makeCompressed();
+
+            triplets.clear();
+
+            // the system's dynamics at step i only depends on the states at
+            // step i and i+1 and on the optimal inputs mapped on the step i
+            for (size_t i = 0; i < ph(); i++)
+            {
+                for (size_t r = 0; r < nx(); r++)
+                {
+                    int row = (i * nx()) + r;
+
+                    if (i > 0)
+                    {
+                        for (size_t c = 0; c < nx(); c++)
+                        {
+                            triplets.push_back(Eigen::Triplet<double>(row, ((i - 1) * nx()) + c, 0.0));
+                        }
+                    }
+
+                    for (size_t c = 0; c < nx(); c++)
+                    {
+                        triplets.push_back(Eigen::Triplet<double>(row, (i * nx()) + c, 0.0));
+                    }
+
+                    // with the basis functions every coefficient can move the step (the
+                    // pattern does not depend on the pole or on the knots)
+                    for (size_t j = 0; j < ch(); j++)
+                    {
+                        if (blockingPattern && mapping->inputWeight(i, j) == 0)
+                        {
+                            continue;
+                        }
+
+                        for (size_t c = 0; c < nu(); c++)
+                        {
+                            triplets.push_back(Eigen::Triplet<double>(row, (ph() * nx()) + (j * nu()) + c, 0.0));
+                        }
+                    }
+                }
+            }
+
+            // user defined constraints have no known structure
+            int offset = ph() * nx();
+            if (hasIneq)
+            {
+                for (size_t r = 0; r < ineq(); r++)
+                {
+                    for (int c = 0; c < numVars(); c++)
+                    {
+                        triplets.push_back(Eigen::Triplet<double>(offset + r, c, 0.0));
+                    }
+                }
+            }
+
+            offset += ineq();
+            if (hasEq)
+            {
+                for (size_t r = 0; r < eq(); r++)
+                {
+                    for (int c = 0; c < numVars(); c++)
+                    {
+                        triplets.push_back(Eigen::Triplet<double>(offset + r, c, 0.0));
+                    }
+                }
+            }
+
+            // box constraints on the optimization vector
+            offset += eq();
+            for (int r = 0; r < numVars(); r++)
+            {
+                triplets.push_back(Eigen::Triplet<double>(offset + r, r, 1.0));
+            }
+
+            A.resize(numConstraints(), numVars());
+            A.setFromTriplets(triplets.begin(), triplets.end());
+            A.makeCompressed();
+
+            hasPattern = true;
+            this->hasIneq = hasIneq;
+            this->hasEq = hasEq;
+
+            Logger::instance().log(Logger::log_type::DETAIL)
+                << "SQP sub-problem pattern: "
+                << P.nonZeros() << " hessian and "
+                << A.nonZeros() << " constraints non-zeros"
+                << std::endl;
+        }
+
+        /**
+         * @brief Check if the sparsity pattern is computed and compatible with
+         * the current set of user constraints and with the input parameterization
+         *
+         * @param hasIneq the user inequality constraints are defined
+         * @param hasEq the user equality constraints are defined
+         * @return true
+         * @return false
+         */
+        bool isPatternValid(bool hasIneq, bool hasEq) const
+        {
+            return hasPattern && this->hasIneq == hasIneq && this->hasEq == hasEq &&
+                   blockingPattern == (mapping->InputBasis() == NLInputBasis::BLOCKING);
+        }
+
+        /**
+         * @brief Set the diagonal hessian approximation of the objective function
+         * (the off-diagonal entries of the pattern are set to zero)
+         *
+         * @param hdiag diagonal of the hessian
+         */
+        void setHessianDiagonal(const cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> &hdiag)
+        {
+            checkOrQuit();
+
+            for (int k = 0; k < P.outerSize(); ++k)
+            {
+                for (smat::InnerIterator it(P, k); it; ++it)
+                {
+                    it.valueRef() = it.row() == it.col() ? hdiag(it.row()) : 0.0;
+                }
+            }
+        }
+
+        /**
+         * @brief Set the full hessian approximation of the objective function.
+         * The sparsity pattern of the hessian is extended with the non-zero entries
+         * of the upper triangular part not already included (the pattern never shrinks
+         * so that it settles after the first iterations)
+         *
+         * @param H hessian of the objective function
+         * @return true if the sparsity pattern has been extended
+         * @return false
+         */
+        bool setHessian(
+            const mat<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1), ((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> &H)
+        {
+            checkOrQuit();
+
+            std::vector<Eigen::Triplet<double>> triplets;
+            std::vector<bool> stored(numVars());
+            bool extended = false;
+
+            for (int k = 0; k < P.outerSize(); ++k)
+            {
+                std::fill(stored.begin(), stored.end(), false);
+                for (smat::InnerIterator it(P, k); it; ++it)
+                {
+                    stored[it.row()] = true;
+                    triplets.push_back(Eigen::Triplet<double>(it.row(), it.col(), 0.0));
+                }
+
+                for (int r = 0; r <= k; r++)
+                {
+                    if (!stored[r] && H(r, k) != 0.0)
+                    {
+                        triplets.push_back(Eigen::Triplet<double>(r, k, 0.0));
+                        extended = true;
+                    }
+                }
+            }
+
+            if (extended)
+            {
+                P.setFromTriplets(triplets.begin(), triplets.end());
+                P.makeCompressed();
+
+                Logger::instance().log(Logger::log_type::DETAIL)
+                    << "SQP sub-problem hessian pattern extended to "
+                    << P.nonZeros() << " non-zeros"
+                    << std::endl;
+            }
+
+            for (int k = 0; k < P.outerSize(); ++k)
+            {
+                for (smat::InnerIterator it(P, k); it; ++it)
+                {
+                    it.valueRef() = H(it.row(), it.col());
+                }
+            }
+
+            return extended;
+        }
+
+        /**
+         * @brief Set the gradient of the objective function
+         *
+         * @param grad objective function gradient
+         */
+        void setGradient(const cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> &grad)
+        {
+            checkOrQuit();
+            q = grad;
+        }
+
+        /**
+         * @brief Set the constraints Jacobian matrices. The matrices are
+         * stored transposed (one column for each constraint) as computed by
+         * the Constraints class
+         *
+         * @param JstateT system's dynamics constraints Jacobian
+         * @param JineqT user inequality constraints Jacobian
+         * @param JeqT user equality constraints Jacobian
+         */
+        void setJacobian(
+            const mat<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1), (sizer.ph * sizer.nx)> &JstateT,
+            const mat<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1), sizer.ineq> &JineqT,
+            const mat<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1), sizer.eq> &JeqT)
+        {
+            checkOrQuit();
+
+            int ineqOffset = ph() * nx();
+            int eqOffset = ineqOffset + ineq();
+            int boundsOffset = eqOffset + eq();
+
+            for (int k = 0; k < A.outerSize(); ++k)
+            {
+                for (smat::InnerIterator it(A, k); it; ++it)
+                {
+                    int r = it.row();
+                    int c = it.col();
+
+                    if (r < ineqOffset)
+                    {
+                        it.valueRef() = JstateT(c, r);
+                    }
+                    else if (r < eqOffset)
+                    {
+                        it.valueRef() = JineqT(c, r - ineqOffset);
+                    }
+                    else if (r < boundsOffset)
+                    {
+                        it.valueRef() = JeqT(c, r - eqOffset);
+                    }
+                }
+            }
+        }
+
+        /**
+         * @brief Set the constraints bounds of the step from the value of the
+         * constraints at the linearization point
+         *
+         * @param cstate system's dynamics constraints value
+         * @param cineq user inequality constraints value
+         * @param ceq user equality constraints value
+         * @param x current optimization vector
+         * @param lb optimization vector lower bounds
+         * @param ub optimization vector upper bounds
+         */
+        void setConstraintsValue(
+            const cvec<(sizer.ph * sizer.nx)> &cstate,
+            const cvec<sizer.ineq> &cineq,
+            const cvec<sizer.eq> &ceq,
+            const cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> &x,
+            const cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> &lb,
+            const cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> &ub)
+        {
+            checkOrQuit();
+
+            int offset = 0;
+            l.middleRows(offset, ph() * nx()) = -cstate;
+            u.middleRows(offset, ph() * nx()) = -cstate;
+
+            offset += ph() * nx();
+            l.middleRows(offset, ineq()).setConstant(-inf);
+            u.middleRows(offset, ineq()) = hasIneq ? cvec<sizer.ineq>(-cineq) : cvec<sizer.ineq>(cvec<sizer.ineq>::Constant(ineq(), inf));
+
+            offset += ineq();
+            l.middleRows(offset, eq()) = hasEq ? cvec<sizer.eq>(-ceq) : cvec<sizer.eq>(cvec<sizer.eq>::Constant(eq(), -inf));
+            u.middleRows(offset, eq()) = hasEq ? cvec<sizer.eq>(-ceq) : cvec<sizer.eq>(cvec<sizer.eq>::Constant(eq(), inf));
+
+            offset += eq();
+            l.middleRows(offset, numVars()) = lb - x;
+            u.middleRows(offset, numVars()) = ub - x;
+        }
+
+        /**
+         * @brief Get the number of variables of the sub-problem
+         *
+         * @return int number of variables
+         */
+        int numVars()
+        {
+            return (ph() * nx()) + (nu() * ch()) + 1;
+        }
+
+        /**
+         * @brief Get the number of constraints of the sub-problem
+         *
+         * @return int number of constraints
+         */
+        int numConstraints()
+        {
+            return (ph() * nx()) + ineq() + eq() + numVars();
+        }
+
+        // objective_matrix is P (upper triangular)
+        smat P;
+        // objective_vector is q
+        cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> q;
+        // constraint_matrix is A
+        smat A;
+        // lower_bounds is l and upper_bounds is u
+        cvec<((sizer.ph * sizer.nx) + sizer.ineq + sizer.eq + ((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1))> l, u;
+
+    private:
+        std::shared_ptr<Mapping<sizer>> mapping;
+
+        bool hasPattern = false;
+        bool blockingPattern = true;
+        bool hasIneq = false;
+        bool hasEq = false;
+    };
+} // namespace mpc
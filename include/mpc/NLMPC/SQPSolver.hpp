@@ -0,0 +1,941 @@
+/*
+ *   Copyright (c) 2023 Nicola Piccinelli
+ *   All rights reserved.
+ */
+#pragma once
+
+#include <mpc/IComponent.hpp>
+#include <mpc/Logger.hpp>
+#include <mpc/NLMPC/Constraints.hpp>
+#include <mpc/NLMPC/Mapping.hpp>
+#include <mpc/NLMPC/Objective.hpp>
+#include <mpc/NLMPC/SQPProblemBuilder.hpp>
+#include <mpc/Types.hpp>
+
+#include <osqp/osqp.h>
+
+namespace mpc
+{
+    /**
+     * @brief Sequential quadratic programming solver for the non-linear mpc.
+     * The iteration is split in a preparation phase, where the problem is
+     * linearized around the current guess and the quadratic sub-problem is
+     * factorized, and in a feedback phase, where the measured initial
+     * condition is embedded in the sub-problem and the step is computed.
+     * The OSQP workspace is kept alive across the iterations and only the
+     * values of the sub-problem are updated. Optionally the hessian of the
+     * sub-problem is a block-diagonal quasi-Newton approximation of the
+     * Lagrangian hessian (one block for the states and one for the inputs of
+     * each stage) updated between the iterations of a control step, the blocks
+     * are then shifted together with the optimization vector and kept across
+     * the control steps. The multipliers of the last sub-problem are used to warm
+     * start the next one, between the control steps the multipliers of the
+     * system's dynamics and of the bounds are shifted by one stage. In the linear
+     * time-varying mode the linearization point is a trajectory consistent with
+     * the measured initial condition, so the correction of the feedback phase and
+     * the quasi-Newton approximation are not used.
+     *
+     * @tparam sizer.nx dimension of the state space
+     * @tparam sizer.nu dimension of the input space
+     * @tparam sizer.ny dimension of the output space
+     * @tparam sizer.ph length of the prediction horizon
+     * @tparam sizer.ch length of the control horizon
+     * @tparam sizer.ineq number of the user inequality constraints
+     * @tparam sizer.eq number of the user equality constraints
+     */
+    template <MPCSize sizer>
+    class SQPSolver : public IComponent<sizer>
+    {
+    private:
+        using IComponent<sizer>::checkOrQuit;
+        using IDimensionable<sizer>::nu;
+        using IDimensionable<sizer>::nx;
+        using IDimensionable<sizer>::ndu;
+        using IDimensionable<sizer>::ny;
+        using IDimensionable<sizer>::ph;
+        using IDimensionable<sizer>::ch;
+        using IDimensionable<sizer>::ineq;
+        using IDimensionable<sizer>::eq;
+
+    public:
+        SQPSolver() = default;
+
+        ~SQPSolver()
+        {
+            clearWorkspace();
+        }
+
+        /**
+         * @brief Initialization hook override. Performing initialization in this
+         * method ensures the correct problem dimensions assigment has been
+         * already performed
+         */
+        void onInit() override
+        {
+            clearWorkspace();
+
+            builder = std::make_shared<SQPProblemBuilder<sizer>>();
+            builder->initialize(nx(), nu(), ndu(), ny(), ph(), ch(), ineq(), eq());
+
+            COND_RESIZE_CVEC(sizer, x_lin, ((ph() * nx()) + (nu() * ch()) + 1));
+            COND_RESIZE_CVEC(sizer, x0_lin, nx());
+            COND_RESIZE_CVEC(sizer, cstate, (ph() * nx()));
+            COND_RESIZE_CVEC(sizer, cineq, ineq());
+            COND_RESIZE_CVEC(sizer, ceq, eq());
+            COND_RESIZE_MAT(sizer, Jx0, (ph() * nx()), nx());
+            COND_RESIZE_CVEC(sizer, qn_point, ((ph() * nx()) + (nu() * ch()) + 1));
+            COND_RESIZE_CVEC(sizer, qn_x0, nx());
+
+            x_lin.setZero();
+            x0_lin.setZero();
+            cstate.setZero();
+            cineq.setZero();
+            ceq.setZero();
+            Jx0.setZero();
+
+            dual_prev.clear();
+            is_prepared = false;
+            step_norm = inf;
+
+            resetQuasiNewton();
+        }
+
+        /**
+         * @brief Set the model and the mapping object references
+         *
+         * @param sysModel the model object
+         * @param map the mapping object
+         */
+        void setModel(std::shared_ptr<Model<sizer>> sysModel, std::shared_ptr<Mapping<sizer>> map)
+        {
+            checkOrQuit();
+
+            model = sysModel;
+            mapping = map;
+            builder->setMapping(map);
+        }
+
+        /**
+         * @brief Set the Cost And Constraints object
+         *
+         * @param objFunc
+         * @param conFunc
+         */
+        void setCostAndConstraints(
+            std::shared_ptr<Objective<sizer>> objFunc,
+            std::shared_ptr<Constraints<sizer>> conFunc)
+        {
+            checkOrQuit();
+
+            this->objFunc = objFunc;
+            this->conFunc = conFunc;
+        }
+
+        /**
+         * @brief Set the quadratic sub-problems solver parameters
+         *
+         * @param param parameters desired
+         */
+        void setParameters(const NLParameters &param)
+        {
+            checkOrQuit();
+
+            qp_tolerance = param.sqp_qp_tolerance;
+            qp_maximum_iteration = param.sqp_qp_maximum_iteration;
+            qp_time_limit = param.time_limit;
+            dual_warm_start = param.enable_dual_warm_start;
+            linear_time_varying = param.backend == NLBackend::LTV;
+
+            // the linear time-varying mode keeps the diagonal hessian approximation
+            bool useQuasiNewton = param.sqp_quasi_newton && !linear_time_varying;
+            if (quasi_newton != useQuasiNewton)
+            {
+                quasi_newton = useQuasiNewton;
+                resetQuasiNewton();
+            }
+
+            if (work)
+            {
+                osqp_update_eps_abs(work, qp_tolerance);
+                osqp_update_eps_rel(work, qp_tolerance);
+                osqp_update_max_iter(work, qp_maximum_iteration);
+            }
+        }
+
+        /**
+         * @brief Preparation phase: linearize the problem around the given
+         * optimization vector and the predicted initial condition and update
+         * the quadratic sub-problem (including its factorization)
+         *
+         * @param x optimization vector used as linearization point
+         * @param x0 predicted system's initial condition
+         * @param lb optimization vector lower bounds
+         * @param ub optimization vector upper bounds
+         * @param shifted the linearization point is the last one shifted by one stage
+         * @return true
+         * @return false
+         */
+        bool prepare(
+            const cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> &x,
+            const cvec<sizer.nx> &x0,
+            const cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> &lb,
+            const cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> &ub,
+            bool shifted = false)
+        {
+            checkOrQuit();
+
+            bool hasIneq = conFunc->hasIneqConstraints() && ineq() > 0;
+            bool hasEq = conFunc->hasEqConstraints() && eq() > 0;
+
+            bool patternChanged = !builder->isPatternValid(hasIneq, hasEq);
+            if (patternChanged)
+            {
+                builder->buildPattern(hasIneq, hasEq);
+                // the values of the previous linearization are lost
+                qn_has_point = false;
+            }
+
+            x_lin = x;
+            x0_lin = x0;
+
+            patternChanged = linearize(hasIneq, hasEq, shifted) || patternChanged;
+
+            builder->setConstraintsValue(cstate, cineq, ceq, x_lin, lb, ub);
+            clampBounds();
+
+            if (patternChanged || !work)
+            {
+                if (!setupWorkspace())
+                {
+                    is_prepared = false;
+                    return false;
+                }
+            }
+            else
+            {
+                c_int exitflag = osqp_update_P_A(
+                    work,
+                    builder->P.valuePtr(), OSQP_NULL, builder->P.nonZeros(),
+                    builder->A.valuePtr(), OSQP_NULL, builder->A.nonZeros());
+                exitflag |= osqp_update_lin_cost(work, builder->q.data());
+
+                if (exitflag != 0)
+                {
+                    Logger::instance().log(Logger::log_type::ERROR)
+                        << "Unable to update the SQP sub-problem " << exitflag << std::endl;
+                    is_prepared = false;
+                    return false;
+                }
+            }
+
+            // multipliers used to warm start the sub-problem
+            if (shifted)
+            {
+                if (dual_warm_start)
+                {
+                    shiftDuals();
+                }
+                else
+                {
+                    dual_prev.clear();
+                }
+            }
+
+            if (has_dual_guess)
+            {
+                applyDualGuess();
+            }
+
+            is_prepared = true;
+            return true;
+        }
+
+        /**
+         * @brief Feedback phase: embed the measured initial condition in the
+         * prepared sub-problem and compute the new optimization vector
+         *
+         * @param x0 measured system's initial condition
+         * @param lb optimization vector lower bounds
+         * @param ub optimization vector upper bounds
+         * @param x resulting optimization vector
+         * @return true if the step has been applied
+         * @return false
+         */
+        bool feedback(
+            const cvec<sizer.nx> &x0,
+            const cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> &lb,
+            const cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> &ub,
+            cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> &x)
+        {
+            checkOrQuit();
+
+            if (!is_prepared)
+            {
+                Logger::instance().log(Logger::log_type::ERROR)
+                    << "SQP feedback requested without a prepared sub-problem" << std::endl;
+                solver_status = OSQP_UNSOLVED;
+                return false;
+            }
+
+            is_prepared = false;
+
+            // first order correction of the system's dynamics due to
+            // the difference between the predicted and the measured state
+            cvec<(sizer.ph * sizer.nx)> cstate_fb;
+            cstate_fb = cstate + (Jx0 * (x0 - x0_lin));
+
+            builder->setConstraintsValue(cstate_fb, cineq, ceq, x_lin, lb, ub);
+            clampBounds();
+
+            c_int exitflag = osqp_update_bounds(work, builder->l.data(), builder->u.data());
+            if (exitflag != 0)
+            {
+                Logger::instance().log(Logger::log_type::ERROR)
+                    << "Unable to update the SQP sub-problem bounds " << exitflag << std::endl;
+                solver_status = OSQP_UNSOLVED;
+                return false;
+            }
+
+            // the step is expected to be small while the multipliers
+            // are close to the ones of the previous sub-problem
+            if (dual_prev.size() == (size_t)builder->numConstraints())
+            {
+                std::vector<double> primal_guess(builder->numVars(), 0.0);
+                osqp_warm_start(work, primal_guess.data(), dual_prev.data());
+            }
+
+            exitflag = osqp_solve(work);
+            solver_status = work->info->status_val;
+            qp_iterations = work->info->iter;
+
+            Logger::instance().log(Logger::log_type::DETAIL)
+                << "SQP sub-problem solved in "
+                << qp_iterations
+                << " iterations with status: "
+                << work->info->status
+                << std::endl;
+
+            bool accepted = exitflag == 0 &&
+                            (solver_status == OSQP_SOLVED ||
+                             solver_status == OSQP_SOLVED_INACCURATE ||
+                             solver_status == OSQP_MAX_ITER_REACHED);
+
+            if (!accepted)
+            {
+                return false;
+            }
+
+            auto step = Eigen::Map<cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)>>(
+                work->solution->x, builder->numVars());
+
+            x = x_lin + step;
+            step_norm = step.template lpNorm<Eigen::Infinity>();
+
+            dual_prev.assign(work->solution->y, work->solution->y + builder->numConstraints());
+
+            return true;
+        }
+
+        /**
+         * @brief Check if the sub-problem has been prepared and it is waiting
+         * for the feedback phase
+         *
+         * @return true
+         * @return false
+         */
+        bool isPrepared() const
+        {
+            return is_prepared;
+        }
+
+        /**
+         * @brief Get the status code of the last quadratic sub-problem
+         *
+         * @return int OSQP status code
+         */
+        int solverStatus() const
+        {
+            return solver_status;
+        }
+
+        /**
+         * @brief Get the infinity norm of the last step of the optimization vector
+         *
+         * @return double norm of the step
+         */
+        double stepNorm() const
+        {
+            return step_norm;
+        }
+
+        /**
+         * @brief Get the number of iterations of the last quadratic sub-problem
+         *
+         * @return int number of iterations
+         */
+        int subproblemIterations() const
+        {
+            return qp_iterations;
+        }
+
+        /**
+         * @brief Get the multipliers of the constraints of the last sub-problem in the order
+         * system's dynamics, user inequality and user equality constraints
+         *
+         * @return cvec<((sizer.ph * sizer.nx) + sizer.ineq + sizer.eq)> multipliers
+         */
+        cvec<((sizer.ph * sizer.nx) + sizer.ineq + sizer.eq)> dualMultipliers()
+        {
+            checkOrQuit();
+
+            cvec<((sizer.ph * sizer.nx) + sizer.ineq + sizer.eq)> y;
+            COND_RESIZE_CVEC(sizer, y, ((ph() * nx()) + ineq() + eq()));
+            y.setZero();
+
+            if (dual_prev.size() == (size_t)builder->numConstraints())
+            {
+                y = Eigen::Map<cvec<((sizer.ph * sizer.nx) + sizer.ineq + sizer.eq)>>(dual_prev.data(), y.size());
+            }
+
+            return y;
+        }
+
+        /**
+         * @brief Set the multipliers of the constraints used to warm start the next
+         * sub-problem, they replace the ones of the last sub-problem
+         *
+         * @param guess multipliers in the order system's dynamics, user inequality and
+         * user equality constraints
+         */
+        void setDualMultipliers(const cvec<((sizer.ph * sizer.nx) + sizer.ineq + sizer.eq)> &guess)
+        {
+            checkOrQuit();
+
+            dual_guess = guess;
+            has_dual_guess = true;
+        }
+
+        /**
+         * @brief Discard the state carried over between the control steps: the quasi-Newton
+         * blocks, the multipliers of the last sub-problem and the prepared sub-problem
+         * (e.g. when the scaling of the optimization vector changes)
+         */
+        void resetWarmStart()
+        {
+            checkOrQuit();
+
+            resetQuasiNewton();
+            dual_prev.clear();
+            is_prepared = false;
+        }
+
+        /**
+         * @brief Converts the status of the quadratic sub-problem to the corresponding ResultStatus enum value.
+         *
+         * @param status The OSQP status value to convert.
+         * @return The corresponding ResultStatus enum value.
+         *
+         * @see ResultStatus
+         */
+        static ResultStatus convertToResultStatus(int status)
+        {
+            switch (status)
+            {
+            case OSQP_SOLVED:
+                return ResultStatus::SUCCESS;
+            case OSQP_MAX_ITER_REACHED:
+                return ResultStatus::MAX_ITERATION;
+            case OSQP_PRIMAL_INFEASIBLE:
+            case OSQP_DUAL_INFEASIBLE:
+            case OSQP_PRIMAL_INFEASIBLE_INACCURATE:
+            case OSQP_DUAL_INFEASIBLE_INACCURATE:
+                return ResultStatus::INFEASIBLE;
+            case OSQP_SOLVED_INACCURATE:
+                return ResultStatus::SUCCESS;
+            case OSQP_SIGINT:
+            case OSQP_TIME_LIMIT_REACHED:
+            case OSQP_NON_CVX:
+                return ResultStatus::ERROR;
+            case OSQP_UNSOLVED:
+                return ResultStatus::UNKNOWN;
+            default:
+                return ResultStatus::UNKNOWN;
+            }
+        }
+
+    private:
+        /**
+         * @brief Shift the multipliers of the system's dynamics and of the bounds by
+         * one stage, the multipliers of the user constraints are kept since their
+         * dependency on the stages is not known
+         */
+        void shiftDuals()
+        {
+            if (dual_prev.size() != (size_t)builder->numConstraints())
+            {
+                return;
+            }
+
+            for (size_t i = 0; i + 1 < ph(); i++)
+            {
+                std::copy_n(&dual_prev[(i + 1) * nx()], nx(), &dual_prev[i * nx()]);
+            }
+
+            int boxOffset = (ph() * nx()) + ineq() + eq();
+
+            cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> ybox;
+            ybox = Eigen::Map<cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)>>(
+                &dual_prev[boxOffset], builder->numVars());
+            mapping->shiftVector(ybox);
+            std::copy_n(ybox.data(), ybox.size(), &dual_prev[boxOffset]);
+        }
+
+        /**
+         * @brief Replace the multipliers of the constraints with the ones provided by
+         * the user, the multipliers of the bounds are kept if available
+         */
+        void applyDualGuess()
+        {
+            if (dual_prev.size() != (size_t)builder->numConstraints())
+            {
+                dual_prev.assign(builder->numConstraints(), 0.0);
+            }
+
+            std::copy_n(dual_guess.data(), dual_guess.size(), dual_prev.begin());
+            has_dual_guess = false;
+        }
+
+        /**
+         * @brief Evaluate the objective function gradient and curvature, the
+         * constraints value and Jacobian matrices at the linearization point
+         *
+         * @param hasIneq the user inequality constraints are defined
+         * @param hasEq the user equality constraints are defined
+         * @param shifted the linearization point is the last one shifted by one stage
+         * @return true if the hessian sparsity pattern has been extended
+         * @return false
+         */
+        bool linearize(bool hasIneq, bool hasEq, bool shifted)
+        {
+            objFunc->setCurrentState(x0_lin);
+            conFunc->setCurrentState(x0_lin);
+
+            bool hessianChanged = false;
+            typename Objective<sizer>::Cost obj;
+
+            // the curvature pairs are collected only between the iterations of the same
+            // problem (the initial condition changes the problem), the gradient of the Lagrangian
+            // at the last linearization point is evaluated before the sub-problem is
+            // overwritten using the last multipliers estimate
+            bool useQuasiNewton = quasi_newton && !objFunc->hasResidual();
+            bool hasPair = useQuasiNewton && qn_has_point && !shifted &&
+                           x0_lin == qn_x0 &&
+                           dual_prev.size() == (size_t)builder->numConstraints();
+
+            cvec<> lambda;
+            cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> lagrangianPrev;
+            if (hasPair)
+            {
+                // the multipliers of the box constraints are not included since
+                // their contribution does not depend on the linearization point
+                lambda = Eigen::Map<cvec<>>(dual_prev.data(), dual_prev.size());
+                lambda.tail(builder->numVars()).setZero();
+
+                lagrangianPrev = lagrangianGradient(lambda);
+            }
+
+            if (objFunc->hasResidual())
+            {
+                // objective function in residual form, the Gauss-Newton hessian
+                // is regularized to keep the sub-problem strictly convex
+                mat<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1), ((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> hessian;
+                obj = objFunc->evaluateGaussNewton(x_lin, hessian);
+                hessian.diagonal().array() += hessian_regularization;
+                hessianChanged = builder->setHessian(hessian);
+            }
+            else if (useQuasiNewton)
+            {
+                // the quasi-Newton approximation is updated once the Jacobians at
+                // the new linearization point are available
+                obj = objFunc->evaluate(x_lin, true);
+                if (!qn_initialized)
+                {
+                    initializeQuasiNewton(
+                        objFunc->evaluateHessianDiagonal(x_lin, obj.value).cwiseMax(hessian_regularization));
+                }
+            }
+            else
+            {
+                // the hessian is approximated by the diagonal of the objective function
+                // hessian (second order central differences), negative or null curvature
+                // is replaced by a small regularization to keep the sub-problem convex
+                obj = objFunc->evaluate(x_lin, true);
+                builder->setHessianDiagonal(
+                    objFunc->evaluateHessianDiagonal(x_lin, obj.value).cwiseMax(hessian_regularization));
+            }
+
+            builder->setGradient(obj.grad);
+
+            // system's dynamics constraints
+            auto cs = conFunc->evaluateStateModelEq(x_lin, true);
+            cstate = cs.value;
+
+            mat<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1), (sizer.ph * sizer.nx)> JstateT;
+            JstateT = Eigen::Map<mat<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1), (sizer.ph * sizer.nx)>>(
+                cs.grad.data(), builder->numVars(), (ph() * nx()));
+
+            // user defined constraints
+            mat<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1), sizer.ineq> JineqT;
+            COND_RESIZE_MAT(sizer, JineqT, builder->numVars(), ineq());
+            JineqT.setZero();
+            cineq.setZero();
+            // skip the evaluation when the user constraints are statically empty
+            if constexpr (sizer.ineq.value != 0)
+            {
+                if (hasIneq)
+                {
+                    auto ci = conFunc->evaluateIneq(x_lin, true);
+                    cineq = ci.value;
+                    JineqT = Eigen::Map<mat<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1), sizer.ineq>>(
+                        ci.grad.data(), builder->numVars(), ineq());
+                }
+            }
+
+            mat<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1), sizer.eq> JeqT;
+            COND_RESIZE_MAT(sizer, JeqT, builder->numVars(), eq());
+            JeqT.setZero();
+            ceq.setZero();
+            if constexpr (sizer.eq.value != 0)
+            {
+                if (hasEq)
+                {
+                    auto ce = conFunc->evaluateEq(x_lin, true);
+                    ceq = ce.value;
+                    JeqT = Eigen::Map<mat<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1), sizer.eq>>(
+                        ce.grad.data(), builder->numVars(), eq());
+                }
+            }
+
+            builder->setJacobian(JstateT, JineqT, JeqT);
+
+            if (useQuasiNewton)
+            {
+                if (shifted)
+                {
+                    shiftQuasiNewton();
+                }
+
+                if (hasPair)
+                {
+                    updateQuasiNewton(x_lin - qn_point, lagrangianGradient(lambda) - lagrangianPrev);
+                }
+
+                hessianChanged = builder->setHessian(assembleQuasiNewton());
+
+                qn_point = x_lin;
+                qn_x0 = x0_lin;
+                qn_has_point = true;
+            }
+
+            // in the linear time-varying mode the linearization point is consistent
+            // with the measured initial condition and no correction is needed
+            if (linear_time_varying)
+            {
+                Jx0.setZero();
+                return hessianChanged;
+            }
+
+            // sensitivity of the system's dynamics with respect to the initial
+            // condition, used in the feedback phase to correct the prediction
+            cvec<sizer.nx> x0p;
+            x0p = x0_lin;
+            for (size_t j = 0; j < nx(); j++)
+            {
+                double h = dv * std::max(1.0, std::fabs(x0_lin(j)));
+                x0p(j) = x0_lin(j) + h;
+                conFunc->setCurrentState(x0p);
+                Jx0.col(j) = (conFunc->evaluateStateModelEq(x_lin, false).value - cstate) / h;
+                x0p(j) = x0_lin(j);
+            }
+
+            conFunc->setCurrentState(x0_lin);
+
+            return hessianChanged;
+        }
+
+        /**
+         * @brief Compute the gradient of the Lagrangian of the problem from the
+         * gradient and the Jacobian matrices currently stored in the sub-problem
+         *
+         * @param lambda multipliers of the sub-problem constraints
+         * @return cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> gradient of the Lagrangian
+         */
+        cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> lagrangianGradient(const cvec<> &lambda)
+        {
+            return builder->q + (builder->A.transpose() * lambda);
+        }
+
+        /**
+         * @brief Discard the quasi-Newton approximation, it will be initialized
+         * again at the next linearization
+         */
+        void resetQuasiNewton()
+        {
+            qn_blocks.clear();
+            qn_initialized = false;
+            qn_has_point = false;
+        }
+
+        /**
+         * @brief Initialize the quasi-Newton blocks from a diagonal approximation
+         * of the hessian. The blocks are ordered as the optimization vector: the
+         * states of each step of the prediction horizon, the inputs of each step of
+         * the control horizon and the slack variable
+         *
+         * @param hdiag diagonal of the hessian
+         */
+        void initializeQuasiNewton(const cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> &hdiag)
+        {
+            qn_blocks.clear();
+
+            int offset = 0;
+            for (size_t i = 0; i < ph(); i++)
+            {
+                qn_blocks.push_back(mat<>(hdiag.middleRows(offset, nx()).asDiagonal()));
+                offset += nx();
+            }
+
+            for (size_t i = 0; i < ch(); i++)
+            {
+                qn_blocks.push_back(mat<>(hdiag.middleRows(offset, nu()).asDiagonal()));
+                offset += nu();
+            }
+
+            qn_blocks.push_back(mat<>(hdiag.middleRows(offset, 1).asDiagonal()));
+
+            qn_shift_input = mapping->shiftableInputBlocks();
+
+            qn_initialized = true;
+        }
+
+        /**
+         * @brief Shift the quasi-Newton blocks by one stage, the blocks of the last
+         * stage of the horizons and the input blocks spanning more steps are kept
+         */
+        void shiftQuasiNewton()
+        {
+            for (size_t i = 0; i + 1 < ph(); i++)
+            {
+                qn_blocks[i] = qn_blocks[i + 1];
+            }
+
+            for (size_t i = 0; i + 1 < ch(); i++)
+            {
+                if (qn_shift_input[i])
+                {
+                    qn_blocks[ph() + i] = qn_blocks[ph() + i + 1];
+                }
+            }
+        }
+
+        /**
+         * @brief Update each quasi-Newton block with the damped BFGS formula, the
+         * damping keeps the blocks positive definite also when the curvature
+         * of the Lagrangian along the step is negative
+         *
+         * @param step difference of the linearization points
+         * @param grad difference of the Lagrangian gradients
+         */
+        void updateQuasiNewton(
+            const cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> &step,
+            const cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> &grad)
+        {
+            int offset = 0;
+            for (auto &B : qn_blocks)
+            {
+                cvec<> s = step.middleRows(offset, B.rows());
+                cvec<> y = grad.middleRows(offset, B.rows());
+                offset += B.rows();
+
+                cvec<> Bs = B * s;
+                double sBs = s.dot(Bs);
+                if (s.norm() < dv || sBs <= 0)
+                {
+                    continue;
+                }
+
+                double sy = s.dot(y);
+                double theta = sy >= 0.2 * sBs ? 1.0 : (0.8 * sBs) / (sBs - sy);
+
+                cvec<> r = (theta * y) + ((1.0 - theta) * Bs);
+                B += ((r * r.transpose()) / s.dot(r)) - ((Bs * Bs.transpose()) / sBs);
+            }
+        }
+
+        /**
+         * @brief Assemble the block-diagonal quasi-Newton hessian
+         *
+         * @return mat<...> hessian approximation
+         */
+        mat<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1), ((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> assembleQuasiNewton()
+        {
+            mat<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1), ((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> H;
+            COND_RESIZE_MAT(sizer, H, builder->numVars(), builder->numVars());
+            H.setZero();
+
+            int offset = 0;
+            for (auto &B : qn_blocks)
+            {
+                H.block(offset, offset, B.rows(), B.cols()) = B;
+                offset += B.rows();
+            }
+
+            return H;
+        }
+
+        /**
+         * @brief Saturate the sub-problem bounds to the OSQP infinity
+         */
+        void clampBounds()
+        {
+            builder->l = builder->l.cwiseMax(-OSQP_INFTY).cwiseMin(OSQP_INFTY);
+            builder->u = builder->u.cwiseMax(-OSQP_INFTY).cwiseMin(OSQP_INFTY);
+        }
+
+        /**
+         * @brief Create the OSQP workspace from the current sub-problem
+         *
+         * @return true
+         * @return false
+         */
+        bool setupWorkspace()
+        {
+            clearWorkspace();
+
+            OSQPSettings *settings = (OSQPSettings *)c_malloc(sizeof(OSQPSettings));
+            OSQPData *data = (OSQPData *)c_malloc(sizeof(OSQPData));
+
+            osqp_set_default_settings(settings);
+            settings->verbose = 0;
+            settings->polish = 1;
+            settings->warm_start = 1;
+            settings->eps_abs = qp_tolerance;
+            settings->eps_rel = qp_tolerance;
+            settings->max_iter = qp_maximum_iteration;
+            settings->time_limit = qp_time_limit;
+
+            data->n = builder->numVars();
+            data->m = builder->numConstraints();
+            data->P = createOsqpSparseMatrix(builder->P);
+            data->A = createOsqpSparseMatrix(builder->A);
+            data->q = builder->q.data();
+            data->l = builder->l.data();
+            data->u = builder->u.data();
+
+            c_int exitflag = osqp_setup(&work, data, settings);
+
+            // the workspace owns a copy of the problem data
+            csc_spfree(data->P);
+            csc_spfree(data->A);
+            c_free(data);
+            c_free(settings);
+
+            if (exitflag != 0)
+            {
+                Logger::instance().log(Logger::log_type::ERROR)
+                    << "Unable to setup the SQP sub-problem " << exitflag << std::endl;
+                work = nullptr;
+                return false;
+            }
+
+            dual_prev.clear();
+            return true;
+        }
+
+        /**
+         * @brief Release the OSQP workspace
+         */
+        void clearWorkspace()
+        {
+            if (work)
+            {
+                osqp_cleanup(work);
+                work = nullptr;
+            }
+        }
+
+        /**
+         * @brief Create an osqp sparse matrix from a compressed sparse eigen matrix
+         * (the explicit zeros of the pattern are preserved)
+         *
+         * @param eigenSparseMatrix eigen sparse matrix
+         * @return csc* osqp sparse matrix
+         */
+        static csc *createOsqpSparseMatrix(const smat &eigenSparseMatrix)
+        {
+            c_int rows = eigenSparseMatrix.rows();
+            c_int cols = eigenSparseMatrix.cols();
+            c_int numberOfNonZeroCoeff = eigenSparseMatrix.nonZeros();
+
+            csc *osqpSparseMatrix = csc_spalloc(rows, cols, numberOfNonZeroCoeff, 1, 0);
+
+            for (c_int k = 0; k <= cols; k++)
+            {
+                osqpSparseMatrix->p[k] = static_cast<c_int>(eigenSparseMatrix.outerIndexPtr()[k]);
+            }
+
+            for (c_int k = 0; k < numberOfNonZeroCoeff; k++)
+            {
+                osqpSparseMatrix->i[k] = static_cast<c_int>(eigenSparseMatrix.innerIndexPtr()[k]);
+                osqpSparseMatrix->x[k] = static_cast<c_float>(eigenSparseMatrix.valuePtr()[k]);
+            }
+
+            return osqpSparseMatrix;
+        }
+
+        std::shared_ptr<SQPProblemBuilder<sizer>> builder;
+
+        std::shared_ptr<Objective<sizer>> objFunc;
+        std::shared_ptr<Constraints<sizer>> conFunc;
+        std::shared_ptr<Mapping<sizer>> mapping;
+        std::shared_ptr<Model<sizer>> model;
+
+        OSQPWorkspace *work = nullptr;
+
+        // linearization point and constraints value
+        cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> x_lin;
+        cvec<sizer.nx> x0_lin;
+        cvec<(sizer.ph * sizer.nx)> cstate;
+        cvec<sizer.ineq> cineq;
+        cvec<sizer.eq> ceq;
+        mat<(sizer.ph * sizer.nx), sizer.nx> Jx0;
+
+        std::vector<double> dual_prev;
+
+        // quasi-Newton blocks and last linearization point
+        std::vector<mat<>> qn_blocks;
+        std::vector<bool> qn_shift_input;
+        cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> qn_point;
+        cvec<sizer.nx> qn_x0;
+        bool qn_initialized = false;
+        bool qn_has_point = false;
+
+        bool is_prepared = false;
+        int solver_status = OSQP_UNSOLVED;
+        int qp_iterations = 0;
+        double step_norm = inf;
+
+        double qp_tolerance = 1e-6;
+        int qp_maximum_iteration = 4000;
+        double qp_time_limit = 0;
+        bool quasi_newton = false;
+        bool dual_warm_start = true;
+        bool linear_time_varying = false;
+
+        cvec<((sizer.ph * sizer.nx) + sizer.ineq + sizer.eq)> dual_guess;
+        bool has_dual_guess = false;
+
+        const double dv = sqrt(std::numeric_limits<double>::epsilon());
+        const double hessian_regularization = 1e-6;
+    };
+} // namespace mpc
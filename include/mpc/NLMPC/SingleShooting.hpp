@@ -0,0 +1,430 @@
+/*
+ *   Copyright (c) 2023 Nicola Piccinelli
+ *   All rights reserved.
+ */
+#pragma once
+
+#include <mpc/NLMPC/Base.hpp>
+
+namespace mpc
+{
+    /**
+     * @brief Single shooting (condensed) transcription of the non-linear mpc.
+     * The reduced optimization vector contains only the control inputs and the
+     * slack variable, the states along the prediction horizon are computed by
+     * rolling the model forward from the initial condition. The states are
+     * placed in the full optimization vector so that the objective function and
+     * the constraints are evaluated as in the multiple shooting formulation
+     *
+     * @tparam sizer.nx dimension of the state space
+     * @tparam sizer.nu dimension of the input space
+     * @tparam Tny dimension of the output space
+     * @tparam Tph length of the prediction horizon
+     * @tparam Tch length of the control horizon
+     * @tparam Tineq number of the user inequality constraints
+     * @tparam Teq number of the user equality constraints
+     */
+    template <MPCSize sizer>
+    class SingleShooting : public Base<sizer>
+    {
+    private:
+        using IComponent<sizer>::checkOrQuit;
+        using IDimensionable<sizer>::nu;
+        using IDimensionable<sizer>::nx;
+        using IDimensionable<sizer>::ndu;
+        using IDimensionable<sizer>::ny;
+        using IDimensionable<sizer>::ph;
+        using IDimensionable<sizer>::ch;
+        using IDimensionable<sizer>::ineq;
+        using IDimensionable<sizer>::eq;
+
+        using Base<sizer>::mapping;
+        using Base<sizer>::model;
+        using Base<sizer>::x0;
+        using Base<sizer>::Xmat;
+        using Base<sizer>::Umat;
+        using Base<sizer>::e;
+
+    public:
+        SingleShooting() = default;
+        ~SingleShooting() = default;
+
+        /**
+         * @brief Initialization hook override used to perform the
+         * initialization procedure. Performing initialization in this
+         * method ensures the correct problem dimensions assigment has been
+         * already performed.
+         */
+        void onInit() override
+        {
+            COND_RESIZE_CVEC(sizer, x0, nx());
+            COND_RESIZE_MAT(sizer, Xmat, (ph() + 1), nx());
+            COND_RESIZE_MAT(sizer, Umat, (ph() + 1), nu());
+
+            COND_RESIZE_CVEC(sizer, full, ((ph() * nx()) + (nu() * ch()) + 1));
+            COND_RESIZE_MAT(sizer, S, ((ph() * nx()) + (nu() * ch()) + 1), ((nu() * ch()) + 1));
+            COND_RESIZE_CVEC(sizer, z_last, ((nu() * ch()) + 1));
+            COND_RESIZE_CVEC(sizer, x0_last, nx());
+
+            x0.setZero();
+            full.setZero();
+            S.setZero();
+
+            has_value = false;
+            has_sensitivity = false;
+            converged = true;
+        }
+
+        /**
+         * @brief Roll the model forward along the prediction horizon and build
+         * the full optimization vector. The result of the last call is reused
+         * when the reduced vector and the initial condition did not change. When
+         * the implicit step of a continuous time model does not converge the
+         * rollout is flagged as failed (see SingleShooting::isConverged)
+         *
+         * @param z reduced optimization vector (control inputs and slack variable)
+         * @param hasGradient request the computation of the forward sensitivities
+         */
+        void expand(const cvec<((sizer.nu * sizer.ch) + 1)> &z, bool hasGradient)
+        {
+            checkOrQuit();
+
+            if (has_value && (has_sensitivity || !hasGradient) && z == z_last && x0 == x0_last)
+            {
+                return;
+            }
+
+            full.setZero();
+            full.bottomRows((nu() * ch()) + 1) = z;
+
+            // the first row of the state sequence and the input sequence
+            // are obtained as in the multiple shooting formulation
+            mapping->unwrapVector(full, x0, Xmat, Umat, e);
+
+            // sensitivity of the current state w.r.t. the control inputs
+            mat<sizer.nx, (sizer.nu * sizer.ch)> dx;
+            COND_RESIZE_MAT(sizer, dx, nx(), (nu() * ch()));
+            dx.setZero();
+
+            if (hasGradient)
+            {
+                S.setZero();
+                S.bottomRows((nu() * ch()) + 1).setIdentity();
+            }
+
+            mat<sizer.nx, sizer.nx> Sx;
+            Sx = mapping->StateInverseScaling().asDiagonal();
+
+            converged = true;
+            for (size_t i = 0; i < ph(); i++)
+            {
+                cvec<sizer.nx> xk;
+                xk = Xmat.row(i).transpose();
+
+                cvec<sizer.nu> uk;
+                uk = Umat.row(i).transpose();
+
+                cvec<sizer.nx> xk1;
+                COND_RESIZE_CVEC(sizer, xk1, nx());
+
+                mat<sizer.nx, sizer.nx> Ax;
+                COND_RESIZE_MAT(sizer, Ax, nx(), nx());
+
+                mat<sizer.nx, sizer.nu> Au;
+                COND_RESIZE_MAT(sizer, Au, nx(), nu());
+
+                if (!integrate(xk1, Ax, Au, xk, uk, i, hasGradient) && converged)
+                {
+                    converged = false;
+                    Logger::instance().log(Logger::log_type::DETAIL)
+                        << "Single shooting rollout not converged at the step "
+                        << i
+                        << std::endl;
+                }
+
+                Xmat.row(i + 1) = xk1.transpose();
+                full.middleRows(i * nx(), nx()) = xk1.cwiseProduct(mapping->StateInverseScaling());
+
+                if (hasGradient)
+                {
+                    // only the input blocks weighting the step move the input
+                    dx = Ax * dx;
+                    for (size_t j = 0; j < ch(); j++)
+                    {
+                        double w = mapping->inputWeight(i, j);
+                        if (w != 0)
+                        {
+                            dx.middleCols(j * nu(), nu()) += w * Au * mapping->InputScaling().asDiagonal();
+                        }
+                    }
+                    S.block(i * nx(), 0, nx(), nu() * ch()) = Sx * dx;
+                }
+            }
+
+            z_last = z;
+            x0_last = x0;
+            has_value = true;
+            has_sensitivity = hasGradient;
+
+            Logger::instance().log(Logger::log_type::DETAIL)
+                << "Single shooting predicted state vector\n"
+                << Xmat
+                << std::endl;
+        }
+
+        /**
+         * @brief Return if the implicit steps of the last expansion converged, the
+         * predicted states of a failed rollout do not satisfy the system's dynamics
+         *
+         * @return true
+         * @return false
+         */
+        bool isConverged() const
+        {
+            return converged;
+        }
+
+        /**
+         * @brief Get the full optimization vector computed by the last expansion
+         *
+         * @return const cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)>& full optimization vector
+         */
+        const cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> &fullVector() const
+        {
+            return full;
+        }
+
+        /**
+         * @brief Get the derivative of the full optimization vector w.r.t. the
+         * reduced one computed by the last expansion
+         *
+         * @return const mat<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1), ((sizer.nu * sizer.ch) + 1)>& sensitivity matrix
+         */
+        const mat<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1), ((sizer.nu * sizer.ch) + 1)> &sensitivity() const
+        {
+            return S;
+        }
+
+        /**
+         * @brief Extract the reduced optimization vector from the full one
+         *
+         * @param x full optimization vector
+         * @return cvec<((sizer.nu * sizer.ch) + 1)> reduced optimization vector
+         */
+        cvec<((sizer.nu * sizer.ch) + 1)> reduce(const cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> &x)
+        {
+            return x.bottomRows((nu() * ch()) + 1);
+        }
+
+    private:
+        /**
+         * @brief Propagate the state over a single step of the prediction horizon.
+         * Continuous time models are integrated with the same method used by the
+         * multiple shooting equality constraints, the implicit step of the trapezoidal
+         * rule is solved with Newton iterations
+         *
+         * @param xk1 state at the next step
+         * @param Ax derivative of the next state w.r.t. the current state
+         * @param Au derivative of the next state w.r.t. the current input
+         * @param xk current state
+         * @param uk current input
+         * @param p index of the step along the prediction horizon
+         * @param hasGradient request the computation of the derivatives
+         * @return true if the implicit step or the integrator converged (always for the explicit steps)
+         */
+        bool integrate(
+            cvec<sizer.nx> &xk1,
+            mat<sizer.nx, sizer.nx> &Ax,
+            mat<sizer.nx, sizer.nu> &Au,
+            const cvec<sizer.nx> &xk,
+            const cvec<sizer.nu> &uk,
+            unsigned int p,
+            bool hasGradient)
+        {
+            if (!model->isContinuousTime)
+            {
+                model->transition(xk1, xk, uk, p);
+
+                if (hasGradient)
+                {
+                    linearize(Ax, Au, xk, uk, p);
+                }
+
+                return true;
+            }
+
+            // the integrated continuous time model is a discrete time transition
+            // whose sensitivities are provided by the integrator
+            if (model->isIntegrated())
+            {
+                // batch of a single point, the buffers are reused along the rollout
+                Xk.resize(nx(), 1);
+                Fk.resize(nx(), 1);
+                Uk.resize(nu(), 1);
+                pk.resize(1);
+
+                Xk.col(0) = xk;
+                Uk.col(0) = uk;
+                pk[0] = p;
+
+                model->transitionBatch(Fk, Xk, Uk, pk, model_ws);
+                xk1 = Fk.col(0);
+
+                if (hasGradient)
+                {
+                    model->transitionJacobians(Jxk, Jmvk, Xk, Uk, pk, model_ws);
+
+                    Ax = Jxk;
+                    Au = Jmvk;
+
+                    if (!Ax.allFinite() || !Au.allFinite())
+                    {
+                        return false;
+                    }
+                }
+
+                // a failed point of the integrator returns a non-finite end state
+                return xk1.allFinite();
+            }
+
+            double h = model->sampleTime / 2.0;
+
+            mat<sizer.nx, sizer.nx> Ix;
+            COND_RESIZE_MAT(sizer, Ix, nx(), nx());
+            Ix.setIdentity();
+
+            cvec<sizer.nx> fk, fk1;
+            COND_RESIZE_CVEC(sizer, fk, nx());
+            COND_RESIZE_CVEC(sizer, fk1, nx());
+
+            mat<sizer.nx, sizer.nx> A1;
+            COND_RESIZE_MAT(sizer, A1, nx(), nx());
+
+            mat<sizer.nx, sizer.nu> B1;
+            COND_RESIZE_MAT(sizer, B1, nx(), nu());
+
+            model->vectorField(fk, xk, uk, p);
+
+            // explicit euler step as initial guess of the implicit step
+            xk1 = xk + (2.0 * h * fk);
+
+            // the residual is checked also after the last update
+            bool stepConverged = false;
+            for (int it = 0; it <= newton_iterations; it++)
+            {
+                model->vectorField(fk1, xk1, uk, p);
+
+                cvec<sizer.nx> g;
+                g = xk + (h * (fk + fk1)) - xk1;
+
+                if (g.allFinite() && g.norm() <= newton_tolerance * (1.0 + xk1.norm()))
+                {
+                    stepConverged = true;
+                    break;
+                }
+
+                if (it == newton_iterations)
+                {
+                    break;
+                }
+
+                linearize(A1, B1, xk1, uk, p);
+                xk1 = xk1 + (Ix - (h * A1)).partialPivLu().solve(g);
+            }
+
+            if (hasGradient)
+            {
+                mat<sizer.nx, sizer.nx> A0;
+                COND_RESIZE_MAT(sizer, A0, nx(), nx());
+
+                mat<sizer.nx, sizer.nu> B0;
+                COND_RESIZE_MAT(sizer, B0, nx(), nu());
+
+                linearize(A0, B0, xk, uk, p);
+                linearize(A1, B1, xk1, uk, p);
+
+                // implicit function theorem applied to the trapezoidal rule
+                auto M = (Ix - (h * A1)).partialPivLu();
+                Ax = M.solve(Ix + (h * A0));
+                Au = M.solve(h * (B0 + B1));
+            }
+
+            return stepConverged;
+        }
+
+        /**
+         * @brief Compute the Jacobian matrices of the state update function (of the
+         * transition for the integrated models) using the central difference method
+         *
+         * @param Jx Jacobian w.r.t. the state
+         * @param Jmv Jacobian w.r.t. the input
+         * @param xk state linearization point
+         * @param uk input linearization point
+         * @param p index of the step along the prediction horizon
+         */
+        void linearize(
+            mat<sizer.nx, sizer.nx> &Jx,
+            mat<sizer.nx, sizer.nu> &Jmv,
+            const cvec<sizer.nx> &xk,
+            const cvec<sizer.nu> &uk,
+            unsigned int p)
+        {
+            cvec<sizer.nx> f_plus, f_minus;
+            COND_RESIZE_CVEC(sizer, f_plus, nx());
+            COND_RESIZE_CVEC(sizer, f_minus, nx());
+
+            cvec<sizer.nx> Xa = xk.cwiseAbs().cwiseMax(1.0);
+            for (size_t i = 0; i < nx(); i++)
+            {
+                double dx = dv * Xa(i);
+
+                cvec<sizer.nx> x_plus = xk;
+                cvec<sizer.nx> x_minus = xk;
+
+                x_plus(i) += dx;
+                x_minus(i) -= dx;
+
+                model->transition(f_plus, x_plus, uk, p);
+                model->transition(f_minus, x_minus, uk, p);
+
+                Jx.col(i) = (f_plus - f_minus) / (2 * dx);
+            }
+
+            cvec<sizer.nu> Ua = uk.cwiseAbs().cwiseMax(1.0);
+            for (size_t i = 0; i < nu(); i++)
+            {
+                double du = dv * Ua(i);
+
+                cvec<sizer.nu> u_plus = uk;
+                cvec<sizer.nu> u_minus = uk;
+
+                u_plus(i) += du;
+                u_minus(i) -= du;
+
+                model->transition(f_plus, xk, u_plus, p);
+                model->transition(f_minus, xk, u_minus, p);
+
+                Jmv.col(i) = (f_plus - f_minus) / (2 * du);
+            }
+        }
+
+        cvec<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1)> full;
+        mat<((sizer.ph * sizer.nx) + (sizer.nu * sizer.ch) + 1), ((sizer.nu * sizer.ch) + 1)> S;
+
+        // single point batch of the integrated model and the work buffers of the integrators
+        mat<sizer.nx, Eigen::Dynamic> Xk, Fk, Jxk, Jmvk;
+        mat<sizer.nu, Eigen::Dynamic> Uk;
+        std::vector<unsigned int> pk;
+        typename Model<sizer>::Workspace model_ws;
+
+        cvec<((sizer.nu * sizer.ch) + 1)> z_last;
+        cvec<sizer.nx> x0_last;
+        bool has_value = false;
+        bool has_sensitivity = false;
+        bool converged = true;
+
+        const int newton_iterations = 20;
+        const double newton_tolerance = 1e-12;
+        const double dv = sqrt(std::numeric_limits<double>::epsilon());
+    };
+} // namespace mpc
@@ -73,6 +73,8 @@ namespace mpc
                 return "ERROR";
             case ResultStatus::UNKNOWN:
                 return "UNKNOWN";
+            case ResultStatus::TIME_LIMIT:
+                return "TIME_LIMIT";
             default:
                 return "INVALID";
             }
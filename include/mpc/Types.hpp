@@ -90,7 +90,9 @@ namespace mpc
         MAX_ITERATION,
         INFEASIBLE,
         ERROR,
-        UNKNOWN
+        UNKNOWN,
+        /// @brief The time limit stopped the optimization and the best feasible iterate is returned
+        TIME_LIMIT
     };
 
     /**
@@ -106,6 +108,7 @@ namespace mpc
         /// @brief Set the maximum number of iterations before stopping the optimization
         int maximum_iteration = 100;
         /// @brief Set the maximum time before stopping the optimization (in seconds)
+        // with the NLOPT backend the best feasible iterate found before the deadline is returned
         double time_limit = 0;
         /// @brief Enable the warm start of the optimization (enabling the warm start
         // can speed up the optimization process if the optimization variables
@@ -113,6 +116,138 @@ namespace mpc
         bool enable_warm_start = false;
     };
 
+    /**
+     * @brief Non-linear optimizer backend
+     */
+    enum class NLBackend
+    {
+        /// @brief Solve the optimal control problem to convergence using NLopt (SLSQP)
+        NLOPT,
+        /// @brief Perform a fixed number of sequential quadratic programming iterations
+        /// per control step (real-time iteration scheme) using OSQP
+        SQP,
+        /// @brief Solve the optimal control problem to convergence using the
+        /// structure-exploiting primal-dual interior point solver
+        IPM,
+        /// @brief Linearize the system's dynamics along the trajectory obtained by rolling the
+        /// model forward with the last optimal inputs and solve a single quadratic problem per
+        /// control step using OSQP (linear time-varying mpc)
+        LTV
+    };
+
+    /**
+     * @brief Transcription of the non-linear optimal control problem
+     */
+    enum class NLFormulation
+    {
+        /// @brief The states along the prediction horizon are optimization variables
+        /// bound to the system's dynamics by equality constraints
+        MULTIPLE_SHOOTING,
+        /// @brief Only the control inputs are optimization variables, the states are
+        /// computed by rolling the model forward from the initial condition
+        SINGLE_SHOOTING,
+        /// @brief Legendre-Gauss-Radau direct collocation of the continuous time system's
+        /// dynamics, the states at the collocation points inside each step of the horizon
+        /// are optimization variables too
+        COLLOCATION
+    };
+
+    /**
+     * @brief Algorithm of the NLopt backend of the non-linear mpc
+     */
+    enum class NLAlgorithm
+    {
+        /// @brief Sequential least-squares quadratic programming
+        SLSQP,
+        /// @brief Method of moving asymptotes, the equality constraints are handled by
+        /// the augmented lagrangian wrapping the algorithm
+        MMA,
+        /// @brief Conservative convex separable quadratic approximations, the equality
+        /// constraints are handled by the augmented lagrangian wrapping the algorithm
+        CCSAQ,
+        /// @brief Augmented lagrangian penalizing all the constraints, the sub-problems
+        /// are solved by the local algorithm
+        AUGLAG,
+        /// @brief Limited-memory BFGS, the algorithm does not support constraints and it
+        /// is always wrapped by the augmented lagrangian
+        LBFGS
+    };
+
+    /**
+     * @brief Update strategy of the constraints Jacobian matrices in the non-linear mpc
+     */
+    enum class NLJacobianUpdate
+    {
+        /// @brief Recompute the Jacobian matrices with finite differences at each request
+        FINITE_DIFFERENCE,
+        /// @brief Update the Jacobian matrices with rank-one Broyden updates, the finite
+        /// differences are recomputed periodically or when the step is large
+        BROYDEN
+    };
+
+    /**
+     * @brief Integration of the continuous time system's dynamics over each step of the
+     * prediction horizon in the non-linear mpc
+     */
+    enum class NLIntegrator
+    {
+        /// @brief Implicit trapezoidal rule, the defect of each step is imposed on the vector
+        /// field at both the ends of the step
+        TRAPEZOIDAL,
+        /// @brief Explicit Runge-Kutta of the 4th order with a fixed number of sub-steps
+        RK4,
+        /// @brief Embedded Runge-Kutta-Fehlberg 3(2) with an adaptive sub-step
+        RKF32,
+        /// @brief L-stable singly diagonally implicit Runge-Kutta of the 4th order with a fixed
+        /// number of sub-steps, suited for stiff systems
+        SDIRK
+    };
+
+    /**
+     * @brief Initialization of the optimization vector when no previous solution is used
+     */
+    enum class NLInitialization
+    {
+        /// @brief The states and the inputs are set to the initial condition along the whole horizon
+        CONSTANT,
+        /// @brief The states and the inputs are set to the solution of the problem linearized
+        /// around the initial condition (a single quadratic problem solved with OSQP)
+        LINEARIZED
+    };
+
+    /**
+     * @brief Scaling of the states and the inputs in the optimization vector of the
+     * non-linear mpc
+     */
+    enum class NLScaling
+    {
+        /// @brief The scaling set with setStateScale and setInputScale is used
+        MANUAL,
+        /// @brief The scaling is the largest finite magnitude of the bounds of each variable
+        BOUNDS,
+        /// @brief The scaling is the running magnitude of each variable along the recent optimal
+        /// sequences, the bounds are used until the first solution
+        TRAJECTORY
+    };
+
+    /**
+     * @brief Parameterization of the inputs along the prediction horizon in the non-linear mpc,
+     * each input is the combination of ch basis functions weighted by the input elements of the
+     * optimization vector
+     */
+    enum class NLInputBasis
+    {
+        /// @brief Piecewise constant inputs on the steps of the control horizon, the last value
+        /// is held until the end of the prediction horizon
+        BLOCKING,
+        /// @brief Discrete Laguerre functions with the selected pole, decaying along the horizon
+        LAGUERRE,
+        /// @brief Chebyshev polynomials of the first kind over the prediction horizon
+        CHEBYSHEV,
+        /// @brief Clamped B-splines of the selected degree with uniform or user-defined knots
+        BSPLINE
+    };
+
     /**
      * @brief Non-linear optimizer parameters
      * (SEE NLOPT DOCUMENTATION FOR MORE DETAILS)
@@ -136,6 +271,96 @@ namespace mpc
 
         /// @brief If enabled, the slack variable is constrained to be zero (forcing the inequality constraints to be hard constraints)
         bool hard_constraints = true;
+
+        /// @brief Backend used to solve the non-linear optimal control problem
+        NLBackend backend = NLBackend::NLOPT;
+        /// @brief Transcription of the optimal control problem (NLOPT backend only)
+        NLFormulation formulation = NLFormulation::MULTIPLE_SHOOTING;
+        /// @brief Algorithm of the NLopt solver (NLOPT backend only)
+        NLAlgorithm algorithm = NLAlgorithm::SLSQP;
+        /// @brief Local algorithm solving the sub-problems of the augmented lagrangian (NLOPT backend only)
+        NLAlgorithm auglag_local_algorithm = NLAlgorithm::LBFGS;
+
+        /// @brief Number of SQP iterations performed at each control step (SQP backend only),
+        // a single iteration corresponds to the real-time iteration scheme
+        int sqp_iterations = 1;
+        /// @brief Absolute and relative tolerance of the quadratic sub-problems (SQP backend only)
+        double sqp_qp_tolerance = 1e-6;
+        /// @brief Maximum number of iterations of the quadratic sub-problems solver (SQP backend only)
+        int sqp_qp_maximum_iteration = 4000;
+        /// @brief Infinity norm of the step below which the SQP iterations are stopped (SQP backend only)
+        // negative value means that the convergence check is disabled
+        double sqp_step_tolerance = -1;
+        /// @brief If enabled, the hessian of the sub-problems is a block-diagonal (one block per stage)
+        // quasi-Newton approximation kept across the control steps (SQP backend only)
+        bool sqp_quasi_newton = false;
+
+        /// @brief Tolerance on the scaled optimality conditions (IPM backend only)
+        double ipm_tolerance = 1e-6;
+        /// @brief Initial value of the barrier parameter (IPM backend only),
+        // with the warm start enabled the barrier restarts from the last solution one
+        double ipm_barrier_init = 0.1;
+
+        /// @brief If enabled together with the warm start, the constraints multipliers of the last solution
+        // are shifted by one stage and used to initialize the next one (SQP and IPM backends only)
+        bool enable_dual_warm_start = true;
+
+        /// @brief Update strategy of the system's dynamics and user constraints Jacobian matrices
+        NLJacobianUpdate jacobian_update = NLJacobianUpdate::FINITE_DIFFERENCE;
+        /// @brief Number of Broyden updates after which the Jacobian matrices are recomputed
+        // with finite differences (Broyden update only)
+        int jacobian_refresh_iterations = 10;
+        /// @brief Infinity norm of the step above which the Jacobian matrices are recomputed
+        // with finite differences (Broyden update only)
+        double jacobian_refresh_step = 0.1;
+
+        /// @brief Integration of the continuous time system's dynamics over each step of the horizon
+        NLIntegrator integrator = NLIntegrator::TRAPEZOIDAL;
+        /// @brief Number of sub-steps of each step of the horizon (RK4 and SDIRK integrators),
+        // or initial number of sub-steps of the adaptive step size (RKF32 integrator)
+        int integrator_steps = 1;
+        /// @brief Local error tolerance (absolute and relative) of the adaptive step size (RKF32 integrator),
+        // or of the Newton iterations of the implicit stages (SDIRK integrator)
+        double integrator_tolerance = 1e-8;
+        /// @brief Number of collocation points of each step of the horizon, the order of the collocation
+        // is 2 * collocation_points - 1 (COLLOCATION formulation). Only 1 to 3 points are supported,
+        // other values are rejected with an error and the current number of points is kept
+        int collocation_points = 3;
+
+        /// @brief Scaling of the states and the inputs in the optimization vector, the automatic
+        // scalings are rounded to powers of two
+        NLScaling scaling = NLScaling::MANUAL;
+        /// @brief Smoothing factor of the running magnitude of the variables (TRAJECTORY scaling)
+        double scaling_smoothing = 0.9;
+
+        /// @brief Parameterization of the inputs along the prediction horizon, the control horizon
+        // is the number of basis functions of each input
+        NLInputBasis input_basis = NLInputBasis::BLOCKING;
+        /// @brief Pole of the discrete Laguerre functions, in [0, 1) (LAGUERRE basis)
+        double laguerre_pole = 0.5;
+        /// @brief Degree of the B-splines, reduced to ch - 1 on shorter control horizons (BSPLINE basis)
+        int spline_degree = 3;
+        /// @brief Interior knots of the B-splines as increasing fractions of the prediction horizon in (0, 1),
+        // ch - spline_degree - 1 knots are expected, uniform knots are used when empty (BSPLINE basis)
+        std::vector<double> spline_knots;
+
+        /// @brief Initialization of the optimization vector at the first step or when the warm start
+        // is disabled (NLOPT and IPM backends only)
+        NLInitialization initialization = NLInitialization::CONSTANT;
+
+        /// @brief Number of starting points optimized in parallel threads at each control step
+        // (NLOPT backend with the multiple shooting formulation only)
+        int multistart = 1;
+        /// @brief Relative tolerance on the cost of the initial guess (the previous solution shifted
+        // forward with the warm start) within which the first converged and feasible solution stops
+        // the other starts, the early stop requires a feasible initial guess. A negative value means
+        // that all the starts are completed and the best feasible solution is selected
+        double multistart_cost_tolerance = 0;
+
+        /// @brief Evaluate the constraints and their Jacobian matrices in a team of two threads while
+        // the objective function and its gradient are computed (NLOPT backend with the multiple
+        // shooting formulation and a single start only)
+        bool concurrent_evaluation = false;
     };
 
     /**
@@ -167,7 +392,7 @@ namespace mpc
     template <int Tnu = Eigen::Dynamic>
     struct Result
     {
-        Result() : solver_status(0), cost(0), status(ResultStatus::UNKNOWN), solver_status_msg(""), is_feasible(false)
+        Result() : solver_status(0), cost(0), status(ResultStatus::UNKNOWN), solver_status_msg(""), is_feasible(false), iterations(0)
         {
             cmd.setZero();
         }
@@ -178,6 +403,9 @@ namespace mpc
         double cost;
         ResultStatus status;
         cvec<Tnu> cmd;
+        // number of iterations performed by the solver (SQP and IPM backends), number of
+        // objective function evaluations with the NLopt backend (single start only)
+        int iterations;
     };
 
     template <
@@ -16,6 +16,8 @@ void expose_NLMPC(py::module &m)
     std::string name = "NLMPC";
     using NLMPCType = mpc::NLMPC<Tnx, Tnu, Tny, Tph, Tch, Tineq, Teq>;
 
+    using ObjectiveFunc = std::function<double(const Eigen::MatrixXd &, const Eigen::MatrixXd &, const Eigen::MatrixXd &, const double &)>;
+
     using StateSpaceFunc = std::function<Eigen::VectorXd(const Eigen::VectorXd &, const Eigen::VectorXd &, const unsigned int &)>;
     auto stateSpaceFuncWrapper = [](NLMPCType &self, StateSpaceFunc impl, double tol)
     {
@@ -26,6 +28,16 @@ void expose_NLMPC(py::module &m)
         }, tol);
     };
 
+    using BatchStateSpaceFunc = std::function<Eigen::MatrixXd(const Eigen::MatrixXd &, const Eigen::MatrixXd &, const std::vector<unsigned int> &)>;
+    auto batchStateSpaceFuncWrapper = [](NLMPCType &self, BatchStateSpaceFunc impl, double tol)
+    {
+        return self.setBatchStateSpaceFunction([impl](Eigen::MatrixXd &F, const Eigen::MatrixXd &X, const Eigen::MatrixXd &U, const std::vector<unsigned int> &k)
+        {
+            // invoke the python function once for the whole batch
+            F = impl(X, U, k);
+        }, tol);
+    };
+
     using OutputFunc = StateSpaceFunc;
     auto outputFuncWrapper = [](NLMPCType &self, OutputFunc impl)
     {
@@ -36,6 +48,16 @@ void expose_NLMPC(py::module &m)
         });
     };
 
+    using ResidualFunc = std::function<Eigen::VectorXd(const Eigen::MatrixXd &, const Eigen::MatrixXd &, const Eigen::MatrixXd &, const double &)>;
+    auto residualFuncWrapper = [](NLMPCType &self, ResidualFunc impl, int nres)
+    {
+        return self.setResidualFunction([impl](Eigen::VectorXd &r, const Eigen::MatrixXd &x, const Eigen::MatrixXd &y, const Eigen::MatrixXd &u, const double &slack)
+        {
+            // invoke the python function and assign the result to reference value
+            r = impl(x, y, u, slack);
+        }, nres);
+    };
+
     using IneqConFunc = std::function<Eigen::VectorXd(const Eigen::MatrixXd &, const Eigen::MatrixXd &, const Eigen::MatrixXd &, const double &)>;
     auto ineqConFuncWrapper = [](NLMPCType &self, IneqConFunc impl, double tol)
     {
@@ -77,8 +99,10 @@ void expose_NLMPC(py::module &m)
         .def("setOutputBounds", py::overload_cast<const Eigen::MatrixXd &, const Eigen::MatrixXd &>(&NLMPCType::setOutputBounds))
         .def("setOutputBounds", py::overload_cast<const Eigen::VectorXd &, const Eigen::VectorXd &, const mpc::HorizonSlice &>(&NLMPCType::setOutputBounds))
         // methods from the NLMPC class
-        .def("setObjectiveFunction", &NLMPCType::setObjectiveFunction)
+        .def("setObjectiveFunction", py::overload_cast<const ObjectiveFunc>(&NLMPCType::setObjectiveFunction))
+        .def("setResidualFunction", residualFuncWrapper)
         .def("setStateSpaceFunction", stateSpaceFuncWrapper)
+        .def("setBatchStateSpaceFunction", batchStateSpaceFuncWrapper)
         .def("setOutputFunction", outputFuncWrapper)
         .def("setIneqConFunction", ineqConFuncWrapper)
         .def("setEqConFunction", eqConFuncWrapper);
@@ -147,7 +171,8 @@ PYBIND11_MODULE(pympcxx, m)
         .def_readonly("solver_status_msg", &ResulType::solver_status_msg)
         .def_readonly("cost", &ResulType::cost)
         .def_readonly("cmd", &ResulType::cmd)
-        .def_readonly("status", &ResulType::status);
+        .def_readonly("status", &ResulType::status)
+        .def_readonly("iterations", &ResulType::iterations);
 
     // export the solution stats struct to python
     using StatsType = mpc::SolutionStats;
@@ -0,0 +1,435 @@
+/*
+ *   Copyright (c) 2023 Nicola Piccinelli
+ *   All rights reserved.
+ */
+#include "basic.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_template_test_macros.hpp>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+// the allocations are counted only for the fixed size problems, the dynamic
+// sized matrices are allocated on the heap by design. The allocation functions
+// are replaced for the whole executable, so this file is built in its own test
+// executable and not with the other tests of the library
+namespace
+{
+    std::atomic<bool> counting{false};
+    std::atomic<int> allocations{0};
+
+    void countAllocation()
+    {
+        if (counting.load(std::memory_order_relaxed))
+        {
+            allocations.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief Count the heap allocations performed between the construction and
+     * the call of the stop method
+     */
+    struct AllocationCounter
+    {
+        AllocationCounter()
+        {
+            allocations = 0;
+            counting = true;
+        }
+
+        int stop()
+        {
+            counting = false;
+            return allocations;
+        }
+
+        ~AllocationCounter()
+        {
+            counting = false;
+        }
+    };
+}
+
+void *operator new(std::size_t size)
+{
+    countAllocation();
+    if (void *p = std::malloc(size ? size : 1))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size)
+{
+    return ::operator new(size);
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+#if defined(__GLIBC__)
+// eigen allocates the dynamic storage through malloc, the glibc allocator is
+// interposed to count these allocations too
+extern "C"
+{
+    void *__libc_malloc(std::size_t size);
+    void *__libc_calloc(std::size_t n, std::size_t size);
+    void *__libc_realloc(void *p, std::size_t size);
+
+    void *malloc(std::size_t size)
+    {
+        countAllocation();
+        return __libc_malloc(size);
+    }
+
+    void *calloc(std::size_t n, std::size_t size)
+    {
+        countAllocation();
+        return __libc_calloc(n, size);
+    }
+
+    void *realloc(void *p, std::size_t size)
+    {
+        countAllocation();
+        return __libc_realloc(p, size);
+    }
+}
+#endif
+
+TEMPLATE_TEST_CASE_SIG(
+    MPC_TEST_NAME("Checking allocation free callbacks"),
+    MPC_TEST_TAGS("[allocations][template]"),
+    ((int Tnx, int Tnu, int Tph, int Tch), Tnx, Tnu, Tph, Tch),
+    (2, 1, 5, 5), (2, 1, 6, 3))
+{
+    static constexpr int Tny = 2;
+    static constexpr int Tineq = 2;
+    static constexpr int Teq = 1;
+    static constexpr int N = (Tph * Tnx) + (Tnu * Tch) + 1;
+
+    static constexpr auto sizer = mpc::MPCSize(TVAR(Tnx), TVAR(Tnu), TVAR(0), TVAR(Tny), TVAR(Tph), TVAR(Tch), TVAR(Tineq), TVAR(Teq));
+
+    mpc::Logger::instance().setLevel(mpc::Logger::log_level::NONE);
+
+    auto objFunc = std::make_shared<mpc::Objective<sizer>>();
+    objFunc->initialize(Tnx, Tnu, 0, Tny, Tph, Tch, Tineq, Teq);
+
+    auto conFunc = std::make_shared<mpc::Constraints<sizer>>();
+    conFunc->initialize(Tnx, Tnu, 0, Tny, Tph, Tch, Tineq, Teq);
+
+    auto mapping = std::make_shared<mpc::Mapping<sizer>>();
+    mapping->initialize(Tnx, Tnu, 0, Tny, Tph, Tch, Tineq, Teq);
+
+    auto model = std::make_shared<mpc::Model<sizer>>();
+    model->initialize(Tnx, Tnu, 0, Tny, Tph, Tch, Tineq, Teq);
+
+    model->setContinuous(true, 0.1);
+    model->setStateModel([](
+                            mpc::cvec<TVAR(Tnx)> &dx,
+                            const mpc::cvec<TVAR(Tnx)> &x,
+                            const mpc::cvec<TVAR(Tnu)> &u,
+                            const unsigned int &)
+                        {
+            dx[0] = ((1.0 - (x[1] * x[1])) * x[0]) - x[1] + u[0];
+            dx[1] = x[0]; });
+
+    objFunc->setModel(model, mapping);
+    objFunc->setObjective([](
+                             const mpc::mat<TVAR(Tph + 1), TVAR(Tnx)> &x,
+                             const mpc::mat<TVAR(Tph + 1), TVAR(Tny)> &,
+                             const mpc::mat<TVAR(Tph + 1), TVAR(Tnu)> &u,
+                             const double &)
+                         { return x.array().square().sum() + u.array().square().sum(); });
+
+    conFunc->setModel(model, mapping);
+    conFunc->setIneqConstraints([](
+                                    mpc::cvec<TVAR(Tineq)> &in_con,
+                                    const mpc::mat<TVAR(Tph + 1), TVAR(Tnx)> &x,
+                                    const mpc::mat<TVAR(Tph + 1), TVAR(Tny)> &,
+                                    const mpc::mat<TVAR(Tph + 1), TVAR(Tnu)> &u,
+                                    const double &)
+                                {
+            in_con(0) = x(Tph, 0) - 1.0;
+            in_con(1) = u.col(0).maxCoeff() - 0.5; },
+                                1e-6);
+    conFunc->setEqConstraints([](
+                                  mpc::cvec<TVAR(Teq)> &eq_con,
+                                  const mpc::mat<TVAR(Tph + 1), TVAR(Tnx)> &x,
+                                  const mpc::mat<TVAR(Tph + 1), TVAR(Tnu)> &)
+                              { eq_con(0) = x(Tph, 1); },
+                              1e-6);
+
+    mpc::cvec<TVAR(Tnx)> x0;
+    x0 << 0.5, -0.5;
+    objFunc->setCurrentState(x0);
+    conFunc->setCurrentState(x0);
+
+    // buffers owned by the internal solver, the jacobian matrices are row-major
+    std::vector<double> x(N), grad(N);
+    std::vector<double> stateValue(Tph * Tnx), stateJac(N * Tph * Tnx);
+    std::vector<double> ineqValue(Tineq), ineqJac(N * Tineq);
+    std::vector<double> eqValue(Teq), eqJac(N * Teq);
+
+    for (int i = 0; i < N; i++)
+    {
+        x[i] = 0.1 * (i % 7);
+    }
+
+    // the integrators of the continuous time model and the Broyden update of the
+    // Jacobian matrices reuse their work buffers too
+    std::vector<std::pair<mpc::NLIntegrator, mpc::NLJacobianUpdate>> setups = {
+        {mpc::NLIntegrator::TRAPEZOIDAL, mpc::NLJacobianUpdate::FINITE_DIFFERENCE},
+        {mpc::NLIntegrator::TRAPEZOIDAL, mpc::NLJacobianUpdate::BROYDEN},
+        {mpc::NLIntegrator::RK4, mpc::NLJacobianUpdate::FINITE_DIFFERENCE},
+        {mpc::NLIntegrator::RKF32, mpc::NLJacobianUpdate::FINITE_DIFFERENCE},
+        {mpc::NLIntegrator::RKF32, mpc::NLJacobianUpdate::BROYDEN},
+        {mpc::NLIntegrator::SDIRK, mpc::NLJacobianUpdate::FINITE_DIFFERENCE},
+        {mpc::NLIntegrator::SDIRK, mpc::NLJacobianUpdate::BROYDEN}};
+
+    for (auto [integrator, update] : setups)
+    {
+        model->setIntegrator(integrator, 2, 1e-8);
+        conFunc->setJacobianUpdate(update, 10, 0.0);
+
+        for (bool fixedSlack : {false, true})
+        {
+            const unsigned int n = N - (fixedSlack ? 1 : 0);
+            objFunc->setSlackFixed(fixedSlack);
+            conFunc->setSlackFixed(fixedSlack);
+
+            // callbacks evaluated as the internal solver does, the first call is a warm-up
+            auto callbacks = [&](bool hasGradient)
+            {
+                double value = objFunc->evaluate(
+                    objFunc->restoreSlack(x.data(), n),
+                    Eigen::Map<mpc::cvec<>>(grad.data(), hasGradient ? n : 0));
+
+                conFunc->evaluateStateModelEq(
+                    conFunc->restoreSlack(x.data(), n),
+                    Eigen::Map<mpc::cvec<>>(stateValue.data(), Tph * Tnx),
+                    Eigen::Map<mpc::mat<>>(stateJac.data(), hasGradient ? n : 0, Tph * Tnx));
+
+                conFunc->evaluateIneq(
+                    conFunc->restoreSlack(x.data(), n),
+                    Eigen::Map<mpc::cvec<>>(ineqValue.data(), Tineq),
+                    Eigen::Map<mpc::mat<>>(ineqJac.data(), hasGradient ? n : 0, Tineq));
+
+                conFunc->evaluateEq(
+                    conFunc->restoreSlack(x.data(), n),
+                    Eigen::Map<mpc::cvec<>>(eqValue.data(), Teq),
+                    Eigen::Map<mpc::mat<>>(eqJac.data(), hasGradient ? n : 0, Teq));
+
+                return value;
+            };
+
+            callbacks(true);
+
+            // the Broyden update refreshes the Jacobian matrices at each new point
+            x[0] += 1e-3;
+
+            int counted;
+            double value;
+            {
+                AllocationCounter counter;
+                value = callbacks(true);
+                callbacks(false);
+                counted = counter.stop();
+            }
+
+            REQUIRE(counted == 0);
+
+            // the in-place evaluations match the ones returning the cost structure
+            auto full = mpc::cvec<TVAR(N)>(Eigen::Map<mpc::cvec<TVAR(N)>>(x.data(), N));
+            if (fixedSlack)
+            {
+                full(N - 1) = 0;
+            }
+
+            auto obj = objFunc->evaluate(full, true);
+            REQUIRE(obj.value == value);
+            REQUIRE(obj.grad.head(n).isApprox(Eigen::Map<mpc::cvec<>>(grad.data(), n)));
+
+            auto state = conFunc->evaluateStateModelEq(full, true);
+            REQUIRE(state.value.isApprox(Eigen::Map<mpc::cvec<>>(stateValue.data(), Tph * Tnx)));
+            REQUIRE(Eigen::Map<mpc::mat<>>(state.grad.data(), N, Tph * Tnx).topRows(n).isApprox(Eigen::Map<mpc::mat<>>(stateJac.data(), n, Tph * Tnx)));
+
+            auto ineq = conFunc->evaluateIneq(full, true);
+            REQUIRE(ineq.value.isApprox(Eigen::Map<mpc::cvec<>>(ineqValue.data(), Tineq)));
+            REQUIRE(Eigen::Map<mpc::mat<>>(ineq.grad.data(), N, Tineq).topRows(n).isApprox(Eigen::Map<mpc::mat<>>(ineqJac.data(), n, Tineq)));
+        }
+    }
+}
+
+TEMPLATE_TEST_CASE_SIG(
+    MPC_TEST_NAME("Checking allocation free single points of batched models"),
+    MPC_TEST_TAGS("[allocations][template]"),
+    ((int Tnx, int Tnu, int Tph, int Tch), Tnx, Tnu, Tph, Tch),
+    (2, 1, 5, 5))
+{
+    static constexpr auto sizer = mpc::MPCSize(TVAR(Tnx), TVAR(Tnu), TVAR(0), TVAR(0), TVAR(Tph), TVAR(Tch), TVAR(0), TVAR(0));
+
+    mpc::Logger::instance().setLevel(mpc::Logger::log_level::NONE);
+
+    auto model = std::make_shared<mpc::Model<sizer>>();
+    model->initialize(Tnx, Tnu, 0, 0, Tph, Tch, 0, 0);
+
+    // the function used on single points is derived from the batched one
+    model->setContinuous(true, 0.1);
+    model->setBatchStateModel([](
+                                  mpc::mat<TVAR(Tnx), Eigen::Dynamic> &F,
+                                  const mpc::mat<TVAR(Tnx), Eigen::Dynamic> &X,
+                                  const mpc::mat<TVAR(Tnu), Eigen::Dynamic> &U,
+                                  const std::vector<unsigned int> &)
+                              {
+            F.row(0) = (1.0 - X.row(1).array().square()).matrix().cwiseProduct(X.row(0)) - X.row(1) + U.row(0);
+            F.row(1) = X.row(0); });
+
+    mpc::cvec<TVAR(Tnx)> x(Tnx), f(Tnx), fb(Tnx);
+    mpc::cvec<TVAR(Tnu)> u(Tnu);
+    x << 0.5, -0.5;
+    u << 0.2;
+
+    // the single points of the vector field and of the transition of the integrated
+    // model reuse their one column batch, the first call is a warm-up
+    for (auto integrator : {mpc::NLIntegrator::TRAPEZOIDAL, mpc::NLIntegrator::RK4, mpc::NLIntegrator::SDIRK})
+    {
+        model->setIntegrator(integrator, 2, 1e-8);
+
+        model->vectorField(f, x, u, 0);
+        model->transition(f, x, u, 0);
+
+        int counted;
+        {
+            AllocationCounter counter;
+            model->vectorField(f, x, u, 1);
+            model->transition(f, x, u, 1);
+            counted = counter.stop();
+        }
+
+        REQUIRE(counted == 0);
+
+        // the single point matches the batch of one point
+        mpc::mat<TVAR(Tnx), Eigen::Dynamic> F(Tnx, 1);
+        model->transitionBatch(F, x, u, {1});
+        fb = F.col(0);
+        REQUIRE(f.isApprox(fb));
+    }
+}
+
+TEST_CASE(
+    MPC_TEST_NAME("Checking allocation free optimizer callbacks"),
+    MPC_TEST_TAGS("[allocations]"))
+{
+    static constexpr int Tnx = 2;
+    static constexpr int Tnu = 1;
+    static constexpr int Tny = 2;
+    static constexpr int Tph = 6;
+    static constexpr int Tch = 3;
+    static constexpr int Tineq = Tph + 1;
+    static constexpr int Teq = 1;
+
+    static constexpr double ts = 0.1;
+
+    // allocations counted at the first and at the last evaluation of the objective function
+    int first = -1;
+    int last = -1;
+    int calls = 0;
+
+    for (bool hard : {false, true})
+    {
+        for (bool concurrent : {false, true})
+        {
+            mpc::NLMPC<Tnx, Tnu, Tny, Tph, Tch, Tineq, Teq> optsolver;
+            optsolver.setLoggerLevel(mpc::Logger::log_level::NONE);
+
+            mpc::NLParameters params;
+            params.maximum_iteration = 50;
+            params.hard_constraints = hard;
+            params.concurrent_evaluation = concurrent;
+            optsolver.setOptimizerParameters(params);
+
+            optsolver.setStateSpaceFunction([](
+                                                mpc::cvec<Tnx> &xn,
+                                                const mpc::cvec<Tnx> &x,
+                                                const mpc::cvec<Tnu> &u,
+                                                const unsigned int &)
+                                            {
+                xn(0) = x(0) + ts * x(1);
+                xn(1) = x(1) + ts * (-std::sin(x(0)) - 0.1 * x(1) + u(0)); });
+
+            optsolver.setObjectiveFunction([&](
+                                               const mpc::mat<Tph + 1, Tnx> &x,
+                                               const mpc::mat<Tph + 1, Tny> &,
+                                               const mpc::mat<Tph + 1, Tnu> &u,
+                                               const double &)
+                                           {
+                if (counting)
+                {
+                    first = first < 0 ? allocations.load() : first;
+                    last = allocations;
+                    calls++;
+                }
+                return x.array().square().sum() + 0.1 * u.array().square().sum(); });
+
+            optsolver.setIneqConFunction([](
+                                             mpc::cvec<Tineq> &in_con,
+                                             const mpc::mat<Tph + 1, Tnx> &,
+                                             const mpc::mat<Tph + 1, Tny> &,
+                                             const mpc::mat<Tph + 1, Tnu> &u,
+                                             const double &)
+                                         {
+                for (int i = 0; i < Tineq; i++) {
+                    in_con(i) = u(i, 0) * u(i, 0) - 2.25;
+                } });
+
+            optsolver.setEqConFunction([](
+                                           mpc::cvec<Teq> &eq_con,
+                                           const mpc::mat<Tph + 1, Tnx> &,
+                                           const mpc::mat<Tph + 1, Tnu> &u)
+                                       { eq_con(0) = u(0, 0) - u(1, 0); });
+
+            mpc::cvec<Tnx> x;
+            x << 1.0, 0.0;
+
+            mpc::cvec<Tnu> u;
+            u.setZero();
+
+            // the first step sizes the buffers of the optimizer
+            u = optsolver.optimize(x, u).cmd;
+
+            first = last = -1;
+            calls = 0;
+            {
+                AllocationCounter counter;
+                optsolver.optimize(x, u);
+                counter.stop();
+            }
+
+            // the callbacks of NLopt, the constraints of the team and the tracking of the
+            // iterates performed between the evaluations of the objective do not allocate
+            REQUIRE(calls > 0);
+            REQUIRE(last - first == 0);
+        }
+    }
+}
@@ -0,0 +1,301 @@
+/*
+ *   Copyright (c) 2023 Nicola Piccinelli
+ *   All rights reserved.
+ */
+#include "basic.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_template_test_macros.hpp>
+
+TEMPLATE_TEST_CASE_SIG(
+    MPC_TEST_NAME("Checking collocation defects and their Jacobian"),
+    MPC_TEST_TAGS("[collocation][template]"),
+    ((int Tnx, int Tnu, int Tny, int Tph, int Tch, int Tpoints), Tnx, Tnu, Tny, Tph, Tch, Tpoints),
+    (2, 1, 2, 5, 5, 1), (2, 1, 2, 5, 3, 2), (2, 1, 2, 5, 3, 3))
+{
+    constexpr int Tineq = 0;
+    constexpr int Teq = 0;
+    static constexpr auto sizer = mpc::MPCSize(TVAR(Tnx), TVAR(Tnu), TVAR(0), TVAR(Tny), TVAR(Tph), TVAR(Tch), TVAR(Tineq), TVAR(Teq));
+
+    auto mapping = std::make_shared<mpc::Mapping<sizer>>();
+    mapping->initialize(Tnx, Tnu, 0, Tny, Tph, Tch, Tineq, Teq);
+
+    mpc::cvec<TVAR(Tnx)> sx(Tnx);
+    sx << 2.0, 0.5;
+    mapping->setStateScaling(sx);
+
+    // van der pol oscillator
+    auto model = std::make_shared<mpc::Model<sizer>>();
+    model->initialize(Tnx, Tnu, 0, Tny, Tph, Tch, Tineq, Teq);
+    model->setContinuous(true, 0.1);
+    model->setStateModel([](
+                             mpc::cvec<TVAR(Tnx)> &dx,
+                             const mpc::cvec<TVAR(Tnx)> &x,
+                             const mpc::cvec<TVAR(Tnu)> &u,
+                             const unsigned int &)
+                         {
+        dx[0] = ((1.0 - (x[1] * x[1])) * x[0]) - x[1] + u[0];
+        dx[1] = x[0]; });
+
+    auto collocation = std::make_shared<mpc::Collocation<sizer>>();
+    collocation->initialize(Tnx, Tnu, 0, Tny, Tph, Tch, Tineq, Teq);
+    collocation->setModel(model, mapping);
+    REQUIRE(collocation->setPoints(Tpoints));
+
+    // the unsupported numbers of points are rejected
+    REQUIRE_FALSE(collocation->setPoints(0));
+    REQUIRE_FALSE(collocation->setPoints(4));
+    REQUIRE(collocation->points() == Tpoints);
+    REQUIRE(collocation->size() == (size_t)(Tph * (Tpoints - 1) * Tnx));
+    REQUIRE(collocation->defects() == (size_t)(Tph * Tpoints * Tnx));
+
+    mpc::cvec<TVAR(Tnx)> x0(Tnx);
+    x0 << 0.5, -0.3;
+    collocation->setCurrentState(x0);
+
+    // optimization vector followed by the collocation states
+    int nz = (Tph * Tnx) + (Tnu * Tch) + 1;
+    int n = nz + (int)collocation->size();
+    int m = (int)collocation->defects();
+
+    mpc::cvec<> x(n);
+    for (int i = 0; i < n; i++)
+    {
+        x[i] = 0.3 * std::cos(i);
+    }
+
+    mpc::cvec<> c(m);
+    mpc::mat<> J(n, m);
+    collocation->evaluateDefects(x.data(), n, c, J);
+
+    // the defects do not depend on the slack variable
+    REQUIRE(J.row(nz - 1).cwiseAbs().maxCoeff() == 0);
+
+    // the Jacobian matrix is not computed when empty
+    mpc::mat<> none(0, m);
+
+    double h = 1e-6;
+    for (int i = 0; i < n; i++)
+    {
+        mpc::cvec<> xp = x, xm = x;
+        xp[i] += h;
+        xm[i] -= h;
+
+        mpc::cvec<> cp(m), cm(m);
+        collocation->evaluateDefects(xp.data(), n, cp, none);
+        collocation->evaluateDefects(xm.data(), n, cm, none);
+
+        REQUIRE((((cp - cm) / (2 * h)) - J.row(i).transpose()).cwiseAbs().maxCoeff() < 1e-6);
+    }
+
+    // the initial collocation states lie on the segments between the states
+    mpc::cvec<> states(collocation->size());
+    collocation->initialStates(x.head(nz), states);
+    for (int k = 0; k < Tph && Tpoints > 1; k++)
+    {
+        mpc::cvec<TVAR(Tnx)> xk(Tnx), xk1(Tnx);
+        xk = x0.cwiseQuotient(sx);
+        if (k > 0)
+        {
+            xk = x.segment((k - 1) * Tnx, Tnx);
+        }
+        xk1 = x.segment(k * Tnx, Tnx);
+
+        mpc::cvec<TVAR(Tnx)> d = states.segment(k * (Tpoints - 1) * Tnx, Tnx) - xk;
+        REQUIRE(std::fabs((d[0] * (xk1[1] - xk[1])) - (d[1] * (xk1[0] - xk[0]))) < 1e-12);
+    }
+}
+
+TEMPLATE_TEST_CASE_SIG(
+    MPC_TEST_NAME("Checking collocation accuracy"),
+    MPC_TEST_TAGS("[collocation][template]"),
+    ((int Tnx, int Tnu, int Tph), Tnx, Tnu, Tph),
+    (2, 1, 2))
+{
+    constexpr int Tch = Tph;
+    static constexpr auto sizer = mpc::MPCSize(TVAR(Tnx), TVAR(Tnu), TVAR(0), TVAR(0), TVAR(Tph), TVAR(Tch), TVAR(0), TVAR(0));
+
+    auto mapping = std::make_shared<mpc::Mapping<sizer>>();
+    mapping->initialize(Tnx, Tnu, 0, 0, Tph, Tch, 0, 0);
+
+    // two lags in series, the exact solution with a constant input is known
+    const double ts = 0.5;
+    auto model = std::make_shared<mpc::Model<sizer>>();
+    model->initialize(Tnx, Tnu, 0, 0, Tph, Tch, 0, 0);
+    model->setContinuous(true, ts);
+    model->setStateModel([](
+                             mpc::cvec<TVAR(Tnx)> &dx,
+                             const mpc::cvec<TVAR(Tnx)> &x,
+                             const mpc::cvec<TVAR(Tnu)> &u,
+                             const unsigned int &)
+                         {
+        dx[0] = -x[0] + u[0];
+        dx[1] = -2.0 * x[1] + x[0]; });
+
+    auto collocation = std::make_shared<mpc::Collocation<sizer>>();
+    collocation->initialize(Tnx, Tnu, 0, 0, Tph, Tch, 0, 0);
+    collocation->setModel(model, mapping);
+
+    mpc::cvec<TVAR(Tnx)> x0(Tnx);
+    x0 << 1.0, -0.5;
+    collocation->setCurrentState(x0);
+
+    const double uc = 0.4;
+    auto exact = [&](double t)
+    {
+        double a = x0[0] - uc;
+        double b = x0[1] - (uc / 2.0) - a;
+        return std::array<double, 2>{uc + (a * std::exp(-t)), (uc / 2.0) + (a * std::exp(-t)) + (b * std::exp(-2.0 * t))};
+    };
+
+    std::vector<double> error;
+    for (int points = 1; points <= 3; points++)
+    {
+        REQUIRE(collocation->setPoints(points));
+
+        int nz = (Tph * Tnx) + (Tnu * Tch) + 1;
+        int n = nz + (int)collocation->size();
+        int m = (int)collocation->defects();
+
+        // the states and the collocation states are the unknowns of the defects
+        mpc::cvec<> x = mpc::cvec<>::Zero(n);
+        x.segment(Tph * Tnx, Tnu * Tch).setConstant(uc);
+
+        mpc::cvec<> c(m);
+        mpc::mat<> J(n, m);
+        std::vector<int> unknowns;
+        for (int i = 0; i < n; i++)
+        {
+            if (i < Tph * Tnx || i >= nz)
+            {
+                unknowns.push_back(i);
+            }
+        }
+        REQUIRE((int)unknowns.size() == m);
+
+        for (int it = 0; it < 10; it++)
+        {
+            collocation->evaluateDefects(x.data(), n, c, J);
+
+            mpc::mat<> Ju(m, m);
+            for (int i = 0; i < m; i++)
+            {
+                Ju.col(i) = J.row(unknowns[i]).transpose();
+            }
+
+            mpc::cvec<> dz = Ju.partialPivLu().solve(-c);
+            for (int i = 0; i < m; i++)
+            {
+                x[unknowns[i]] += dz[i];
+            }
+        }
+
+        mpc::mat<> none(0, m);
+        collocation->evaluateDefects(x.data(), n, c, none);
+        REQUIRE(c.cwiseAbs().maxCoeff() < 1e-10);
+
+        double e = 0;
+        for (int k = 0; k < Tph; k++)
+        {
+            auto xe = exact(ts * (k + 1));
+            e = std::max(e, std::max(std::fabs(x[k * Tnx] - xe[0]), std::fabs(x[(k * Tnx) + 1] - xe[1])));
+        }
+        error.push_back(e);
+    }
+
+    // the order of the collocation grows with the number of points,
+    // three points on the long interval are as accurate as a fine step
+    REQUIRE(error[0] > 1e-2);
+    REQUIRE(error[1] < 0.1 * error[0]);
+    REQUIRE(error[2] < 1e-4);
+}
+
+namespace
+{
+    using namespace nlmpc_fixture;
+
+    /**
+     * @brief Van der pol oscillator
+     */
+    void vanderpol(
+        mpc::cvec<TVAR(Tnx)> &dx,
+        const mpc::cvec<TVAR(Tnx)> &x,
+        const mpc::cvec<TVAR(Tnu)> &u)
+    {
+        dx(0) = ((1.0 - (x(1) * x(1))) * x(0)) - x(1) + u(0);
+        dx(1) = x(0);
+    }
+
+    std::shared_ptr<Controller<0, 0>> buildVanderpolController(mpc::NLParameters params)
+    {
+        auto optsolver = makeController();
+        optsolver->setDiscretizationSamplingTime(ts);
+
+        optsolver->setStateSpaceFunction([](
+                                             mpc::cvec<TVAR(Tnx)> &dx,
+                                             const mpc::cvec<TVAR(Tnx)> &x,
+                                             const mpc::cvec<TVAR(Tnu)> &u,
+                                             const unsigned int &)
+                                         { vanderpol(dx, x, u); });
+
+        setQuadraticObjective(optsolver);
+        setSymmetricInputBounds(optsolver, 1.0);
+        optsolver->setOptimizerParameters(params);
+
+        return optsolver;
+    }
+} // namespace
+
+TEST_CASE(
+    MPC_TEST_NAME("Collocation formulation matches the converged SQP solution"),
+    MPC_TEST_TAGS("[collocation]"))
+{
+    mpc::NLParameters collocation_params;
+    collocation_params.formulation = mpc::NLFormulation::COLLOCATION;
+    collocation_params.collocation_points = 3;
+    collocation_params.maximum_iteration = 1000;
+    collocation_params.relative_xtol = 1e-10;
+
+    // the reference integrates each step with fine sub-steps
+    mpc::NLParameters sqp_params;
+    sqp_params.backend = mpc::NLBackend::SQP;
+    sqp_params.sqp_iterations = 10;
+    sqp_params.integrator = mpc::NLIntegrator::RK4;
+    sqp_params.integrator_steps = 10;
+
+    auto collocation = buildVanderpolController(collocation_params);
+    auto sqp = buildVanderpolController(sqp_params);
+
+    mpc::cvec<TVAR(Tnx)> x(Tnx);
+    mpc::cvec<TVAR(Tnu)> u(Tnu);
+    u.setZero();
+
+    // the second initial condition saturates the input at the lower bound
+    std::vector<std::array<double, 2>> initial = {{0.5, 0.0}, {2.0, 1.0}};
+    for (auto &x0 : initial)
+    {
+        x << x0[0], x0[1];
+
+        auto r_collocation = collocation->optimize(x, u);
+        auto r_sqp = sqp->optimize(x, u);
+
+        REQUIRE(r_collocation.status == mpc::ResultStatus::SUCCESS);
+        REQUIRE(r_sqp.status == mpc::ResultStatus::SUCCESS);
+        REQUIRE((r_collocation.cmd - r_sqp.cmd).norm() < 1e-3);
+        REQUIRE(std::fabs(r_collocation.cost - r_sqp.cost) < 1e-3 * std::max(1.0, r_sqp.cost));
+
+        // the optimal sequence follows the system's dynamics integrated with fine steps
+        auto seq = collocation->getOptimalSequence();
+        mpc::cvec<TVAR(Tnx)> xk = seq.state.row(0).transpose();
+        for (int i = 0; i < Tph; i++)
+        {
+            mpc::cvec<TVAR(Tnu)> uk = seq.input.row(i).transpose();
+            for (int s = 0; s < 1000; s++)
+            {
+                mpc::cvec<TVAR(Tnx)> dx(Tnx);
+                vanderpol(dx, xk, uk);
+                xk += (ts / 1000) * dx;
+            }
+            REQUIRE((xk - seq.state.row(i + 1).transpose()).norm() < 1e-3);
+        }
+    }
+}
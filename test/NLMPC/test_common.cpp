@@ -105,6 +105,229 @@ TEMPLATE_TEST_CASE_SIG(
     REQUIRE(x(x.size() - 1) == e);
 }
 
+TEMPLATE_TEST_CASE_SIG(
+    MPC_TEST_NAME("Checking move-blocking operators"),
+    MPC_TEST_TAGS("[mapping][template]"),
+    ((int Tnx, int Tnu, int Tph, int Tch), Tnx, Tnu, Tph, Tch),
+    (1, 1, 1, 1), (5, 3, 1, 1), (5, 3, 7, 1), (5, 3, 7, 4), (5, 3, 7, 7))
+{
+    static constexpr int Tny = 1;
+    static constexpr int Tineq = 1;
+    static constexpr int Teq = 1;
+    static constexpr int Tnc = 2;
+
+    static constexpr auto sizer = mpc::MPCSize(TVAR(Tnx), TVAR(Tnu), TVAR(0), TVAR(Tny), TVAR(Tph), TVAR(Tch), TVAR(Tineq), TVAR(Teq));
+
+    mpc::Mapping<sizer> mapping;
+    mapping.initialize(Tnx, Tnu, 0, Tny, Tph, Tch, Tineq, Teq);
+
+    mpc::cvec<TVAR(Tnu)> su;
+    su.resize(Tnu);
+    for (int i = 0; i < Tnu; i++)
+    {
+        su[i] = 0.5 * (i + 1);
+    }
+    mapping.setInputScaling(su);
+
+    mpc::cvec<TVAR(((Tph * Tnx) + (Tnu * Tch) + 1))> x;
+    x.resize((Tph * Tnx) + (Tnu * Tch) + 1);
+    for (int i = 0; i < x.rows(); i++)
+    {
+        x[i] = std::sin(i + 1.0);
+    }
+
+    // the input sequence matches the product by the dense mapping matrix
+    mpc::mat<TVAR(Tph + 1), TVAR(Tnu)> Umat;
+    Umat.resize(Tph + 1, Tnu);
+    mapping.unwrapInputs(x, Umat);
+
+    mpc::cvec<TVAR(Tph * Tnu)> u;
+    u = mapping.Iz2u() * x.middleRows(Tph * Tnx, Tnu * Tch);
+    for (int k = 0; k < Tph; k++)
+    {
+        REQUIRE((Umat.row(k).transpose() - u.middleRows(k * Tnu, Tnu)).norm() < 1e-15);
+    }
+    REQUIRE(Umat.row(Tph) == Umat.row(Tph - 1));
+
+    // and it is converted back to the same input blocks
+    mpc::cvec<TVAR(((Tph * Tnx) + (Tnu * Tch) + 1))> z;
+    z.resize((Tph * Tnx) + (Tnu * Tch) + 1);
+    z.setZero();
+    mapping.wrapInputs(Umat, z);
+    REQUIRE((z.middleRows(Tph * Tnx, Tnu * Tch) - (mapping.Iu2z() * u)).norm() < 1e-14);
+    REQUIRE((z.middleRows(Tph * Tnx, Tnu * Tch) - x.middleRows(Tph * Tnx, Tnu * Tch)).norm() < 1e-14);
+
+    // the Jacobian matrices w.r.t. the inputs are summed on the blocks
+    mpc::mat<Tnc, TVAR(Tph * Tnu)> Ju;
+    Ju.resize(Tnc, Tph * Tnu);
+    for (int i = 0; i < Ju.size(); i++)
+    {
+        Ju(i) = std::cos(i + 1.0);
+    }
+
+    mpc::mat<Tnc, TVAR(Tnu * Tch)> Jz;
+    Jz.resize(Tnc, Tnu * Tch);
+    mapping.template blockInputJacobian<Tnc>(Ju, Jz);
+    REQUIRE((Jz - (Ju * mapping.Iz2u())).norm() < 1e-14);
+
+    // each element of the input blocks moves the steps it is mapped on
+    mpc::mat<TVAR(Tph + 1), TVAR(Tnu)> D;
+    D.resize(Tph + 1, Tnu);
+    for (int c = 0; c < Tnu * Tch; c++)
+    {
+        mapping.inputDirection(c, D);
+        for (int k = 0; k < Tph; k++)
+        {
+            REQUIRE((D.row(k).transpose() - mapping.Iz2u().block(k * Tnu, c, Tnu, 1)).norm() == 0);
+        }
+    }
+}
+
+TEMPLATE_TEST_CASE_SIG(
+    MPC_TEST_NAME("Checking input basis functions"),
+    MPC_TEST_TAGS("[mapping][template]"),
+    ((int Tnx, int Tnu, int Tph, int Tch), Tnx, Tnu, Tph, Tch),
+    (1, 1, 1, 1), (3, 2, 12, 5), (2, 1, 7, 7), (1, 1, 40, 4))
+{
+    static constexpr int Tny = 1;
+    static constexpr int Tineq = 1;
+    static constexpr int Teq = 1;
+    static constexpr int Tnc = 2;
+
+    static constexpr auto sizer = mpc::MPCSize(TVAR(Tnx), TVAR(Tnu), TVAR(0), TVAR(Tny), TVAR(Tph), TVAR(Tch), TVAR(Tineq), TVAR(Teq));
+
+    mpc::Mapping<sizer> mapping;
+    mapping.initialize(Tnx, Tnu, 0, Tny, Tph, Tch, Tineq, Teq);
+
+    mpc::cvec<TVAR(Tnu)> su;
+    su.resize(Tnu);
+    for (int i = 0; i < Tnu; i++)
+    {
+        su[i] = 0.5 * (i + 1);
+    }
+    mapping.setInputScaling(su);
+
+    // invalid parameterizations are rejected and the basis is left unchanged
+    REQUIRE_FALSE(mapping.setInputBasis(mpc::NLInputBasis::LAGUERRE, 1.0, 3, {}));
+    REQUIRE_FALSE(mapping.setInputBasis(mpc::NLInputBasis::BSPLINE, 0.5, -1, {}));
+    REQUIRE_FALSE(mapping.setInputBasis(mpc::NLInputBasis::BSPLINE, 0.5, 0, std::vector<double>(Tch, 0.5)));
+    if (Tch > 2)
+    {
+        std::vector<double> knots(Tch - 1, 0.5);
+        REQUIRE_FALSE(mapping.setInputBasis(mpc::NLInputBasis::BSPLINE, 0.5, 0, knots));
+    }
+    REQUIRE(mapping.InputBasis() == mpc::NLInputBasis::BLOCKING);
+
+    mpc::cvec<TVAR(((Tph * Tnx) + (Tnu * Tch) + 1))> x;
+    x.resize((Tph * Tnx) + (Tnu * Tch) + 1);
+    for (int i = 0; i < x.rows(); i++)
+    {
+        x[i] = std::sin(i + 1.0);
+    }
+
+    std::vector<mpc::NLInputBasis> bases = {
+        mpc::NLInputBasis::LAGUERRE,
+        mpc::NLInputBasis::CHEBYSHEV,
+        mpc::NLInputBasis::BSPLINE};
+
+    for (auto basis : bases)
+    {
+        // the spline knots are placed towards the beginning of the horizon when there
+        // are enough steps to keep the basis independent, otherwise they are uniform
+        std::vector<double> knots;
+        for (int i = 0; basis == mpc::NLInputBasis::BSPLINE && Tph >= 2 * Tch && i < Tch - std::min(2, Tch - 1) - 1; i++)
+        {
+            knots.push_back(std::pow((i + 1.0) / (Tch - std::min(2, Tch - 1)), 2));
+        }
+
+        REQUIRE(mapping.setInputBasis(basis, 0.5, 2, knots));
+        REQUIRE(mapping.InputBasis() == basis);
+
+        // the input sequence matches the product by the dense mapping matrix
+        mpc::mat<TVAR(Tph + 1), TVAR(Tnu)> Umat;
+        Umat.resize(Tph + 1, Tnu);
+        mapping.unwrapInputs(x, Umat);
+
+        mpc::cvec<TVAR(Tph * Tnu)> u;
+        u = mapping.Iz2u() * x.middleRows(Tph * Tnx, Tnu * Tch);
+        for (int k = 0; k < Tph; k++)
+        {
+            REQUIRE((Umat.row(k).transpose() - u.middleRows(k * Tnu, Tnu)).norm() < 1e-12);
+        }
+        REQUIRE(Umat.row(Tph) == Umat.row(Tph - 1));
+
+        // the projection recovers the coefficients of a sequence spanned by the basis
+        mpc::cvec<TVAR(((Tph * Tnx) + (Tnu * Tch) + 1))> z;
+        z.resize((Tph * Tnx) + (Tnu * Tch) + 1);
+        z.setZero();
+        mapping.wrapInputs(Umat, z);
+        REQUIRE((z.middleRows(Tph * Tnx, Tnu * Tch) - (mapping.Iu2z() * u)).norm() < 1e-10);
+        REQUIRE((z.middleRows(Tph * Tnx, Tnu * Tch) - x.middleRows(Tph * Tnx, Tnu * Tch)).norm() < 1e-8);
+
+        // the Jacobian matrices w.r.t. the inputs are weighted by the basis
+        mpc::mat<Tnc, TVAR(Tph * Tnu)> Ju;
+        Ju.resize(Tnc, Tph * Tnu);
+        for (int i = 0; i < Ju.size(); i++)
+        {
+            Ju(i) = std::cos(i + 1.0);
+        }
+
+        mpc::mat<Tnc, TVAR(Tnu * Tch)> Jz;
+        Jz.resize(Tnc, Tnu * Tch);
+        mapping.template blockInputJacobian<Tnc>(Ju, Jz);
+        REQUIRE((Jz - (Ju * mapping.Iz2u())).norm() < 1e-12);
+
+        mpc::mat<TVAR(Tph + 1), TVAR(Tnu)> D;
+        D.resize(Tph + 1, Tnu);
+        for (int c = 0; c < Tnu * Tch; c++)
+        {
+            mapping.inputDirection(c, D);
+            for (int k = 0; k < Tph; k++)
+            {
+                REQUIRE((D.row(k).transpose() - mapping.Iz2u().block(k * Tnu, c, Tnu, 1)).norm() < 1e-15);
+            }
+        }
+
+        // the coefficients are never shifted
+        for (bool shiftable : mapping.shiftableInputBlocks())
+        {
+            REQUIRE_FALSE(shiftable);
+        }
+
+        mpc::mat<TVAR(Tph), TVAR(Tch)> B;
+        B.resize(Tph, Tch);
+        for (int k = 0; k < Tph; k++)
+        {
+            for (int j = 0; j < Tch; j++)
+            {
+                B(k, j) = mapping.inputWeight(k, j);
+            }
+        }
+
+        if (basis == mpc::NLInputBasis::BSPLINE)
+        {
+            // the splines are a partition of unity
+            for (int k = 0; k < Tph; k++)
+            {
+                REQUIRE(std::fabs(B.row(k).sum() - 1.0) < 1e-12);
+                REQUIRE(B.row(k).minCoeff() >= 0);
+            }
+        }
+        else if (basis == mpc::NLInputBasis::LAGUERRE && Tph >= 40)
+        {
+            // the Laguerre functions are orthonormal over a long horizon
+            REQUIRE((B.transpose() * B - mpc::mat<TVAR(Tch), TVAR(Tch)>::Identity(Tch, Tch)).norm() < 1e-8);
+        }
+    }
+
+    // the piecewise constant blocking is restored
+    REQUIRE(mapping.setInputBasis(mpc::NLInputBasis::BLOCKING, 0.5, 3, {}));
+    for (int k = 0; k < Tph; k++)
+    {
+        REQUIRE(mapping.inputWeight(k, std::min(k, Tch - 1)) == 1.0);
+    }
+}
+
 TEMPLATE_TEST_CASE_SIG(
     MPC_TEST_NAME("Checking horizon slicing validation"),
     MPC_TEST_TAGS("[horizon slicing][template]"),
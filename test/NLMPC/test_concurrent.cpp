@@ -0,0 +1,192 @@
+/*
+ *   Copyright (c) 2023 Nicola Piccinelli
+ *   All rights reserved.
+ */
+#include "basic.hpp"
+#include <catch2/catch_test_macros.hpp>
+
+namespace
+{
+    using namespace nlmpc_fixture;
+
+    constexpr int Tineq = Tph + 1;
+    constexpr int Teq = 1;
+
+    using ConcurrentController = Controller<Tineq, Teq>;
+
+    std::shared_ptr<ConcurrentController> buildConstrainedController(mpc::NLParameters params, double umax)
+    {
+        auto optsolver = makeController<Tineq, Teq>();
+        optsolver->setOptimizerParameters(params);
+        setPendulumModel(optsolver);
+        setQuadraticObjective(optsolver);
+
+        optsolver->setIneqConFunction([umax](
+                                          mpc::cvec<TVAR(Tineq)> &in_con,
+                                          const mpc::mat<TVAR(Tph + 1), TVAR(Tnx)> &,
+                                          const mpc::mat<TVAR(Tph + 1), TVAR(Tny)> &,
+                                          const mpc::mat<TVAR(Tph + 1), TVAR(Tnu)> &u,
+                                          const double &)
+                                      {
+            for (int i = 0; i < Tineq; i++) {
+                in_con(i) = u(i, 0) * u(i, 0) - umax * umax;
+            } });
+
+        // the first two inputs are equal
+        optsolver->setEqConFunction([](
+                                        mpc::cvec<TVAR(Teq)> &eq_con,
+                                        const mpc::mat<TVAR(Tph + 1), TVAR(Tnx)> &,
+                                        const mpc::mat<TVAR(Tph + 1), TVAR(Tnu)> &u)
+                                    { eq_con(0) = u(0, 0) - u(1, 0); });
+
+        return optsolver;
+    }
+} // namespace
+
+TEST_CASE(
+    MPC_TEST_NAME("Concurrent evaluation of the constraints"),
+    MPC_TEST_TAGS("[concurrent]"))
+{
+    for (bool hard : {false, true})
+    {
+        mpc::NLParameters sequential_params;
+        sequential_params.maximum_iteration = 200;
+        sequential_params.relative_xtol = 1e-8;
+        sequential_params.hard_constraints = hard;
+
+        mpc::NLParameters concurrent_params = sequential_params;
+        concurrent_params.concurrent_evaluation = true;
+
+        auto sequential = buildConstrainedController(sequential_params, 1.5);
+        auto concurrent = buildConstrainedController(concurrent_params, 1.5);
+
+        mpc::cvec<TVAR(Tnx)> x(Tnx);
+        x << 1.0, 0.0;
+
+        mpc::cvec<TVAR(Tnu)> u(Tnu);
+        u.setZero();
+
+        // the team evaluates the same functions, so the closed loops are the same
+        for (int k = 0; k < 5; k++)
+        {
+            auto r_sequential = sequential->optimize(x, u);
+            auto r_concurrent = concurrent->optimize(x, u);
+
+            REQUIRE(r_concurrent.status == r_sequential.status);
+            REQUIRE(r_concurrent.is_feasible == r_sequential.is_feasible);
+            REQUIRE(std::fabs(r_concurrent.cost - r_sequential.cost) <= 1e-9 * std::max(1.0, std::fabs(r_sequential.cost)));
+            REQUIRE((r_concurrent.cmd - r_sequential.cmd).cwiseAbs().maxCoeff() <= 1e-9);
+
+            u = r_concurrent.cmd;
+            x(0) = x(0) + ts * x(1);
+            x(1) = x(1) + ts * (-std::sin(x(0)) - 0.1 * x(1) + u(0));
+        }
+    }
+}
+
+TEST_CASE(
+    MPC_TEST_NAME("Concurrent evaluation follows the changes of the constraints"),
+    MPC_TEST_TAGS("[concurrent]"))
+{
+    mpc::NLParameters sequential_params;
+    sequential_params.maximum_iteration = 200;
+    sequential_params.relative_xtol = 1e-8;
+
+    mpc::NLParameters concurrent_params = sequential_params;
+    concurrent_params.concurrent_evaluation = true;
+
+    std::shared_ptr<ConcurrentController> optsolver[] = {
+        buildConstrainedController(sequential_params, 2.0),
+        buildConstrainedController(concurrent_params, 2.0)};
+
+    mpc::cvec<TVAR(Tnx)> x(Tnx);
+    x << 2.0, 0.0;
+
+    mpc::cvec<TVAR(Tnu)> u(Tnu);
+    u.setZero();
+
+    auto compare = [&]()
+    {
+        auto r_sequential = optsolver[0]->optimize(x, u);
+        auto r_concurrent = optsolver[1]->optimize(x, u);
+
+        REQUIRE(r_concurrent.status == r_sequential.status);
+        REQUIRE(r_concurrent.is_feasible == r_sequential.is_feasible);
+        REQUIRE((r_concurrent.cmd - r_sequential.cmd).cwiseAbs().maxCoeff() <= 1e-9);
+    };
+
+    compare();
+
+    // the user constraints registered again are evaluated by the team
+    for (auto &s : optsolver)
+    {
+        s->setIneqConFunction([](
+                                  mpc::cvec<TVAR(Tineq)> &in_con,
+                                  const mpc::mat<TVAR(Tph + 1), TVAR(Tnx)> &,
+                                  const mpc::mat<TVAR(Tph + 1), TVAR(Tny)> &,
+                                  const mpc::mat<TVAR(Tph + 1), TVAR(Tnu)> &u,
+                                  const double &)
+                              {
+            for (int i = 0; i < Tineq; i++) {
+                in_con(i) = u(i, 0) * u(i, 0) - 0.25;
+            } });
+    }
+
+    compare();
+
+    // the team is not used by the single shooting formulation
+    sequential_params.formulation = mpc::NLFormulation::SINGLE_SHOOTING;
+    concurrent_params.formulation = mpc::NLFormulation::SINGLE_SHOOTING;
+    optsolver[0]->setOptimizerParameters(sequential_params);
+    optsolver[1]->setOptimizerParameters(concurrent_params);
+
+    compare();
+}
+
+TEST_CASE(
+    MPC_TEST_NAME("Concurrent evaluation reports the errors of the team"),
+    MPC_TEST_TAGS("[concurrent]"))
+{
+    mpc::NLParameters params;
+    params.maximum_iteration = 200;
+    params.concurrent_evaluation = true;
+
+    auto optsolver = buildConstrainedController(params, 1.5);
+
+    mpc::cvec<TVAR(Tnx)> x(Tnx);
+    x << 1.0, 0.0;
+
+    mpc::cvec<TVAR(Tnu)> u(Tnu);
+    u.setZero();
+
+    auto r = optsolver->optimize(x, u);
+    REQUIRE(r.status != mpc::ResultStatus::ERROR);
+
+    // the user constraints are evaluated by a thread of the team
+    optsolver->setIneqConFunction([](
+                                      mpc::cvec<TVAR(Tineq)> &,
+                                      const mpc::mat<TVAR(Tph + 1), TVAR(Tnx)> &,
+                                      const mpc::mat<TVAR(Tph + 1), TVAR(Tny)> &,
+                                      const mpc::mat<TVAR(Tph + 1), TVAR(Tnu)> &,
+                                      const double &)
+                                  { throw std::runtime_error("constraint failure"); });
+
+    r = optsolver->optimize(x, u);
+    REQUIRE(r.status == mpc::ResultStatus::ERROR);
+    REQUIRE(r.solver_status_msg.find("constraint failure") != std::string::npos);
+
+    // the team is idle after the error, so the constraints can be replaced
+    optsolver->setIneqConFunction([](
+                                      mpc::cvec<TVAR(Tineq)> &in_con,
+                                      const mpc::mat<TVAR(Tph + 1), TVAR(Tnx)> &,
+                                      const mpc::mat<TVAR(Tph + 1), TVAR(Tny)> &,
+                                      const mpc::mat<TVAR(Tph + 1), TVAR(Tnu)> &u,
+                                      const double &)
+                                  {
+            for (int i = 0; i < Tineq; i++) {
+                in_con(i) = u(i, 0) * u(i, 0) - 2.25;
+            } });
+
+    r = optsolver->optimize(x, u);
+    REQUIRE(r.status != mpc::ResultStatus::ERROR);
+}
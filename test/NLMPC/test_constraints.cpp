@@ -78,6 +78,575 @@ TEMPLATE_TEST_CASE_SIG(
     REQUIRE(c.grad.isZero());
 }
 
+TEMPLATE_TEST_CASE_SIG(
+    MPC_TEST_NAME("Checking batched model equality constraints"),
+    MPC_TEST_TAGS("[constraints][template]"),
+    ((int Tnx, int Tnu, int Tny, int Tph, int Tch, int Tineq), Tnx, Tnu, Tny, Tph, Tch, Tineq),
+    (2, 1, 1, 5, 5, 0), (2, 1, 1, 5, 3, 0))
+{
+    constexpr int Teq = 0;
+    static constexpr auto sizer = mpc::MPCSize(TVAR(Tnx), TVAR(Tnu), TVAR(0), TVAR(Tny), TVAR(Tph), TVAR(Tch), TVAR(Tineq), TVAR(Teq));
+
+    auto vanderpol = [](
+                         mpc::cvec<TVAR(Tnx)> &dx,
+                         const mpc::cvec<TVAR(Tnx)> &x,
+                         const mpc::cvec<TVAR(Tnu)> &u,
+                         const unsigned int &p)
+    {
+        dx[0] = ((1.0 - (x[1] * x[1])) * x[0]) - x[1] + (u[0] * (1.0 + (0.1 * p)));
+        dx[1] = x[0];
+    };
+
+    int batches = 0;
+    auto batched = [&](
+                       mpc::mat<TVAR(Tnx), Eigen::Dynamic> &F,
+                       const mpc::mat<TVAR(Tnx), Eigen::Dynamic> &X,
+                       const mpc::mat<TVAR(Tnu), Eigen::Dynamic> &U,
+                       const std::vector<unsigned int> &steps)
+    {
+        batches++;
+        REQUIRE(X.cols() == (int)steps.size());
+        REQUIRE(U.cols() == (int)steps.size());
+
+        for (size_t j = 0; j < steps.size(); j++)
+        {
+            F(0, j) = ((1.0 - (X(1, j) * X(1, j))) * X(0, j)) - X(1, j) + (U(0, j) * (1.0 + (0.1 * steps[j])));
+            F(1, j) = X(0, j);
+        }
+    };
+
+    // input decision variables vector
+    mpc::cvec<TVAR(((Tph * Tnx) + (Tnu * Tch) + 1))> x;
+    x.resize((Tph * Tnx) + (Tnu * Tch) + 1);
+    for (int i = 0; i < x.rows(); i++)
+    {
+        x[i] = 0.1 * std::sin(i);
+    }
+
+    mpc::cvec<TVAR(Tnx)> x0;
+    x0.resize(Tnx);
+    x0 << 0.5, -0.2;
+
+    for (bool continuous : {true, false})
+    {
+        std::shared_ptr<mpc::Constraints<sizer>> conFunc[2];
+        std::shared_ptr<mpc::Model<sizer>> model[2];
+
+        std::shared_ptr<mpc::Mapping<sizer>> mapping;
+        mapping = std::make_shared<mpc::Mapping<sizer>>();
+        mapping->initialize(Tnx, Tnu, 0, Tny, Tph, Tch, Tineq, Teq);
+
+        for (int k = 0; k < 2; k++)
+        {
+            conFunc[k] = std::make_shared<mpc::Constraints<sizer>>();
+            conFunc[k]->initialize(Tnx, Tnu, 0, Tny, Tph, Tch, Tineq, Teq);
+
+            model[k] = std::make_shared<mpc::Model<sizer>>();
+            model[k]->initialize(Tnx, Tnu, 0, Tny, Tph, Tch, Tineq, Teq);
+            model[k]->setContinuous(continuous, 0.1);
+        }
+
+        model[0]->setStateModel(vanderpol);
+        model[1]->setBatchStateModel(batched);
+
+        REQUIRE_FALSE(model[0]->hasBatchStateModel());
+        REQUIRE(model[1]->hasBatchStateModel());
+
+        for (int k = 0; k < 2; k++)
+        {
+            conFunc[k]->setModel(model[k], mapping);
+            conFunc[k]->setCurrentState(x0);
+        }
+
+        batches = 0;
+        auto c_scalar = conFunc[0]->evaluateStateModelEq(x, true);
+        auto c_batched = conFunc[1]->evaluateStateModelEq(x, true);
+
+        // a single batch for the constraints value and one for the finite differences
+        REQUIRE(batches == 2);
+        REQUIRE((c_scalar.value - c_batched.value).cwiseAbs().maxCoeff() < 1e-12);
+        REQUIRE((c_scalar.grad - c_batched.grad).cwiseAbs().maxCoeff() < 1e-9);
+
+        // the single point update function is derived from the batched one
+        mpc::cvec<TVAR(Tnx)> f_scalar(Tnx), f_batched(Tnx);
+        mpc::cvec<TVAR(Tnu)> u(Tnu);
+        u << 0.3;
+        model[0]->vectorField(f_scalar, x0, u, 2);
+        model[1]->vectorField(f_batched, x0, u, 2);
+        REQUIRE((f_scalar - f_batched).norm() < 1e-12);
+    }
+}
+
+TEMPLATE_TEST_CASE_SIG(
+    MPC_TEST_NAME("Checking packet model equality constraints"),
+    MPC_TEST_TAGS("[constraints][template]"),
+    ((int Tnx, int Tnu, int Tny, int Tph, int Tch, int Tineq), Tnx, Tnu, Tny, Tph, Tch, Tineq),
+    (2, 1, 1, 5, 5, 0), (2, 1, 1, 7, 3, 0))
+{
+    constexpr int Teq = 0;
+    static constexpr auto sizer = mpc::MPCSize(TVAR(Tnx), TVAR(Tnu), TVAR(0), TVAR(Tny), TVAR(Tph), TVAR(Tch), TVAR(Tineq), TVAR(Teq));
+
+    auto vanderpol = [](
+                         mpc::cvec<TVAR(Tnx)> &dx,
+                         const mpc::cvec<TVAR(Tnx)> &x,
+                         const mpc::cvec<TVAR(Tnu)> &u,
+                         const unsigned int &p)
+    {
+        dx[0] = ((1.0 - (x[1] * x[1])) * x[0]) - x[1] + (u[0] * (1.0 + (0.1 * p)));
+        dx[1] = x[0];
+    };
+
+    int lanes = 0;
+    auto packet = [&](auto &dx, const auto &x, const auto &u, const auto &steps)
+    {
+        lanes = std::max(lanes, (int)x.cols());
+
+        Eigen::Array<double, 1, Eigen::Dynamic> gain(steps.size());
+        for (size_t l = 0; l < steps.size(); l++)
+        {
+            gain(l) = 1.0 + (0.1 * steps[l]);
+        }
+
+        dx.row(0) = ((1.0 - x.row(1).square()) * x.row(0)) - x.row(1) + (u.row(0) * gain);
+        dx.row(1) = x.row(0);
+    };
+
+    // input decision variables vector
+    mpc::cvec<TVAR(((Tph * Tnx) + (Tnu * Tch) + 1))> x;
+    x.resize((Tph * Tnx) + (Tnu * Tch) + 1);
+    for (int i = 0; i < x.rows(); i++)
+    {
+        x[i] = 0.1 * std::cos(i);
+    }
+
+    mpc::cvec<TVAR(Tnx)> x0;
+    x0.resize(Tnx);
+    x0 << -0.3, 0.4;
+
+    for (bool continuous : {true, false})
+    {
+        std::shared_ptr<mpc::Constraints<sizer>> conFunc[2];
+        std::shared_ptr<mpc::Model<sizer>> model[2];
+
+        std::shared_ptr<mpc::Mapping<sizer>> mapping;
+        mapping = std::make_shared<mpc::Mapping<sizer>>();
+        mapping->initialize(Tnx, Tnu, 0, Tny, Tph, Tch, Tineq, Teq);
+
+        for (int k = 0; k < 2; k++)
+        {
+            conFunc[k] = std::make_shared<mpc::Constraints<sizer>>();
+            conFunc[k]->initialize(Tnx, Tnu, 0, Tny, Tph, Tch, Tineq, Teq);
+
+            model[k] = std::make_shared<mpc::Model<sizer>>();
+            model[k]->initialize(Tnx, Tnu, 0, Tny, Tph, Tch, Tineq, Teq);
+            model[k]->setContinuous(continuous, 0.1);
+        }
+
+        model[0]->setStateModel(vanderpol);
+        REQUIRE(model[1]->setPacketStateModel(packet));
+        REQUIRE(model[1]->hasBatchStateModel());
+
+        for (int k = 0; k < 2; k++)
+        {
+            conFunc[k]->setModel(model[k], mapping);
+            conFunc[k]->setCurrentState(x0);
+        }
+
+        lanes = 0;
+        auto c_scalar = conFunc[0]->evaluateStateModelEq(x, true);
+        auto c_packet = conFunc[1]->evaluateStateModelEq(x, true);
+
+        REQUIRE(lanes == mpc::Model<sizer>::packetLanes());
+        REQUIRE((c_scalar.value - c_packet.value).cwiseAbs().maxCoeff() < 1e-12);
+        REQUIRE((c_scalar.grad - c_packet.grad).cwiseAbs().maxCoeff() < 1e-9);
+
+        // single points are evaluated on packets of one lane
+        mpc::cvec<TVAR(Tnx)> f_scalar(Tnx), f_packet(Tnx);
+        mpc::cvec<TVAR(Tnu)> u(Tnu);
+        u << -0.7;
+        model[0]->vectorField(f_scalar, x0, u, 3);
+        model[1]->vectorField(f_packet, x0, u, 3);
+        REQUIRE((f_scalar - f_packet).norm() < 1e-12);
+    }
+}
+
+TEMPLATE_TEST_CASE_SIG(
+    MPC_TEST_NAME("Checking integrated model equality constraints"),
+    MPC_TEST_TAGS("[constraints][template]"),
+    ((int Tnx, int Tnu, int Tny, int Tph, int Tch, int Tineq), Tnx, Tnu, Tny, Tph, Tch, Tineq),
+    (2, 1, 1, 5, 5, 0))
+{
+    constexpr int Teq = 0;
+    static constexpr auto sizer = mpc::MPCSize(TVAR(Tnx), TVAR(Tnu), TVAR(0), TVAR(Tny), TVAR(Tph), TVAR(Tch), TVAR(Tineq), TVAR(Teq));
+
+    constexpr int N = (Tph * Tnx) + (Tnu * Tch) + 1;
+    const double ts = 0.1;
+
+    std::shared_ptr<mpc::Constraints<sizer>> conFunc;
+    conFunc = std::make_shared<mpc::Constraints<sizer>>();
+    conFunc->initialize(Tnx, Tnu, 0, Tny, Tph, Tch, Tineq, Teq);
+
+    std::shared_ptr<mpc::Mapping<sizer>> mapping;
+    mapping = std::make_shared<mpc::Mapping<sizer>>();
+    mapping->initialize(Tnx, Tnu, 0, Tny, Tph, Tch, Tineq, Teq);
+
+    std::shared_ptr<mpc::Model<sizer>> model;
+    model = std::make_shared<mpc::Model<sizer>>();
+    model->initialize(Tnx, Tnu, 0, Tny, Tph, Tch, Tineq, Teq);
+
+    // first order lags with a known exact discretization
+    model->setContinuous(true, ts);
+    model->setStateModel([](
+                             mpc::cvec<TVAR(Tnx)> &dx,
+                             const mpc::cvec<TVAR(Tnx)> &x,
+                             const mpc::cvec<TVAR(Tnu)> &u,
+                             const unsigned int &)
+                         {
+        dx[0] = -x[0] + u[0];
+        dx[1] = -2.0 * x[1] + (x[0] * u[0]); });
+
+    conFunc->setModel(model, mapping);
+
+    mpc::cvec<TVAR(Tnx)> x0;
+    x0.resize(Tnx);
+    x0 << 1.0, -0.5;
+    conFunc->setCurrentState(x0);
+
+    // states of the exact solution with a constant input, the second state
+    // is integrated with a fine explicit euler
+    const double uc = 0.4;
+    mpc::cvec<TVAR(N)> x;
+    x.resize(N);
+    x.setConstant(uc);
+
+    mpc::cvec<TVAR(Tnx)> xk = x0;
+    for (int i = 0; i < Tph; i++)
+    {
+        for (int s = 0; s < 100000; s++)
+        {
+            double dt = ts / 100000;
+            mpc::cvec<TVAR(Tnx)> dx(Tnx);
+            dx << -xk[0] + uc, -2.0 * xk[1] + (xk[0] * uc);
+            xk += dt * dx;
+        }
+        x.segment(i * Tnx, Tnx) = xk;
+    }
+
+    auto trapezoidal = conFunc->evaluateStateModelEq(x, false);
+    REQUIRE_FALSE(model->isIntegrated());
+    REQUIRE(trapezoidal.value.cwiseAbs().maxCoeff() > 1e-5);
+
+    for (auto method : {mpc::NLIntegrator::RK4, mpc::NLIntegrator::RKF32, mpc::NLIntegrator::SDIRK})
+    {
+        model->setIntegrator(method, 2, 1e-10);
+        REQUIRE(model->isIntegrated());
+
+        // the defect is the error of the integrator (and of the reference)
+        auto c = conFunc->evaluateStateModelEq(x, true);
+        REQUIRE(c.value.cwiseAbs().maxCoeff() < 1e-5);
+
+        // the sensitivities of the integrated end state match the
+        // finite differences of the defects
+        for (int j = 0; j < N - 1; j++)
+        {
+            mpc::cvec<TVAR(N)> xp = x, xm = x;
+            xp[j] += 1e-6;
+            xm[j] -= 1e-6;
+
+            auto cp = conFunc->evaluateStateModelEq(xp, false);
+            auto cm = conFunc->evaluateStateModelEq(xm, false);
+
+            for (int k = 0; k < Tph * Tnx; k++)
+            {
+                REQUIRE(std::fabs(((cp.value[k] - cm.value[k]) / 2e-6) - c.grad[j + (N * k)]) < 1e-4);
+            }
+        }
+    }
+}
+
+TEMPLATE_TEST_CASE_SIG(
+    MPC_TEST_NAME("Checking adaptive integration of each point"),
+    MPC_TEST_TAGS("[constraints][template]"),
+    ((int Tnx, int Tnu), Tnx, Tnu),
+    (2, 1))
+{
+    static constexpr auto sizer = mpc::MPCSize(TVAR(Tnx), TVAR(Tnu), TVAR(0), TVAR(0), TVAR(1), TVAR(1), TVAR(0), TVAR(0));
+
+    std::shared_ptr<mpc::Model<sizer>> model;
+    model = std::make_shared<mpc::Model<sizer>>();
+    model->initialize(Tnx, Tnu, 0, 0, 1, 1, 0, 0);
+
+    // the vector field is not finite for negative values of the first state
+    model->setContinuous(true, 0.1);
+    model->setStateModel([](
+                             mpc::cvec<TVAR(Tnx)> &dx,
+                             const mpc::cvec<TVAR(Tnx)> &x,
+                             const mpc::cvec<TVAR(Tnu)> &u,
+                             const unsigned int &)
+                         {
+        dx[0] = -50.0 * x[0] + u[0];
+        dx[1] = std::sqrt(x[0]); });
+    model->setIntegrator(mpc::NLIntegrator::RKF32, 1, 1e-8);
+
+    mpc::cvec<TVAR(Tnx)> xa(Tnx), xb(Tnx), f(Tnx);
+    mpc::cvec<TVAR(Tnu)> u(Tnu);
+    xa << 1.0, 0.0;
+    xb << 0.5, 0.2;
+    u << 0.5;
+
+    // the non-finite transition is returned to the caller
+    mpc::cvec<TVAR(Tnx)> xn(Tnx);
+    xn << -1.0, 0.0;
+    model->transition(f, xn, u, 0);
+    REQUIRE_FALSE(f.allFinite());
+
+    // the transition of a point does not depend on the other points of the batch
+    mpc::cvec<TVAR(Tnx)> fa(Tnx), fb(Tnx);
+    model->transition(fa, xa, u, 0);
+    model->transition(fb, xb, u, 0);
+    REQUIRE(fa.allFinite());
+
+    mpc::mat<TVAR(Tnx), Eigen::Dynamic> X(Tnx, 3), F(Tnx, 3);
+    mpc::mat<TVAR(Tnu), Eigen::Dynamic> U(Tnu, 3);
+    X << xa, xb, xn;
+    U << u, u, u;
+    model->transitionBatch(F, X, U, {0, 1, 2});
+
+    REQUIRE(F.col(0) == fa);
+    REQUIRE(F.col(1) == fb);
+    REQUIRE_FALSE(F.col(2).allFinite());
+
+    // the sensitivities follow the sub-steps of their point
+    mpc::mat<TVAR(Tnx), Eigen::Dynamic> Jx, Jmv;
+    model->transitionJacobians(Jx, Jmv, X.leftCols(2), U.leftCols(2), {0, 1});
+
+    for (int j = 0; j < 2; j++)
+    {
+        for (int i = 0; i < Tnx; i++)
+        {
+            mpc::cvec<TVAR(Tnx)> xp = X.col(j), xm = X.col(j), fp(Tnx), fm(Tnx);
+            xp[i] += 1e-7;
+            xm[i] -= 1e-7;
+            model->transition(fp, xp, u, 0);
+            model->transition(fm, xm, u, 0);
+            REQUIRE(((fp - fm) / 2e-7 - Jx.col((j * Tnx) + i)).cwiseAbs().maxCoeff() < 1e-4);
+        }
+    }
+}
+
+TEMPLATE_TEST_CASE_SIG(
+    MPC_TEST_NAME("Checking stiff model equality constraints"),
+    MPC_TEST_TAGS("[constraints][template]"),
+    ((int Tnx, int Tnu, int Tny, int Tph, int Tch, int Tineq), Tnx, Tnu, Tny, Tph, Tch, Tineq),
+    (2, 1, 1, 5, 5, 0))
+{
+    constexpr int Teq = 0;
+    static constexpr auto sizer = mpc::MPCSize(TVAR(Tnx), TVAR(Tnu), TVAR(0), TVAR(Tny), TVAR(Tph), TVAR(Tch), TVAR(Tineq), TVAR(Teq));
+
+    constexpr int N = (Tph * Tnx) + (Tnu * Tch) + 1;
+    const double ts = 0.1;
+    const double lambda = 1000.0;
+
+    std::shared_ptr<mpc::Constraints<sizer>> conFunc;
+    conFunc = std::make_shared<mpc::Constraints<sizer>>();
+    conFunc->initialize(Tnx, Tnu, 0, Tny, Tph, Tch, Tineq, Teq);
+
+    std::shared_ptr<mpc::Mapping<sizer>> mapping;
+    mapping = std::make_shared<mpc::Mapping<sizer>>();
+    mapping->initialize(Tnx, Tnu, 0, Tny, Tph, Tch, Tineq, Teq);
+
+    std::shared_ptr<mpc::Model<sizer>> model;
+    model = std::make_shared<mpc::Model<sizer>>();
+    model->initialize(Tnx, Tnu, 0, Tny, Tph, Tch, Tineq, Teq);
+
+    // a fast lag (time constant much shorter than the sampling time)
+    // driving a slow one
+    model->setContinuous(true, ts);
+    model->setStateModel([lambda](
+                             mpc::cvec<TVAR(Tnx)> &dx,
+                             const mpc::cvec<TVAR(Tnx)> &x,
+                             const mpc::cvec<TVAR(Tnu)> &u,
+                             const unsigned int &)
+                         {
+        dx[0] = -lambda * (x[0] - u[0]);
+        dx[1] = x[0] - x[1]; });
+
+    conFunc->setModel(model, mapping);
+
+    mpc::cvec<TVAR(Tnx)> x0;
+    x0.resize(Tnx);
+    x0 << 1.0, -0.5;
+    conFunc->setCurrentState(x0);
+
+    // states of the exact solution with a constant input
+    const double uc = 0.4;
+    mpc::cvec<TVAR(N)> x;
+    x.resize(N);
+    x.setConstant(uc);
+
+    double c = x0[0] - uc;
+    double k = c / (1.0 - lambda);
+    for (int i = 0; i < Tph; i++)
+    {
+        double t = ts * (i + 1);
+        x[i * Tnx] = uc + (c * std::exp(-lambda * t));
+        x[(i * Tnx) + 1] = uc + (k * std::exp(-lambda * t)) + ((x0[1] - uc - k) * std::exp(-t));
+    }
+
+    // the explicit method is unstable on the fast lag
+    model->setIntegrator(mpc::NLIntegrator::RK4, 1, 1e-10);
+    auto explicitDefect = conFunc->evaluateStateModelEq(x, false);
+    REQUIRE(explicitDefect.value.cwiseAbs().maxCoeff() > 1.0);
+
+    // the implicit method is stable on the same step, the transient of the
+    // fast lag is damped and the slow lag is accurate
+    model->setIntegrator(mpc::NLIntegrator::SDIRK, 1, 1e-10);
+    auto c0 = conFunc->evaluateStateModelEq(x, true);
+    for (int i = 0; i < Tph; i++)
+    {
+        REQUIRE(std::fabs(c0.value[i * Tnx]) < 0.1 * std::fabs(c));
+        REQUIRE(std::fabs(c0.value[(i * Tnx) + 1]) < 1e-3);
+    }
+
+    for (int j = 0; j < N - 1; j++)
+    {
+        mpc::cvec<TVAR(N)> xp = x, xm = x;
+        xp[j] += 1e-6;
+        xm[j] -= 1e-6;
+
+        auto cp = conFunc->evaluateStateModelEq(xp, false);
+        auto cm = conFunc->evaluateStateModelEq(xm, false);
+
+        for (int i = 0; i < Tph * Tnx; i++)
+        {
+            REQUIRE(std::fabs(((cp.value[i] - cm.value[i]) / 2e-6) - c0.grad[j + (N * i)]) < 1e-4);
+        }
+    }
+}
+
+TEMPLATE_TEST_CASE_SIG(
+    MPC_TEST_NAME("Checking unconverged implicit stages"),
+    MPC_TEST_TAGS("[constraints][template]"),
+    ((int Tnx, int Tnu), Tnx, Tnu),
+    (2, 1))
+{
+    static constexpr auto sizer = mpc::MPCSize(TVAR(Tnx), TVAR(Tnu), TVAR(0), TVAR(0), TVAR(1), TVAR(1), TVAR(0), TVAR(0));
+
+    std::shared_ptr<mpc::Model<sizer>> model;
+    model = std::make_shared<mpc::Model<sizer>>();
+    model->initialize(Tnx, Tnu, 0, 0, 1, 1, 0, 0);
+
+    // the cubic decay is stiff far from the origin, where the iteration matrix frozen
+    // at the beginning of the step does not make the Newton iterations converge
+    model->setContinuous(true, 0.1);
+    model->setStateModel([](
+                             mpc::cvec<TVAR(Tnx)> &dx,
+                             const mpc::cvec<TVAR(Tnx)> &x,
+                             const mpc::cvec<TVAR(Tnu)> &u,
+                             const unsigned int &)
+                         {
+        dx[0] = (-1e4 * x[0] * x[0] * x[0]) + u[0];
+        dx[1] = -x[1]; });
+    model->setIntegrator(mpc::NLIntegrator::SDIRK, 1, 1e-10);
+
+    mpc::cvec<TVAR(Tnx)> xa(Tnx), xb(Tnx), f(Tnx);
+    mpc::cvec<TVAR(Tnu)> u(Tnu);
+    xa << 1e-3, 1.0;
+    xb << 0.1, 1.0;
+    u << 0.0;
+
+    // the step close to the origin is almost linear and converges
+    model->transition(f, xa, u, 0);
+    REQUIRE(f.allFinite());
+    REQUIRE(std::fabs(f[1] - std::exp(-0.1)) < 1e-6);
+
+    // the unconverged stages are finite but they are not used as the transition
+    model->transition(f, xb, u, 0);
+    REQUIRE_FALSE(f.allFinite());
+
+    // shorter sub-steps converge
+    model->setIntegrator(mpc::NLIntegrator::SDIRK, 20, 1e-10);
+    model->transition(f, xb, u, 0);
+    REQUIRE(f.allFinite());
+    model->setIntegrator(mpc::NLIntegrator::SDIRK, 1, 1e-10);
+
+    mpc::mat<TVAR(Tnx), Eigen::Dynamic> X(Tnx, 2), F(Tnx, 2);
+    mpc::mat<TVAR(Tnu), Eigen::Dynamic> U(Tnu, 2);
+    X << xa, xb;
+    U << u, u;
+    model->transitionBatch(F, X, U, {0, 1});
+
+    REQUIRE(F.col(0).allFinite());
+    REQUIRE_FALSE(F.col(1).allFinite());
+
+    // neither are their sensitivities
+    mpc::mat<TVAR(Tnx), Eigen::Dynamic> Jx, Jmv;
+    model->transitionJacobians(Jx, Jmv, X, U, {0, 1});
+
+    REQUIRE(Jx.leftCols(Tnx).allFinite());
+    REQUIRE(Jmv.leftCols(Tnu).allFinite());
+    REQUIRE_FALSE(Jx.rightCols(Tnx).allFinite());
+    REQUIRE_FALSE(Jmv.rightCols(Tnu).allFinite());
+}
+
+TEMPLATE_TEST_CASE_SIG(
+    MPC_TEST_NAME("Checking single shooting rollout with unconverged implicit stages"),
+    MPC_TEST_TAGS("[constraints][shooting][template]"),
+    ((int Tnx, int Tnu, int Tph, int Tch), Tnx, Tnu, Tph, Tch),
+    (2, 1, 3, 3))
+{
+    static constexpr auto sizer = mpc::MPCSize(TVAR(Tnx), TVAR(Tnu), TVAR(0), TVAR(0), TVAR(Tph), TVAR(Tch), TVAR(0), TVAR(0));
+
+    auto mapping = std::make_shared<mpc::Mapping<sizer>>();
+    mapping->initialize(Tnx, Tnu, 0, 0, Tph, Tch, 0, 0);
+
+    // same stiff cubic decay of the previous case
+    auto model = std::make_shared<mpc::Model<sizer>>();
+    model->initialize(Tnx, Tnu, 0, 0, Tph, Tch, 0, 0);
+    model->setContinuous(true, 0.1);
+    model->setStateModel([](
+                             mpc::cvec<TVAR(Tnx)> &dx,
+                             const mpc::cvec<TVAR(Tnx)> &x,
+                             const mpc::cvec<TVAR(Tnu)> &u,
+                             const unsigned int &)
+                         {
+        dx[0] = (-1e4 * x[0] * x[0] * x[0]) + u[0];
+        dx[1] = -x[1]; });
+    model->setIntegrator(mpc::NLIntegrator::SDIRK, 1, 1e-10);
+
+    auto shooting = std::make_shared<mpc::SingleShooting<sizer>>();
+    shooting->initialize(Tnx, Tnu, 0, 0, Tph, Tch, 0, 0);
+    shooting->setModel(model, mapping);
+
+    mpc::cvec<TVAR((Tnu * Tch) + 1)> z((Tnu * Tch) + 1);
+    z.setZero();
+
+    mpc::cvec<TVAR(Tnx)> x0(Tnx);
+    x0 << 1e-3, 1.0;
+    shooting->setCurrentState(x0);
+    shooting->expand(z, true);
+    REQUIRE(shooting->isConverged());
+    REQUIRE(shooting->fullVector().allFinite());
+
+    // the failed point of the integrator makes the whole rollout fail, with
+    // and without the sensitivities
+    x0 << 0.1, 1.0;
+    shooting->setCurrentState(x0);
+    shooting->expand(z, false);
+    REQUIRE_FALSE(shooting->isConverged());
+
+    shooting->expand(z, true);
+    REQUIRE_FALSE(shooting->isConverged());
+
+    // shorter sub-steps converge (a new initial condition discards the cached rollout)
+    model->setIntegrator(mpc::NLIntegrator::SDIRK, 20, 1e-10);
+    x0 << 0.1, 0.5;
+    shooting->setCurrentState(x0);
+    shooting->expand(z, true);
+    REQUIRE(shooting->isConverged());
+    REQUIRE(shooting->fullVector().allFinite());
+}
+
 TEMPLATE_TEST_CASE_SIG(
     MPC_TEST_NAME("Checking user inequality constraints"),
     MPC_TEST_TAGS("[constraints][template]"),
@@ -208,4 +777,243 @@ TEMPLATE_TEST_CASE_SIG(
 
     REQUIRE(c.value == costExpected);
     REQUIRE(c.grad.isZero());
-}
\ No newline at end of file
+}
+TEMPLATE_TEST_CASE_SIG(
+    MPC_TEST_NAME("Checking Broyden update of the constraints Jacobian"),
+    MPC_TEST_TAGS("[constraints][template]"),
+    ((int Tnx, int Tnu, int Tny, int Tph, int Tch, int Tineq), Tnx, Tnu, Tny, Tph, Tch, Tineq),
+    (2, 1, 2, 5, 5, 2))
+{
+    constexpr int Teq = 0;
+    static constexpr auto sizer = mpc::MPCSize(TVAR(Tnx), TVAR(Tnu), TVAR(0), TVAR(Tny), TVAR(Tph), TVAR(Tch), TVAR(Tineq), TVAR(Teq));
+
+    std::shared_ptr<mpc::Mapping<sizer>> mapping;
+    mapping = std::make_shared<mpc::Mapping<sizer>>();
+    mapping->initialize(Tnx, Tnu, 0, Tny, Tph, Tch, Tineq, Teq);
+
+    int evaluations = 0;
+
+    std::shared_ptr<mpc::Model<sizer>> model;
+    model = std::make_shared<mpc::Model<sizer>>();
+    model->initialize(Tnx, Tnu, 0, Tny, Tph, Tch, Tineq, Teq);
+    model->setContinuous(false);
+    model->setStateModel([&](
+                             mpc::cvec<TVAR(Tnx)> &xn,
+                             const mpc::cvec<TVAR(Tnx)> &x,
+                             const mpc::cvec<TVAR(Tnu)> &u,
+                             const unsigned int &)
+                         {
+        evaluations++;
+        xn[0] = x[0] + (0.1 * x[1]);
+        xn[1] = x[1] + (0.1 * (-std::sin(x[0]) + (x[1] * u[0]))); });
+
+    auto ineq = [](
+                    mpc::cvec<TVAR(Tineq)> &ieq_con,
+                    const mpc::mat<TVAR(Tph + 1), TVAR(Tnx)> &x,
+                    const mpc::mat<TVAR(Tph + 1), TVAR(Tny)> &,
+                    const mpc::mat<TVAR(Tph + 1), TVAR(Tnu)> &u,
+                    const double &)
+    {
+        ieq_con[0] = x(2, 0) - (2.0 * x(3, 1));
+        ieq_con[1] = u(1, 0) + x(0, 0);
+    };
+
+    auto build = [&](mpc::NLJacobianUpdate update)
+    {
+        auto conFunc = std::make_shared<mpc::Constraints<sizer>>();
+        conFunc->initialize(Tnx, Tnu, 0, Tny, Tph, Tch, Tineq, Teq);
+        conFunc->setModel(model, mapping);
+        conFunc->setIneqConstraints(ineq, 1e-10);
+        conFunc->setJacobianUpdate(update, 3, 0.1);
+        return conFunc;
+    };
+
+    auto reference = build(mpc::NLJacobianUpdate::FINITE_DIFFERENCE);
+    auto broyden = build(mpc::NLJacobianUpdate::BROYDEN);
+
+    mpc::cvec<TVAR(Tnx)> x0(Tnx);
+    x0 << 0.3, -0.2;
+    reference->setCurrentState(x0);
+    broyden->setCurrentState(x0);
+
+    mpc::cvec<TVAR(((Tph * Tnx) + (Tnu * Tch) + 1))> x((Tph * Tnx) + (Tnu * Tch) + 1);
+    for (int i = 0; i < x.rows(); i++)
+    {
+        x[i] = 0.1 * std::cos(i);
+    }
+
+    // the first request is always served with finite differences
+    evaluations = 0;
+    auto cb = broyden->evaluateStateModelEq(x, true);
+    int fdEvaluations = evaluations;
+    auto cr = reference->evaluateStateModelEq(x, true);
+
+    REQUIRE(fdEvaluations == Tph * (1 + (2 * (Tnx + Tnu))));
+    REQUIRE(cb.grad == cr.grad);
+
+    // small steps are served with the rank-one updates, the model
+    // is evaluated only once per step of the horizon
+    mpc::cvec<TVAR(((Tph * Tnx) + (Tnu * Tch) + 1))> dx((Tph * Tnx) + (Tnu * Tch) + 1);
+    for (int i = 0; i < dx.rows(); i++)
+    {
+        dx[i] = 1e-3 * std::sin(3 * i);
+    }
+
+    for (int k = 0; k < 3; k++)
+    {
+        x += dx;
+
+        evaluations = 0;
+        cb = broyden->evaluateStateModelEq(x, true);
+        REQUIRE(evaluations == Tph);
+
+        cr = reference->evaluateStateModelEq(x, true);
+        REQUIRE(cb.value == cr.value);
+        REQUIRE((cb.grad - cr.grad).norm() < 1e-2 * cr.grad.norm());
+    }
+
+    // the finite differences are recomputed after the given number of updates
+    x += dx;
+    evaluations = 0;
+    cb = broyden->evaluateStateModelEq(x, true);
+    REQUIRE(evaluations == fdEvaluations);
+    REQUIRE(cb.grad == reference->evaluateStateModelEq(x, true).grad);
+
+    // or when the step is large
+    x += 500 * dx;
+    evaluations = 0;
+    broyden->evaluateStateModelEq(x, true);
+    REQUIRE(evaluations == fdEvaluations);
+
+    // the user constraints are linear so that the update is exact
+    auto ib = broyden->evaluateIneq(x, true);
+    x += dx;
+    ib = broyden->evaluateIneq(x, true);
+    auto ir = reference->evaluateIneq(x, true);
+    REQUIRE(ib.value == ir.value);
+    REQUIRE((ib.grad - ir.grad).norm() < 1e-6);
+
+    // a change of the initial condition keeps the last Jacobian
+    x0 << 0.5, 0.1;
+    broyden->setCurrentState(x0);
+    reference->setCurrentState(x0);
+    x += dx;
+    ib = broyden->evaluateIneq(x, true);
+    ir = reference->evaluateIneq(x, true);
+    REQUIRE(ib.value == ir.value);
+    REQUIRE((ib.grad - ir.grad).norm() < 1e-6);
+}
+
+TEMPLATE_TEST_CASE_SIG(
+    MPC_TEST_NAME("Checking user constraints Jacobian with blocked inputs"),
+    MPC_TEST_TAGS("[constraints][template]"),
+    ((int Tnx, int Tnu, int Tny, int Tph, int Tch, int Tineq, int Teq), Tnx, Tnu, Tny, Tph, Tch, Tineq, Teq),
+    (2, 2, 1, 8, 3, 2, 1), (2, 2, 1, 5, 5, 2, 1))
+{
+    static constexpr auto sizer = mpc::MPCSize(TVAR(Tnx), TVAR(Tnu), TVAR(0), TVAR(Tny), TVAR(Tph), TVAR(Tch), TVAR(Tineq), TVAR(Teq));
+    constexpr int N = (Tph * Tnx) + (Tnu * Tch) + 1;
+
+    std::shared_ptr<mpc::Constraints<sizer>> conFunc;
+    conFunc = std::make_shared<mpc::Constraints<sizer>>();
+    conFunc->initialize(Tnx, Tnu, 0, Tny, Tph, Tch, Tineq, Teq);
+
+    std::shared_ptr<mpc::Mapping<sizer>> mapping;
+    mapping = std::make_shared<mpc::Mapping<sizer>>();
+    mapping->initialize(Tnx, Tnu, 0, Tny, Tph, Tch, Tineq, Teq);
+
+    mpc::cvec<TVAR(Tnu)> su(Tnu);
+    su << 2.0, 0.5;
+    mapping->setInputScaling(su);
+
+    std::shared_ptr<mpc::Model<sizer>> model;
+    model = std::make_shared<mpc::Model<sizer>>();
+    model->initialize(Tnx, Tnu, 0, Tny, Tph, Tch, Tineq, Teq);
+
+    model->setContinuous(true);
+    model->setStateModel([](
+                            mpc::cvec<TVAR(Tnx)> &dx,
+                            const mpc::cvec<TVAR(Tnx)> &x,
+                            const mpc::cvec<TVAR(Tnu)> &u,
+                            const unsigned int &)
+                        {
+        dx[0] = x[1] + u[0];
+        dx[1] = -x[0] + u[1]; });
+
+    conFunc->setModel(model, mapping);
+
+    int evaluations = 0;
+    conFunc->setIneqConstraints([&](
+                                    mpc::cvec<TVAR(Tineq)> &ieq_con,
+                                    const mpc::mat<TVAR(Tph + 1), TVAR(Tnx)> &x,
+                                    const mpc::mat<TVAR(Tph + 1), TVAR(Tny)> &,
+                                    const mpc::mat<TVAR(Tph + 1), TVAR(Tnu)> &u,
+                                    const double &e)
+                                {
+        evaluations++;
+        ieq_con[0] = 0;
+        for (int k = 0; k < Tph + 1; k++)
+        {
+            ieq_con[0] += (k + 1) * u(k, 0) * u(k, 0);
+        }
+        ieq_con[0] += x(3, 1) * e;
+        ieq_con[1] = (x(Tph, 0) * u(Tph, 1)) + (e * e); }, 1e-10);
+
+    conFunc->setEqConstraints([](
+                                  mpc::cvec<TVAR(Teq)> &eq_con,
+                                  const mpc::mat<TVAR(Tph + 1), TVAR(Tnx)> &x,
+                                  const mpc::mat<TVAR(Tph + 1), TVAR(Tnu)> &u)
+                              {
+        eq_con[0] = 0;
+        for (int k = 0; k < Tph + 1; k++)
+        {
+            eq_con[0] += u(k, 1) * x(k, 0);
+        } }, 1e-10);
+
+    mpc::cvec<TVAR(Tnx)> x0;
+    x0.resize(Tnx);
+    x0 << 0.3, -0.2;
+    conFunc->setCurrentState(x0);
+
+    mpc::cvec<TVAR(N)> x;
+    x.resize(N);
+    for (int i = 0; i < x.rows(); i++)
+    {
+        x[i] = 0.2 * std::sin(i + 1.0);
+    }
+
+    // reference Jacobian matrices by central differences on the whole optimization vector
+    double h = 1e-6;
+    mpc::mat<> Jieq(Tineq, N), Jeq(Teq, N);
+    for (int i = 0; i < N; i++)
+    {
+        auto xp = x;
+        auto xm = x;
+        xp[i] += h;
+        xm[i] -= h;
+        Jieq.col(i) = (conFunc->evaluateIneq(xp, false).value - conFunc->evaluateIneq(xm, false).value) / (2 * h);
+        Jeq.col(i) = (conFunc->evaluateEq(xp, false).value - conFunc->evaluateEq(xm, false).value) / (2 * h);
+    }
+
+    // the inputs are perturbed once for each element of the control horizon
+    evaluations = 0;
+    auto ci = conFunc->evaluateIneq(x, true);
+    REQUIRE(evaluations == 1 + (2 * ((Tph * Tnx) + (Tnu * Tch))) + 2);
+
+    auto ce = conFunc->evaluateEq(x, true);
+    for (int k = 0; k < Tineq; k++)
+    {
+        REQUIRE((ci.grad.middleRows(k * N, N) - Jieq.row(k).transpose()).cwiseAbs().maxCoeff() < 1e-6);
+    }
+    REQUIRE((ce.grad.middleRows(0, N) - Jeq.row(0).transpose()).cwiseAbs().maxCoeff() < 1e-6);
+
+    // the slack variable fixed by its bounds is not perturbed
+    conFunc->setSlackFixed(true);
+    evaluations = 0;
+    ci = conFunc->evaluateIneq(x, true);
+    REQUIRE(evaluations == 1 + (2 * ((Tph * Tnx) + (Tnu * Tch))));
+    for (int k = 0; k < Tineq; k++)
+    {
+        REQUIRE(ci.grad((k * N) + N - 1) == 0);
+        REQUIRE((ci.grad.middleRows(k * N, N - 1) - Jieq.row(k).head(N - 1).transpose()).cwiseAbs().maxCoeff() < 1e-6);
+    }
+}
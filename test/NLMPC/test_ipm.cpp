@@ -0,0 +1,436 @@
+/*
+ *   Copyright (c) 2023 Nicola Piccinelli
+ *   All rights reserved.
+ */
+#include "basic.hpp"
+#include <catch2/catch_test_macros.hpp>
+
+namespace
+{
+    using namespace nlmpc_fixture;
+
+    constexpr int Tineq = Tph;
+    constexpr int Teq = 0;
+
+    using IPMController = Controller<Tineq, Teq>;
+
+    mpc::NLParameters ipmParameters()
+    {
+        mpc::NLParameters params;
+        params.backend = mpc::NLBackend::IPM;
+        params.enable_warm_start = true;
+        return params;
+    }
+} // namespace
+
+TEST_CASE(
+    MPC_TEST_NAME("IPM backend closed loop"),
+    MPC_TEST_TAGS("[ipm]"))
+{
+    auto optsolver = buildController<Tineq, Teq>(ipmParameters());
+
+    mpc::cvec<TVAR(Tnx)> x(Tnx), xn(Tnx);
+    x << 1.0, 0.0;
+
+    mpc::cvec<TVAR(Tnu)> u(Tnu);
+    u.setZero();
+
+    for (int k = 0; k < 100; k++)
+    {
+        auto r = optsolver->optimize(x, u);
+
+        REQUIRE(r.status == mpc::ResultStatus::SUCCESS);
+        REQUIRE(r.cmd(0) <= 2.0);
+        REQUIRE(r.cmd(0) >= -2.0);
+
+        u = r.cmd;
+        pendulum(xn, x, u, false);
+        x = xn;
+    }
+
+    REQUIRE(x.norm() < 1e-2);
+}
+
+TEST_CASE(
+    MPC_TEST_NAME("IPM backend matches the converged SQP solution"),
+    MPC_TEST_TAGS("[ipm]"))
+{
+    mpc::NLParameters sqp_params;
+    sqp_params.backend = mpc::NLBackend::SQP;
+    sqp_params.sqp_iterations = 10;
+
+    auto ipm = buildController<Tineq, Teq>(ipmParameters(), true);
+    auto sqp = buildController<Tineq, Teq>(sqp_params, true);
+
+    mpc::cvec<TVAR(Tnx)> x(Tnx);
+    mpc::cvec<TVAR(Tnu)> u(Tnu);
+    u.setZero();
+
+    // the second initial condition saturates the input at the lower bound
+    std::vector<std::array<double, 2>> initial = {{0.5, 0.0}, {3.0, 1.0}};
+    for (auto &x0 : initial)
+    {
+        x << x0[0], x0[1];
+
+        auto r_ipm = ipm->optimize(x, u);
+        auto r_sqp = sqp->optimize(x, u);
+
+        REQUIRE(r_ipm.status == mpc::ResultStatus::SUCCESS);
+        REQUIRE(r_sqp.status == mpc::ResultStatus::SUCCESS);
+        REQUIRE((r_ipm.cmd - r_sqp.cmd).norm() < 1e-3);
+        REQUIRE(std::fabs(r_ipm.cost - r_sqp.cost) < 1e-3 * std::max(1.0, r_sqp.cost));
+    }
+
+    REQUIRE(ipm->getLastResult().cmd(0) > -2.0);
+    REQUIRE(ipm->getLastResult().cmd(0) < -2.0 + 1e-3);
+}
+
+TEST_CASE(
+    MPC_TEST_NAME("IPM backend user inequality constraints"),
+    MPC_TEST_TAGS("[ipm]"))
+{
+    auto optsolver = buildController<Tineq, Teq>(ipmParameters());
+
+    // lower bound on the velocity of the pendulum along the horizon
+    optsolver->setIneqConFunction([](
+                                      mpc::cvec<TVAR(Tineq)> &ineq,
+                                      const mpc::mat<TVAR(Tph + 1), TVAR(Tnx)> &x,
+                                      const mpc::mat<TVAR(Tph + 1), TVAR(Tny)> &,
+                                      const mpc::mat<TVAR(Tph + 1), TVAR(Tnu)> &,
+                                      const double &)
+                                  {
+                                      for (int i = 0; i < Tineq; i++)
+                                      {
+                                          ineq(i) = -x(i + 1, 1) - 0.3;
+                                      } });
+
+    mpc::cvec<TVAR(Tnx)> x(Tnx);
+    x << 1.0, 0.0;
+
+    mpc::cvec<TVAR(Tnu)> u(Tnu);
+    u.setZero();
+
+    auto r = optsolver->optimize(x, u);
+    REQUIRE(r.status == mpc::ResultStatus::SUCCESS);
+    REQUIRE(r.is_feasible);
+
+    auto seq = optsolver->getOptimalSequence();
+    double vmin = seq.state.col(1).minCoeff();
+
+    // the constraint is active along the optimal trajectory
+    REQUIRE(vmin >= -0.3 - 1e-4);
+    REQUIRE(vmin < -0.3 + 1e-2);
+}
+
+TEST_CASE(
+    MPC_TEST_NAME("IPM backend with residual objective"),
+    MPC_TEST_TAGS("[ipm]"))
+{
+    auto residual = [](
+                        mpc::cvec<> &r,
+                        const mpc::mat<TVAR(Tph + 1), TVAR(Tnx)> &x,
+                        const mpc::mat<TVAR(Tph + 1), TVAR(Tny)> &,
+                        const mpc::mat<TVAR(Tph + 1), TVAR(Tnu)> &u,
+                        const double &)
+    {
+        for (int i = 0; i < Tph + 1; i++)
+        {
+            r(i) = x(i, 0) + 0.5 * x(i, 1);
+            r(Tph + 1 + i) = x(i, 1);
+            r(2 * (Tph + 1) + i) = 0.3 * u(i, 0);
+        }
+    };
+
+    mpc::NLParameters sqp_params;
+    sqp_params.backend = mpc::NLBackend::SQP;
+    sqp_params.sqp_iterations = 10;
+
+    auto ipm = buildController<Tineq, Teq>(ipmParameters());
+    REQUIRE(ipm->setResidualFunction(residual, 3 * (Tph + 1)));
+
+    auto sqp = buildController<Tineq, Teq>(sqp_params);
+    REQUIRE(sqp->setResidualFunction(residual, 3 * (Tph + 1)));
+
+    mpc::cvec<TVAR(Tnx)> x(Tnx);
+    x << 1.5, -0.5;
+
+    mpc::cvec<TVAR(Tnu)> u(Tnu);
+    u.setZero();
+
+    auto r_ipm = ipm->optimize(x, u);
+    auto r_sqp = sqp->optimize(x, u);
+
+    REQUIRE(r_ipm.status == mpc::ResultStatus::SUCCESS);
+    REQUIRE(r_sqp.status == mpc::ResultStatus::SUCCESS);
+    REQUIRE((r_ipm.cmd - r_sqp.cmd).norm() < 1e-3);
+    REQUIRE(std::fabs(r_ipm.cost - r_sqp.cost) < 1e-3 * r_sqp.cost);
+}
+
+TEST_CASE(
+    MPC_TEST_NAME("IPM backend dual warm start"),
+    MPC_TEST_TAGS("[ipm]"))
+{
+    auto cold_params = ipmParameters();
+    cold_params.enable_dual_warm_start = false;
+
+    auto warm = buildController<Tineq, Teq>(ipmParameters());
+    auto cold = buildController<Tineq, Teq>(cold_params);
+
+    int iterations[2] = {0, 0};
+    std::shared_ptr<IPMController> controllers[2] = {warm, cold};
+    for (int c = 0; c < 2; c++)
+    {
+        mpc::cvec<TVAR(Tnx)> x(Tnx), xn(Tnx);
+        x << 1.0, 0.0;
+
+        mpc::cvec<TVAR(Tnu)> u(Tnu);
+        u.setZero();
+
+        for (int k = 0; k < 30; k++)
+        {
+            auto r = controllers[c]->optimize(x, u);
+            REQUIRE(r.status == mpc::ResultStatus::SUCCESS);
+            iterations[c] += r.iterations;
+
+            u = r.cmd;
+            pendulum(xn, x, u, false);
+            x = xn;
+        }
+    }
+
+    // the shifted multipliers save iterations along the closed loop
+    REQUIRE(iterations[0] < iterations[1]);
+}
+
+TEST_CASE(
+    MPC_TEST_NAME("IPM backend dual multipliers"),
+    MPC_TEST_TAGS("[ipm]"))
+{
+    mpc::NLParameters sqp_params;
+    sqp_params.backend = mpc::NLBackend::SQP;
+    sqp_params.sqp_iterations = 10;
+
+    auto cold_params = ipmParameters();
+    cold_params.enable_warm_start = false;
+
+    auto ipm = buildController<Tineq, Teq>(cold_params, true);
+    auto sqp = buildController<Tineq, Teq>(sqp_params, true);
+
+    mpc::cvec<TVAR(Tnx)> x(Tnx);
+    x << 0.5, 0.0;
+
+    mpc::cvec<TVAR(Tnu)> u(Tnu);
+    u.setZero();
+
+    auto r_ipm = ipm->optimize(x, u);
+    auto r_sqp = sqp->optimize(x, u);
+    REQUIRE(r_ipm.status == mpc::ResultStatus::SUCCESS);
+    REQUIRE(r_sqp.status == mpc::ResultStatus::SUCCESS);
+
+    // both backends converge to the same multipliers of the system's dynamics
+    auto y_ipm = ipm->getDualMultipliers();
+    auto y_sqp = sqp->getDualMultipliers();
+    REQUIRE(y_ipm.size() == (Tph * Tnx) + Tineq + Teq);
+    REQUIRE(y_ipm.head(Tph * Tnx).norm() > 1e-3);
+    REQUIRE((y_ipm.head(Tph * Tnx) - y_sqp.head(Tph * Tnx)).norm() < 1e-2 * y_ipm.head(Tph * Tnx).norm());
+
+    // the multipliers provided by the user initialize the next solve
+    REQUIRE(ipm->setDualMultipliers(y_ipm));
+    auto r_guess = ipm->optimize(x, u);
+    REQUIRE(r_guess.status == mpc::ResultStatus::SUCCESS);
+    REQUIRE((r_guess.cmd - r_ipm.cmd).norm() < 1e-4);
+
+    REQUIRE_FALSE(ipm->setDualMultipliers(mpc::cvec<>::Zero(3)));
+}
+
+TEST_CASE(
+    MPC_TEST_NAME("IPM backend linearized initialization"),
+    MPC_TEST_TAGS("[ipm]"))
+{
+    // without the warm start every step starts from the cold initial guess
+    auto constant_params = ipmParameters();
+    constant_params.enable_warm_start = false;
+
+    auto linearized_params = constant_params;
+    linearized_params.initialization = mpc::NLInitialization::LINEARIZED;
+
+    auto constant = buildController<Tineq, Teq>(constant_params);
+    auto linearized = buildController<Tineq, Teq>(linearized_params);
+
+    mpc::cvec<TVAR(Tnx)> x(Tnx), xn(Tnx);
+    x << 1.0, 0.0;
+
+    mpc::cvec<TVAR(Tnu)> u(Tnu);
+    u.setZero();
+
+    int iterations[2] = {0, 0};
+    for (int k = 0; k < 30; k++)
+    {
+        auto r_constant = constant->optimize(x, u);
+        auto r_linearized = linearized->optimize(x, u);
+
+        REQUIRE(r_constant.status == mpc::ResultStatus::SUCCESS);
+        REQUIRE(r_linearized.status == mpc::ResultStatus::SUCCESS);
+        REQUIRE((r_constant.cmd - r_linearized.cmd).norm() < 1e-3);
+
+        iterations[0] += r_constant.iterations;
+        iterations[1] += r_linearized.iterations;
+
+        u = r_linearized.cmd;
+        pendulum(xn, x, u, false);
+        x = xn;
+    }
+
+    // the solution of the linearized problem is close to the optimal one
+    REQUIRE(iterations[1] < iterations[0]);
+}
+
+TEST_CASE(
+    MPC_TEST_NAME("IPM backend user constraints calls with Broyden update"),
+    MPC_TEST_TAGS("[ipm]"))
+{
+    // with the linear model the Broyden update is exact and the finite
+    // differences are never refreshed after the first Jacobian matrix
+    auto params = ipmParameters();
+    params.jacobian_update = mpc::NLJacobianUpdate::BROYDEN;
+    params.jacobian_refresh_iterations = 1000;
+    params.jacobian_refresh_step = 1e3;
+
+    auto optsolver = buildController<Tineq, Teq>(params, true);
+
+    int calls = 0;
+    optsolver->setIneqConFunction([&](
+                                      mpc::cvec<TVAR(Tineq)> &ineq,
+                                      const mpc::mat<TVAR(Tph + 1), TVAR(Tnx)> &x,
+                                      const mpc::mat<TVAR(Tph + 1), TVAR(Tny)> &,
+                                      const mpc::mat<TVAR(Tph + 1), TVAR(Tnu)> &,
+                                      const double &)
+                                  {
+                                      calls++;
+                                      for (int i = 0; i < Tineq; i++)
+                                      {
+                                          ineq(i) = -x(i + 1, 1) - 0.3;
+                                      } });
+
+    // central differences on the states, the inputs and the slack variable
+    const int fdCalls = 2 * ((Tph * Tnx) + (Tch * Tnu) + 1);
+
+    mpc::cvec<TVAR(Tnx)> x(Tnx), xn(Tnx);
+    x << 1.0, 0.0;
+
+    mpc::cvec<TVAR(Tnu)> u(Tnu);
+    u.setZero();
+
+    for (int k = 0; k < 10; k++)
+    {
+        calls = 0;
+        auto r = optsolver->optimize(x, u);
+        REQUIRE(r.status == mpc::ResultStatus::SUCCESS);
+
+        // the trial points of the line search evaluate the constraints once
+        if (k == 0)
+        {
+            REQUIRE(calls > fdCalls);
+        }
+        else
+        {
+            REQUIRE(calls < fdCalls);
+        }
+
+        u = r.cmd;
+        pendulum(xn, x, u, true);
+        x = xn;
+    }
+}
+
+TEST_CASE(
+    MPC_TEST_NAME("IPM backend input bounds with basis functions"),
+    MPC_TEST_TAGS("[ipm]"))
+{
+    constexpr double umax = 0.5;
+
+    std::vector<mpc::NLInputBasis> bases = {
+        mpc::NLInputBasis::BLOCKING,
+        mpc::NLInputBasis::LAGUERRE,
+        mpc::NLInputBasis::CHEBYSHEV,
+        mpc::NLInputBasis::BSPLINE};
+
+    for (auto basis : bases)
+    {
+        auto params = ipmParameters();
+        params.input_basis = basis;
+        params.spline_degree = 2;
+
+        auto optsolver = makeController<Tineq, Teq>();
+        setPendulumModel(optsolver);
+        setQuadraticObjective(optsolver);
+        optsolver->setOptimizerParameters(params);
+
+        mpc::cvec<TVAR(Tnu)> umin(Tnu), umaxv(Tnu);
+        umin << -umax;
+        umaxv << umax;
+
+        if (basis == mpc::NLInputBasis::LAGUERRE || basis == mpc::NLInputBasis::CHEBYSHEV)
+        {
+            // the bounds of the coefficients do not bound the input sequence,
+            // the inputs are constrained along the horizon instead
+            REQUIRE_FALSE(optsolver->setInputBounds(umin, umaxv, mpc::HorizonSlice::all()));
+            optsolver->setIneqConFunction([](
+                                              mpc::cvec<TVAR(Tineq)> &ineq,
+                                              const mpc::mat<TVAR(Tph + 1), TVAR(Tnx)> &,
+                                              const mpc::mat<TVAR(Tph + 1), TVAR(Tny)> &,
+                                              const mpc::mat<TVAR(Tph + 1), TVAR(Tnu)> &u,
+                                              const double &)
+                                          {
+                                              for (int i = 0; i < Tineq; i++)
+                                              {
+                                                  ineq(i) = (u(i, 0) * u(i, 0)) - (umax * umax);
+                                              } });
+        }
+        else
+        {
+            REQUIRE(optsolver->setInputBounds(umin, umaxv, mpc::HorizonSlice::all()));
+        }
+
+        mpc::cvec<TVAR(Tnx)> x(Tnx), xn(Tnx);
+        x << 1.0, 0.0;
+
+        mpc::cvec<TVAR(Tnu)> u(Tnu);
+        u.setZero();
+
+        double peak = 0;
+        for (int k = 0; k < 30; k++)
+        {
+            auto r = optsolver->optimize(x, u);
+            REQUIRE(r.status == mpc::ResultStatus::SUCCESS);
+
+            auto seq = optsolver->getOptimalSequence();
+            REQUIRE(seq.input.topRows(Tph).maxCoeff() <= umax + 1e-4);
+            REQUIRE(seq.input.topRows(Tph).minCoeff() >= -umax - 1e-4);
+            peak = std::max(peak, seq.input.topRows(Tph).cwiseAbs().maxCoeff());
+
+            u = r.cmd;
+            pendulum(xn, x, u, false);
+            x = xn;
+        }
+
+        // the bounds are active along the closed loop
+        REQUIRE(peak > umax - 1e-2);
+    }
+
+    // the bounds set before the change of the basis are removed
+    auto params = ipmParameters();
+    auto optsolver = buildController<Tineq, Teq>(params);
+    setSymmetricInputBounds(optsolver, umax);
+    params.input_basis = mpc::NLInputBasis::LAGUERRE;
+    optsolver->setOptimizerParameters(params);
+
+    mpc::cvec<TVAR(Tnx)> x(Tnx);
+    x << 1.0, 0.0;
+
+    mpc::cvec<TVAR(Tnu)> u(Tnu);
+    u.setZero();
+
+    REQUIRE(optsolver->optimize(x, u).status == mpc::ResultStatus::SUCCESS);
+    REQUIRE(optsolver->getOptimalSequence().input.cwiseAbs().maxCoeff() > umax + 1e-2);
+}
@@ -0,0 +1,140 @@
+/*
+ *   Copyright (c) 2023 Nicola Piccinelli
+ *   All rights reserved.
+ */
+#include "basic.hpp"
+#include <catch2/catch_test_macros.hpp>
+
+namespace
+{
+    using namespace nlmpc_fixture;
+
+    constexpr int Tineq = 0;
+    constexpr int Teq = 0;
+} // namespace
+
+TEST_CASE(
+    MPC_TEST_NAME("Multi-start selects the best feasible solution"),
+    MPC_TEST_TAGS("[multistart]"))
+{
+    mpc::NLParameters single_params;
+    single_params.maximum_iteration = 500;
+    single_params.relative_xtol = 1e-8;
+
+    // all the starts are completed and the lowest cost is selected
+    mpc::NLParameters multi_params = single_params;
+    multi_params.multistart = 4;
+    multi_params.multistart_cost_tolerance = -1;
+
+    auto single = buildController(single_params);
+    auto multi = buildController(multi_params);
+
+    mpc::cvec<TVAR(Tnx)> x(Tnx);
+    mpc::cvec<TVAR(Tnu)> u(Tnu);
+    u.setZero();
+
+    std::vector<std::array<double, 2>> initial = {{0.5, 0.0}, {3.0, 1.0}, {-1.0, 2.0}};
+    for (auto &x0 : initial)
+    {
+        x << x0[0], x0[1];
+
+        auto r_single = single->optimize(x, u);
+        auto r_multi = multi->optimize(x, u);
+
+        REQUIRE(r_single.status == mpc::ResultStatus::SUCCESS);
+        REQUIRE(r_multi.status == mpc::ResultStatus::SUCCESS);
+        REQUIRE(r_multi.is_feasible);
+
+        // the first start uses the same initial guess of the single start
+        REQUIRE(r_multi.cost <= r_single.cost + 1e-6 * std::max(1.0, r_single.cost));
+    }
+}
+
+TEST_CASE(
+    MPC_TEST_NAME("Multi-start with early stop"),
+    MPC_TEST_TAGS("[multistart]"))
+{
+    mpc::NLParameters params;
+    params.maximum_iteration = 500;
+    params.relative_xtol = 1e-8;
+    params.multistart = 3;
+    params.multistart_cost_tolerance = 1e6;
+
+    auto optsolver = buildController(params);
+
+    mpc::cvec<TVAR(Tnx)> x(Tnx);
+    x << 1.0, 0.0;
+
+    mpc::cvec<TVAR(Tnu)> u(Tnu);
+    u.setZero();
+
+    for (int k = 0; k < 3; k++)
+    {
+        auto r = optsolver->optimize(x, u);
+        REQUIRE(r.status == mpc::ResultStatus::SUCCESS);
+        REQUIRE(r.is_feasible);
+    }
+
+    // the instances of the multi-start follow the changes of the bounds
+    mpc::cvec<TVAR(Tnu)> umin(Tnu), umax(Tnu);
+    umin << -0.5;
+    umax << 0.5;
+    optsolver->setInputBounds(umin, umax, mpc::HorizonSlice::all());
+
+    auto r = optsolver->optimize(x, u);
+    REQUIRE(r.status == mpc::ResultStatus::SUCCESS);
+    REQUIRE(r.cmd(0) <= 0.5 + 1e-4);
+    REQUIRE(r.cmd(0) >= -0.5 - 1e-4);
+}
+
+TEST_CASE(
+    MPC_TEST_NAME("Multi-start without early stop from an infeasible guess"),
+    MPC_TEST_TAGS("[multistart]"))
+{
+    auto build = [](double tolerance)
+    {
+        auto optsolver = makeController<1, Teq>();
+        setPendulumModel(optsolver);
+        setQuadraticObjective(optsolver);
+
+        // the first input is limited, the initial guess built from the previous input violates it
+        optsolver->setIneqConFunction([](
+                                          mpc::cvec<TVAR(1)> &in_con,
+                                          const mpc::mat<TVAR(Tph + 1), TVAR(Tnx)> &,
+                                          const mpc::mat<TVAR(Tph + 1), TVAR(Tny)> &,
+                                          const mpc::mat<TVAR(Tph + 1), TVAR(Tnu)> &u,
+                                          const double &)
+                                      { in_con(0) = u(0, 0) - 1.0; },
+                                      1e-6);
+
+        setSymmetricInputBounds(optsolver, 2.0);
+
+        mpc::NLParameters params;
+        params.maximum_iteration = 500;
+        params.relative_xtol = 1e-8;
+        params.multistart = 3;
+        params.multistart_cost_tolerance = tolerance;
+        optsolver->setOptimizerParameters(params);
+
+        return optsolver;
+    };
+
+    // with an infeasible guess the large tolerance does not stop the starts early,
+    // so the same solution of the multi-start completing all the starts is selected
+    auto tolerant = build(1e6);
+    auto complete = build(-1);
+
+    mpc::cvec<TVAR(Tnx)> x(Tnx);
+    x << 1.0, 0.0;
+
+    mpc::cvec<TVAR(Tnu)> u(Tnu);
+    u << 1.8;
+
+    auto r_tolerant = tolerant->optimize(x, u);
+    auto r_complete = complete->optimize(x, u);
+
+    REQUIRE(r_tolerant.status == r_complete.status);
+    REQUIRE(r_tolerant.is_feasible == r_complete.is_feasible);
+    REQUIRE(std::fabs(r_tolerant.cost - r_complete.cost) <= 1e-9 * std::max(1.0, std::fabs(r_complete.cost)));
+    REQUIRE((r_tolerant.cmd - r_complete.cmd).cwiseAbs().maxCoeff() <= 1e-9);
+}
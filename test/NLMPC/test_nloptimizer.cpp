@@ -6,6 +6,9 @@
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/catch_template_test_macros.hpp>
 
+#include <chrono>
+#include <thread>
+
 TEMPLATE_TEST_CASE_SIG(
     MPC_TEST_NAME("Checking state and input bounds"),
     MPC_TEST_TAGS("[nloptimizer][template]"),
@@ -118,4 +121,99 @@ TEMPLATE_TEST_CASE_SIG(
             REQUIRE(ub_check[(Tph * Tnx) + ((i * Tnu) + j)] == std::numeric_limits<double>::infinity());
         }
     }
-}
\ No newline at end of file
+}
+
+TEST_CASE(
+    MPC_TEST_NAME("Time limit returns the best feasible iterate of multiple shooting"),
+    MPC_TEST_TAGS("[nloptimizer][deadline]"))
+{
+    constexpr int Tnx = 2;
+    constexpr int Tnu = 1;
+    constexpr int Tny = 2;
+    constexpr int Tph = 10;
+    constexpr int Tch = 5;
+    constexpr int Tineq = Tph + 1;
+    constexpr int Teq = 1;
+
+    constexpr double ts = 0.1;
+
+    // the three groups of constraints (system's dynamics, user inequality and equality)
+    // are evaluated at each iterate before it is kept as the best feasible one
+    for (bool concurrent : {false, true})
+    {
+#ifdef MPC_DYNAMIC
+        mpc::NLMPC<> optsolver(Tnx, Tnu, Tny, Tph, Tch, Tineq, Teq);
+#else
+        mpc::NLMPC<Tnx, Tnu, Tny, Tph, Tch, Tineq, Teq> optsolver;
+#endif
+        optsolver.setLoggerLevel(mpc::Logger::log_level::NONE);
+
+        mpc::NLParameters params;
+        params.maximum_iteration = 1000000;
+        params.time_limit = 0.01;
+        params.concurrent_evaluation = concurrent;
+        optsolver.setOptimizerParameters(params);
+
+        optsolver.setStateSpaceFunction([](
+                                            mpc::cvec<TVAR(Tnx)> &xn,
+                                            const mpc::cvec<TVAR(Tnx)> &x,
+                                            const mpc::cvec<TVAR(Tnu)> &u,
+                                            const unsigned int &)
+                                        {
+            xn(0) = x(0) + ts * x(1);
+            xn(1) = x(1) + ts * (-std::sin(x(0)) - 0.1 * x(1) + u(0)); });
+
+        // the objective function and its gradient at the initial guess are computed before
+        // the deadline, then the evaluations are slowed down so that the solver cannot
+        // converge before the deadline
+        int calls = 0;
+        optsolver.setObjectiveFunction([&calls](
+                                           const mpc::mat<TVAR(Tph + 1), TVAR(Tnx)> &x,
+                                           const mpc::mat<TVAR(Tph + 1), TVAR(Tny)> &,
+                                           const mpc::mat<TVAR(Tph + 1), TVAR(Tnu)> &u,
+                                           const double &)
+                                       {
+            if (++calls > 2 * ((Tph * Tnx) + (Tnu * Tch) + 1) + 8) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            return (x.col(0).array() - 0.5).square().sum() + 0.1 * u.array().square().sum(); });
+
+        optsolver.setIneqConFunction([](
+                                         mpc::cvec<TVAR(Tineq)> &in_con,
+                                         const mpc::mat<TVAR(Tph + 1), TVAR(Tnx)> &,
+                                         const mpc::mat<TVAR(Tph + 1), TVAR(Tny)> &,
+                                         const mpc::mat<TVAR(Tph + 1), TVAR(Tnu)> &u,
+                                         const double &)
+                                     {
+            for (int i = 0; i < Tineq; i++) {
+                in_con(i) = u(i, 0) * u(i, 0) - 4.0;
+            } });
+
+        optsolver.setEqConFunction([](
+                                       mpc::cvec<TVAR(Teq)> &eq_con,
+                                       const mpc::mat<TVAR(Tph + 1), TVAR(Tnx)> &,
+                                       const mpc::mat<TVAR(Tph + 1), TVAR(Tnu)> &u)
+                                   { eq_con(0) = u(0, 0) - u(1, 0); });
+
+        // the pendulum at rest is an equilibrium, so the initial guess is feasible
+        mpc::cvec<TVAR(Tnx)> x(Tnx);
+        mpc::cvec<TVAR(Tnu)> u(Tnu);
+        x.setZero();
+        u.setZero();
+
+        auto r = optsolver.optimize(x, u);
+
+        // the solver is stopped by the deadline and not by its stopping criteria
+        REQUIRE(r.status == mpc::ResultStatus::TIME_LIMIT);
+        REQUIRE((r.solver_status == nlopt::FORCED_STOP || r.solver_status == nlopt::MAXTIME_REACHED));
+        REQUIRE(r.is_feasible);
+        REQUIRE(std::isfinite(r.cost));
+        REQUIRE(r.cmd.allFinite());
+        REQUIRE(r.cmd(0) >= -2.0);
+        REQUIRE(r.cmd(0) <= 2.0);
+
+        // the returned cost is not larger than the cost of the initial guess
+        REQUIRE(r.cost <= (0.25 * (Tph + 1)) + 1e-9);
+        REQUIRE(optsolver.getOptimalSequence().state.allFinite());
+    }
+}
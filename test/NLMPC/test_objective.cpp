@@ -61,3 +61,169 @@ TEMPLATE_TEST_CASE_SIG(
     auto c = objFunc->evaluate(x, false);
     REQUIRE(c.value == expectedValue);
 }
+
+TEMPLATE_TEST_CASE_SIG(
+    MPC_TEST_NAME("Checking objective function in residual form"),
+    MPC_TEST_TAGS("[objective][template]"),
+    ((int Tnx, int Tnu, int Tph, int Tch), Tnx, Tnu, Tph, Tch),
+    (5, 3, 7, 7), (5, 3, 7, 4))
+{
+    static constexpr int Tny = 1;
+    static constexpr int Tineq = 0;
+    static constexpr int Teq = 0;
+
+    static constexpr auto sizer = mpc::MPCSize(TVAR(Tnx), TVAR(Tnu), TVAR(0), TVAR(Tny), TVAR(Tph), TVAR(Tch), TVAR(Tineq), TVAR(Teq));
+
+    std::shared_ptr<mpc::Objective<sizer>> objFunc;
+    objFunc = std::make_shared<mpc::Objective<sizer>>();
+    objFunc->initialize(Tnx, Tnu, 0, Tny, Tph, Tch, Tineq, Teq);
+
+    std::shared_ptr<mpc::Mapping<sizer>> mapping;
+    mapping = std::make_shared<mpc::Mapping<sizer>>();
+    mapping->initialize(Tnx, Tnu, 0, Tny, Tph, Tch, Tineq, Teq);
+
+    std::shared_ptr<mpc::Model<sizer>> model;
+    model = std::make_shared<mpc::Model<sizer>>();
+    model->initialize(Tnx, Tnu, 0, Tny, Tph, Tch, Tineq, Teq);
+
+    objFunc->setModel(model, mapping);
+
+    // the residuals couple the states at the same step of the horizon
+    REQUIRE(objFunc->setResidual([](
+                                     mpc::cvec<> &r,
+                                     const mpc::mat<TVAR(Tph + 1), TVAR(Tnx)> &x,
+                                     const mpc::mat<TVAR(Tph + 1), TVAR(Tny)> &,
+                                     const mpc::mat<TVAR(Tph + 1), TVAR(Tnu)> &u,
+                                     const double &)
+                                 {
+                                     for (int i = 0; i < Tph + 1; i++)
+                                     {
+                                         r(i) = x(i, 0) - x(i, 1);
+                                         r(Tph + 1 + i) = x.row(i).sum();
+                                         r(2 * (Tph + 1) + i) = u.row(i).sum();
+                                     } },
+                                 3 * (Tph + 1)));
+    REQUIRE(objFunc->hasResidual());
+
+    mpc::cvec<TVAR(Tnx)> x0;
+    x0.resize(Tnx);
+    x0.setConstant(0.5);
+    objFunc->setCurrentState(x0);
+
+    mpc::cvec<TVAR(((Tph * Tnx) + (Tnu * Tch) + 1))> x, d;
+    x.resize((Tph * Tnx) + (Tnu * Tch) + 1);
+    d.resize((Tph * Tnx) + (Tnu * Tch) + 1);
+
+    for (int i = 0; i < x.rows(); i++)
+    {
+        x[i] = 0.1 * i;
+        d[i] = 0.01 * ((i % 3) - 1);
+    }
+
+    mpc::mat<TVAR(((Tph * Tnx) + (Tnu * Tch) + 1)), TVAR(((Tph * Tnx) + (Tnu * Tch) + 1))> H, Hd;
+    auto c = objFunc->evaluateGaussNewton(x, H);
+    auto cd = objFunc->evaluateGaussNewton(x + d, Hd);
+
+    // the value and the gradient are consistent with the scalar objective function
+    auto ref = objFunc->evaluate(x, true);
+    REQUIRE(std::fabs(c.value - ref.value) < 1e-10 * std::fabs(ref.value));
+    REQUIRE((c.grad - ref.grad).norm() < 1e-3 * c.grad.norm());
+
+    // the residuals are linear so the Gauss-Newton hessian is exact
+    REQUIRE((H - H.transpose()).norm() < 1e-6);
+    REQUIRE((H - Hd).norm() < 1e-4 * H.norm());
+    REQUIRE(((cd.grad - c.grad) - (H * d)).norm() < 1e-4 * c.grad.norm());
+
+    // a copy (e.g. of a multi-start) evaluates the residuals on its own after the original is gone
+    auto copy = std::make_shared<mpc::Objective<sizer>>(*objFunc);
+    objFunc.reset();
+    auto cc = copy->evaluate(x, true);
+    REQUIRE(cc.value == ref.value);
+    REQUIRE((cc.grad - ref.grad).norm() == 0.0);
+}
+
+TEMPLATE_TEST_CASE_SIG(
+    MPC_TEST_NAME("Checking objective function gradient with blocked inputs"),
+    MPC_TEST_TAGS("[objective][template]"),
+    ((int Tnx, int Tnu, int Tph, int Tch), Tnx, Tnu, Tph, Tch),
+    (3, 2, 8, 3), (3, 2, 6, 6))
+{
+    static constexpr int Tny = 1;
+    static constexpr int Tineq = 0;
+    static constexpr int Teq = 0;
+    constexpr int N = (Tph * Tnx) + (Tnu * Tch) + 1;
+
+    static constexpr auto sizer = mpc::MPCSize(TVAR(Tnx), TVAR(Tnu), TVAR(0), TVAR(Tny), TVAR(Tph), TVAR(Tch), TVAR(Tineq), TVAR(Teq));
+
+    std::shared_ptr<mpc::Objective<sizer>> objFunc;
+    objFunc = std::make_shared<mpc::Objective<sizer>>();
+    objFunc->initialize(Tnx, Tnu, 0, Tny, Tph, Tch, Tineq, Teq);
+
+    std::shared_ptr<mpc::Mapping<sizer>> mapping;
+    mapping = std::make_shared<mpc::Mapping<sizer>>();
+    mapping->initialize(Tnx, Tnu, 0, Tny, Tph, Tch, Tineq, Teq);
+
+    mpc::cvec<TVAR(Tnu)> su(Tnu);
+    su << 4.0, 0.25;
+    mapping->setInputScaling(su);
+
+    std::shared_ptr<mpc::Model<sizer>> model;
+    model = std::make_shared<mpc::Model<sizer>>();
+    model->initialize(Tnx, Tnu, 0, Tny, Tph, Tch, Tineq, Teq);
+
+    objFunc->setModel(model, mapping);
+
+    int evaluations = 0;
+    objFunc->setObjective([&](
+                              const mpc::mat<TVAR(Tph + 1), TVAR(Tnx)> &x,
+                              const mpc::mat<TVAR(Tph + 1), TVAR(Tny)> &,
+                              const mpc::mat<TVAR(Tph + 1), TVAR(Tnu)> &u,
+                              const double &e)
+                          {
+        evaluations++;
+        double f = x.array().square().sum() + (3.0 * e * e) + e;
+        for (int k = 0; k < Tph + 1; k++)
+        {
+            f += (k + 1) * (u(k, 0) * u(k, 0)) + (u(k, 1) * x(k, 2));
+        }
+        return f; });
+
+    mpc::cvec<TVAR(Tnx)> x0;
+    x0.resize(Tnx);
+    x0 << 0.1, -0.4, 0.7;
+    objFunc->setCurrentState(x0);
+
+    mpc::cvec<TVAR(N)> x;
+    x.resize(N);
+    for (int i = 0; i < x.rows(); i++)
+    {
+        x[i] = 0.3 * std::cos(i + 0.5);
+    }
+
+    mpc::cvec<TVAR(N)> expectedGrad;
+    expectedGrad.resize(N);
+    double h = 1e-5;
+    for (int i = 0; i < N; i++)
+    {
+        auto xp = x;
+        auto xm = x;
+        xp[i] += h;
+        xm[i] -= h;
+        expectedGrad[i] = (objFunc->evaluate(xp, false).value - objFunc->evaluate(xm, false).value) / (2 * h);
+    }
+
+    // the gradient is approximated by forward differences
+    // the inputs are perturbed once for each element of the control horizon
+    evaluations = 0;
+    auto c = objFunc->evaluate(x, true);
+    REQUIRE(evaluations == 1 + (Tph * Tnx) + (Tnu * Tch) + 2);
+    REQUIRE((c.grad - expectedGrad).cwiseAbs().maxCoeff() < 1e-3);
+
+    // the slack variable fixed by its bounds is not perturbed
+    objFunc->setSlackFixed(true);
+    evaluations = 0;
+    c = objFunc->evaluate(x, true);
+    REQUIRE(evaluations == 1 + (Tph * Tnx) + (Tnu * Tch));
+    REQUIRE(c.grad(N - 1) == 0);
+    REQUIRE((c.grad.head(N - 1) - expectedGrad.head(N - 1)).cwiseAbs().maxCoeff() < 1e-3);
+}
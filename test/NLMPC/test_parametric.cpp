@@ -0,0 +1,95 @@
+/*
+ *   Copyright (c) 2023 Nicola Piccinelli
+ *   All rights reserved.
+ */
+#include "basic.hpp"
+#include <catch2/catch_test_macros.hpp>
+
+namespace
+{
+    using namespace nlmpc_fixture;
+
+    /**
+     * @brief Discretized linear oscillator with a time-varying input gain
+     */
+    void oscillator(
+        mpc::cvec<TVAR(Tnx)> &xn,
+        const mpc::cvec<TVAR(Tnx)> &x,
+        const mpc::cvec<TVAR(Tnu)> &u,
+        double gain)
+    {
+        xn(0) = x(0) + ts * x(1);
+        xn(1) = x(1) + ts * (-x(0) - 0.1 * x(1) + gain * u(0));
+    }
+
+    std::shared_ptr<Controller<0, 0>> buildOscillatorController()
+    {
+        auto optsolver = makeController();
+
+        mpc::NLParameters params;
+        params.backend = mpc::NLBackend::SQP;
+        params.sqp_iterations = 1;
+        optsolver->setOptimizerParameters(params);
+
+        return optsolver;
+    }
+} // namespace
+
+TEST_CASE(
+    MPC_TEST_NAME("Parametric callbacks read the preview parameters table"),
+    MPC_TEST_TAGS("[nlmpc][parametric]"))
+{
+    // controller with the input gain baked in the model
+    auto baked = buildOscillatorController();
+    baked->setStateSpaceFunction([](
+                                     mpc::cvec<TVAR(Tnx)> &xn,
+                                     const mpc::cvec<TVAR(Tnx)> &x,
+                                     const mpc::cvec<TVAR(Tnu)> &u,
+                                     const unsigned int &)
+                                 { oscillator(xn, x, u, 0.5); });
+    setQuadraticObjective(baked);
+
+    // controller reading the input gain from the preview parameters table
+    auto parametric = buildOscillatorController();
+    REQUIRE_FALSE(parametric->setPreviewParametersSize(-1));
+    REQUIRE(parametric->setPreviewParametersSize(1));
+    REQUIRE(parametric->previewParameters().rows() == 1);
+    REQUIRE(parametric->previewParameters().cols() == Tph + 1);
+
+    auto model = [](
+                     mpc::cvec<TVAR(Tnx)> &xn,
+                     const mpc::cvec<TVAR(Tnx)> &x,
+                     const mpc::cvec<TVAR(Tnu)> &u,
+                     const unsigned int &k,
+                     const mpc::mat<> &P)
+    { oscillator(xn, x, u, P(0, k)); };
+
+    // binding the model twice must not register the dynamics constraints twice
+    parametric->setStateSpaceFunction(model);
+    parametric->setStateSpaceFunction(model);
+    setQuadraticObjective(parametric);
+
+    REQUIRE_FALSE(parametric->setPreviewParameters(mpc::mat<>::Zero(2, Tph + 1)));
+    REQUIRE(parametric->setPreviewParameters(mpc::mat<>::Constant(1, Tph + 1, 0.5)));
+
+    mpc::cvec<TVAR(Tnx)> x(Tnx);
+    x << 1.0, 0.0;
+
+    mpc::cvec<TVAR(Tnu)> u(Tnu);
+    u.setZero();
+
+    auto r_baked = baked->optimize(x, u);
+    auto r_parametric = parametric->optimize(x, u);
+
+    REQUIRE(r_baked.status == mpc::ResultStatus::SUCCESS);
+    REQUIRE(r_parametric.status == mpc::ResultStatus::SUCCESS);
+    REQUIRE((r_baked.cmd - r_parametric.cmd).norm() < 1e-6);
+
+    // the table is updated in place, the callbacks see the new values
+    // without being bound again
+    parametric->previewParameters().setConstant(2.0);
+    r_parametric = parametric->optimize(x, u);
+
+    REQUIRE(r_parametric.status == mpc::ResultStatus::SUCCESS);
+    REQUIRE((r_baked.cmd - r_parametric.cmd).norm() > 1e-3);
+}
@@ -0,0 +1,308 @@
+/*
+ *   Copyright (c) 2023 Nicola Piccinelli
+ *   All rights reserved.
+ */
+#include "basic.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_template_test_macros.hpp>
+
+#include <chrono>
+#include <thread>
+
+TEMPLATE_TEST_CASE_SIG(
+    MPC_TEST_NAME("Checking single shooting expansion and sensitivities"),
+    MPC_TEST_TAGS("[shooting][template]"),
+    ((int Tnx, int Tnu, int Tny, int Tph, int Tch, int Tcontinuous), Tnx, Tnu, Tny, Tph, Tch, Tcontinuous),
+    (2, 1, 2, 5, 5, 0), (2, 1, 2, 5, 3, 0), (2, 1, 2, 5, 5, 1), (2, 1, 2, 5, 3, 1))
+{
+    constexpr int Tineq = 0;
+    constexpr int Teq = 0;
+    static constexpr auto sizer = mpc::MPCSize(TVAR(Tnx), TVAR(Tnu), TVAR(0), TVAR(Tny), TVAR(Tph), TVAR(Tch), TVAR(Tineq), TVAR(Teq));
+
+    auto mapping = std::make_shared<mpc::Mapping<sizer>>();
+    mapping->initialize(Tnx, Tnu, 0, Tny, Tph, Tch, Tineq, Teq);
+
+    auto model = std::make_shared<mpc::Model<sizer>>();
+    model->initialize(Tnx, Tnu, 0, Tny, Tph, Tch, Tineq, Teq);
+
+    if (Tcontinuous)
+    {
+        // van der pol oscillator
+        model->setContinuous(true, 0.1);
+        model->setStateModel([](
+                                 mpc::cvec<TVAR(Tnx)> &dx,
+                                 const mpc::cvec<TVAR(Tnx)> &x,
+                                 const mpc::cvec<TVAR(Tnu)> &u,
+                                 const unsigned int &)
+                             {
+                dx[0] = ((1.0 - (x[1] * x[1])) * x[0]) - x[1] + u[0];
+                dx[1] = x[0]; });
+    }
+    else
+    {
+        // damped pendulum
+        model->setStateModel([](
+                                 mpc::cvec<TVAR(Tnx)> &xn,
+                                 const mpc::cvec<TVAR(Tnx)> &x,
+                                 const mpc::cvec<TVAR(Tnu)> &u,
+                                 const unsigned int &)
+                             {
+                xn[0] = x[0] + 0.1 * x[1];
+                xn[1] = x[1] + 0.1 * (-std::sin(x[0]) - 0.1 * x[1] + u[0]); });
+    }
+
+    auto shooting = std::make_shared<mpc::SingleShooting<sizer>>();
+    shooting->initialize(Tnx, Tnu, 0, Tny, Tph, Tch, Tineq, Teq);
+    shooting->setModel(model, mapping);
+
+    auto conFunc = std::make_shared<mpc::Constraints<sizer>>();
+    conFunc->initialize(Tnx, Tnu, 0, Tny, Tph, Tch, Tineq, Teq);
+    conFunc->setModel(model, mapping);
+
+    mpc::cvec<TVAR(Tnx)> x0(Tnx);
+    x0 << 0.5, -0.3;
+    shooting->setCurrentState(x0);
+    conFunc->setCurrentState(x0);
+
+    mpc::cvec<TVAR((Tnu * Tch) + 1)> z((Tnu * Tch) + 1);
+    for (int i = 0; i < z.rows(); i++)
+    {
+        z[i] = 0.3 * std::cos(i);
+    }
+
+    shooting->expand(z, true);
+    auto full = shooting->fullVector();
+    auto S = shooting->sensitivity();
+
+    // the control inputs and the slack variable are copied in the full vector
+    REQUIRE(shooting->reduce(full) == z);
+
+    // the rolled out states satisfy the multiple shooting equality constraints
+    auto c = conFunc->evaluateStateModelEq(full, false);
+    REQUIRE(c.value.cwiseAbs().maxCoeff() < 1e-9);
+
+    // forward sensitivities compared with finite differences
+    double h = 1e-6;
+    for (int i = 0; i < z.rows(); i++)
+    {
+        auto zp = z;
+        auto zm = z;
+        zp[i] += h;
+        zm[i] -= h;
+
+        shooting->expand(zp, false);
+        auto fp = shooting->fullVector();
+
+        shooting->expand(zm, false);
+        auto fm = shooting->fullVector();
+
+        REQUIRE(((fp - fm) / (2 * h) - S.col(i)).cwiseAbs().maxCoeff() < 1e-6);
+    }
+}
+
+TEST_CASE(
+    MPC_TEST_NAME("Checking single shooting rollout convergence"),
+    MPC_TEST_TAGS("[shooting]"))
+{
+    constexpr int Tnx = 1;
+    constexpr int Tnu = 1;
+    constexpr int Tph = 3;
+    constexpr int Tch = 3;
+    static constexpr auto sizer = mpc::MPCSize(TVAR(Tnx), TVAR(Tnu), TVAR(0), TVAR(0), TVAR(Tph), TVAR(Tch), TVAR(0), TVAR(0));
+
+    auto mapping = std::make_shared<mpc::Mapping<sizer>>();
+    mapping->initialize(Tnx, Tnu, 0, 0, Tph, Tch, 0, 0);
+
+    // the trapezoidal step of the quadratic growth has no solution for large states
+    auto model = std::make_shared<mpc::Model<sizer>>();
+    model->initialize(Tnx, Tnu, 0, 0, Tph, Tch, 0, 0);
+    model->setContinuous(true, 0.1);
+    model->setStateModel([](
+                             mpc::cvec<TVAR(Tnx)> &dx,
+                             const mpc::cvec<TVAR(Tnx)> &x,
+                             const mpc::cvec<TVAR(Tnu)> &u,
+                             const unsigned int &)
+                         { dx[0] = (x[0] * x[0]) + u[0]; });
+
+    auto shooting = std::make_shared<mpc::SingleShooting<sizer>>();
+    shooting->initialize(Tnx, Tnu, 0, 0, Tph, Tch, 0, 0);
+    shooting->setModel(model, mapping);
+
+    mpc::cvec<TVAR((Tnu * Tch) + 1)> z((Tnu * Tch) + 1);
+    z.setZero();
+
+    mpc::cvec<TVAR(Tnx)> x0(Tnx);
+    x0 << 0.1;
+    shooting->setCurrentState(x0);
+    shooting->expand(z, true);
+    REQUIRE(shooting->isConverged());
+
+    x0 << 10.0;
+    shooting->setCurrentState(x0);
+    shooting->expand(z, true);
+    REQUIRE_FALSE(shooting->isConverged());
+
+    // the flag follows the cached rollout
+    shooting->expand(z, false);
+    REQUIRE_FALSE(shooting->isConverged());
+
+    x0 << 0.1;
+    shooting->setCurrentState(x0);
+    shooting->expand(z, false);
+    REQUIRE(shooting->isConverged());
+}
+
+namespace
+{
+    using namespace nlmpc_fixture;
+
+    constexpr int Tineq = 0;
+    constexpr int Teq = 0;
+} // namespace
+
+TEST_CASE(
+    MPC_TEST_NAME("Single shooting formulation matches the converged SQP solution"),
+    MPC_TEST_TAGS("[shooting]"))
+{
+    mpc::NLParameters shooting_params;
+    shooting_params.formulation = mpc::NLFormulation::SINGLE_SHOOTING;
+    shooting_params.maximum_iteration = 1000;
+    shooting_params.relative_xtol = 1e-10;
+
+    mpc::NLParameters sqp_params;
+    sqp_params.backend = mpc::NLBackend::SQP;
+    sqp_params.sqp_iterations = 10;
+
+    auto shooting = buildController(shooting_params);
+    auto sqp = buildController(sqp_params);
+
+    mpc::cvec<TVAR(Tnx)> x(Tnx);
+    mpc::cvec<TVAR(Tnu)> u(Tnu);
+    u.setZero();
+
+    // the second initial condition saturates the input at the lower bound
+    std::vector<std::array<double, 2>> initial = {{0.5, 0.0}, {3.0, 1.0}};
+    for (auto &x0 : initial)
+    {
+        x << x0[0], x0[1];
+
+        auto r_shooting = shooting->optimize(x, u);
+        auto r_sqp = sqp->optimize(x, u);
+
+        REQUIRE(r_shooting.status == mpc::ResultStatus::SUCCESS);
+        REQUIRE(r_sqp.status == mpc::ResultStatus::SUCCESS);
+        REQUIRE((r_shooting.cmd - r_sqp.cmd).norm() < 1e-3);
+        REQUIRE(std::fabs(r_shooting.cost - r_sqp.cost) < 1e-3 * std::max(1.0, r_sqp.cost));
+
+        // the optimal sequence is consistent with the system's dynamics
+        auto seq = shooting->getOptimalSequence();
+        for (int i = 0; i < Tph; i++)
+        {
+            mpc::cvec<TVAR(Tnx)> xn(Tnx);
+            pendulum(xn, seq.state.row(i).transpose(), seq.input.row(i).transpose());
+            REQUIRE((xn - seq.state.row(i + 1).transpose()).norm() < 1e-9);
+        }
+    }
+}
+
+TEST_CASE(
+    MPC_TEST_NAME("NLopt algorithms selected by the parameters"),
+    MPC_TEST_TAGS("[shooting][algorithm]"))
+{
+    mpc::NLParameters reference_params;
+    reference_params.formulation = mpc::NLFormulation::SINGLE_SHOOTING;
+    reference_params.maximum_iteration = 5000;
+    reference_params.relative_ftol = 1e-12;
+    reference_params.relative_xtol = 1e-10;
+
+    auto reference = buildController(reference_params);
+
+    mpc::cvec<TVAR(Tnx)> x(Tnx);
+    mpc::cvec<TVAR(Tnu)> u(Tnu);
+    x << 0.5, 0.0;
+    u.setZero();
+
+    auto r_reference = reference->optimize(x, u);
+    REQUIRE(r_reference.status == mpc::ResultStatus::SUCCESS);
+
+    for (auto algorithm : {mpc::NLAlgorithm::MMA, mpc::NLAlgorithm::CCSAQ, mpc::NLAlgorithm::AUGLAG, mpc::NLAlgorithm::LBFGS})
+    {
+        // the single shooting problem has only the input bounds
+        mpc::NLParameters params = reference_params;
+        params.algorithm = algorithm;
+
+        auto shooting = buildController(params);
+        auto r = shooting->optimize(x, u);
+
+        REQUIRE(r.status != mpc::ResultStatus::ERROR);
+        REQUIRE((r.cmd - r_reference.cmd).norm() < 1e-2);
+
+        // the multiple shooting problem wraps the algorithm with the augmented lagrangian
+        params.formulation = mpc::NLFormulation::MULTIPLE_SHOOTING;
+        auto multiple = buildController(params);
+
+        // the algorithm can be changed after the callbacks have been bound
+        params.algorithm = mpc::NLAlgorithm::SLSQP;
+        params.maximum_iteration = 1000;
+        multiple->setOptimizerParameters(params);
+        params.algorithm = algorithm;
+        multiple->setOptimizerParameters(params);
+
+        r = multiple->optimize(x, u);
+        REQUIRE(r.cmd.allFinite());
+        REQUIRE(r.cmd(0) >= -2.0);
+        REQUIRE(r.cmd(0) <= 2.0);
+    }
+}
+
+TEST_CASE(
+    MPC_TEST_NAME("Time limit returns the best feasible iterate"),
+    MPC_TEST_TAGS("[shooting][deadline]"))
+{
+    mpc::NLParameters params;
+    params.formulation = mpc::NLFormulation::SINGLE_SHOOTING;
+    params.maximum_iteration = 1000000;
+    params.time_limit = 0.005;
+
+    auto shooting = buildController(params);
+
+    // slow down the model so that the solver cannot converge before the deadline
+    shooting->setStateSpaceFunction([](
+                                        mpc::cvec<TVAR(Tnx)> &xn,
+                                        const mpc::cvec<TVAR(Tnx)> &x,
+                                        const mpc::cvec<TVAR(Tnu)> &u,
+                                        const unsigned int &)
+                                    {
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+        pendulum(xn, x, u); });
+
+    mpc::cvec<TVAR(Tnx)> x(Tnx);
+    mpc::cvec<TVAR(Tnu)> u(Tnu);
+    x << 3.0, 1.0;
+    u.setZero();
+
+    auto r = shooting->optimize(x, u);
+
+    // the solver is stopped by the deadline and not by its stopping criteria
+    REQUIRE(r.status == mpc::ResultStatus::TIME_LIMIT);
+    REQUIRE((r.solver_status == nlopt::FORCED_STOP || r.solver_status == nlopt::MAXTIME_REACHED));
+    REQUIRE(r.is_feasible);
+    REQUIRE(std::isfinite(r.cost));
+    REQUIRE(r.cmd.allFinite());
+    REQUIRE(r.cmd(0) >= -2.0);
+    REQUIRE(r.cmd(0) <= 2.0);
+
+    // the returned cost is not larger than the cost of the initial guess
+    auto seq = shooting->getOptimalSequence();
+    double guess_cost = 0;
+    mpc::cvec<TVAR(Tnx)> xi = x;
+    for (int i = 0; i <= Tph; i++)
+    {
+        guess_cost += xi.squaredNorm();
+        mpc::cvec<TVAR(Tnx)> xn(Tnx);
+        pendulum(xn, xi, u);
+        xi = xn;
+    }
+    REQUIRE(r.cost <= guess_cost + 1e-9);
+    REQUIRE(seq.state.allFinite());
+}
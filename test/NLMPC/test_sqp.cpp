@@ -0,0 +1,534 @@
+/*
+ *   Copyright (c) 2023 Nicola Piccinelli
+ *   All rights reserved.
+ */
+#include "basic.hpp"
+#include <catch2/catch_test_macros.hpp>
+
+namespace
+{
+    using namespace nlmpc_fixture;
+
+    constexpr int Tineq = 0;
+    constexpr int Teq = 0;
+
+    mpc::NLParameters sqpParameters(
+        mpc::NLBackend backend,
+        mpc::NLScaling scaling = mpc::NLScaling::MANUAL)
+    {
+        mpc::NLParameters params;
+        params.backend = backend;
+        params.sqp_iterations = 1;
+        params.enable_warm_start = true;
+        params.scaling = scaling;
+        return params;
+    }
+} // namespace
+
+TEST_CASE(
+    MPC_TEST_NAME("SQP backend real-time iteration closed loop"),
+    MPC_TEST_TAGS("[sqp]"))
+{
+    auto optsolver = buildController(sqpParameters(mpc::NLBackend::SQP));
+
+    mpc::cvec<TVAR(Tnx)> x(Tnx), xn(Tnx);
+    x << 1.0, 0.0;
+
+    mpc::cvec<TVAR(Tnu)> u(Tnu);
+    u.setZero();
+
+    // the preparation phase needs a previous solution
+    REQUIRE_FALSE(optsolver->prepare());
+
+    for (int k = 0; k < 100; k++)
+    {
+        auto r = optsolver->optimize(x, u);
+
+        REQUIRE(r.status == mpc::ResultStatus::SUCCESS);
+        REQUIRE(r.cmd(0) <= 2.0 + 1e-4);
+        REQUIRE(r.cmd(0) >= -2.0 - 1e-4);
+
+        u = r.cmd;
+        pendulum(xn, x, u, false);
+        x = xn;
+
+        // linearize the next problem while "waiting" for the new measurement
+        REQUIRE(optsolver->prepare());
+    }
+
+    REQUIRE(x.norm() < 1e-2);
+}
+
+TEST_CASE(
+    MPC_TEST_NAME("SQP backend prepare and feedback phases"),
+    MPC_TEST_TAGS("[sqp]"))
+{
+    // with a linear model and a quadratic objective the sub-problem is exact,
+    // the solution must not depend on the linearization point
+    auto prepared = buildController(sqpParameters(mpc::NLBackend::SQP), true);
+    auto direct = buildController(sqpParameters(mpc::NLBackend::SQP), true);
+
+    mpc::cvec<TVAR(Tnx)> x(Tnx);
+    x << 1.0, 0.0;
+
+    mpc::cvec<TVAR(Tnu)> u(Tnu);
+    u.setZero();
+
+    auto r_prepared = prepared->optimize(x, u);
+    auto r_direct = direct->optimize(x, u);
+    REQUIRE((r_prepared.cmd - r_direct.cmd).norm() < 1e-3);
+
+    REQUIRE(prepared->prepare());
+
+    // the measured state differs from the predicted one
+    x << 0.8, 0.3;
+
+    r_prepared = prepared->optimize(x, r_prepared.cmd);
+    r_direct = direct->optimize(x, r_direct.cmd);
+
+    REQUIRE(r_prepared.status == mpc::ResultStatus::SUCCESS);
+    REQUIRE(r_direct.status == mpc::ResultStatus::SUCCESS);
+    REQUIRE((r_prepared.cmd - r_direct.cmd).norm() < 1e-3);
+
+    auto seq_prepared = prepared->getOptimalSequence();
+    auto seq_direct = direct->getOptimalSequence();
+    REQUIRE((seq_prepared.state - seq_direct.state).norm() < 1e-2);
+}
+
+TEST_CASE(
+    MPC_TEST_NAME("SQP preparation with NLopt backend"),
+    MPC_TEST_TAGS("[sqp]"))
+{
+    auto optsolver = buildController(sqpParameters(mpc::NLBackend::NLOPT));
+    REQUIRE_FALSE(optsolver->prepare());
+}
+
+TEST_CASE(
+    MPC_TEST_NAME("SQP backend with residual objective"),
+    MPC_TEST_TAGS("[sqp]"))
+{
+    // with a linear model and linear residuals the Gauss-Newton sub-problem is exact,
+    // a single iteration must reach the converged solution also when the residuals
+    // couple the states (not captured by a diagonal hessian approximation)
+    auto residual = [](
+                        mpc::cvec<> &r,
+                        const mpc::mat<TVAR(Tph + 1), TVAR(Tnx)> &x,
+                        const mpc::mat<TVAR(Tph + 1), TVAR(Tny)> &,
+                        const mpc::mat<TVAR(Tph + 1), TVAR(Tnu)> &u,
+                        const double &)
+    {
+        for (int i = 0; i < Tph + 1; i++)
+        {
+            r(i) = x(i, 0) + 0.5 * x(i, 1);
+            r(Tph + 1 + i) = x(i, 1);
+            r(2 * (Tph + 1) + i) = 0.3 * u(i, 0);
+        }
+    };
+
+    auto single = buildController(sqpParameters(mpc::NLBackend::SQP), true);
+    REQUIRE(single->setResidualFunction(residual, 3 * (Tph + 1)));
+
+    auto converged = buildController(sqpParameters(mpc::NLBackend::SQP), true);
+    REQUIRE(converged->setResidualFunction(residual, 3 * (Tph + 1)));
+
+    mpc::NLParameters params;
+    params.backend = mpc::NLBackend::SQP;
+    params.sqp_iterations = 10;
+    converged->setOptimizerParameters(params);
+
+    mpc::cvec<TVAR(Tnx)> x(Tnx);
+    x << 1.0, -0.5;
+
+    mpc::cvec<TVAR(Tnu)> u(Tnu);
+    u.setZero();
+
+    auto r_single = single->optimize(x, u);
+    auto r_converged = converged->optimize(x, u);
+
+    REQUIRE(r_single.status == mpc::ResultStatus::SUCCESS);
+    REQUIRE(r_converged.status == mpc::ResultStatus::SUCCESS);
+    REQUIRE((r_single.cmd - r_converged.cmd).norm() < 1e-4);
+    REQUIRE(std::fabs(r_single.cost - r_converged.cost) < 1e-4 * r_converged.cost);
+}
+
+TEST_CASE(
+    MPC_TEST_NAME("SQP backend persistent quasi-Newton hessian"),
+    MPC_TEST_TAGS("[sqp]"))
+{
+    // the objective couples position and velocity of each stage, this curvature
+    // is missed by the diagonal hessian approximation but it is recovered by the
+    // quasi-Newton blocks which are kept across the control steps
+    auto objective = [](
+                         const mpc::mat<TVAR(Tph + 1), TVAR(Tnx)> &x,
+                         const mpc::mat<TVAR(Tph + 1), TVAR(Tny)> &,
+                         const mpc::mat<TVAR(Tph + 1), TVAR(Tnu)> &u,
+                         const double &)
+    {
+        return (x.col(0) + x.col(1)).array().square().sum() +
+               x.array().square().sum() +
+               0.1 * u.array().square().sum();
+    };
+
+    auto closedLoop = [&](bool quasiNewton)
+    {
+        auto optsolver = buildController(sqpParameters(mpc::NLBackend::SQP));
+        optsolver->setObjectiveFunction(objective);
+
+        mpc::NLParameters params;
+        params.backend = mpc::NLBackend::SQP;
+        params.enable_warm_start = true;
+        params.sqp_iterations = 50;
+        params.sqp_step_tolerance = 1e-4;
+        params.sqp_qp_tolerance = 1e-9;
+        params.sqp_quasi_newton = quasiNewton;
+        optsolver->setOptimizerParameters(params);
+
+        mpc::cvec<TVAR(Tnx)> x(Tnx), xn(Tnx);
+        x << 1.0, 0.0;
+
+        mpc::cvec<TVAR(Tnu)> u(Tnu);
+        u.setZero();
+
+        int iterations = 0;
+        for (int k = 0; k < 100; k++)
+        {
+            auto r = optsolver->optimize(x, u);
+
+            REQUIRE(r.status == mpc::ResultStatus::SUCCESS);
+            REQUIRE(r.iterations >= 1);
+            REQUIRE(r.iterations <= params.sqp_iterations);
+
+            iterations += r.iterations;
+
+            u = r.cmd;
+            pendulum(xn, x, u, false);
+            x = xn;
+        }
+
+        REQUIRE(x.norm() < 1e-2);
+        return iterations;
+    };
+
+    int diagonal = closedLoop(false);
+    int quasiNewton = closedLoop(true);
+
+    REQUIRE(quasiNewton < diagonal);
+}
+
+TEST_CASE(
+    MPC_TEST_NAME("SQP backend with Broyden Jacobian updates"),
+    MPC_TEST_TAGS("[sqp]"))
+{
+    auto closedLoop = [](mpc::NLJacobianUpdate update, int &evaluations)
+    {
+        auto optsolver = buildController(sqpParameters(mpc::NLBackend::SQP));
+        optsolver->setStateSpaceFunction([&](
+                                             mpc::cvec<TVAR(Tnx)> &xn,
+                                             const mpc::cvec<TVAR(Tnx)> &x,
+                                             const mpc::cvec<TVAR(Tnu)> &u,
+                                             const unsigned int &)
+                                         {
+                                             evaluations++;
+                                             pendulum(xn, x, u, false); });
+
+        mpc::NLParameters params;
+        params.backend = mpc::NLBackend::SQP;
+        params.enable_warm_start = true;
+        params.jacobian_update = update;
+        optsolver->setOptimizerParameters(params);
+
+        mpc::cvec<TVAR(Tnx)> x(Tnx), xn(Tnx);
+        x << 1.0, 0.0;
+
+        mpc::cvec<TVAR(Tnu)> u(Tnu);
+        u.setZero();
+
+        for (int k = 0; k < 100; k++)
+        {
+            auto r = optsolver->optimize(x, u);
+            REQUIRE(r.status == mpc::ResultStatus::SUCCESS);
+
+            u = r.cmd;
+            pendulum(xn, x, u, false);
+            x = xn;
+        }
+
+        return x;
+    };
+
+    int fdEvaluations = 0;
+    int broydenEvaluations = 0;
+
+    auto xfd = closedLoop(mpc::NLJacobianUpdate::FINITE_DIFFERENCE, fdEvaluations);
+    auto xbroyden = closedLoop(mpc::NLJacobianUpdate::BROYDEN, broydenEvaluations);
+
+    REQUIRE(xfd.norm() < 1e-2);
+    REQUIRE(xbroyden.norm() < 1e-2);
+    REQUIRE(broydenEvaluations < fdEvaluations / 2);
+}
+
+TEST_CASE(
+    MPC_TEST_NAME("LTV backend linearized along the rollout of the last inputs"),
+    MPC_TEST_TAGS("[sqp][ltv]"))
+{
+    mpc::NLParameters ltv_params;
+    ltv_params.backend = mpc::NLBackend::LTV;
+    ltv_params.enable_warm_start = true;
+    // the number of iterations is ignored in the linear time-varying mode
+    ltv_params.sqp_iterations = 10;
+
+    mpc::NLParameters sqp_params;
+    sqp_params.backend = mpc::NLBackend::SQP;
+    sqp_params.enable_warm_start = true;
+    sqp_params.sqp_iterations = 10;
+
+    // with a linear model the single sub-problem is exact
+    auto ltv = buildController(sqpParameters(mpc::NLBackend::LTV), true);
+    auto converged = buildController(sqpParameters(mpc::NLBackend::SQP), true);
+    ltv->setOptimizerParameters(ltv_params);
+    converged->setOptimizerParameters(sqp_params);
+
+    mpc::cvec<TVAR(Tnx)> x(Tnx), xn(Tnx);
+    x << 1.0, -0.5;
+
+    mpc::cvec<TVAR(Tnu)> u(Tnu);
+    u.setZero();
+
+    auto r_ltv = ltv->optimize(x, u);
+    auto r_converged = converged->optimize(x, u);
+
+    REQUIRE(r_ltv.status == mpc::ResultStatus::SUCCESS);
+    REQUIRE(r_ltv.iterations == 1);
+    REQUIRE((r_ltv.cmd - r_converged.cmd).norm() < 1e-3);
+
+    // mildly non-linear plant, the closed loop follows the converged solution
+    ltv = buildController(sqpParameters(mpc::NLBackend::LTV));
+    converged = buildController(sqpParameters(mpc::NLBackend::SQP));
+    ltv->setOptimizerParameters(ltv_params);
+    converged->setOptimizerParameters(sqp_params);
+
+    x << 0.3, 0.0;
+    u.setZero();
+
+    for (int k = 0; k < 100; k++)
+    {
+        r_ltv = ltv->optimize(x, u);
+        r_converged = converged->optimize(x, u);
+
+        REQUIRE(r_ltv.status == mpc::ResultStatus::SUCCESS);
+        REQUIRE(r_ltv.iterations == 1);
+        REQUIRE((r_ltv.cmd - r_converged.cmd).norm() < 1e-2);
+
+        // the predicted states are linearized around a trajectory consistent
+        // with the system's dynamics, so the prediction error is of second order
+        auto seq = ltv->getOptimalSequence();
+        for (int i = 0; i < Tph; i++)
+        {
+            pendulum(xn, seq.state.row(i).transpose(), seq.input.row(i).transpose(), false);
+            REQUIRE((xn - seq.state.row(i + 1).transpose()).norm() < 1e-3);
+        }
+
+        u = r_ltv.cmd;
+        pendulum(xn, x, u, false);
+        x = xn;
+    }
+
+    REQUIRE(x.norm() < 1e-2);
+}
+
+TEST_CASE(
+    MPC_TEST_NAME("SQP backend with a statically dispatched model"),
+    MPC_TEST_TAGS("[sqp]"))
+{
+    auto handle = buildController(sqpParameters(mpc::NLBackend::SQP));
+    auto dispatched = buildController(sqpParameters(mpc::NLBackend::SQP));
+
+    // replace the std::function model with the same model as a static callable
+    REQUIRE(dispatched->setStaticStateSpaceFunction([](
+                                                        mpc::cvec<TVAR(Tnx)> &xn,
+                                                        const mpc::cvec<TVAR(Tnx)> &x,
+                                                        const mpc::cvec<TVAR(Tnu)> &u,
+                                                        const unsigned int &)
+                                                    { pendulum(xn, x, u, false); }));
+
+    mpc::cvec<TVAR(Tnx)> x(Tnx), xn(Tnx);
+    x << 1.0, 0.0;
+
+    mpc::cvec<TVAR(Tnu)> u(Tnu);
+    u.setZero();
+
+    for (int k = 0; k < 20; k++)
+    {
+        auto r_handle = handle->optimize(x, u);
+        auto r_dispatched = dispatched->optimize(x, u);
+
+        REQUIRE(r_dispatched.status == mpc::ResultStatus::SUCCESS);
+        REQUIRE((r_handle.cmd - r_dispatched.cmd).norm() < 1e-9);
+
+        u = r_handle.cmd;
+        pendulum(xn, x, u, false);
+        x = xn;
+    }
+}
+
+TEST_CASE(
+    MPC_TEST_NAME("SQP backend with automatic scaling"),
+    MPC_TEST_TAGS("[sqp]"))
+{
+    // with a linear model and a quadratic objective the sub-problem is exact,
+    // the solution must not depend on the scaling of the optimization vector
+    auto manual = buildController(sqpParameters(mpc::NLBackend::SQP), true);
+    auto bounds = buildController(sqpParameters(mpc::NLBackend::SQP, mpc::NLScaling::BOUNDS), true);
+    auto trajectory = buildController(sqpParameters(mpc::NLBackend::SQP, mpc::NLScaling::TRAJECTORY), true);
+
+    mpc::cvec<TVAR(Tnx)> xmin(Tnx), xmax(Tnx);
+    xmin << -4.0, -4.0;
+    xmax << 4.0, 4.0;
+    for (auto &optsolver : {manual, bounds, trajectory})
+    {
+        optsolver->setStateBounds(xmin, xmax, mpc::HorizonSlice::all());
+    }
+
+    mpc::cvec<TVAR(Tnx)> x(Tnx), xn(Tnx);
+    x << 1.0, 0.0;
+
+    mpc::cvec<TVAR(Tnu)> u(Tnu);
+    u.setZero();
+
+    for (int k = 0; k < 20; k++)
+    {
+        auto r_manual = manual->optimize(x, u);
+        auto r_bounds = bounds->optimize(x, u);
+        auto r_trajectory = trajectory->optimize(x, u);
+
+        REQUIRE(r_bounds.status == mpc::ResultStatus::SUCCESS);
+        REQUIRE(r_trajectory.status == mpc::ResultStatus::SUCCESS);
+        REQUIRE((r_manual.cmd - r_bounds.cmd).norm() < 1e-3);
+        REQUIRE((r_manual.cmd - r_trajectory.cmd).norm() < 1e-3);
+
+        // the predicted sequences are returned in the system's units
+        REQUIRE((manual->getOptimalSequence().state - trajectory->getOptimalSequence().state).norm() < 1e-2);
+        REQUIRE((manual->getOptimalSequence().state.row(0).transpose() - x).norm() < 1e-12);
+        REQUIRE((trajectory->getOptimalSequence().state.row(0).transpose() - x).norm() < 1e-12);
+
+        u = r_manual.cmd;
+        pendulum(xn, x, u, true);
+        x = xn;
+    }
+}
+
+TEST_CASE(
+    MPC_TEST_NAME("SQP backend with a changing scaling and warm start"),
+    MPC_TEST_TAGS("[sqp]"))
+{
+    static constexpr int Tcon = Tph + 1;
+
+    // the trajectory scaling changes while the state converges, the quasi-Newton hessian,
+    // the multipliers and the Broyden Jacobian matrices of the previous solves must not
+    // be reused in the old units
+    auto build = [](mpc::NLScaling scaling, mpc::NLJacobianUpdate update)
+    {
+        auto optsolver = makeController<Tcon, Teq>();
+        setPendulumModel(optsolver, true);
+        setQuadraticObjective(optsolver);
+
+        optsolver->setIneqConFunction([](
+                                          mpc::cvec<TVAR(Tcon)> &in_con,
+                                          const mpc::mat<TVAR(Tph + 1), TVAR(Tnx)> &,
+                                          const mpc::mat<TVAR(Tph + 1), TVAR(Tny)> &,
+                                          const mpc::mat<TVAR(Tph + 1), TVAR(Tnu)> &u,
+                                          const double &)
+                                      {
+            for (int i = 0; i < Tcon; i++) {
+                in_con(i) = -u(i, 0) - 0.5;
+            } },
+                                      1e-6);
+
+        mpc::cvec<TVAR(Tnx)> xmin(Tnx), xmax(Tnx);
+        xmin << -4.0, -4.0;
+        xmax << 4.0, 4.0;
+        optsolver->setStateBounds(xmin, xmax, mpc::HorizonSlice::all());
+        setSymmetricInputBounds(optsolver, 2.0);
+
+        auto params = sqpParameters(mpc::NLBackend::SQP, scaling);
+        params.jacobian_update = update;
+        // the Jacobian matrices are never refreshed by the Broyden update itself
+        params.jacobian_refresh_iterations = 1000;
+        params.jacobian_refresh_step = 1e6;
+        optsolver->setOptimizerParameters(params);
+
+        return optsolver;
+    };
+
+    auto manual = build(mpc::NLScaling::MANUAL, mpc::NLJacobianUpdate::FINITE_DIFFERENCE);
+    auto trajectory = build(mpc::NLScaling::TRAJECTORY, mpc::NLJacobianUpdate::BROYDEN);
+
+    mpc::cvec<TVAR(Tnx)> x(Tnx), xn(Tnx);
+    x << 1.0, 0.0;
+
+    mpc::cvec<TVAR(Tnu)> u(Tnu);
+    u.setZero();
+
+    for (int k = 0; k < 20; k++)
+    {
+        auto r_manual = manual->optimize(x, u);
+        auto r_trajectory = trajectory->optimize(x, u);
+
+        REQUIRE(r_manual.status == mpc::ResultStatus::SUCCESS);
+        REQUIRE(r_trajectory.status == mpc::ResultStatus::SUCCESS);
+        REQUIRE((r_manual.cmd - r_trajectory.cmd).norm() < 1e-3);
+        REQUIRE(r_trajectory.cmd(0) >= -0.5 - 1e-4);
+
+        u = r_manual.cmd;
+        pendulum(xn, x, u, true);
+        x = xn;
+    }
+}
+
+TEST_CASE(
+    MPC_TEST_NAME("SQP backend with input basis functions"),
+    MPC_TEST_TAGS("[sqp]"))
+{
+    std::vector<mpc::NLInputBasis> bases = {
+        mpc::NLInputBasis::LAGUERRE,
+        mpc::NLInputBasis::CHEBYSHEV,
+        mpc::NLInputBasis::BSPLINE};
+
+    for (auto basis : bases)
+    {
+        auto optsolver = buildController(sqpParameters(mpc::NLBackend::SQP));
+
+        mpc::NLParameters params;
+        params.backend = mpc::NLBackend::SQP;
+        params.sqp_iterations = 1;
+        params.enable_warm_start = true;
+        params.input_basis = basis;
+        params.spline_degree = 2;
+        optsolver->setOptimizerParameters(params);
+
+        mpc::cvec<TVAR(Tnx)> x(Tnx), xn(Tnx);
+        x << 1.0, 0.0;
+
+        mpc::cvec<TVAR(Tnu)> u(Tnu);
+        u.setZero();
+
+        for (int k = 0; k < 100; k++)
+        {
+            auto r = optsolver->optimize(x, u);
+            REQUIRE(r.status == mpc::ResultStatus::SUCCESS);
+
+            // the splines lie in the convex hull of their coefficients
+            if (basis == mpc::NLInputBasis::BSPLINE)
+            {
+                REQUIRE(optsolver->getOptimalSequence().input.maxCoeff() <= 2.0 + 1e-4);
+                REQUIRE(optsolver->getOptimalSequence().input.minCoeff() >= -2.0 - 1e-4);
+            }
+
+            u = r.cmd;
+            pendulum(xn, x, u, false);
+            x = xn;
+        }
+
+        REQUIRE(x.norm() < 1e-2);
+    }
+}
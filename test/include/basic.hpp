@@ -28,4 +28,102 @@ constexpr int TVAR(int v)
 }
 
 #define MPC_TEST_NAME(name) MPC_DYNAMIC_TEST_NAME name
-#define MPC_TEST_TAGS(tags) MPC_DYNAMIC_TEST_TAGS tags
\ No newline at end of file
+#define MPC_TEST_TAGS(tags) MPC_DYNAMIC_TEST_TAGS tags
+
+/**
+ * @brief Controller of the non-linear mpc shared by the tests of the backends and of the
+ * formulations, with the damped pendulum model and a quadratic objective. The constraints
+ * and the other models are set by each test
+ */
+namespace nlmpc_fixture
+{
+    constexpr int Tnx = 2;
+    constexpr int Tnu = 1;
+    constexpr int Tny = 2;
+    constexpr int Tph = 10;
+    constexpr int Tch = 5;
+
+    constexpr double ts = 0.1;
+
+#ifdef MPC_DYNAMIC
+    template <int Tineq, int Teq>
+    using Controller = mpc::NLMPC<>;
+#else
+    template <int Tineq, int Teq>
+    using Controller = mpc::NLMPC<Tnx, Tnu, Tny, Tph, Tch, Tineq, Teq>;
+#endif
+
+    /**
+     * @brief Discretized damped pendulum, the linear flag replaces sin(x) with x in the gravity term
+     */
+    inline void pendulum(
+        mpc::cvec<TVAR(Tnx)> &xn,
+        const mpc::cvec<TVAR(Tnx)> &x,
+        const mpc::cvec<TVAR(Tnu)> &u,
+        bool linear = false)
+    {
+        double f = linear ? -x(0) : -std::sin(x(0));
+        xn(0) = x(0) + ts * x(1);
+        xn(1) = x(1) + ts * (f - 0.1 * x(1) + u(0));
+    }
+
+    /**
+     * @brief Create a controller without the system's dynamics and the objective function
+     */
+    template <int Tineq = 0, int Teq = 0>
+    std::shared_ptr<Controller<Tineq, Teq>> makeController()
+    {
+#ifdef MPC_DYNAMIC
+        auto optsolver = std::make_shared<Controller<Tineq, Teq>>(Tnx, Tnu, Tny, Tph, Tch, Tineq, Teq);
+#else
+        auto optsolver = std::make_shared<Controller<Tineq, Teq>>();
+#endif
+        optsolver->setLoggerLevel(mpc::Logger::log_level::NONE);
+        return optsolver;
+    }
+
+    template <typename TController>
+    void setPendulumModel(const std::shared_ptr<TController> &optsolver, bool linear = false)
+    {
+        optsolver->setStateSpaceFunction([=](
+                                             mpc::cvec<TVAR(Tnx)> &xn,
+                                             const mpc::cvec<TVAR(Tnx)> &x,
+                                             const mpc::cvec<TVAR(Tnu)> &u,
+                                             const unsigned int &)
+                                         { pendulum(xn, x, u, linear); });
+    }
+
+    template <typename TController>
+    void setQuadraticObjective(const std::shared_ptr<TController> &optsolver)
+    {
+        optsolver->setObjectiveFunction([](
+                                            const mpc::mat<TVAR(Tph + 1), TVAR(Tnx)> &x,
+                                            const mpc::mat<TVAR(Tph + 1), TVAR(Tny)> &,
+                                            const mpc::mat<TVAR(Tph + 1), TVAR(Tnu)> &u,
+                                            const double &)
+                                        { return x.array().square().sum() + 0.1 * u.array().square().sum(); });
+    }
+
+    template <typename TController>
+    void setSymmetricInputBounds(const std::shared_ptr<TController> &optsolver, double bound)
+    {
+        mpc::cvec<TVAR(Tnu)> umin(Tnu), umax(Tnu);
+        umin << -bound;
+        umax << bound;
+        optsolver->setInputBounds(umin, umax, mpc::HorizonSlice::all());
+    }
+
+    /**
+     * @brief Create the pendulum controller with the quadratic objective and the inputs in [-2, 2]
+     */
+    template <int Tineq = 0, int Teq = 0>
+    std::shared_ptr<Controller<Tineq, Teq>> buildController(const mpc::NLParameters &params, bool linear = false)
+    {
+        auto optsolver = makeController<Tineq, Teq>();
+        setPendulumModel(optsolver, linear);
+        setQuadraticObjective(optsolver);
+        setSymmetricInputBounds(optsolver, 2.0);
+        optsolver->setOptimizerParameters(params);
+        return optsolver;
+    }
+} // namespace nlmpc_fixture
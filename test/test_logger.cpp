@@ -118,4 +118,35 @@ TEST_CASE("Logger reset function", "[Logger]")
 
         REQUIRE(oss.str().empty());
     }
-}
\ No newline at end of file
+}
+
+TEST_CASE("Logger mutes the messages of a thread", "[Logger]")
+{
+    // Set up the logger
+    mpc::Logger &logger = mpc::Logger::instance();
+    std::ostringstream oss;
+    logger.setStream(&oss);
+    logger.setPrefix("");
+    logger.setLevel(mpc::Logger::log_level::DEEP);
+
+    // the type of the message of the muted thread does not affect the caller
+    logger.log(mpc::Logger::log_type::INFO) << "Caller ";
+
+    std::thread worker([&logger]()
+                       {
+        mpc::Logger::ThreadMute mute;
+        logger.log(mpc::Logger::log_type::ERROR) << "Worker message"; });
+    worker.join();
+
+    logger << "message";
+
+    {
+        mpc::Logger::ThreadMute mute;
+        logger.log(mpc::Logger::log_type::INFO) << "Muted message";
+    }
+
+    REQUIRE(oss.str() == "[MPC++] Caller message");
+
+    logger.reset();
+    logger.setStream(&std::cout);
+}
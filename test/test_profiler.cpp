@@ -39,6 +39,7 @@ TEST_CASE("SolutionStats", "[SolutionStats]")
         REQUIRE(mpc::SolutionStats::resultStatusToString(mpc::ResultStatus::INFEASIBLE) == "INFEASIBLE");
         REQUIRE(mpc::SolutionStats::resultStatusToString(mpc::ResultStatus::ERROR) == "ERROR");
         REQUIRE(mpc::SolutionStats::resultStatusToString(mpc::ResultStatus::UNKNOWN) == "UNKNOWN");
+        REQUIRE(mpc::SolutionStats::resultStatusToString(mpc::ResultStatus::TIME_LIMIT) == "TIME_LIMIT");
         REQUIRE(mpc::SolutionStats::resultStatusToString(static_cast<mpc::ResultStatus>(99)) == "INVALID");
     }
 }
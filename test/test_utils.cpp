@@ -4,6 +4,7 @@
  */
 #include "basic.hpp"
 #include <mpc/Utils.hpp>
+#include <mpc/Integrator.hpp>
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/catch_template_test_macros.hpp>
 
@@ -60,4 +61,26 @@ TEST_CASE("Checking LTI system discretization", "[utils]")
 
     REQUIRE(Ad_test.isApprox(Ad));
     REQUIRE(Bd_test.isApprox(Bd));
-}
\ No newline at end of file
+}
+
+TEST_CASE("Checking RK4 integration", "[utils]")
+{
+    // the integrator is included together with the non-linear mpc headers, the
+    // enumerators of the non-linear mpc must not collide with the class template
+    mpc::RK4<2> rk4([](double, const mpc::cvec<2> &x)
+                    {
+                        mpc::cvec<2> dx;
+                        dx << x(1), -x(0);
+                        return dx; });
+
+    mpc::cvec<2> x0;
+    x0 << 1, 0;
+
+    mpc::cvec<2> x1 = rk4.run(0, x0, 0.01, 100);
+
+    mpc::cvec<2> x1_test;
+    x1_test << std::cos(1.0), -std::sin(1.0);
+
+    REQUIRE((x1 - x1_test).norm() < 1e-8);
+    REQUIRE(mpc::NLParameters().integrator == mpc::NLIntegrator::TRAPEZOIDAL);
+}